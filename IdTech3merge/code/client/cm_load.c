@@ -54,6 +54,7 @@ void SetPlaneSignbits (cplane_t *out) {
 clipMap_t	cm;
 int			c_pointcontents;
 int			c_traces, c_brush_traces, c_patch_traces;
+int			c_trace_cached, c_brush_culls, c_trace_usec;
 
 
 byte		*cmod_base;
@@ -62,6 +63,7 @@ byte		*cmod_base;
 cvar_t		*cm_noAreas;
 cvar_t		*cm_noCurves;
 cvar_t		*cm_playerCurveClip;
+cvar_t		*cm_traceCache;
 #endif
 
 cmodel_t	box_model;
@@ -372,6 +374,45 @@ void CMod_LoadLeafBrushes (lump_t *l)
 	}
 }
 
+/*
+=================
+CM_BoundLeafBrush
+=================
+*/
+static void CM_BoundLeafBrush( int leafBrush ) {
+	cbrush_t			*b;
+	cLeafBrushBounds_t	*out;
+	int					i;
+
+	b = &cm.brushes[ cm.leafbrushes[leafBrush] ];
+	out = &cm.leafbrushBounds[leafBrush];
+	for ( i = 0 ; i < 3 ; i++ ) {
+		out->bounds[0][i] = b->bounds[0][i] - BRUSH_BOUNDS_EPSILON;
+		out->bounds[1][i] = b->bounds[1][i] + BRUSH_BOUNDS_EPSILON;
+	}
+	out->contents = b->contents;
+}
+
+/*
+=================
+CMod_LoadLeafBrushBounds
+
+Must be called after the brushes and leafbrushes are loaded
+=================
+*/
+void CMod_LoadLeafBrushBounds( void ) {
+	int			i;
+
+	cm.leafbrushBounds = Hunk_Alloc( ( cm.numLeafBrushes + BOX_BRUSHES ) * sizeof( *cm.leafbrushBounds ), h_high );
+
+	for ( i = 0 ; i < cm.numLeafBrushes ; i++ ) {
+		if ( (unsigned)cm.leafbrushes[i] >= (unsigned)cm.numBrushes ) {
+			Com_Error( ERR_DROP, "CMod_LoadLeafBrushBounds: bad brush number %i", cm.leafbrushes[i] );
+		}
+		CM_BoundLeafBrush( i );
+	}
+}
+
 /*
 =================
 CMod_LoadLeafSurfaces
@@ -581,6 +622,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	cm_noAreas = Cvar_Get ("cm_noAreas", "0", CVAR_CHEAT);
 	cm_noCurves = Cvar_Get ("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get ("cm_playerCurveClip", "1", CVAR_ARCHIVE|CVAR_CHEAT );
+	cm_traceCache = Cvar_Get ("cm_traceCache", "1", 0 );
 #endif
 	Com_DPrintf( "CM_LoadMap( %s, %i )\n", name, clientload );
 
@@ -592,6 +634,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	// free old stuff
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
+	CM_ClearTraceCache();
 
 	if ( !name[0] ) {
 		cm.numLeafs = 1;
@@ -638,6 +681,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	CMod_LoadPlanes (&header.lumps[LUMP_PLANES]);
 	CMod_LoadBrushSides (&header.lumps[LUMP_BRUSHSIDES]);
 	CMod_LoadBrushes (&header.lumps[LUMP_BRUSHES]);
+	CMod_LoadLeafBrushBounds ();
 	CMod_LoadSubmodels (&header.lumps[LUMP_MODELS]);
 	CMod_LoadNodes (&header.lumps[LUMP_NODES]);
 	CMod_LoadEntityString (&header.lumps[LUMP_ENTITIES]);
@@ -665,6 +709,7 @@ CM_ClearMap
 void CM_ClearMap( void ) {
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
+	CM_ClearTraceCache();
 }
 
 /*
@@ -819,6 +864,7 @@ clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule
 
 	VectorCopy( mins, box_brush->bounds[0] );
 	VectorCopy( maxs, box_brush->bounds[1] );
+	CM_BoundLeafBrush( box_model.leaf.firstLeafBrush );
 
 	return BOX_MODEL_HANDLE;
 }
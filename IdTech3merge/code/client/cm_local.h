@@ -65,6 +65,15 @@ typedef struct {
 	int			checkcount;		// to avoid repeated testings
 } cbrush_t;
 
+// brush bounds copied out in leafbrushes order, so the trace broadphase
+// can reject brushes without touching the brush itself
+typedef struct {
+	vec3_t		bounds[2];		// expanded by BRUSH_BOUNDS_EPSILON
+	int			contents;
+} cLeafBrushBounds_t;
+
+#define	BRUSH_BOUNDS_EPSILON	1
+
 
 typedef struct {
 	int			checkcount;				// to avoid repeated testings
@@ -99,6 +108,7 @@ typedef struct {
 
 	int			numLeafBrushes;
 	int			*leafbrushes;
+	cLeafBrushBounds_t	*leafbrushBounds;	// [numLeafBrushes + BOX_BRUSHES]
 
 	int			numLeafSurfaces;
 	int			*leafsurfaces;
@@ -136,9 +146,11 @@ typedef struct {
 extern	clipMap_t	cm;
 extern	int			c_pointcontents;
 extern	int			c_traces, c_brush_traces, c_patch_traces;
+extern	int			c_trace_cached, c_brush_culls, c_trace_usec;
 extern	cvar_t		*cm_noAreas;
 extern	cvar_t		*cm_noCurves;
 extern	cvar_t		*cm_playerCurveClip;
+extern	cvar_t		*cm_traceCache;
 
 // cm_test.c
 
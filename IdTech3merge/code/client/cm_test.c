@@ -48,12 +48,19 @@ int CM_PointLeafnum_r( const vec3_t p, int num ) {
 			num = node->children[0];
 	}
 
-	c_pointcontents++;		// optimize counter
-
 	return -1 - num;
 }
 
 int CM_PointLeafnum( const vec3_t p ) {
+	if ( !cm.numNodes ) {	// map not loaded
+		return 0;
+	}
+	c_pointcontents++;		// optimize counter
+	return CM_PointLeafnum_r (p, 0);
+}
+
+// same as CM_PointLeafnum without touching the counter, for job threads
+int CM_PointLeafnumThreaded( const vec3_t p ) {
 	if ( !cm.numNodes ) {	// map not loaded
 		return 0;
 	}
@@ -241,6 +248,7 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 		clipm = CM_ClipHandleToModel( model );
 		leaf = &clipm->leaf;
 	} else {
+		c_pointcontents++;		// optimize counter
 		leafnum = CM_PointLeafnum_r (p, 0);
 		leaf = &cm.leafs[leafnum];
 	}
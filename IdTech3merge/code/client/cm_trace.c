@@ -154,6 +154,35 @@ POSITION TESTING
 ===============================================================================
 */
 
+/*
+================
+CM_LeafBrushTouchesTrace
+
+Broadphase reject against the packed leaf brush bounds.  This is always
+looser than the axial planes of the brush, so anything rejected here
+could not have been hit.  Nothing is written, so a rejected brush is not
+marked with the checkcount and is simply rejected again in the next leaf.
+================
+*/
+static ID_INLINE qboolean CM_LeafBrushTouchesTrace( const traceWork_t *tw, int leafBrush ) {
+	const cLeafBrushBounds_t	*lb;
+
+	lb = &cm.leafbrushBounds[leafBrush];
+	if ( !( lb->contents & tw->contents ) ) {
+		return qfalse;
+	}
+	if ( tw->bounds[0][0] > lb->bounds[1][0]
+		|| tw->bounds[0][1] > lb->bounds[1][1]
+		|| tw->bounds[0][2] > lb->bounds[1][2]
+		|| tw->bounds[1][0] < lb->bounds[0][0]
+		|| tw->bounds[1][1] < lb->bounds[0][1]
+		|| tw->bounds[1][2] < lb->bounds[0][2] ) {
+		c_brush_culls++;
+		return qfalse;
+	}
+	return qtrue;
+}
+
 /*
 ================
 CM_TestBoxInBrush
@@ -248,6 +277,9 @@ void CM_TestInLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 
 	// test box position against all brushes in the leaf
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
+		if ( !CM_LeafBrushTouchesTrace( tw, leaf->firstLeafBrush+k ) ) {
+			continue;
+		}
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 		b = &cm.brushes[brushnum];
 		if (b->checkcount == cm.checkcount) {
@@ -671,6 +703,9 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 
 	// trace line against all brushes in the leaf
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
+		if ( !CM_LeafBrushTouchesTrace( tw, leaf->firstLeafBrush+k ) ) {
+			continue;
+		}
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 
 		b = &cm.brushes[brushnum];
@@ -972,6 +1007,40 @@ void CM_TraceCapsuleThroughCapsule( traceWork_t *tw, clipHandle_t model ) {
 	CM_TraceThroughSphere(tw, bottom, radius, starttop, endtop);
 }
 
+/*
+==================
+CM_CalcTraceBounds
+
+Enclosing box of the swept volume, used by the brush rejects
+==================
+*/
+static void CM_CalcTraceBounds( traceWork_t *tw ) {
+	int		i;
+
+	if ( tw->sphere.use ) {
+		for ( i = 0 ; i < 3 ; i++ ) {
+			if ( tw->start[i] < tw->end[i] ) {
+				tw->bounds[0][i] = tw->start[i] - fabs(tw->sphere.offset[i]) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->end[i] + fabs(tw->sphere.offset[i]) + tw->sphere.radius;
+			} else {
+				tw->bounds[0][i] = tw->end[i] - fabs(tw->sphere.offset[i]) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->start[i] + fabs(tw->sphere.offset[i]) + tw->sphere.radius;
+			}
+		}
+	}
+	else {
+		for ( i = 0 ; i < 3 ; i++ ) {
+			if ( tw->start[i] < tw->end[i] ) {
+				tw->bounds[0][i] = tw->start[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->end[i] + tw->size[1][i];
+			} else {
+				tw->bounds[0][i] = tw->end[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->start[i] + tw->size[1][i];
+			}
+		}
+	}
+}
+
 /*
 ================
 CM_TraceBoundingBoxThroughCapsule
@@ -1002,6 +1071,8 @@ void CM_TraceBoundingBoxThroughCapsule( traceWork_t *tw, clipHandle_t model ) {
 	tw->sphere.radius = ( size[1][0] > size[1][2] ) ? size[1][2]: size[1][0];
 	tw->sphere.halfheight = size[1][2];
 	VectorSet( tw->sphere.offset, 0, 0, size[1][2] - tw->sphere.radius );
+	// the swept volume is the capsule now
+	CM_CalcTraceBounds( tw );
 
 	// replace the capsule with the bounding box
 	h = CM_TempBoxModel(tw->size[0], tw->size[1], qfalse);
@@ -1141,12 +1212,87 @@ void CM_TraceThroughTree( traceWork_t *tw, int num, float p1f, float p2f, vec3_t
 //======================================================================
 
 
+/*
+===============================================================================
+
+TRACE CACHE
+
+Movement prediction, bots and hitscan repeat the same traces many times in
+a frame.  The result only depends on the arguments and the map, so recent
+results are kept in a small direct mapped table that is emptied every
+frame.  The temporary box model changes between calls and is never cached.
+
+The table, like cm.checkcount, is shared and unlocked, so traces must only
+be run from one thread at a time.  Nothing traces off the main thread: the
+server snapshot jobs only test points and the botlib threads only route.
+
+===============================================================================
+*/
+
+#define	TRACE_CACHE_SIZE	256		// must be a power of two
+
+typedef struct {
+	vec3_t			start, end;
+	vec3_t			mins, maxs;
+	vec3_t			origin;
+	sphere_t		sphere;
+	qboolean		hasSphere;
+	clipHandle_t	model;
+	int				brushmask;
+	int				capsule;
+	int				noCurves;
+	int				playerCurveClip;
+} traceKey_t;
+
+typedef struct {
+	int				frame;
+	traceKey_t		key;
+	trace_t			trace;
+} traceCacheEntry_t;
+
+static traceCacheEntry_t	traceCache[TRACE_CACHE_SIZE];
+static int					traceCacheFrame = 1;
+
 /*
 ==================
-CM_Trace
+CM_ClearTraceCache
 ==================
 */
-void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs,
+void CM_ClearTraceCache( void ) {
+	traceCacheFrame++;
+}
+
+/*
+==================
+CM_TraceCacheEntry
+
+Returns the slot for the key, the caller checks the frame to see if it
+holds a valid result
+==================
+*/
+static traceCacheEntry_t *CM_TraceCacheEntry( const traceKey_t *key ) {
+	const unsigned	*p;
+	unsigned		hash;
+	int				i;
+
+	p = (const unsigned *)key;
+	hash = 2166136261u;
+	for ( i = 0 ; i < sizeof( *key ) / sizeof( *p ) ; i++ ) {
+		hash = ( hash ^ p[i] ) * 16777619u;
+	}
+	hash ^= hash >> 16;
+	return &traceCache[ hash & ( TRACE_CACHE_SIZE - 1 ) ];
+}
+
+//======================================================================
+
+
+/*
+==================
+CM_TraceWork
+==================
+*/
+static void CM_TraceWork( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs,
 						  clipHandle_t model, const vec3_t origin, int brushmask, int capsule, sphere_t *sphere ) {
 	int			i;
 	traceWork_t	tw;
@@ -1157,8 +1303,6 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 
 	cm.checkcount++;		// for multi-check avoidance
 
-	c_traces++;				// for statistics, may be zeroed
-
 	// fill in a default trace
 	Com_Memset( &tw, 0, sizeof(tw) );
 	tw.trace.fraction = 1;	// assume it goes the entire distance until shown otherwise
@@ -1241,28 +1385,7 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 	//
 	// calculate bounds
 	//
-	if ( tw.sphere.use ) {
-		for ( i = 0 ; i < 3 ; i++ ) {
-			if ( tw.start[i] < tw.end[i] ) {
-				tw.bounds[0][i] = tw.start[i] - fabs(tw.sphere.offset[i]) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.end[i] + fabs(tw.sphere.offset[i]) + tw.sphere.radius;
-			} else {
-				tw.bounds[0][i] = tw.end[i] - fabs(tw.sphere.offset[i]) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.start[i] + fabs(tw.sphere.offset[i]) + tw.sphere.radius;
-			}
-		}
-	}
-	else {
-		for ( i = 0 ; i < 3 ; i++ ) {
-			if ( tw.start[i] < tw.end[i] ) {
-				tw.bounds[0][i] = tw.start[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.end[i] + tw.size[1][i];
-			} else {
-				tw.bounds[0][i] = tw.end[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.start[i] + tw.size[1][i];
-			}
-		}
-	}
+	CM_CalcTraceBounds( &tw );
 
 	//
 	// check for position test special case
@@ -1359,6 +1482,76 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mi
 	*results = tw.trace;
 }
 
+/*
+==================
+CM_Trace
+==================
+*/
+void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, vec3_t mins, vec3_t maxs,
+						  clipHandle_t model, const vec3_t origin, int brushmask, int capsule, sphere_t *sphere ) {
+#ifndef BSPC
+	traceKey_t			key;
+	traceCacheEntry_t	*entry;
+	qboolean			timed;
+	int					startTime;
+#endif
+
+	c_traces++;				// for statistics, may be zeroed
+
+#ifdef BSPC
+	CM_TraceWork( results, start, end, mins, maxs, model, origin, brushmask, capsule, sphere );
+#else
+	timed = com_showtrace->integer;
+	startTime = timed ? Sys_Microseconds() : 0;
+
+	entry = NULL;
+	if ( cm_traceCache->integer && model < cm.numSubModels
+		&& model != BOX_MODEL_HANDLE && model != CAPSULE_MODEL_HANDLE ) {
+		// clear the padding too, the key is hashed and compared as memory
+		Com_Memset( &key, 0, sizeof( key ) );
+		VectorCopy( start, key.start );
+		VectorCopy( end, key.end );
+		if ( mins ) {
+			VectorCopy( mins, key.mins );
+		}
+		if ( maxs ) {
+			VectorCopy( maxs, key.maxs );
+		}
+		VectorCopy( origin, key.origin );
+		if ( sphere ) {
+			key.sphere = *sphere;
+			key.hasSphere = qtrue;
+		}
+		key.model = model;
+		key.brushmask = brushmask;
+		key.capsule = capsule;
+		key.noCurves = cm_noCurves->integer;
+		key.playerCurveClip = cm_playerCurveClip->integer;
+
+		entry = CM_TraceCacheEntry( &key );
+		if ( entry->frame == traceCacheFrame && !memcmp( &entry->key, &key, sizeof( key ) ) ) {
+			*results = entry->trace;
+			c_trace_cached++;
+			if ( timed ) {
+				c_trace_usec += Sys_Microseconds() - startTime;
+			}
+			return;
+		}
+	}
+
+	CM_TraceWork( results, start, end, mins, maxs, model, origin, brushmask, capsule, sphere );
+
+	if ( entry ) {
+		entry->frame = traceCacheFrame;
+		entry->key = key;
+		entry->trace = *results;
+	}
+	if ( timed ) {
+		c_trace_usec += Sys_Microseconds() - startTime;
+	}
+#endif
+}
+
 /*
 ==================
 CM_BoxTrace
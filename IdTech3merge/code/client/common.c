@@ -2782,15 +2782,22 @@ void Com_Frame( void ) {
 	
 		extern	int c_traces, c_brush_traces, c_patch_traces;
 		extern	int	c_pointcontents;
+		extern	int	c_trace_cached, c_brush_culls, c_trace_usec;
 
-		Com_Printf ("%4i traces  (%ib %ip) %4i points\n", c_traces,
-			c_brush_traces, c_patch_traces, c_pointcontents);
+		Com_Printf ("%4i traces  (%ib %ip) %4i points %4i cached %5i culled %.2fus/trace\n", c_traces,
+			c_brush_traces, c_patch_traces, c_pointcontents, c_trace_cached, c_brush_culls,
+			c_traces ? (float)c_trace_usec / c_traces : 0.0f);
 		c_traces = 0;
 		c_brush_traces = 0;
 		c_patch_traces = 0;
 		c_pointcontents = 0;
+		c_trace_cached = 0;
+		c_brush_culls = 0;
+		c_trace_usec = 0;
 	}
 
+	CM_ClearTraceCache();
+
 	// old net chan encryption key
 	key = lastTime * 0x87243987;
 
@@ -27,41 +27,42 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "../game/q_shared.h"
 #include "qcommon.h"
 
+// only used by the whole message Huff_Compress / Huff_Decompress, the offset
+// versions keep their position in the caller's variable so the message
+// codec can run on several threads at once
 static int			bloc = 0;
 
 void	Huff_putBit( int bit, byte *fout, int *offset) {
-	bloc = *offset;
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
+	int pos = *offset;
+	if ((pos&7) == 0) {
+		fout[(pos>>3)] = 0;
 	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
-	*offset = bloc;
+	fout[(pos>>3)] |= bit << (pos&7);
+	*offset = pos + 1;
 }
 
 int		Huff_getBit( byte *fin, int *offset) {
 	int t;
-	bloc = *offset;
-	t = (fin[(bloc>>3)] >> (bloc&7)) & 0x1;
-	bloc++;
-	*offset = bloc;
+	int pos = *offset;
+	t = (fin[(pos>>3)] >> (pos&7)) & 0x1;
+	*offset = pos + 1;
 	return t;
 }
 
 /* Add a bit to the output file (buffered) */
-static void add_bit (char bit, byte *fout) {
-	if ((bloc&7) == 0) {
-		fout[(bloc>>3)] = 0;
+static void add_bit (char bit, byte *fout, int *pos) {
+	if ((*pos&7) == 0) {
+		fout[(*pos>>3)] = 0;
 	}
-	fout[(bloc>>3)] |= bit << (bloc&7);
-	bloc++;
+	fout[(*pos>>3)] |= bit << (*pos&7);
+	(*pos)++;
 }
 
 /* Receive one bit from the input file (buffered) */
-static int get_bit (byte *fin) {
+static int get_bit (byte *fin, int *pos) {
 	int t;
-	t = (fin[(bloc>>3)] >> (bloc&7)) & 0x1;
-	bloc++;
+	t = (fin[(*pos>>3)] >> (*pos&7)) & 0x1;
+	(*pos)++;
 	return t;
 }
 
@@ -255,7 +256,7 @@ void Huff_addRef(huff_t* huff, byte ch) {
 /* Get a symbol */
 int Huff_Receive (node_t *node, int *ch, byte *fin) {
 	while (node && node->symbol == INTERNAL_NODE) {
-		if (get_bit(fin)) {
+		if (get_bit(fin, &bloc)) {
 			node = node->right;
 		} else {
 			node = node->left;
@@ -270,9 +271,9 @@ int Huff_Receive (node_t *node, int *ch, byte *fin) {
 
 /* Get a symbol */
 void Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset) {
-	bloc = *offset;
+	int pos = *offset;
 	while (node && node->symbol == INTERNAL_NODE) {
-		if (get_bit(fin)) {
+		if (get_bit(fin, &pos)) {
 			node = node->right;
 		} else {
 			node = node->left;
@@ -284,19 +285,19 @@ void Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset) {
 //		Com_Error(ERR_DROP, "Illegal tree!\n");
 	}
 	*ch = node->symbol;
-	*offset = bloc;
+	*offset = pos;
 }
 
 /* Send the prefix code for this node */
-static void send(node_t *node, node_t *child, byte *fout) {
+static void send(node_t *node, node_t *child, byte *fout, int *pos) {
 	if (node->parent) {
-		send(node->parent, node, fout);
+		send(node->parent, node, fout, pos);
 	}
 	if (child) {
 		if (node->right == child) {
-			add_bit(1, fout);
+			add_bit(1, fout, pos);
 		} else {
-			add_bit(0, fout);
+			add_bit(0, fout, pos);
 		}
 	}
 }
@@ -308,17 +309,137 @@ void Huff_transmit (huff_t *huff, int ch, byte *fout) {
 		/* node_t hasn't been transmitted, send a NYT, then the symbol */
 		Huff_transmit(huff, NYT, fout);
 		for (i = 7; i >= 0; i--) {
-			add_bit((char)((ch >> i) & 0x1), fout);
+			add_bit((char)((ch >> i) & 0x1), fout, &bloc);
 		}
 	} else {
-		send(huff->loc[ch], NULL, fout);
+		send(huff->loc[ch], NULL, fout, &bloc);
 	}
 }
 
 void Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset) {
-	bloc = *offset;
-	send(huff->loc[ch], NULL, fout);
-	*offset = bloc;
+	send(huff->loc[ch], NULL, fout, offset);
+}
+
+/*
+==================
+Huff_BuildTable
+
+Flattens a tree that will not be updated any more into per symbol codes
+and a lookup table indexed by the next HUFF_DECODE_BITS bits of input.
+Codes longer than the table finish with a normal tree walk.
+==================
+*/
+void Huff_BuildTable( huff_t *huff, huffTable_t *table ) {
+	int			i, ch, length;
+	unsigned	code;
+	node_t		*node;
+
+	Com_Memset( table, 0, sizeof( *table ) );
+	table->tree = huff->tree;
+
+	for ( ch = 0 ; ch < HMAX ; ch++ ) {
+		node = huff->loc[ch];
+		if ( !node ) {
+			continue;
+		}
+		code = 0;
+		length = 0;
+		for ( ; node->parent ; node = node->parent ) {
+			code <<= 1;
+			if ( node->parent->right == node ) {
+				code |= 1;
+			}
+			length++;
+		}
+		if ( length > HUFF_MAX_CODE ) {
+			Com_Error( ERR_FATAL, "Huff_BuildTable: %i bit code for symbol %i", length, ch );
+		}
+		table->code[ch] = code;
+		table->codeLength[ch] = length;
+	}
+
+	for ( i = 0 ; i < ( 1 << HUFF_DECODE_BITS ) ; i++ ) {
+		node = huff->tree;
+		for ( length = 0 ; length < HUFF_DECODE_BITS ; length++ ) {
+			if ( !node || node->symbol != INTERNAL_NODE ) {
+				break;
+			}
+			node = ( i >> length ) & 1 ? node->right : node->left;
+		}
+		table->decode[i].node = node;
+		if ( node && node->symbol != INTERNAL_NODE ) {
+			table->decode[i].symbol = node->symbol;
+			table->decode[i].length = length;
+		}
+	}
+}
+
+/*
+==================
+Huff_tableTransmit
+
+Writes the whole code in one go, the partial byte at the offset is kept
+and a new byte is cleared first just like add_bit does
+==================
+*/
+void Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset ) {
+	int			pos, bits;
+	unsigned	code;
+	byte		*out;
+
+	pos = *offset;
+	out = fout + ( pos >> 3 );
+	if ( ( pos & 7 ) == 0 ) {
+		*out = 0;
+	}
+	code = *out | ( table->code[ch] << ( pos & 7 ) );
+	bits = ( pos & 7 ) + table->codeLength[ch];
+
+	*out++ = code;
+	for ( bits -= 8 ; bits > 0 ; bits -= 8 ) {
+		code >>= 8;
+		*out++ = code;
+	}
+	*offset = pos + table->codeLength[ch];
+}
+
+/*
+==================
+Huff_tableReceive
+
+size is the number of readable bytes in fin, the last few bits before it
+go through the tree so the lookahead never reads past the buffer
+==================
+*/
+void Huff_tableReceive( const huffTable_t *table, int *ch, byte *fin, int *offset, int size ) {
+	int					pos;
+	unsigned			peek;
+	byte				*in;
+	const huffDecode_t	*entry;
+
+	pos = *offset;
+	if ( ( pos >> 3 ) + 2 >= size ) {
+		Huff_offsetReceive( table->tree, ch, fin, offset );
+		return;
+	}
+
+	in = fin + ( pos >> 3 );
+	peek = ( in[0] | ( in[1] << 8 ) | ( in[2] << 16 ) ) >> ( pos & 7 );
+	entry = &table->decode[peek & ( ( 1 << HUFF_DECODE_BITS ) - 1 )];
+	if ( entry->length ) {
+		*ch = entry->symbol;
+		*offset = pos + entry->length;
+		return;
+	}
+
+	// longer than the table, keep walking from where it stopped
+	pos += HUFF_DECODE_BITS;
+	Huff_offsetReceive( entry->node, ch, fin, &pos );
+	if ( entry->node ) {
+		*offset = pos;
+	} else {
+		*ch = 0;
+	}
 }
 
 void Huff_Decompress(msg_t *mbuf, int offset) {
@@ -361,7 +482,7 @@ void Huff_Decompress(msg_t *mbuf, int offset) {
 		if ( ch == NYT ) {								/* We got a NYT, get the symbol associated with it */
 			ch = 0;
 			for ( i = 0; i < 8; i++ ) {
-				ch = (ch<<1) + get_bit(buffer);
+				ch = (ch<<1) + get_bit(buffer, &bloc);
 			}
 		}
     
@@ -82,6 +82,18 @@ int		Sys_Milliseconds (void) {
 	return 0;
 }
 
+int		Sys_Microseconds (void) {
+	return 0;
+}
+
+void	Sys_RunJobs( int numThreads, int count, void (*func)( void *data, int index ), void *data ) {
+	int		i;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		func( data, i );
+	}
+}
+
 void	Sys_Mkdir (char *path) {
 }
 
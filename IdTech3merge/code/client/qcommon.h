@@ -273,6 +273,41 @@ enum clc_ops_e {
 /*
 ==============================================================
 
+VIRTUAL MACHINE
+
+==============================================================
+*/
+
+typedef struct vm_s vm_t;
+
+typedef enum {
+	VMI_NATIVE,
+	VMI_BYTECODE,
+	VMI_COMPILED
+} vmInterpret_t;
+
+void	VM_Init( void );
+vm_t	*VM_Create( const char *module, int (*systemCalls)(int *), 
+				   vmInterpret_t interpret );
+// module should be bare: "cgame", not "cgame.dll" or "vm/cgame.qvm"
+
+void	VM_Free( vm_t *vm );
+void	VM_Clear(void);
+vm_t	*VM_Restart( vm_t *vm );
+
+int		QDECL VM_Call( vm_t *vm, int callNum, ... );
+
+void	VM_Debug( int level );
+
+void	*VM_ArgPtr( int intValue );
+void	*VM_ExplicitArgPtr( vm_t *vm, int intValue );
+
+#define	VMA(x) VM_ArgPtr(args[x])
+#define	VMF(x)	((float *)args)[x]
+
+/*
+==============================================================
+
 CMD
 
 Command text buffering and command execution
@@ -661,6 +696,7 @@ void		Com_StartupVariable( const char *match );
 extern	cvar_t	*com_developer;
 extern	cvar_t	*com_dedicated;
 extern	cvar_t	*com_speeds;
+extern	cvar_t	*com_showtrace;
 extern	cvar_t	*com_timescale;
 extern	cvar_t	*com_sv_running;
 extern	cvar_t	*com_cl_running;
@@ -909,6 +945,16 @@ void	Sys_Print( const char *msg );
 // any game related timing information should come from event timestamps
 int		Sys_Milliseconds (void);
 
+// wraps, only differences between two calls are meaningful
+int		Sys_Microseconds (void);
+
+// calls func( data, 0 ) .. func( data, count-1 ) spread over numThreads
+// threads, the caller being one of them, and returns when all are done.
+// func must not use Com_Error, Com_Printf, cvars or anything else that
+// isn't thread safe
+#define	MAX_JOB_THREADS		16
+void	Sys_RunJobs( int numThreads, int count, void (*func)( void *data, int index ), void *data );
+
 void	Sys_SnapVector( float *v );
 
 // the system console is shown when a dedicated server is running
@@ -990,6 +1036,24 @@ typedef struct {
 	huff_t		decompressor;
 } huffman_t;
 
+// static code tables for a tree that is no longer updated, this produces
+// and accepts exactly the same bits as Huff_offsetTransmit / Huff_offsetReceive
+#define	HUFF_DECODE_BITS	11
+#define	HUFF_MAX_CODE		24		// codes must fit a 32 bit write with a partial byte in front
+
+typedef struct {
+	node_t		*node;				// subtree to keep walking when length is 0
+	short		symbol;
+	short		length;
+} huffDecode_t;
+
+typedef struct {
+	node_t			*tree;
+	unsigned int	code[HMAX];		// first bit in the lowest position
+	byte			codeLength[HMAX];
+	huffDecode_t	decode[1<<HUFF_DECODE_BITS];
+} huffTable_t;
+
 void	Huff_Compress(msg_t *buf, int offset);
 void	Huff_Decompress(msg_t *buf, int offset);
 void	Huff_Init(huffman_t *huff);
@@ -1000,6 +1064,9 @@ void	Huff_offsetReceive (node_t *node, int *ch, byte *fin, int *offset);
 void	Huff_offsetTransmit (huff_t *huff, int ch, byte *fout, int *offset);
 void	Huff_putBit( int bit, byte *fout, int *offset);
 int		Huff_getBit( byte *fout, int *offset);
+void	Huff_BuildTable( huff_t *huff, huffTable_t *table );
+void	Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset );
+void	Huff_tableReceive( const huffTable_t *table, int *ch, byte *fin, int *offset, int size );
 
 extern huffman_t clientHuffTables;
 
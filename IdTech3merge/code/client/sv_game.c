@@ -727,6 +727,9 @@ int SV_GameSystemCalls( int *args ) {
 		return botlib_export->ai.BotChooseLTGItem( args[1], VMA(2), VMA(3), args[4] );
 	case BOTLIB_AI_CHOOSE_NBG_ITEM:
 		return botlib_export->ai.BotChooseNBGItem( args[1], VMA(2), VMA(3), args[4], VMA(5), VMF(6) );
+	case BOTLIB_AI_PREPARE_GOAL_STATES:
+		botlib_export->ai.BotPrepareGoalStates( args[1], VMA(2), VMA(3), VMA(4) );
+		return 0;
 	case BOTLIB_AI_TOUCHING_GOAL:
 		return botlib_export->ai.BotTouchingGoal( VMA(1), VMA(2) );
 	case BOTLIB_AI_ITEM_GOAL_IN_VIS_BUT_NOT_VISIBLE:
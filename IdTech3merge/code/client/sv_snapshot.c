@@ -116,42 +116,56 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 /*
 ==================
-SV_WriteSnapshotToClient
+SV_SnapshotDeltaFrame
+
+Picks the frame the snapshot will be delta compressed against.  Must run after
+every snapshot of the batch has taken its entities from the ring, so an old
+frame that survives the check can't be overwritten while it is being read.
 ==================
 */
-static void SV_WriteSnapshotToClient( client_t *client, msg_t *msg ) {
-	clientSnapshot_t	*frame, *oldframe;
-	int					lastframe;
-	int					i;
-	int					snapFlags;
-
-	// this is the snapshot we are creating
-	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+static clientSnapshot_t *SV_SnapshotDeltaFrame( client_t *client, int *lastframe ) {
+	clientSnapshot_t	*oldframe;
 
 	// try to use a previous frame as the source for delta compressing the snapshot
 	if ( client->deltaMessage <= 0 || client->state != CS_ACTIVE ) {
 		// client is asking for a retransmit
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else if ( client->netchan.outgoingSequence - client->deltaMessage 
 		>= (PACKET_BACKUP - 3) ) {
 		// client hasn't gotten a good message through in a long time
 		Com_DPrintf ("%s: Delta request from out of date packet.\n", client->name);
 		oldframe = NULL;
-		lastframe = 0;
+		*lastframe = 0;
 	} else {
 		// we have a valid snapshot to delta from
 		oldframe = &client->frames[ client->deltaMessage & PACKET_MASK ];
-		lastframe = client->netchan.outgoingSequence - client->deltaMessage;
+		*lastframe = client->netchan.outgoingSequence - client->deltaMessage;
 
 		// the snapshot's entities may still have rolled off the buffer, though
 		if ( oldframe->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
 			Com_DPrintf ("%s: Delta request from out of date entities.\n", client->name);
 			oldframe = NULL;
-			lastframe = 0;
+			*lastframe = 0;
 		}
 	}
 
+	return oldframe;
+}
+
+/*
+==================
+SV_WriteSnapshotToClient
+==================
+*/
+static void SV_WriteSnapshotToClient( client_t *client, clientSnapshot_t *oldframe, int lastframe, msg_t *msg ) {
+	clientSnapshot_t	*frame;
+	int					i;
+	int					snapFlags;
+
+	// this is the snapshot we are creating
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	MSG_WriteByte (msg, svc_snapshot);
 
 	// NOTE, MRE: now sent at the start of every message from server to client
@@ -227,54 +241,54 @@ Build a client snapshot structure
 
 #define	MAX_SNAPSHOT_ENTITIES	1024
 typedef struct {
-	int		numSnapshotEntities;
-	int		snapshotEntities[MAX_SNAPSHOT_ENTITIES];	
+	int			numSnapshotEntities;
+	unsigned	entityBits[MAX_GENTITIES/32];	// walked in order, so no sort is needed
+	const char	*error;							// can't Com_Error on a job thread
 } snapshotEntityNumbers_t;
 
-/*
-=======================
-SV_QsortEntityNumbers
-=======================
-*/
-static int QDECL SV_QsortEntityNumbers( const void *a, const void *b ) {
-	int	*ea, *eb;
-
-	ea = (int *)a;
-	eb = (int *)b;
-
-	if ( *ea == *eb ) {
-		Com_Error( ERR_DROP, "SV_QsortEntityStates: duplicated entity" );
-	}
-
-	if ( *ea < *eb ) {
-		return -1;
-	}
-
-	return 1;
-}
-
-
 /*
 ===============
 SV_AddEntToSnapshot
 ===============
 */
-static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+static void SV_AddEntToSnapshot( sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
+	int		e;
+
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	e = gEnt->s.number;
+	if ( eNums->entityBits[e >> 5] & ( 1 << ( e & 31 ) ) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
 		return;
 	}
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
+	eNums->entityBits[e >> 5] |= 1 << ( e & 31 );
 	eNums->numSnapshotEntities++;
 }
 
+/*
+===============
+SV_FixEntityNumbers
+
+Done once before building snapshots, so the builders only read the entities
+===============
+*/
+static void SV_FixEntityNumbers( void ) {
+	int		e;
+	sharedEntity_t *ent;
+
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum(e);
+		if ( ent->r.linked && ent->s.number != e ) {
+			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = e;
+		}
+	}
+}
+
 /*
 ===============
 SV_AddEntitiesVisibleFromPoint
@@ -299,7 +313,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		return;
 	}
 
-	leafnum = CM_PointLeafnum (origin);
+	leafnum = CM_PointLeafnumThreaded (origin);
 	clientarea = CM_LeafArea (leafnum);
 	clientcluster = CM_LeafCluster (leafnum);
 
@@ -318,11 +332,6 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 			continue;
 		}
 
-		if (ent->s.number != e) {
-			Com_DPrintf ("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
-
 		// entities can be flagged to explicitly not be sent to the client
 		if ( ent->r.svFlags & SVF_NOCLIENT ) {
 			continue;
@@ -342,22 +351,24 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		}
 		// entities can be flagged to be sent to a given mask of clients
 		if ( ent->r.svFlags & SVF_CLIENTMASK ) {
-			if (frame->ps.clientNum >= 32)
-				Com_Error( ERR_DROP, "SVF_CLIENTMASK: cientNum > 32\n" );
+			if (frame->ps.clientNum >= 32) {
+				eNums->error = "SVF_CLIENTMASK: cientNum > 32\n";
+				return;
+			}
 			if (~ent->r.singleClient & (1 << frame->ps.clientNum))
 				continue;
 		}
 
-		svEnt = SV_SvEntityForGentity( ent );
-
 		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( eNums->entityBits[e >> 5] & ( 1 << ( e & 31 ) ) ) {
 			continue;
 		}
 
+		svEnt = SV_SvEntityForGentity( ent );
+
 		// broadcast entities are always sent
 		if ( ent->r.svFlags & SVF_BROADCAST ) {
-			SV_AddEntToSnapshot( svEnt, ent, eNums );
+			SV_AddEntToSnapshot( ent, eNums );
 			continue;
 		}
 
@@ -403,7 +414,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		}
 
 		// add it
-		SV_AddEntToSnapshot( svEnt, ent, eNums );
+		SV_AddEntToSnapshot( ent, eNums );
 
 		// if its a portal entity, add everything visible from its camera position
 		if ( ent->r.svFlags & SVF_PORTAL ) {
@@ -415,6 +426,9 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 				}
 			}
 			SV_AddEntitiesVisibleFromPoint( ent->s.origin2, frame, eNums, qtrue );
+			if ( eNums->error ) {
+				return;
+			}
 		}
 
 	}
@@ -431,28 +445,25 @@ This properly handles multiple recursive portals, but the render
 currently doesn't.
 
 For viewing through other player's eyes, clent can be something other than client->gentity
+
+Only reads shared server state, so snapshots for different clients can
+be built at the same time.  The entities are copied out later by
+SV_CopySnapshotEntities once they have a place in the ring.
 =============
 */
-static void SV_BuildClientSnapshot( client_t *client ) {
+static void SV_BuildClientSnapshot( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
 	vec3_t						org;
 	clientSnapshot_t			*frame;
-	snapshotEntityNumbers_t		entityNumbers;
 	int							i;
-	sharedEntity_t				*ent;
-	entityState_t				*state;
-	svEntity_t					*svEnt;
 	sharedEntity_t				*clent;
 	int							clientNum;
 	playerState_t				*ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
-
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	Com_Memset( entityNumbers, 0, sizeof( *entityNumbers ) );
 	Com_Memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
   // https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=62
@@ -471,11 +482,10 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	// be regenerated from the playerstate
 	clientNum = frame->ps.clientNum;
 	if ( clientNum < 0 || clientNum >= MAX_GENTITIES ) {
-		Com_Error( ERR_DROP, "SV_SvEntityForGentity: bad gEnt" );
+		entityNumbers->error = "SV_SvEntityForGentity: bad gEnt";
+		return;
 	}
-	svEnt = &sv.svEntities[ clientNum ];
-
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	entityNumbers->entityBits[clientNum >> 5] |= 1 << ( clientNum & 31 );
 
 	// find the client's viewpoint
 	VectorCopy( ps->origin, org );
@@ -483,37 +493,73 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse );
+	SV_AddEntitiesVisibleFromPoint( org, frame, entityNumbers, qfalse );
 
-	// if there were portals visible, there may be out of order entities
-	// in the list which will need to be resorted for the delta compression
-	// to work correctly.  This also catches the error condition
-	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities, 
-		sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	entityNumbers->entityBits[clientNum >> 5] &= ~( 1 << ( clientNum & 31 ) );
 
 	// now that all viewpoint's areabits have been OR'd together, invert
 	// all of them to make it a mask vector, which is what the renderer wants
 	for ( i = 0 ; i < MAX_MAP_AREA_BYTES/4 ; i++ ) {
 		((int *)frame->areabits)[i] = ((int *)frame->areabits)[i] ^ -1;
 	}
+}
 
-	// copy the entity states out
-	frame->num_entities = 0;
+/*
+=============
+SV_AllocSnapshotEntities
+
+Reserves the snapshot's range of the entity ring
+=============
+*/
+static void SV_AllocSnapshotEntities( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
+	clientSnapshot_t	*frame;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	frame->num_entities = entityNumbers->numSnapshotEntities;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum(entityNumbers.snapshotEntities[i]);
-		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
-		*state = ent->s;
-		svs.nextSnapshotEntities++;
-		// this should never hit, map should always be restarted first in SV_Frame
-		if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
-			Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
-		}
-		frame->num_entities++;
+	svs.nextSnapshotEntities += entityNumbers->numSnapshotEntities;
+
+	// this should never hit, map should always be restarted first in SV_Frame
+	if ( svs.nextSnapshotEntities >= 0x7FFFFFFE ) {
+		Com_Error(ERR_FATAL, "svs.nextSnapshotEntities wrapped");
 	}
 }
 
+/*
+=============
+SV_CopySnapshotEntities
+
+Copies the entity states out in entity number order,
+which is what the delta compression needs
+=============
+*/
+static void SV_CopySnapshotEntities( client_t *client, snapshotEntityNumbers_t *entityNumbers ) {
+	clientSnapshot_t	*frame;
+	unsigned			bits;
+	int					i, e, n;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+	n = frame->first_entity;
+	for ( i = 0 ; i < MAX_GENTITIES/32 ; i++ ) {
+		bits = entityNumbers->entityBits[i];
+		e = i * 32;
+		while ( bits ) {
+			if ( !( bits & 0xff ) ) {
+				bits >>= 8;
+				e += 8;
+				continue;
+			}
+			if ( bits & 1 ) {
+				svs.snapshotEntities[n % svs.numSnapshotEntities] = SV_GentityNum(e)->s;
+				n++;
+			}
+			bits >>= 1;
+			e++;
+		}
+	}
+}
 
 /*
 ====================
@@ -599,51 +645,136 @@ void SV_SendMessageToClient( msg_t *msg, client_t *client ) {
 }
 
 
+/*
+=============================================================================
+
+Build snapshots for a batch of clients
+
+Visibility and copying the entity states into the ring run on
+sv_snapshotThreads job threads.  Taking entity ring space, the delta frame
+choice, message encoding, downloads and the actual transmit stay on the main
+thread, because the MSG_ writers can Com_Printf and Com_Error.
+
+=============================================================================
+*/
+
+typedef struct snapshotJob_s {
+	client_t				*client;
+	snapshotEntityNumbers_t	entityNumbers;
+} snapshotJob_t;
+
 /*
 =======================
-SV_SendClientSnapshot
+SV_AllocSnapshotJobs
 
-Also called by SV_FinalMessage
+One job per client slot, allocated with the snapshot entities
+=======================
+*/
+void SV_AllocSnapshotJobs( void ) {
+	svs.snapshotJobs = Hunk_Alloc( sizeof(snapshotJob_t)*sv_maxclients->integer, h_high );
+}
 
+/*
+=======================
+SV_BuildSnapshotJob
 =======================
 */
-void SV_SendClientSnapshot( client_t *client ) {
-	byte		msg_buf[MAX_MSGLEN];
-	msg_t		msg;
+static void SV_BuildSnapshotJob( void *data, int index ) {
+	snapshotJob_t	*job;
 
-	// build the snapshot
-	SV_BuildClientSnapshot( client );
+	job = &((snapshotJob_t *)data)[index];
+	SV_BuildClientSnapshot( job->client, &job->entityNumbers );
+}
 
-	// bots need to have their snapshots build, but
-	// the query them directly without needing to be sent
-	if ( client->gentity && client->gentity->r.svFlags & SVF_BOT ) {
-		return;
+/*
+=======================
+SV_CopySnapshotJob
+=======================
+*/
+static void SV_CopySnapshotJob( void *data, int index ) {
+	snapshotJob_t	*job;
+
+	job = &((snapshotJob_t *)data)[index];
+	SV_CopySnapshotEntities( job->client, &job->entityNumbers );
+}
+
+/*
+=======================
+SV_SendSnapshotJobs
+=======================
+*/
+static void SV_SendSnapshotJobs( snapshotJob_t *jobs, int numJobs, int numThreads ) {
+	snapshotJob_t		*job;
+	client_t			*client;
+	clientSnapshot_t	*oldframe;
+	int					lastframe;
+	byte				msg_buf[MAX_MSGLEN];
+	msg_t				msg;
+	int					i;
+
+	SV_FixEntityNumbers();
+
+	Sys_RunJobs( numThreads, numJobs, SV_BuildSnapshotJob, jobs );
+
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		if ( job->entityNumbers.error ) {
+			Com_Error( ERR_DROP, "%s", job->entityNumbers.error );
+		}
+		SV_AllocSnapshotEntities( job->client, &job->entityNumbers );
 	}
 
-	MSG_Init (&msg, msg_buf, sizeof(msg_buf));
-	msg.allowoverflow = qtrue;
+	Sys_RunJobs( numThreads, numJobs, SV_CopySnapshotJob, jobs );
 
-	// NOTE, MRE: all server->client messages now acknowledge
-	// let the client know which reliable clientCommands we have received
-	MSG_WriteLong( &msg, client->lastClientCommand );
+	for ( i = 0, job = jobs ; i < numJobs ; i++, job++ ) {
+		client = job->client;
+
+		// bots need to have their snapshots build, but
+		// the query them directly without needing to be sent
+		if ( client->gentity && client->gentity->r.svFlags & SVF_BOT ) {
+			continue;
+		}
 
-	// (re)send any reliable server commands
-	SV_UpdateServerCommandsToClient( client, &msg );
+		MSG_Init (&msg, msg_buf, sizeof(msg_buf));
+		msg.allowoverflow = qtrue;
 
-	// send over all the relevant entityState_t
-	// and the playerState_t
-	SV_WriteSnapshotToClient( client, &msg );
+		// NOTE, MRE: all server->client messages now acknowledge
+		// let the client know which reliable clientCommands we have received
+		MSG_WriteLong( &msg, client->lastClientCommand );
 
-	// Add any download data if the client is downloading
-	SV_WriteDownloadToClient( client, &msg );
+		// (re)send any reliable server commands
+		SV_UpdateServerCommandsToClient( client, &msg );
 
-	// check for overflow
-	if ( msg.overflowed ) {
-		Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
-		MSG_Clear (&msg);
+		// send over all the relevant entityState_t
+		// and the playerState_t
+		oldframe = SV_SnapshotDeltaFrame( client, &lastframe );
+		SV_WriteSnapshotToClient( client, oldframe, lastframe, &msg );
+
+		// Add any download data if the client is downloading
+		SV_WriteDownloadToClient( client, &msg );
+
+		// check for overflow
+		if ( msg.overflowed ) {
+			Com_Printf ("WARNING: msg overflowed for %s\n", client->name);
+			MSG_Clear (&msg);
+		}
+
+		SV_SendMessageToClient( &msg, client );
 	}
+}
+
+/*
+=======================
+SV_SendClientSnapshot
 
-	SV_SendMessageToClient( &msg, client );
+Also called by SV_FinalMessage
+
+=======================
+*/
+void SV_SendClientSnapshot( client_t *client ) {
+	snapshotJob_t	job;
+
+	job.client = client;
+	SV_SendSnapshotJobs( &job, 1, 1 );
 }
 
 
@@ -655,8 +786,10 @@ SV_SendClientMessages
 void SV_SendClientMessages( void ) {
 	int			i;
 	client_t	*c;
+	int			numJobs;
 
 	// send a message to each connected client
+	numJobs = 0;
 	for (i=0, c = svs.clients ; i < sv_maxclients->integer ; i++, c++) {
 		if (!c->state) {
 			continue;		// not connected
@@ -676,7 +809,10 @@ void SV_SendClientMessages( void ) {
 		}
 
 		// generate and send a new message
-		SV_SendClientSnapshot( c );
+		svs.snapshotJobs[numJobs++].client = c;
 	}
-}
 
+	if ( numJobs ) {
+		SV_SendSnapshotJobs( svs.snapshotJobs, numJobs, sv_snapshotThreads->integer );
+	}
+}
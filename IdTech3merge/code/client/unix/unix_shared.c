@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <pwd.h>
+#include <pthread.h>
 
 #include "../game/q_shared.h"
 #include "../qcommon/qcommon.h"
@@ -76,6 +77,137 @@ int Sys_Milliseconds (void)
 	return curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+int Sys_Microseconds (void)
+{
+	struct timeval tp;
+
+	gettimeofday(&tp, NULL);
+
+	return (int)( (unsigned long)tp.tv_sec * 1000000 + tp.tv_usec );
+}
+
+/*
+==============================================================
+
+JOB THREADS
+
+Workers are started on first use and then sleep between batches
+
+==============================================================
+*/
+
+typedef struct {
+	void			(*func)( void *data, int index );
+	void			*data;
+	int				count;
+	volatile int	next;			// next index to hand out
+	int				numWorkers;		// workers taking part in this batch
+	int				pending;		// workers that haven't finished this batch
+	int				generation;		// bumped for every batch
+} jobBatch_t;
+
+static pthread_mutex_t	jobMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	jobStart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	jobDone = PTHREAD_COND_INITIALIZER;
+static jobBatch_t		jobBatch;
+static int				numJobThreads;
+
+static void Sys_DoJobs( void ) {
+	int		i;
+
+	while ( ( i = __sync_fetch_and_add( &jobBatch.next, 1 ) ) < jobBatch.count ) {
+		jobBatch.func( jobBatch.data, i );
+	}
+}
+
+static void *Sys_JobThread( void *arg ) {
+	int		threadNum;
+	int		generation;
+
+	threadNum = (int)(long)arg;
+	generation = 0;
+
+	pthread_mutex_lock( &jobMutex );
+	while ( 1 ) {
+		while ( jobBatch.generation == generation ) {
+			pthread_cond_wait( &jobStart, &jobMutex );
+		}
+		generation = jobBatch.generation;
+		if ( threadNum >= jobBatch.numWorkers ) {
+			continue;
+		}
+
+		pthread_mutex_unlock( &jobMutex );
+		Sys_DoJobs();
+		pthread_mutex_lock( &jobMutex );
+
+		if ( --jobBatch.pending == 0 ) {
+			pthread_cond_signal( &jobDone );
+		}
+	}
+
+	return NULL;
+}
+
+/*
+================
+Sys_RunJobs
+================
+*/
+void Sys_RunJobs( int numThreads, int count, void (*func)( void *data, int index ), void *data ) {
+	pthread_t	thread;
+	int			i;
+
+	if ( numThreads > MAX_JOB_THREADS ) {
+		numThreads = MAX_JOB_THREADS;
+	}
+
+	if ( numThreads <= 1 || count <= 1 ) {
+		for ( i = 0 ; i < count ; i++ ) {
+			func( data, i );
+		}
+		return;
+	}
+
+	pthread_mutex_lock( &jobMutex );
+
+	while ( numJobThreads < numThreads - 1 ) {
+		if ( pthread_create( &thread, NULL, Sys_JobThread, (void *)(long)numJobThreads ) ) {
+			break;
+		}
+		pthread_detach( thread );
+		numJobThreads++;
+	}
+
+	jobBatch.func = func;
+	jobBatch.data = data;
+	jobBatch.count = count;
+	jobBatch.next = 0;
+	jobBatch.numWorkers = numThreads - 1;
+	if ( jobBatch.numWorkers > numJobThreads ) {
+		jobBatch.numWorkers = numJobThreads;
+	}
+	jobBatch.pending = jobBatch.numWorkers;
+	jobBatch.generation++;
+
+	pthread_cond_broadcast( &jobStart );
+	pthread_mutex_unlock( &jobMutex );
+
+	// the calling thread works on the batch too
+	Sys_DoJobs();
+
+	pthread_mutex_lock( &jobMutex );
+	while ( jobBatch.pending ) {
+		pthread_cond_wait( &jobDone, &jobMutex );
+	}
+	pthread_mutex_unlock( &jobMutex );
+}
+
 #if defined(__linux__) && !defined(DEDICATED)
 /*
 ================
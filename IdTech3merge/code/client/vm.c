@@ -46,6 +46,7 @@ vm_t	vmTable[MAX_VM];
 
 void VM_VmInfo_f( void );
 void VM_VmProfile_f( void );
+static void VM_ProfileStop( vm_t *vm );
 
 
 // converts a VM pointer to a C pointer and
@@ -359,6 +360,9 @@ vm_t *VM_Restart( vm_t *vm ) {
 	int			i;
 	char		filename[MAX_QPATH];
 
+	// the profiler owns vm->systemCall while running
+	VM_ProfileStop( vm );
+
 	// DLL's can't be restarted in place
 	if ( vm->dllHandle ) {
 		char	name[MAX_QPATH];
@@ -571,6 +575,8 @@ VM_Free
 */
 void VM_Free( vm_t *vm ) {
 
+	VM_ProfileStop( vm );
+
 	if ( vm->dllHandle ) {
 		Sys_UnloadDll( vm->dllHandle );
 		Com_Memset( vm, 0, sizeof( *vm ) );
@@ -595,6 +601,7 @@ void VM_Free( vm_t *vm ) {
 void VM_Clear(void) {
 	int i;
 	for (i=0;i<MAX_VM; i++) {
+		VM_ProfileStop( &vmTable[i] );
 		if ( vmTable[i].dllHandle ) {
 			Sys_UnloadDll( vmTable[i].dllHandle );
 		}
@@ -711,6 +718,191 @@ int	QDECL VM_Call( vm_t *vm, int callnum, ... ) {
 
 //=================================================================
 
+/*
+==============
+VM_ProfileSystemCall
+
+Stands in for vm->systemCall while profiling, so traps are
+counted the same way for dlls, compiled and interpreted code
+==============
+*/
+static int VM_ProfileSystemCall( int *args ) {
+	vm_t		*vm;
+	vmProfile_t	*profile;
+	int			start;
+	int			num;
+	int			r;
+
+	vm = currentVM;
+	profile = vm->profile;
+	num = args[0];
+
+	start = Sys_Microseconds();
+	r = profile->systemCall( args );
+
+	// the trap may have executed a "vmprofile stop"
+	if ( vm->profile != profile ) {
+		return r;
+	}
+
+	if ( (unsigned)num >= MAX_PROFILE_SYSCALLS ) {
+		num = MAX_PROFILE_SYSCALLS - 1;
+	}
+	profile->syscalls[num].calls++;
+	profile->syscalls[num].time += Sys_Microseconds() - start;
+
+	return r;
+}
+
+/*
+==============
+VM_ProfileClear
+==============
+*/
+static void VM_ProfileClear( vmProfile_t *profile ) {
+	Com_Memset( profile->nodes, 0, sizeof( profile->nodes ) );
+	Com_Memset( profile->syscalls, 0, sizeof( profile->syscalls ) );
+
+	// node 0 is the engine, everything called through VM_Call hangs off it
+	profile->numNodes = 1;
+	profile->nodes[0].value = -1;
+	profile->nodes[0].parent = -1;
+	profile->nodes[0].firstChild = -1;
+	profile->nodes[0].nextSibling = -1;
+
+	// frames still open when this runs inside a call are ignored on the way out
+	profile->depth = 0;
+	profile->droppedCalls = 0;
+	profile->startTime = Sys_Milliseconds();
+}
+
+/*
+==============
+VM_ProfileStart
+==============
+*/
+static void VM_ProfileStart( vm_t *vm ) {
+	vmProfile_t	*profile;
+
+	if ( vm->profile ) {
+		return;
+	}
+
+	profile = Z_Malloc( sizeof( *profile ) );
+	profile->systemCall = vm->systemCall;
+	VM_ProfileClear( profile );
+
+	vm->profile = profile;
+	vm->systemCall = VM_ProfileSystemCall;
+}
+
+/*
+==============
+VM_ProfileStop
+==============
+*/
+static void VM_ProfileStop( vm_t *vm ) {
+	if ( !vm->profile ) {
+		return;
+	}
+
+	vm->systemCall = vm->profile->systemCall;
+	Z_Free( vm->profile );
+	vm->profile = NULL;
+}
+
+/*
+==============
+VM_ProfileEnter
+
+Called by the interpreter on OP_ENTER with the code offset of the function
+==============
+*/
+void VM_ProfileEnter( vm_t *vm, int value ) {
+	vmProfile_t			*profile;
+	vmProfileNode_t		*node;
+	vmProfileFrame_t	*frame;
+	int					parent;
+	int					n;
+
+	profile = vm->profile;
+
+	if ( profile->depth >= MAX_PROFILE_DEPTH ) {
+		profile->depth++;
+		profile->droppedCalls++;
+		return;
+	}
+
+	parent = profile->depth ? profile->stack[ profile->depth - 1 ].node : 0;
+
+	// find the call tree node for this function under the caller
+	n = -1;
+	if ( parent >= 0 ) {
+		for ( n = profile->nodes[parent].firstChild ; n >= 0 ; n = profile->nodes[n].nextSibling ) {
+			if ( profile->nodes[n].value == value ) {
+				break;
+			}
+		}
+
+		if ( n < 0 && profile->numNodes < MAX_PROFILE_NODES ) {
+			n = profile->numNodes++;
+			node = &profile->nodes[n];
+			node->value = value;
+			node->parent = parent;
+			node->firstChild = -1;
+			node->nextSibling = profile->nodes[parent].firstChild;
+			profile->nodes[parent].firstChild = n;
+		}
+	}
+
+	if ( n < 0 ) {
+		// tree is full, the time stays with the caller
+		profile->droppedCalls++;
+	} else {
+		profile->nodes[n].calls++;
+	}
+
+	frame = &profile->stack[ profile->depth++ ];
+	frame->node = n;
+	frame->childTime = 0;
+	frame->startTime = Sys_Microseconds();
+}
+
+/*
+==============
+VM_ProfileLeave
+==============
+*/
+void VM_ProfileLeave( vm_t *vm ) {
+	vmProfile_t			*profile;
+	vmProfileFrame_t	*frame;
+	int					elapsed;
+
+	profile = vm->profile;
+
+	// profiling was started from inside a call
+	if ( profile->depth <= 0 ) {
+		return;
+	}
+
+	profile->depth--;
+	if ( profile->depth >= MAX_PROFILE_DEPTH ) {
+		return;
+	}
+
+	frame = &profile->stack[ profile->depth ];
+	if ( frame->node < 0 ) {
+		return;
+	}
+
+	elapsed = Sys_Microseconds() - frame->startTime;
+	profile->nodes[ frame->node ].time += elapsed - frame->childTime;
+
+	if ( profile->depth > 0 ) {
+		profile->stack[ profile->depth - 1 ].childTime += elapsed;
+	}
+}
+
 static int QDECL VM_ProfileSort( const void *a, const void *b ) {
 	vmSymbol_t	*sa, *sb;
 
@@ -726,10 +918,151 @@ static int QDECL VM_ProfileSort( const void *a, const void *b ) {
 	return 0;
 }
 
+static vmProfile_t	*sortProfile;
+
+static int QDECL VM_ProfileSyscallSort( const void *a, const void *b ) {
+	return sortProfile->syscalls[ *(int *)a ].time - sortProfile->syscalls[ *(int *)b ].time;
+}
+
+/*
+==============
+VM_ProfileFunctions
+
+Folds the call tree into the symbols, a function that shows up
+again further down its own path only counts once for inclusive time
+==============
+*/
+static void VM_ProfileFunctions( vm_t *vm ) {
+	vmProfile_t	*profile;
+	vmSymbol_t	*sym;
+	int			*inclusive;
+	int			i, n;
+
+	profile = vm->profile;
+
+	for ( sym = vm->symbols ; sym ; sym = sym->next ) {
+		sym->profileCount = 0;
+		sym->profileInclusive = 0;
+		sym->profileCalls = 0;
+	}
+
+	// children are always allocated after their parent
+	inclusive = Z_Malloc( profile->numNodes * sizeof( *inclusive ) );
+	for ( i = profile->numNodes - 1 ; i > 0 ; i-- ) {
+		inclusive[i] += profile->nodes[i].time;
+		inclusive[ profile->nodes[i].parent ] += inclusive[i];
+	}
+
+	for ( i = 1 ; i < profile->numNodes ; i++ ) {
+		sym = VM_ValueToFunctionSymbol( vm, profile->nodes[i].value );
+		sym->profileCount += profile->nodes[i].time;
+		sym->profileCalls += profile->nodes[i].calls;
+
+		for ( n = profile->nodes[i].parent ; n > 0 ; n = profile->nodes[n].parent ) {
+			if ( VM_ValueToFunctionSymbol( vm, profile->nodes[n].value ) == sym ) {
+				break;
+			}
+		}
+		if ( n <= 0 ) {
+			sym->profileInclusive += inclusive[i];
+		}
+	}
+
+	Z_Free( inclusive );
+}
+
+/*
+==============
+VM_ProfileExport
+
+Writes the call tree as folded stacks, one line per path,
+which is what flamegraph.pl expects
+==============
+*/
+static void VM_ProfileExport( vm_t *vm, const char *filename ) {
+	vmProfile_t	*profile;
+	fileHandle_t	f;
+	int			path[MAX_PROFILE_DEPTH];
+	int			i, n, depth;
+
+	profile = vm->profile;
+
+	f = FS_FOpenFileWrite( filename );
+	if ( !f ) {
+		Com_Printf( "Couldn't write %s.\n", filename );
+		return;
+	}
+
+	for ( i = 1 ; i < profile->numNodes ; i++ ) {
+		if ( profile->nodes[i].time <= 0 ) {
+			continue;
+		}
+
+		depth = 0;
+		for ( n = i ; n > 0 && depth < MAX_PROFILE_DEPTH ; n = profile->nodes[n].parent ) {
+			path[depth++] = n;
+		}
+
+		FS_Printf( f, "%s", vm->name );
+		while ( depth-- ) {
+			n = path[depth];
+			if ( vm->numSymbols ) {
+				FS_Printf( f, ";%s", VM_ValueToFunctionSymbol( vm, profile->nodes[n].value )->symName );
+			} else {
+				FS_Printf( f, ";0x%x", profile->nodes[n].value );
+			}
+		}
+		FS_Printf( f, " %i\n", profile->nodes[i].time );
+	}
+
+	FS_FCloseFile( f );
+	Com_Printf( "Wrote %s.\n", filename );
+}
+
+/*
+==============
+VM_ProfileSyscalls
+==============
+*/
+static void VM_ProfileSyscalls( vm_t *vm ) {
+	vmProfile_t	*profile;
+	int			sorted[MAX_PROFILE_SYSCALLS];
+	int			i, count, total;
+
+	profile = vm->profile;
+
+	count = 0;
+	total = 0;
+	for ( i = 0 ; i < MAX_PROFILE_SYSCALLS ; i++ ) {
+		if ( profile->syscalls[i].calls ) {
+			sorted[count++] = i;
+			total += profile->syscalls[i].time;
+		}
+	}
+
+	sortProfile = profile;
+	qsort( sorted, count, sizeof( sorted[0] ), VM_ProfileSyscallSort );
+
+	Com_Printf( " trap      calls      msec   usec/call\n" );
+	for ( i = 0 ; i < count ; i++ ) {
+		vmProfileSyscall_t	*sc;
+
+		sc = &profile->syscalls[ sorted[i] ];
+		Com_Printf( "%5i %10i %9.2f %11.2f\n", sorted[i], sc->calls,
+			sc->time * 0.001f, (float)sc->time / sc->calls );
+	}
+	Com_Printf( "      %21.2f msec total in traps\n", total * 0.001f );
+}
+
 /*
 ==============
 VM_VmProfile_f
 
+vmprofile start [vm]
+vmprofile stop
+vmprofile syscalls
+vmprofile export <file>
+vmprofile	: print function times and reset
 ==============
 */
 void VM_VmProfile_f( void ) {
@@ -737,17 +1070,76 @@ void VM_VmProfile_f( void ) {
 	vmSymbol_t	**sorted, *sym;
 	int			i;
 	double		total;
+	const char	*cmd;
+
+	cmd = Cmd_Argv( 1 );
+
+	// find the vm being profiled, or the last one that ran
+	vm = NULL;
+	for ( i = 0 ; i < MAX_VM ; i++ ) {
+		if ( vmTable[i].profile ) {
+			vm = &vmTable[i];
+			break;
+		}
+	}
+
+	if ( !Q_stricmp( cmd, "start" ) ) {
+		if ( vm ) {
+			Com_Printf( "Already profiling %s.\n", vm->name );
+			return;
+		}
+		vm = lastVM;
+		if ( Cmd_Argc() > 2 ) {
+			vm = NULL;
+			for ( i = 0 ; i < MAX_VM ; i++ ) {
+				if ( vmTable[i].name[0] && !Q_stricmp( vmTable[i].name, Cmd_Argv( 2 ) ) ) {
+					vm = &vmTable[i];
+				}
+			}
+		}
+		if ( !vm ) {
+			Com_Printf( "No such vm.\n" );
+			return;
+		}
+		if ( vm->dllHandle || vm->compiled ) {
+			Com_Printf( "%s is not interpreted, only traps will be profiled.\n", vm->name );
+		}
+		VM_ProfileStart( vm );
+		Com_Printf( "Profiling %s.\n", vm->name );
+		return;
+	}
 
-	if ( !lastVM ) {
+	if ( !vm ) {
+		Com_Printf( "usage: vmprofile start [vm]\n" );
 		return;
 	}
 
-	vm = lastVM;
+	if ( !Q_stricmp( cmd, "stop" ) ) {
+		VM_ProfileStop( vm );
+		return;
+	}
+
+	if ( !Q_stricmp( cmd, "syscalls" ) ) {
+		VM_ProfileSyscalls( vm );
+		return;
+	}
+
+	if ( !Q_stricmp( cmd, "export" ) ) {
+		if ( Cmd_Argc() != 3 ) {
+			Com_Printf( "usage: vmprofile export <file>\n" );
+			return;
+		}
+		VM_ProfileExport( vm, Cmd_Argv( 2 ) );
+		return;
+	}
 
 	if ( !vm->numSymbols ) {
+		Com_Printf( "%s has no symbols, function times need developer 1 when it is loaded.\n", vm->name );
 		return;
 	}
 
+	VM_ProfileFunctions( vm );
+
 	sorted = Z_Malloc( vm->numSymbols * sizeof( *sorted ) );
 	sorted[0] = vm->symbols;
 	total = sorted[0]->profileCount;
@@ -758,19 +1150,28 @@ void VM_VmProfile_f( void ) {
 
 	qsort( sorted, vm->numSymbols, sizeof( *sorted ), VM_ProfileSort );
 
+	Com_Printf( "excl      usec  incl      usec      calls\n" );
 	for ( i = 0 ; i < vm->numSymbols ; i++ ) {
-		int		perc;
+		int		perc, incl;
 
 		sym = sorted[i];
+		if ( !sym->profileCalls ) {
+			continue;
+		}
 
 		perc = 100 * (float) sym->profileCount / total;
-		Com_Printf( "%2i%% %9i %s\n", perc, sym->profileCount, sym->symName );
-		sym->profileCount = 0;
+		incl = 100 * (float) sym->profileInclusive / total;
+		Com_Printf( "%3i%% %9i %3i%% %9i %10i %s\n", perc, sym->profileCount,
+			incl, sym->profileInclusive, sym->profileCalls, sym->symName );
 	}
 
-	Com_Printf("    %9.0f total\n", total );
+	Com_Printf("     %9.0f total over %i msec, %i calls dropped\n", total,
+		Sys_Milliseconds() - vm->profile->startTime, vm->profile->droppedCalls );
 
 	Z_Free( sorted );
+
+	// start a new sample
+	VM_ProfileClear( vm->profile );
 }
 
 /*
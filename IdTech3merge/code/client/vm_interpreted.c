@@ -0,0 +1,765 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Foobar; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// vm_interpreted.c -- threaded code interpreter for platforms without a compiler
+
+#include "vm_local.h"
+
+/*
+
+  The bytecode is decoded once at load time into a flat array of
+  fixed size ( opcode, parameter ) slots, so the interpreter never has
+  to look at variable length instructions or byte swap constants.
+
+  Common opcode sequences are fused into superinstructions by rewriting
+  the opcode of the first slot only.  The remaining slots of the sequence
+  are left in place and are skipped over by the fused handler, so a jump
+  into the middle of a sequence still executes the original instructions.
+
+  With gcc the handlers are dispatched through a table of label addresses,
+  everything else falls back to a switch.
+
+*/
+
+// superinstructions, numbered after the real opcodes
+typedef enum {
+	OPS_CONST_ADD = OP_NUM_OPS,	// CONST, ADD
+	OPS_CONST_SUB,				// CONST, SUB
+	OPS_CONST_LOAD4,			// CONST, LOAD4
+	OPS_CONST_JUMP,				// CONST, JUMP
+	OPS_LOCAL_LOAD4,			// LOCAL, LOAD4
+	OPS_LOCAL_CONST_STORE4,		// LOCAL, CONST, STORE4
+	OPS_LOCAL_COPY4,			// LOCAL, LOCAL, LOAD4, STORE4
+
+	OPS_NUM_OPS
+} superOpcode_t;
+
+#define	OPSTACK_SIZE	256
+
+#if defined( __GNUC__ )
+#define	VM_THREADED_DISPATCH
+#endif
+
+#ifdef VM_THREADED_DISPATCH
+#define	OPCASE(x)		op_##x
+#define	DISPATCH()		goto *dispatchTable[ codeImage[ programCounter ] ]
+#else
+#define	OPCASE(x)		case x
+#define	DISPATCH()		goto nextInstruction
+#endif
+
+// parameter of the slot at programCounter, and of the n'th slot after it
+#define	PARAM			codeImage[ programCounter + 1 ]
+#define	PARAMN(n)		codeImage[ programCounter + (n) * 2 + 1 ]
+
+
+/*
+=================
+VM_FuseInstructions
+
+Rewrites the first slot of each recognized sequence to a superinstruction
+=================
+*/
+static int VM_FuseInstructions( vm_t *vm, int *codeImage, int instructionCount ) {
+	int		i;
+	int		op0, op1, op2, op3;
+	int		fused;
+
+#define	OPAT(n)	( i + (n) < instructionCount ? codeImage[ ( i + (n) ) * 2 ] : OP_UNDEF )
+
+	fused = 0;
+
+	// the scan goes forward, so the following slots still hold their original opcodes
+	for ( i = 0 ; i < instructionCount ; i++ ) {
+		op0 = OPAT( 0 );
+		op1 = OPAT( 1 );
+		op2 = OPAT( 2 );
+		op3 = OPAT( 3 );
+
+		if ( op0 == OP_LOCAL ) {
+			if ( op1 == OP_LOCAL && op2 == OP_LOAD4 && op3 == OP_STORE4 ) {
+				codeImage[ i*2 ] = OPS_LOCAL_COPY4;
+			} else if ( op1 == OP_CONST && op2 == OP_STORE4 ) {
+				codeImage[ i*2 ] = OPS_LOCAL_CONST_STORE4;
+			} else if ( op1 == OP_LOAD4 ) {
+				codeImage[ i*2 ] = OPS_LOCAL_LOAD4;
+			} else {
+				continue;
+			}
+		} else if ( op0 == OP_CONST ) {
+			if ( op1 == OP_ADD ) {
+				codeImage[ i*2 ] = OPS_CONST_ADD;
+			} else if ( op1 == OP_SUB ) {
+				codeImage[ i*2 ] = OPS_CONST_SUB;
+			} else if ( op1 == OP_LOAD4 ) {
+				codeImage[ i*2 ] = OPS_CONST_LOAD4;
+			} else if ( op1 == OP_JUMP
+				&& (unsigned)codeImage[ i*2 + 1 ] < (unsigned)instructionCount ) {
+				// the constant is only ever read by the fused handler, so it can be relocated
+				codeImage[ i*2 ] = OPS_CONST_JUMP;
+				codeImage[ i*2 + 1 ] = vm->instructionPointers[ codeImage[ i*2 + 1 ] ];
+			} else {
+				continue;
+			}
+		} else {
+			continue;
+		}
+		fused++;
+	}
+
+#undef OPAT
+
+	return fused;
+}
+
+/*
+=================
+VM_PrepareInterpreter
+=================
+*/
+void VM_PrepareInterpreter( vm_t *vm, vmHeader_t *header ) {
+	int		op;
+	int		pc;
+	byte	*code;
+	int		instruction;
+	int		*codeImage;
+	int		target;
+	int		fused;
+
+	codeImage = Hunk_Alloc( header->instructionCount * 2 * sizeof( int ), h_high );
+	vm->codeBase = (byte *)codeImage;
+
+	code = (byte *)header + header->codeOffset;
+
+	// decode every instruction into an ( opcode, parameter ) slot
+	pc = 0;
+	for ( instruction = 0 ; instruction < header->instructionCount ; instruction++ ) {
+		if ( pc >= header->codeLength ) {
+			Com_Error( ERR_FATAL, "VM_PrepareInterpreter: pc >= header->codeLength" );
+		}
+
+		vm->instructionPointers[ instruction ] = instruction * 2;
+
+		op = code[ pc ];
+		pc++;
+
+		codeImage[ instruction*2 ] = op;
+		codeImage[ instruction*2 + 1 ] = 0;
+
+		switch ( op ) {
+		case OP_ENTER:
+		case OP_LEAVE:
+		case OP_CONST:
+		case OP_LOCAL:
+		case OP_EQ:
+		case OP_NE:
+		case OP_LTI:
+		case OP_LEI:
+		case OP_GTI:
+		case OP_GEI:
+		case OP_LTU:
+		case OP_LEU:
+		case OP_GTU:
+		case OP_GEU:
+		case OP_EQF:
+		case OP_NEF:
+		case OP_LTF:
+		case OP_LEF:
+		case OP_GTF:
+		case OP_GEF:
+		case OP_BLOCK_COPY:
+			if ( pc + 4 > header->codeLength ) {
+				Com_Error( ERR_FATAL, "VM_PrepareInterpreter: pc > header->codeLength" );
+			}
+			codeImage[ instruction*2 + 1 ] = code[pc] | (code[pc+1]<<8) | (code[pc+2]<<16) | (code[pc+3]<<24);
+			pc += 4;
+			break;
+		case OP_ARG:
+			if ( pc + 1 > header->codeLength ) {
+				Com_Error( ERR_FATAL, "VM_PrepareInterpreter: pc > header->codeLength" );
+			}
+			codeImage[ instruction*2 + 1 ] = code[pc];
+			pc += 1;
+			break;
+		default:
+			if ( op >= OP_NUM_OPS ) {
+				Com_Error( ERR_FATAL, "VM_PrepareInterpreter: bad opcode %i at offset %i", op, pc - 1 );
+			}
+			break;
+		}
+	}
+
+	// conditional branches go straight to the decoded slot
+	for ( instruction = 0 ; instruction < header->instructionCount ; instruction++ ) {
+		op = codeImage[ instruction*2 ];
+		if ( op < OP_EQ || op > OP_GEF ) {
+			continue;
+		}
+		target = codeImage[ instruction*2 + 1 ];
+		if ( target < 0 || target >= header->instructionCount ) {
+			Com_Error( ERR_FATAL, "VM_PrepareInterpreter: branch target %i out of range", target );
+		}
+		codeImage[ instruction*2 + 1 ] = vm->instructionPointers[ target ];
+	}
+
+	fused = VM_FuseInstructions( vm, codeImage, header->instructionCount );
+
+	Com_DPrintf( "%s: %i instructions, %i superinstructions\n", vm->name, header->instructionCount, fused );
+}
+
+
+/*
+==============
+VM_CallInterpreted
+
+
+Upon a system call, the stack will look like:
+
+sp+32	parm1
+sp+28	parm0
+sp+24	return stack
+sp+20	return address
+sp+16	local1
+sp+14	local0
+sp+12	arg1
+sp+8	arg0
+sp+4	return stack
+sp		return address
+
+An interpreted function will immediately execute
+an OP_ENTER instruction, which will subtract space for
+locals from sp
+==============
+*/
+int	VM_CallInterpreted( vm_t *vm, int *args ) {
+	int		stack[OPSTACK_SIZE];
+	int		*opStack;
+	int		programCounter;
+	int		programStack;
+	int		stackOnEntry;
+	byte	*image;
+	int		*codeImage;
+	int		codeSlots;
+	int		instructionCount;
+	int		dataMask;
+	int		dataMask4;
+	int		dataMask2;
+	int		v1;
+#ifdef VM_THREADED_DISPATCH
+	// must match the order of opcode_t and superOpcode_t
+	static const void *dispatchTable[OPS_NUM_OPS] = {
+		&&op_OP_UNDEF,
+		&&op_OP_IGNORE,
+		&&op_OP_BREAK,
+		&&op_OP_ENTER,
+		&&op_OP_LEAVE,
+		&&op_OP_CALL,
+		&&op_OP_PUSH,
+		&&op_OP_POP,
+		&&op_OP_CONST,
+		&&op_OP_LOCAL,
+		&&op_OP_JUMP,
+		&&op_OP_EQ,
+		&&op_OP_NE,
+		&&op_OP_LTI,
+		&&op_OP_LEI,
+		&&op_OP_GTI,
+		&&op_OP_GEI,
+		&&op_OP_LTU,
+		&&op_OP_LEU,
+		&&op_OP_GTU,
+		&&op_OP_GEU,
+		&&op_OP_EQF,
+		&&op_OP_NEF,
+		&&op_OP_LTF,
+		&&op_OP_LEF,
+		&&op_OP_GTF,
+		&&op_OP_GEF,
+		&&op_OP_LOAD1,
+		&&op_OP_LOAD2,
+		&&op_OP_LOAD4,
+		&&op_OP_STORE1,
+		&&op_OP_STORE2,
+		&&op_OP_STORE4,
+		&&op_OP_ARG,
+		&&op_OP_BLOCK_COPY,
+		&&op_OP_SEX8,
+		&&op_OP_SEX16,
+		&&op_OP_NEGI,
+		&&op_OP_ADD,
+		&&op_OP_SUB,
+		&&op_OP_DIVI,
+		&&op_OP_DIVU,
+		&&op_OP_MODI,
+		&&op_OP_MODU,
+		&&op_OP_MULI,
+		&&op_OP_MULU,
+		&&op_OP_BAND,
+		&&op_OP_BOR,
+		&&op_OP_BXOR,
+		&&op_OP_BCOM,
+		&&op_OP_LSH,
+		&&op_OP_RSHI,
+		&&op_OP_RSHU,
+		&&op_OP_NEGF,
+		&&op_OP_ADDF,
+		&&op_OP_SUBF,
+		&&op_OP_DIVF,
+		&&op_OP_MULF,
+		&&op_OP_CVIF,
+		&&op_OP_CVFI,
+		&&op_OPS_CONST_ADD,
+		&&op_OPS_CONST_SUB,
+		&&op_OPS_CONST_LOAD4,
+		&&op_OPS_CONST_JUMP,
+		&&op_OPS_LOCAL_LOAD4,
+		&&op_OPS_LOCAL_CONST_STORE4,
+		&&op_OPS_LOCAL_COPY4,
+	};
+#endif
+
+	// interpret the code
+	vm->currentlyInterpreting = qtrue;
+
+	// we might be called recursively, so this might not be the very top
+	programStack = stackOnEntry = vm->programStack;
+
+	// set up the stack frame
+	image = vm->dataBase;
+	codeImage = (int *)vm->codeBase;
+	instructionCount = vm->instructionPointersLength >> 2;
+	codeSlots = instructionCount * 2;
+	dataMask = vm->dataMask;
+	dataMask4 = dataMask & ~3;
+	dataMask2 = dataMask & ~1;
+
+	// leave a free spot at start of stack so
+	// that as long as opStack is valid, opStack-1 will
+	// not corrupt anything
+	opStack = stack;
+	programCounter = 0;
+
+	programStack -= 48;
+
+	*(int *)&image[ programStack + 44] = args[9];
+	*(int *)&image[ programStack + 40] = args[8];
+	*(int *)&image[ programStack + 36] = args[7];
+	*(int *)&image[ programStack + 32] = args[6];
+	*(int *)&image[ programStack + 28] = args[5];
+	*(int *)&image[ programStack + 24] = args[4];
+	*(int *)&image[ programStack + 20] = args[3];
+	*(int *)&image[ programStack + 16] = args[2];
+	*(int *)&image[ programStack + 12] = args[1];
+	*(int *)&image[ programStack + 8 ] = args[0];
+	*(int *)&image[ programStack + 4 ] = 0;	// return stack
+	*(int *)&image[ programStack ] = -1;	// will terminate the loop on return
+
+	vm->callLevel = 0;
+
+	VM_Debug(0);
+
+	// main interpreter loop, will exit when a LEAVE instruction
+	// grabs the -1 program counter
+
+	DISPATCH();
+
+#ifndef VM_THREADED_DISPATCH
+nextInstruction:
+	switch ( codeImage[ programCounter ] ) {
+#endif
+
+	OPCASE(OP_UNDEF):
+		Com_Error( ERR_DROP, "VM_CallInterpreted: OP_UNDEF in %s", vm->name );
+		goto done;
+
+	OPCASE(OP_IGNORE):
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_BREAK):
+		vm->breakCount++;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_ENTER):
+		// get size of stack frame
+		v1 = PARAM;
+		programCounter += 2;
+		programStack -= v1;
+		if ( vm->profile ) {
+			VM_ProfileEnter( vm, programCounter - 2 );
+		}
+		if ( programStack <= vm->stackBottom ) {
+			Com_Error( ERR_DROP, "VM_CallInterpreted: %s program stack overflow", vm->name );
+		}
+		if ( opStack >= &stack[OPSTACK_SIZE - 16] ) {
+			Com_Error( ERR_DROP, "VM_CallInterpreted: %s operand stack overflow", vm->name );
+		}
+		DISPATCH();
+
+	OPCASE(OP_LEAVE):
+		if ( vm->profile ) {
+			VM_ProfileLeave( vm );
+		}
+
+		// remove our stack frame
+		programStack += PARAM;
+
+		// grab the saved program counter
+		programCounter = *(int *)&image[ programStack ];
+
+		// check for leaving the VM
+		if ( programCounter == -1 ) {
+			goto done;
+		}
+		if ( (unsigned)programCounter >= (unsigned)codeSlots || ( programCounter & 1 ) ) {
+			Com_Error( ERR_DROP, "VM_CallInterpreted: %s bad return address", vm->name );
+		}
+		DISPATCH();
+
+	OPCASE(OP_CALL):
+		// save the return address, which is the slot after the call
+		*(int *)&image[ programStack ] = programCounter + 2;
+
+		// jump to the location on the stack
+		v1 = *opStack;
+		opStack--;
+		if ( v1 < 0 ) {
+			// system call
+			int		r;
+			int		temp;
+
+			// save the stack to allow recursive VM entry
+			temp = vm->callLevel;
+			vm->programStack = programStack - 4;
+			*(int *)&image[ programStack + 4 ] = -1 - v1;
+
+//VM_LogSyscalls( (int *)&image[ programStack + 4 ] );
+			r = vm->systemCall( (int *)&image[ programStack + 4 ] );
+
+			// save return value
+			opStack++;
+			*opStack = r;
+			programCounter += 2;
+			vm->callLevel = temp;
+		} else {
+			if ( (unsigned)v1 >= (unsigned)instructionCount ) {
+				Com_Error( ERR_DROP, "VM_CallInterpreted: %s call to bad instruction %i", vm->name, v1 );
+			}
+			programCounter = vm->instructionPointers[ v1 ];
+		}
+		DISPATCH();
+
+	// push and pop are only needed for discarded or bad function return values
+	OPCASE(OP_PUSH):
+		opStack++;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_POP):
+		opStack--;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_CONST):
+		*++opStack = PARAM;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_LOCAL):
+		*++opStack = PARAM + programStack;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_JUMP):
+		v1 = *opStack;
+		opStack--;
+		if ( (unsigned)v1 >= (unsigned)instructionCount ) {
+			Com_Error( ERR_DROP, "VM_CallInterpreted: %s jump to bad instruction %i", vm->name, v1 );
+		}
+		programCounter = vm->instructionPointers[ v1 ];
+		DISPATCH();
+
+	//-------------------
+
+#define	BRANCH(cond)									\
+		if ( cond ) {									\
+			programCounter = PARAM;						\
+		} else {										\
+			programCounter += 2;						\
+		}												\
+		opStack -= 2;									\
+		DISPATCH();
+
+	OPCASE(OP_EQ):
+		BRANCH( opStack[-1] == opStack[0] )
+	OPCASE(OP_NE):
+		BRANCH( opStack[-1] != opStack[0] )
+	OPCASE(OP_LTI):
+		BRANCH( opStack[-1] < opStack[0] )
+	OPCASE(OP_LEI):
+		BRANCH( opStack[-1] <= opStack[0] )
+	OPCASE(OP_GTI):
+		BRANCH( opStack[-1] > opStack[0] )
+	OPCASE(OP_GEI):
+		BRANCH( opStack[-1] >= opStack[0] )
+	OPCASE(OP_LTU):
+		BRANCH( (unsigned)opStack[-1] < (unsigned)opStack[0] )
+	OPCASE(OP_LEU):
+		BRANCH( (unsigned)opStack[-1] <= (unsigned)opStack[0] )
+	OPCASE(OP_GTU):
+		BRANCH( (unsigned)opStack[-1] > (unsigned)opStack[0] )
+	OPCASE(OP_GEU):
+		BRANCH( (unsigned)opStack[-1] >= (unsigned)opStack[0] )
+	OPCASE(OP_EQF):
+		BRANCH( ((float *)opStack)[-1] == ((float *)opStack)[0] )
+	OPCASE(OP_NEF):
+		BRANCH( ((float *)opStack)[-1] != ((float *)opStack)[0] )
+	OPCASE(OP_LTF):
+		BRANCH( ((float *)opStack)[-1] < ((float *)opStack)[0] )
+	OPCASE(OP_LEF):
+		BRANCH( ((float *)opStack)[-1] <= ((float *)opStack)[0] )
+	OPCASE(OP_GTF):
+		BRANCH( ((float *)opStack)[-1] > ((float *)opStack)[0] )
+	OPCASE(OP_GEF):
+		BRANCH( ((float *)opStack)[-1] >= ((float *)opStack)[0] )
+
+#undef BRANCH
+
+	//-------------------
+
+	OPCASE(OP_LOAD1):
+		*opStack = image[ *opStack & dataMask ];
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_LOAD2):
+		*opStack = *(unsigned short *)&image[ *opStack & dataMask2 ];
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_LOAD4):
+		*opStack = *(int *)&image[ *opStack & dataMask4 ];
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_STORE1):
+		image[ opStack[-1] & dataMask ] = (byte)opStack[0];
+		opStack -= 2;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_STORE2):
+		*(short *)&image[ opStack[-1] & dataMask2 ] = (short)opStack[0];
+		opStack -= 2;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_STORE4):
+		*(int *)&image[ opStack[-1] & dataMask4 ] = opStack[0];
+		opStack -= 2;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_ARG):
+		// single byte offset from programStack
+		*(int *)&image[ PARAM + programStack ] = *opStack;
+		opStack--;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_BLOCK_COPY):
+		{
+			int		*src, *dest;
+			int		i, count, srci, desti;
+
+			count = PARAM;
+			// MrE: copy range check
+			srci = opStack[0] & dataMask;
+			desti = opStack[-1] & dataMask;
+			count = ((srci + count) & dataMask) - srci;
+			count = ((desti + count) & dataMask) - desti;
+
+			if ( ( srci | desti | count ) & 3 ) {
+				Com_Error( ERR_DROP, "OP_BLOCK_COPY not dword aligned" );
+			}
+
+			src = (int *)&image[ srci ];
+			dest = (int *)&image[ desti ];
+
+			count >>= 2;
+			for ( i = count-1 ; i>= 0 ; i-- ) {
+				dest[i] = src[i];
+			}
+			opStack -= 2;
+			programCounter += 2;
+		}
+		DISPATCH();
+
+	//-------------------
+
+	OPCASE(OP_SEX8):
+		*opStack = (signed char)*opStack;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_SEX16):
+		*opStack = (short)*opStack;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_NEGI):
+		*opStack = -*opStack;
+		programCounter += 2;
+		DISPATCH();
+
+#define	BINOP(expr)										\
+		opStack[-1] = expr;								\
+		opStack--;										\
+		programCounter += 2;							\
+		DISPATCH();
+
+	OPCASE(OP_ADD):
+		BINOP( opStack[-1] + opStack[0] )
+	OPCASE(OP_SUB):
+		BINOP( opStack[-1] - opStack[0] )
+	OPCASE(OP_DIVI):
+		BINOP( opStack[-1] / opStack[0] )
+	OPCASE(OP_DIVU):
+		BINOP( (unsigned)opStack[-1] / (unsigned)opStack[0] )
+	OPCASE(OP_MODI):
+		BINOP( opStack[-1] % opStack[0] )
+	OPCASE(OP_MODU):
+		BINOP( (unsigned)opStack[-1] % (unsigned)opStack[0] )
+	OPCASE(OP_MULI):
+		BINOP( opStack[-1] * opStack[0] )
+	OPCASE(OP_MULU):
+		BINOP( (unsigned)opStack[-1] * (unsigned)opStack[0] )
+	OPCASE(OP_BAND):
+		BINOP( opStack[-1] & opStack[0] )
+	OPCASE(OP_BOR):
+		BINOP( opStack[-1] | opStack[0] )
+	OPCASE(OP_BXOR):
+		BINOP( opStack[-1] ^ opStack[0] )
+	OPCASE(OP_LSH):
+		BINOP( opStack[-1] << opStack[0] )
+	OPCASE(OP_RSHI):
+		BINOP( opStack[-1] >> opStack[0] )
+	OPCASE(OP_RSHU):
+		BINOP( (unsigned)opStack[-1] >> opStack[0] )
+
+#undef BINOP
+
+	OPCASE(OP_BCOM):
+		*opStack = ~*opStack;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_NEGF):
+		*(float *)opStack = -*(float *)opStack;
+		programCounter += 2;
+		DISPATCH();
+
+#define	BINOPF(expr)									\
+		((float *)opStack)[-1] = expr;					\
+		opStack--;										\
+		programCounter += 2;							\
+		DISPATCH();
+
+	OPCASE(OP_ADDF):
+		BINOPF( ((float *)opStack)[-1] + ((float *)opStack)[0] )
+	OPCASE(OP_SUBF):
+		BINOPF( ((float *)opStack)[-1] - ((float *)opStack)[0] )
+	OPCASE(OP_DIVF):
+		BINOPF( ((float *)opStack)[-1] / ((float *)opStack)[0] )
+	OPCASE(OP_MULF):
+		BINOPF( ((float *)opStack)[-1] * ((float *)opStack)[0] )
+
+#undef BINOPF
+
+	OPCASE(OP_CVIF):
+		*(float *)opStack = (float)*opStack;
+		programCounter += 2;
+		DISPATCH();
+
+	OPCASE(OP_CVFI):
+		*opStack = (int)*(float *)opStack;
+		programCounter += 2;
+		DISPATCH();
+
+	//-------------------
+	// superinstructions, each one skips over the slots it replaces
+
+	OPCASE(OPS_CONST_ADD):
+		*opStack += PARAM;
+		programCounter += 2 * 2;
+		DISPATCH();
+
+	OPCASE(OPS_CONST_SUB):
+		*opStack -= PARAM;
+		programCounter += 2 * 2;
+		DISPATCH();
+
+	OPCASE(OPS_CONST_LOAD4):
+		*++opStack = *(int *)&image[ PARAM & dataMask4 ];
+		programCounter += 2 * 2;
+		DISPATCH();
+
+	OPCASE(OPS_CONST_JUMP):
+		// relocated at load time
+		programCounter = PARAM;
+		DISPATCH();
+
+	OPCASE(OPS_LOCAL_LOAD4):
+		*++opStack = *(int *)&image[ ( PARAM + programStack ) & dataMask4 ];
+		programCounter += 2 * 2;
+		DISPATCH();
+
+	OPCASE(OPS_LOCAL_CONST_STORE4):
+		*(int *)&image[ ( PARAM + programStack ) & dataMask4 ] = PARAMN(1);
+		programCounter += 2 * 3;
+		DISPATCH();
+
+	OPCASE(OPS_LOCAL_COPY4):
+		*(int *)&image[ ( PARAM + programStack ) & dataMask4 ] =
+			*(int *)&image[ ( PARAMN(1) + programStack ) & dataMask4 ];
+		programCounter += 2 * 4;
+		DISPATCH();
+
+#ifndef VM_THREADED_DISPATCH
+	default:
+		Com_Error( ERR_DROP, "VM_CallInterpreted: bad opcode %i in %s", codeImage[ programCounter ], vm->name );
+		goto done;
+	}
+#endif
+
+done:
+	vm->currentlyInterpreting = qfalse;
+
+	if ( opStack != &stack[1] ) {
+		Com_Error( ERR_DROP, "Interpreter error: opStack = %i", opStack - stack );
+	}
+
+	vm->programStack = stackOnEntry;
+
+	// return the result
+	return *opStack;
+}
@@ -53,6 +53,125 @@ int Sys_Milliseconds (void)
 	return sys_curtime;
 }
 
+/*
+================
+Sys_Microseconds
+================
+*/
+int Sys_Microseconds (void)
+{
+	static LARGE_INTEGER	frequency;
+	LARGE_INTEGER			counter;
+
+	if ( !frequency.QuadPart ) {
+		QueryPerformanceFrequency( &frequency );
+	}
+	QueryPerformanceCounter( &counter );
+
+	// split the division so long uptimes don't overflow the multiply
+	return (int)( ( counter.QuadPart / frequency.QuadPart ) * 1000000
+		+ ( counter.QuadPart % frequency.QuadPart ) * 1000000 / frequency.QuadPart );
+}
+
+/*
+==============================================================
+
+JOB THREADS
+
+Workers are started on first use and then sleep on a semaphore
+that is released once for every worker a batch needs
+
+==============================================================
+*/
+
+static void			(*jobFunc)( void *data, int index );
+static void			*jobData;
+static int			jobCount;
+static volatile LONG	jobNext;
+static volatile LONG	jobPending;
+static HANDLE		jobSemaphore;
+static HANDLE		jobDoneEvent;
+static int			numJobThreads;
+
+static void Sys_DoJobs( void ) {
+	int		i;
+
+	while ( ( i = InterlockedIncrement( &jobNext ) - 1 ) < jobCount ) {
+		jobFunc( jobData, i );
+	}
+}
+
+static DWORD WINAPI Sys_JobThread( LPVOID arg ) {
+	while ( 1 ) {
+		WaitForSingleObject( jobSemaphore, INFINITE );
+		Sys_DoJobs();
+		if ( InterlockedDecrement( &jobPending ) == 0 ) {
+			SetEvent( jobDoneEvent );
+		}
+	}
+	return 0;
+}
+
+/*
+================
+Sys_RunJobs
+================
+*/
+void Sys_RunJobs( int numThreads, int count, void (*func)( void *data, int index ), void *data ) {
+	HANDLE	thread;
+	DWORD	threadId;
+	int		numWorkers;
+	int		i;
+
+	if ( numThreads > MAX_JOB_THREADS ) {
+		numThreads = MAX_JOB_THREADS;
+	}
+
+	if ( numThreads <= 1 || count <= 1 ) {
+		for ( i = 0 ; i < count ; i++ ) {
+			func( data, i );
+		}
+		return;
+	}
+
+	if ( !jobSemaphore ) {
+		jobSemaphore = CreateSemaphore( NULL, 0, MAX_JOB_THREADS, NULL );
+		jobDoneEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+	}
+
+	while ( numJobThreads < numThreads - 1 ) {
+		thread = CreateThread( NULL, 0, Sys_JobThread, NULL, 0, &threadId );
+		if ( !thread ) {
+			break;
+		}
+		CloseHandle( thread );
+		numJobThreads++;
+	}
+
+	numWorkers = numThreads - 1;
+	if ( numWorkers > numJobThreads ) {
+		numWorkers = numJobThreads;
+	}
+
+	jobFunc = func;
+	jobData = data;
+	jobCount = count;
+	jobNext = 0;
+	jobPending = numWorkers;
+
+	if ( numWorkers ) {
+		ResetEvent( jobDoneEvent );
+		ReleaseSemaphore( jobSemaphore, numWorkers, NULL );
+	}
+
+	// the calling thread works on the batch too
+	Sys_DoJobs();
+
+	if ( numWorkers ) {
+		WaitForSingleObject( jobDoneEvent, INFINITE );
+	}
+}
+
 /*
 ================
 Sys_SnapVector
@@ -23,6 +23,16 @@
 
 #pragma once
 
+// state of the span drawers and the surface cache builder that worker
+// threads (raster bands, surface prebuilds) each keep a copy of. the assembly
+// drawers address these directly, so they stay plain globals when id386 is
+// set and that work is serial there
+#if id386
+#define D_THREADLOCAL
+#else
+#define D_THREADLOCAL thread_local
+#endif
+
 #define WARP_WIDTH 320
 #define WARP_HEIGHT 200
 
@@ -152,6 +162,7 @@ void D_SetupFrame();
 void D_StartParticles();
 void D_TurnZOn();
 void D_WarpScreen();
+void D_FinishPrebuild();
 
 void D_FillRect(vrect_t *vrect, int color);
 void D_DrawRect();
@@ -192,7 +203,7 @@ typedef struct
 	int surfheight;     // in mipmapped texels
 } drawsurf_t;
 
-extern drawsurf_t r_drawsurf;
+extern D_THREADLOCAL drawsurf_t r_drawsurf;
 
 void R_DrawSurface();
 void R_GenTile(msurface_t *psurf, void *pdest);
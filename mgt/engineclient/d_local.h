@@ -38,17 +38,28 @@
 
 #define SURFCACHE_SIZE_AT_320X200 600 * 1024
 
+// the cache is carved into slabs of SURFCACHE_SLAB_SIZE bytes, every slab
+// holds blocks of one size class
+#define SURFCACHE_SLAB_SIZE 0x20000
+#define SURFCACHE_MIN_SLABS 16
+#define SURFCACHE_MAX_SLABS 1024
+
 typedef struct surfcache_s
 {
-	struct surfcache_s *next;
+	struct surfcache_s *next;   // lru or free list of the size class
+	struct surfcache_s *prev;
 	struct surfcache_s **owner; // nullptr is an empty chunk of memory
 	int lightadj[MAXLIGHTMAPS]; // checked for strobe flush
 	int dlight;
-	int size; // including header
+	int lightframe;             // r_framecount it was lit in
+	int lastframe;              // r_framecount of the last use
+	int size;                   // including header, the size of the class
+	int slab;
 	unsigned width;
 	unsigned height; // DEBUG only needed for debug
 	float mipscale;
 	struct texture_s *texture; // checked for animating textures
+	int drawbatch;             // d_drawbatch while spans using it wait to be drawn
 	byte data[4];              // width*height elements
 } surfcache_t;
 
@@ -59,22 +70,56 @@ typedef struct sspan_s
 } sspan_t;
 
 extern cvar_t d_subdiv16;
+extern cvar_t r_rasterthreads;
+
+// the span drawing of each D_DrawSurfaces pass is split into horizontal
+// bands that are rasterized in parallel
+#define MAX_RASTER_BANDS 16
+
+extern int d_drawbatch;
+
+void D_FlushSurfaceBatch();
+void D_RunJobs(int numthreads, int numjobs, void (*func)(int job));
+void D_StartJobs(int numthreads, int numjobs, void (*func)(int job));
+void D_WaitJobs();
+
+extern cvar_t d_scprebuild;
+
+void D_PrebuildSurfaces();
 
 extern float scale_for_mip;
 
-extern qboolean d_roverwrapped;
-extern surfcache_t *sc_rover;
-extern surfcache_t *d_initial_rover;
 
-extern float d_sdivzstepu, d_tdivzstepu, d_zistepu;
-extern float d_sdivzstepv, d_tdivzstepv, d_zistepv;
-extern float d_sdivzorigin, d_tdivzorigin, d_ziorigin;
+extern D_THREADLOCAL float d_sdivzstepu, d_tdivzstepu, d_zistepu;
+extern D_THREADLOCAL float d_sdivzstepv, d_tdivzstepv, d_zistepv;
+extern D_THREADLOCAL float d_sdivzorigin, d_tdivzorigin, d_ziorigin;
 
-fixed16_t sadjust, tadjust;
-fixed16_t bbextents, bbextentt;
+extern D_THREADLOCAL fixed16_t sadjust, tadjust;
+extern D_THREADLOCAL fixed16_t bbextents, bbextentt;
 
 void D_DrawSpans8(espan_t *pspans);
 void D_DrawSpans16(espan_t *pspans);
+
+// vector span drawer for builds without the asm ones, x86-64 always has SSE2
+#if !id386 && (defined(__SSE2__) || defined(_M_X64))
+#define D_SIMDSPANS 1
+void D_DrawSpans8SSE(espan_t *pspans);
+void (*D_VectorDrawSpans8())(espan_t *pspans);
+void D_SpanBench_f();
+#else
+#define D_SIMDSPANS 0
+#endif
+
+// the AVX2 one is compiled in whatever the target flags and only used when
+// cpuid says the machine has it
+#if D_SIMDSPANS && (defined(__GNUC__) || defined(_MSC_VER))
+#define D_AVX2SPANS 1
+void D_DrawSpans8AVX2(espan_t *pspans);
+#else
+#define D_AVX2SPANS 0
+#endif
+
+extern cvar_t d_simdspans;
 void D_DrawZSpans(espan_t *pspans);
 void Turbulent8(espan_t *pspan);
 void D_SpriteDrawSpans(sspan_t *pspan);
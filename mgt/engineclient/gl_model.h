@@ -89,6 +89,7 @@ typedef struct glpoly_s
 	struct glpoly_s *chain;
 	int numverts;
 	int flags;                  // for SURF_UNDERWATER
+	int firstvert;              // in the brush vertex buffer, -1 if not in it
 	float verts[4][VERTEXSIZE]; // variable sized (xyz s1t1 s2t2)
 } glpoly_t;
 
@@ -100,6 +100,8 @@ extern PROC glVertexPointerEXT;
 #define BACKFACE_EPSILON 0.01
 
 void R_TimeRefresh_f();
+void R_LightmapBench_f();
+void R_ClearWorldCache();
 void R_ReadPointFile_f();
 texture_t *R_TextureAnimation(texture_t *base);
 
@@ -212,6 +214,8 @@ extern cvar_t gl_clear;
 extern cvar_t gl_cull;
 extern cvar_t gl_poly;
 extern cvar_t gl_texsort;
+extern cvar_t gl_vertexbuffers;
+extern cvar_t gl_worldcache;
 extern cvar_t gl_smoothmodels;
 extern cvar_t gl_affinemodels;
 extern cvar_t gl_polyblend;
@@ -259,3 +263,30 @@ extern qboolean gl_mtexable;
 
 void GL_DisableMultitexture();
 void GL_EnableMultitexture();
+
+// Buffer objects (ARB_vertex_buffer_object, ARB_pixel_buffer_object)
+#define ARRAY_BUFFER_ARB 0x8892
+#define PIXEL_UNPACK_BUFFER_ARB 0x88EC
+#define STREAM_DRAW_ARB 0x88E0
+#define STATIC_DRAW_ARB 0x88E4
+#define WRITE_ONLY_ARB 0x88B9
+
+typedef void(APIENTRY *lpGenBuffersFUNC)(GLsizei, GLuint *);
+typedef void(APIENTRY *lpDeleteBuffersFUNC)(GLsizei, const GLuint *);
+typedef void(APIENTRY *lpBindBufferFUNC)(GLenum, GLuint);
+typedef void(APIENTRY *lpBufferDataFUNC)(GLenum, ptrdiff_t, const GLvoid *, GLenum);
+typedef GLvoid *(APIENTRY *lpMapBufferFUNC)(GLenum, GLenum);
+typedef GLboolean(APIENTRY *lpUnmapBufferFUNC)(GLenum);
+extern lpGenBuffersFUNC qglGenBuffersARB;
+extern lpDeleteBuffersFUNC qglDeleteBuffersARB;
+extern lpBindBufferFUNC qglBindBufferARB;
+extern lpBufferDataFUNC qglBufferDataARB;
+extern lpMapBufferFUNC qglMapBufferARB;
+extern lpUnmapBufferFUNC qglUnmapBufferARB;
+
+extern qboolean gl_vboable; // vertex buffer objects
+extern qboolean gl_pboable; // pixel unpack buffers as well
+
+void GL_CheckBufferObjectExtensions (void *(*getproc) (const char *name));
+
+extern int c_lightmap_uploads, c_lightmap_bytes;
@@ -0,0 +1,430 @@
+/*
+ * This file is part of OGSNext Engine
+ *
+ * Copyright (C) 1996-1997 Id Software, Inc.
+ * Copyright (C) 2018, 2020 BlackPhrase
+ *
+ * OGSNext Engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OGSNext Engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OGSNext Engine. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// @file
+/// @brief lightmap building kernels shared by the gl and soft surface builders
+///
+/// Every kernel works on the 8.8 blocklights of one surface (at most 18*18
+/// luxels) and has a plain C reference version (the _C ones) next to the
+/// SSE2/AVX2 one that the R_Lightmap* entry points use when available.
+/// "lightmapbench" times the two against each other.
+
+#pragma once
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define R_LIGHTMAP_SIMD 1
+#include <emmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#else
+#define R_LIGHTMAP_SIMD 0
+#endif
+
+#define LIGHTMAP_MAX_SMAX 18
+#define LIGHTMAP_MAX_LUXELS (LIGHTMAP_MAX_SMAX * LIGHTMAP_MAX_SMAX)
+
+//============================================================================
+// C reference versions
+
+/// bl[i] = value
+inline void R_LightmapFill_C(unsigned *bl, int size, unsigned value)
+{
+	for(int i = 0; i < size; i++)
+		bl[i] = value;
+}
+
+/// bl[i] += lightmap[i] * scale, one lightstyle
+inline void R_LightmapAddStyle_C(unsigned *bl, const byte *lightmap, int size, unsigned scale)
+{
+	for(int i = 0; i < size; i++)
+		bl[i] += lightmap[i] * scale;
+}
+
+/// Adds a dynamic light, local is the light impact in surface luxel
+/// space (texture coords minus texturemins), minlight is rad - the light's minlight
+inline void R_LightmapAddDlight_C(unsigned *bl, int smax, int tmax, const float *local, float rad, float minlight)
+{
+	int sd, td;
+	float dist;
+
+	for(int t = 0; t < tmax; t++)
+	{
+		td = local[1] - t * 16;
+		if(td < 0)
+			td = -td;
+		for(int s = 0; s < smax; s++)
+		{
+			sd = local[0] - s * 16;
+			if(sd < 0)
+				sd = -sd;
+			if(sd > td)
+				dist = sd + (td >> 1);
+			else
+				dist = td + (sd >> 1);
+			if(dist < minlight)
+				bl[t * smax + s] += (rad - dist) * 256;
+		}
+	}
+}
+
+/// Soft renderer: bound, invert and shift into the colormap light range
+inline void R_LightmapShade_C(unsigned *bl, int size)
+{
+	int t;
+
+	for(int i = 0; i < size; i++)
+	{
+		t = (255 * 256 - (int)bl[i]) >> (8 - VID_CBITS);
+
+		if(t < (1 << 6))
+			t = (1 << 6);
+
+		bl[i] = t;
+	}
+}
+
+/// GL renderer: bound, invert and store the luxels as bytes, step is the
+/// distance between two luxels in dest (1, or 4 for the alpha of GL_RGBA)
+inline void R_LightmapStore_C(const unsigned *bl, int smax, int tmax, byte *dest, int stride, int step)
+{
+	unsigned t;
+
+	for(int i = 0; i < tmax; i++, dest += stride)
+	{
+		for(int j = 0; j < smax; j++)
+		{
+			t = *bl++;
+			t >>= 7;
+			if(t > 255)
+				t = 255;
+			dest[j * step] = 255 - t;
+		}
+	}
+}
+
+#if R_LIGHTMAP_SIMD
+
+//============================================================================
+// SSE2/AVX2 versions
+
+/// SSE2 has no 32 bit min/max, select by compare mask
+inline __m128i R_LightmapSelect(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline void R_LightmapFill_SIMD(unsigned *bl, int size, unsigned value)
+{
+	__m128i v = _mm_set1_epi32(value);
+	int i;
+
+	for(i = 0; i + 4 <= size; i += 4)
+		_mm_storeu_si128((__m128i *)(bl + i), v);
+	for(; i < size; i++)
+		bl[i] = value;
+}
+
+inline void R_LightmapAddStyle_SIMD(unsigned *bl, const byte *lightmap, int size, unsigned scale)
+{
+	int i = 0;
+
+#ifdef __AVX2__
+	__m256i vscale = _mm256_set1_epi32(scale);
+
+	for(; i + 8 <= size; i += 8)
+	{
+		__m256i samples = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(lightmap + i)));
+		__m256i sum = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(bl + i)),
+		                               _mm256_mullo_epi32(samples, vscale));
+		_mm256_storeu_si256((__m256i *)(bl + i), sum);
+	}
+#else
+	// the styles are 8.8 fractions well below 0x10000, so the 16 bit
+	// multiplies give the full 32 bit products in two halves
+	__m128i vscale = _mm_set1_epi16((short)scale);
+	__m128i zero = _mm_setzero_si128();
+
+	for(; i + 8 <= size; i += 8)
+	{
+		__m128i samples = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(lightmap + i)), zero);
+		__m128i lo = _mm_mullo_epi16(samples, vscale);
+		__m128i hi = _mm_mulhi_epu16(samples, vscale);
+
+		_mm_storeu_si128((__m128i *)(bl + i),
+		                 _mm_add_epi32(_mm_loadu_si128((const __m128i *)(bl + i)), _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128((__m128i *)(bl + i + 4),
+		                 _mm_add_epi32(_mm_loadu_si128((const __m128i *)(bl + i + 4)), _mm_unpackhi_epi16(lo, hi)));
+	}
+#endif
+
+	for(; i < size; i++)
+		bl[i] += lightmap[i] * scale;
+}
+
+inline void R_LightmapAddDlight_SIMD(unsigned *bl, int smax, int tmax, const float *local, float rad, float minlight)
+{
+	const __m128 vminlight = _mm_set1_ps(minlight);
+	const __m128 vrad = _mm_set1_ps(rad);
+	const __m128 v256 = _mm_set1_ps(256.0f);
+	const __m128 ramp = _mm_setr_ps(0, 16, 32, 48);
+	__m128i vtd, vsd, vmax, vmin, mask;
+	__m128 dist, add;
+	int t, s, td;
+	unsigned *row;
+
+	for(t = 0; t < tmax; t++)
+	{
+		td = local[1] - t * 16;
+		if(td < 0)
+			td = -td;
+		vtd = _mm_set1_epi32(td);
+		row = bl + t * smax;
+
+		for(s = 0; s + 4 <= smax; s += 4)
+		{
+			// same truncation as the int conversion in the C version
+			vsd = _mm_cvttps_epi32(_mm_sub_ps(_mm_set1_ps(local[0] - s * 16), ramp));
+			// |sd|, the values are far from INT_MIN
+			vsd = _mm_sub_epi32(_mm_xor_si128(vsd, _mm_srai_epi32(vsd, 31)), _mm_srai_epi32(vsd, 31));
+
+			mask = _mm_cmpgt_epi32(vsd, vtd);
+			vmax = R_LightmapSelect(mask, vsd, vtd);
+			vmin = R_LightmapSelect(mask, vtd, vsd);
+			dist = _mm_cvtepi32_ps(_mm_add_epi32(vmax, _mm_srai_epi32(vmin, 1)));
+
+			add = _mm_mul_ps(_mm_sub_ps(vrad, dist), v256);
+			mask = _mm_castps_si128(_mm_cmplt_ps(dist, vminlight));
+
+			_mm_storeu_si128((__m128i *)(row + s),
+			                 _mm_add_epi32(_mm_loadu_si128((const __m128i *)(row + s)),
+			                               _mm_and_si128(mask, _mm_cvttps_epi32(add))));
+		}
+
+		for(; s < smax; s++)
+		{
+			int sd = local[0] - s * 16;
+			float d;
+
+			if(sd < 0)
+				sd = -sd;
+			if(sd > td)
+				d = sd + (td >> 1);
+			else
+				d = td + (sd >> 1);
+			if(d < minlight)
+				row[s] += (int)((rad - d) * 256);
+		}
+	}
+}
+
+inline void R_LightmapShade_SIMD(unsigned *bl, int size)
+{
+	const __m128i full = _mm_set1_epi32(255 * 256);
+	const __m128i darkest = _mm_set1_epi32(1 << 6);
+	__m128i t;
+	int i;
+
+	for(i = 0; i + 4 <= size; i += 4)
+	{
+		t = _mm_srai_epi32(_mm_sub_epi32(full, _mm_loadu_si128((const __m128i *)(bl + i))), 8 - VID_CBITS);
+		t = R_LightmapSelect(_mm_cmplt_epi32(t, darkest), darkest, t);
+		_mm_storeu_si128((__m128i *)(bl + i), t);
+	}
+
+	R_LightmapShade_C(bl + i, size - i);
+}
+
+inline void R_LightmapStore_SIMD(const unsigned *bl, int smax, int tmax, byte *dest, int stride, int step)
+{
+	const __m128i white = _mm_set1_epi8((char)255);
+	__m128i lo, hi, t;
+	byte row[LIGHTMAP_MAX_SMAX];
+	unsigned u;
+	int i, j;
+
+	for(i = 0; i < tmax; i++, dest += stride, bl += smax)
+	{
+		// luxels >> 7 saturated to a byte and inverted, 8 at a time; the
+		// signed pack is fine since >> 7 leaves at most 25 bits, anything
+		// above 0x7fff saturates on the way to the byte anyway
+		for(j = 0; j + 8 <= smax; j += 8)
+		{
+			lo = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(bl + j)), 7);
+			hi = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(bl + j + 4)), 7);
+			t = _mm_packus_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+			_mm_storel_epi64((__m128i *)(row + j), _mm_sub_epi8(white, t));
+		}
+		for(; j < smax; j++)
+		{
+			u = bl[j] >> 7;
+			row[j] = 255 - (u > 255 ? 255 : u);
+		}
+
+		if(step == 1)
+			memcpy(dest, row, smax);
+		else
+			for(j = 0; j < smax; j++)
+				dest[j * step] = row[j];
+	}
+}
+
+#endif // R_LIGHTMAP_SIMD
+
+//============================================================================
+// entry points
+
+inline void R_LightmapFill(unsigned *bl, int size, unsigned value)
+{
+#if R_LIGHTMAP_SIMD
+	R_LightmapFill_SIMD(bl, size, value);
+#else
+	R_LightmapFill_C(bl, size, value);
+#endif
+}
+
+inline void R_LightmapAddStyle(unsigned *bl, const byte *lightmap, int size, unsigned scale)
+{
+#if R_LIGHTMAP_SIMD
+	R_LightmapAddStyle_SIMD(bl, lightmap, size, scale);
+#else
+	R_LightmapAddStyle_C(bl, lightmap, size, scale);
+#endif
+}
+
+inline void R_LightmapAddDlight(unsigned *bl, int smax, int tmax, const float *local, float rad, float minlight)
+{
+#if R_LIGHTMAP_SIMD
+	R_LightmapAddDlight_SIMD(bl, smax, tmax, local, rad, minlight);
+#else
+	R_LightmapAddDlight_C(bl, smax, tmax, local, rad, minlight);
+#endif
+}
+
+inline void R_LightmapShade(unsigned *bl, int size)
+{
+#if R_LIGHTMAP_SIMD
+	R_LightmapShade_SIMD(bl, size);
+#else
+	R_LightmapShade_C(bl, size);
+#endif
+}
+
+inline void R_LightmapStore(const unsigned *bl, int smax, int tmax, byte *dest, int stride, int step)
+{
+#if R_LIGHTMAP_SIMD
+	R_LightmapStore_SIMD(bl, smax, tmax, dest, stride, step);
+#else
+	R_LightmapStore_C(bl, smax, tmax, dest, stride, step);
+#endif
+}
+
+//============================================================================
+
+/// Backs the "lightmapbench" command: builds synthetic lightmaps of every
+/// size passes times with both the C and the vector kernels and returns the
+/// largest difference between the two results, or -1 if there is no vector
+/// path in this build
+inline int R_LightmapBench(int passes, double *ctime, double *vectime)
+{
+#if R_LIGHTMAP_SIMD
+	static unsigned blc[LIGHTMAP_MAX_LUXELS], bls[LIGHTMAP_MAX_LUXELS];
+	static byte samples[MAXLIGHTMAPS][LIGHTMAP_MAX_LUXELS];
+	static byte destc[LIGHTMAP_MAX_LUXELS * 4], dests[LIGHTMAP_MAX_LUXELS * 4];
+	unsigned seed = 0x1234567;
+	int diff, maxdiff, variant, pass, smax, tmax, size, maps, l;
+	float local[2], rad, minlight;
+	double start;
+
+	for(maps = 0; maps < MAXLIGHTMAPS; maps++)
+		for(l = 0; l < LIGHTMAP_MAX_LUXELS; l++)
+		{
+			seed = seed * 1103515245 + 12345;
+			samples[maps][l] = seed >> 16;
+		}
+
+	maxdiff = 0;
+
+	// C timing, vector timing, then one pass of both to compare
+	for(variant = 0; variant < 3; variant++)
+	{
+		start = Sys_FloatTime();
+
+		for(pass = 0; pass < (variant == 2 ? 1 : passes); pass++)
+			for(smax = 1; smax <= LIGHTMAP_MAX_SMAX; smax++)
+				for(tmax = 1; tmax <= LIGHTMAP_MAX_SMAX; tmax++)
+				{
+					size = smax * tmax;
+
+					// a few dlights around the surface, some of them only
+					// partly touching it
+					local[0] = (smax * 37) % 300 - 20;
+					local[1] = (tmax * 53) % 300 - 20;
+					rad = 100 + smax * 8;
+					minlight = rad - 8;
+
+					if(variant != 1)
+					{
+						R_LightmapFill_C(blc, size, 24 << 8);
+						for(maps = 0; maps < MAXLIGHTMAPS; maps++)
+							R_LightmapAddStyle_C(blc, samples[maps], size, 64 + maps * 70);
+						for(l = 0; l < 4; l++)
+							R_LightmapAddDlight_C(blc, smax, tmax, local, rad + l * 40, minlight + l * 40);
+						R_LightmapStore_C(blc, smax, tmax, destc + 3, smax * 4, 4);
+						R_LightmapShade_C(blc, size);
+					}
+
+					if(variant != 0)
+					{
+						R_LightmapFill_SIMD(bls, size, 24 << 8);
+						for(maps = 0; maps < MAXLIGHTMAPS; maps++)
+							R_LightmapAddStyle_SIMD(bls, samples[maps], size, 64 + maps * 70);
+						for(l = 0; l < 4; l++)
+							R_LightmapAddDlight_SIMD(bls, smax, tmax, local, rad + l * 40, minlight + l * 40);
+						R_LightmapStore_SIMD(bls, smax, tmax, dests + 3, smax * 4, 4);
+						R_LightmapShade_SIMD(bls, size);
+					}
+
+					if(variant == 2)
+					{
+						for(l = 0; l < size; l++)
+						{
+							diff = abs((int)blc[l] - (int)bls[l]);
+							if(diff > maxdiff)
+								maxdiff = diff;
+							diff = abs(destc[l * 4 + 3] - dests[l * 4 + 3]);
+							if(diff > maxdiff)
+								maxdiff = diff;
+						}
+					}
+				}
+
+		if(variant == 0)
+			*ctime = Sys_FloatTime() - start;
+		else if(variant == 1)
+			*vectime = Sys_FloatTime() - start;
+	}
+
+	return maxdiff;
+#else
+	*ctime = *vectime = 0;
+	return -1;
+#endif
+}
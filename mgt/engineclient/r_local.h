@@ -194,8 +194,8 @@ extern int *pfrustum_indexes[4];
 extern int ubasestep, errorterm, erroradjustup, erroradjustdown;
 extern int vstartscan;
 
-extern fixed16_t sadjust, tadjust;
-extern fixed16_t bbextents, bbextentt;
+extern D_THREADLOCAL fixed16_t sadjust, tadjust;
+extern D_THREADLOCAL fixed16_t bbextents, bbextentt;
 
 #define MAXBVERTINDEXES 1000 // new clipped vertices when clipping bmodels
                              //  to the world BSP
@@ -306,6 +306,7 @@ extern qboolean r_fov_greater_than_90;
 
 void R_StoreEfrags(efrag_t **ppefrag);
 void R_TimeRefresh_f();
+void R_LightmapBench_f();
 void R_TimeGraph();
 void R_PrintAliasStats();
 void R_PrintTimes();
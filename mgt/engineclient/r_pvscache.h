@@ -0,0 +1,154 @@
+/*
+ * This file is part of OGSNext Engine
+ *
+ * Copyright (C) 1996-1997 Id Software, Inc.
+ * Copyright (C) 2018, 2020 BlackPhrase
+ *
+ * OGSNext Engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * OGSNext Engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OGSNext Engine. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// @file
+/// @brief per-viewleaf cache of the nodes and leafs R_MarkLeaves marks
+///
+/// Marking a leaf's PVS means decompressing its row and climbing from every
+/// visible leaf up to the root. The result only depends on the leaf, so the
+/// last PVS_CACHE_SIZE of them are kept as bitsets over the nodes and leafs
+/// of the world and replayed when the view goes back into one of them (going
+/// back and forth over a leaf boundary, or around a few rooms)
+
+#pragma once
+
+#define PVS_CACHE_SIZE 32
+
+typedef struct
+{
+	mleaf_t *leaf;    // nullptr if the entry is unused
+	int lastused;     // for the least recently used replacement
+	unsigned *marked; // one bit per node, then one per leaf (leafs[0] included)
+} pvscacheentry_t;
+
+typedef struct
+{
+	model_t *model; // world the bitsets were allocated for
+	int numwords;
+	int time;
+	int hits, misses;
+	pvscacheentry_t entries[PVS_CACHE_SIZE];
+} pvscache_t;
+
+inline pvscache_t r_pvscache;
+
+/// Called from R_NewMap; the bitsets go on the hunk with the rest of the map
+inline void R_ClearPVSCache(model_t *world)
+{
+	memset(&r_pvscache, 0, sizeof(r_pvscache));
+
+	r_pvscache.model = world;
+	r_pvscache.numwords = (world->numnodes + world->numleafs + 1 + 31) >> 5;
+
+	for(int i = 0; i < PVS_CACHE_SIZE; i++)
+		r_pvscache.entries[i].marked = (unsigned *)Hunk_AllocName(r_pvscache.numwords * sizeof(unsigned), "pvscache");
+}
+
+/// Plain PVS marking, also records every node it marks in marked if that is set
+inline void R_MarkPVS(model_t *world, byte *vis, int visframe, unsigned *marked)
+{
+	mnode_t *node;
+	int bit;
+
+	for(int i = 0; i < world->numleafs; i++)
+	{
+		if(!(vis[i >> 3] & (1 << (i & 7))))
+			continue;
+
+		node = (mnode_t *)&world->leafs[i + 1];
+		do
+		{
+			if(node->visframe == visframe)
+				break;
+			node->visframe = visframe;
+
+			if(marked)
+			{
+				if(node->contents < 0)
+					bit = world->numnodes + ((mleaf_t *)node - world->leafs);
+				else
+					bit = node - world->nodes;
+				marked[bit >> 5] |= 1u << (bit & 31);
+			}
+
+			node = node->parent;
+		} while(node);
+	}
+}
+
+/// Sets visframe on everything in the PVS of leaf, from the cache if the
+/// view was in that leaf recently
+inline void R_MarkLeavesCached(model_t *world, mleaf_t *leaf, int visframe)
+{
+	pvscacheentry_t *entry, *oldest;
+	mnode_t *node;
+	unsigned bits;
+	int i, bit;
+
+	if(world != r_pvscache.model)
+	{
+		// no R_NewMap for this one (yet), nothing to cache into
+		R_MarkPVS(world, Mod_LeafPVS(leaf, world), visframe, nullptr);
+		return;
+	}
+
+	r_pvscache.time++;
+
+	oldest = &r_pvscache.entries[0];
+	for(i = 0, entry = r_pvscache.entries; i < PVS_CACHE_SIZE; i++, entry++)
+	{
+		if(entry->leaf == leaf)
+			break;
+		if(entry->lastused < oldest->lastused)
+			oldest = entry;
+	}
+
+	if(i == PVS_CACHE_SIZE)
+	{
+		r_pvscache.misses++;
+
+		entry = oldest;
+		entry->leaf = leaf;
+		entry->lastused = r_pvscache.time;
+		memset(entry->marked, 0, r_pvscache.numwords * sizeof(unsigned));
+
+		R_MarkPVS(world, Mod_LeafPVS(leaf, world), visframe, entry->marked);
+		return;
+	}
+
+	r_pvscache.hits++;
+	entry->lastused = r_pvscache.time;
+
+	// the marked sets are sparse, so whole empty words go by quickly
+	for(i = 0; i < r_pvscache.numwords; i++)
+	{
+		for(bits = entry->marked[i], bit = i << 5; bits; bits >>= 1, bit++)
+		{
+			if(!(bits & 1))
+				continue;
+
+			if(bit < world->numnodes)
+				node = &world->nodes[bit];
+			else
+				node = (mnode_t *)&world->leafs[bit - world->numnodes];
+			node->visframe = visframe;
+		}
+	}
+}
@@ -48,8 +48,9 @@
 
 extern void R_DrawLine(polyvert_t *polyvert0, polyvert_t *polyvert1);
 
-extern int cachewidth;
-extern pixel_t *cacheblock;
+// per surface drawing state, each raster band thread keeps its own copy
+extern D_THREADLOCAL int cachewidth;
+extern D_THREADLOCAL pixel_t *cacheblock;
 extern int screenwidth;
 
 extern float pixelAspect;
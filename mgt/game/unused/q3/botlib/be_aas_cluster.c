@@ -1483,13 +1483,13 @@ void AAS_InitClustering(void)
 	//remove all portals that are not closing a cluster
 	//AAS_RemoveNotClusterClosingPortals();
 	//initialize portal memory
-	if (aasworld.portals) FreeMemory(aasworld.portals);
+	AAS_FreeAASLump(aasworld.portals);
 	aasworld.portals = (aas_portal_t *) GetClearedMemory(AAS_MAX_PORTALS * sizeof(aas_portal_t));
 	//initialize portal index memory
-	if (aasworld.portalindex) FreeMemory(aasworld.portalindex);
+	AAS_FreeAASLump(aasworld.portalindex);
 	aasworld.portalindex = (aas_portalindex_t *) GetClearedMemory(AAS_MAX_PORTALINDEXSIZE * sizeof(aas_portalindex_t));
 	//initialize cluster memory
-	if (aasworld.clusters) FreeMemory(aasworld.clusters);
+	AAS_FreeAASLump(aasworld.clusters);
 	aasworld.clusters = (aas_cluster_t *) GetClearedMemory(AAS_MAX_CLUSTERS * sizeof(aas_cluster_t));
 	//
 	removedPortalAreas = 0;
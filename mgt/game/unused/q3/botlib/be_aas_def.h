@@ -144,6 +144,7 @@ typedef struct aas_settings_s
 typedef struct aas_routingcache_s
 {
 	byte type;									//portal or area cache
+	byte permanent;								//not in the time list, never freed to make room
 	float time;									//last time accessed or updated
 	int size;									//size of the routing cache
 	int cluster;								//cluster the cache is for
@@ -176,6 +177,11 @@ typedef struct aas_reversedlink_s
 	int linknum;								//the aas_areareachability_t
 	int areanum;								//reachable from this area
 	struct aas_reversedlink_s *next;			//next link
+	//copied from the reachability and areas so the routing doesn't have to look them up
+	int travelflags;							//travel flag of the travel type and contents travel flags
+	int cluster;								//cluster of the area reachable from
+	unsigned short int traveltime;				//travel time of the reachability
+	unsigned char reachnum;						//reachability number within the area reachable from
 } aas_reversedlink_t;
 
 //reversed area reachability
@@ -245,6 +251,10 @@ typedef struct aas_s
 	//clusters
 	int numclusters;
 	aas_cluster_t *clusters;
+	//all the lumps of the loaded file in one block, the arrays above point into it
+	char *lumpdata;
+	int lumpdatastart;
+	int lumpdatasize;
 	//
 	int numreachabilityareas;
 	float reachabilitytime;
@@ -174,6 +174,20 @@ void AAS_SwapAASData(void)
 	} //end for
 } //end of the function AAS_SwapAASData
 //===========================================================================
+// free a lump array unless it points into the block the file was read into
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void AAS_FreeAASLump(void *ptr)
+{
+	if (!ptr) return;
+	if (aasworld.lumpdata && (char *) ptr >= aasworld.lumpdata &&
+			(char *) ptr < aasworld.lumpdata + aasworld.lumpdatasize) return;
+	FreeMemory(ptr);
+} //end of the function AAS_FreeAASLump
+//===========================================================================
 // dump the current loaded aas file
 //
 // Parameter:				-
@@ -183,48 +197,52 @@ void AAS_SwapAASData(void)
 void AAS_DumpAASData(void)
 {
 	aasworld.numbboxes = 0;
-	if (aasworld.bboxes) FreeMemory(aasworld.bboxes);
+	AAS_FreeAASLump(aasworld.bboxes);
 	aasworld.bboxes = NULL;
 	aasworld.numvertexes = 0;
-	if (aasworld.vertexes) FreeMemory(aasworld.vertexes);
+	AAS_FreeAASLump(aasworld.vertexes);
 	aasworld.vertexes = NULL;
 	aasworld.numplanes = 0;
-	if (aasworld.planes) FreeMemory(aasworld.planes);
+	AAS_FreeAASLump(aasworld.planes);
 	aasworld.planes = NULL;
 	aasworld.numedges = 0;
-	if (aasworld.edges) FreeMemory(aasworld.edges);
+	AAS_FreeAASLump(aasworld.edges);
 	aasworld.edges = NULL;
 	aasworld.edgeindexsize = 0;
-	if (aasworld.edgeindex) FreeMemory(aasworld.edgeindex);
+	AAS_FreeAASLump(aasworld.edgeindex);
 	aasworld.edgeindex = NULL;
 	aasworld.numfaces = 0;
-	if (aasworld.faces) FreeMemory(aasworld.faces);
+	AAS_FreeAASLump(aasworld.faces);
 	aasworld.faces = NULL;
 	aasworld.faceindexsize = 0;
-	if (aasworld.faceindex) FreeMemory(aasworld.faceindex);
+	AAS_FreeAASLump(aasworld.faceindex);
 	aasworld.faceindex = NULL;
 	aasworld.numareas = 0;
-	if (aasworld.areas) FreeMemory(aasworld.areas);
+	AAS_FreeAASLump(aasworld.areas);
 	aasworld.areas = NULL;
 	aasworld.numareasettings = 0;
-	if (aasworld.areasettings) FreeMemory(aasworld.areasettings);
+	AAS_FreeAASLump(aasworld.areasettings);
 	aasworld.areasettings = NULL;
 	aasworld.reachabilitysize = 0;
-	if (aasworld.reachability) FreeMemory(aasworld.reachability);
+	AAS_FreeAASLump(aasworld.reachability);
 	aasworld.reachability = NULL;
 	aasworld.numnodes = 0;
-	if (aasworld.nodes) FreeMemory(aasworld.nodes);
+	AAS_FreeAASLump(aasworld.nodes);
 	aasworld.nodes = NULL;
 	aasworld.numportals = 0;
-	if (aasworld.portals) FreeMemory(aasworld.portals);
+	AAS_FreeAASLump(aasworld.portals);
 	aasworld.portals = NULL;
 	aasworld.numportals = 0;
-	if (aasworld.portalindex) FreeMemory(aasworld.portalindex);
+	AAS_FreeAASLump(aasworld.portalindex);
 	aasworld.portalindex = NULL;
 	aasworld.portalindexsize = 0;
-	if (aasworld.clusters) FreeMemory(aasworld.clusters);
+	AAS_FreeAASLump(aasworld.clusters);
 	aasworld.clusters = NULL;
 	aasworld.numclusters = 0;
+	if (aasworld.lumpdata) FreeMemory(aasworld.lumpdata);
+	aasworld.lumpdata = NULL;
+	aasworld.lumpdatastart = 0;
+	aasworld.lumpdatasize = 0;
 	//
 	aasworld.loaded = qfalse;
 	aasworld.initialized = qfalse;
@@ -281,42 +299,65 @@ void AAS_FileInfo(void)
 } //end of the function AAS_FileInfo
 #endif //AASFILEDEBUG
 //===========================================================================
-// allocate memory and read a lump of a AAS file
+// read all the lumps of a AAS file into one block of memory
+// with one sequential read instead of one allocation and read per lump
 //
 // Parameter:				-
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
-char *AAS_LoadAASLump(fileHandle_t fp, int offset, int length, int *lastoffset, int size)
+int AAS_ReadAASLumps(fileHandle_t fp, aas_header_t *header, int lastoffset)
 {
-	char *buf;
-	//
-	if (!length)
+	int i, offset, length, start, end;
+
+	start = end = 0;
+	for (i = 0; i < AAS_LUMPS; i++)
 	{
-		//just alloc a dummy
-		return (char *) GetClearedHunkMemory(size+1);
-	} //end if
+		offset = LittleLong(header->lumps[i].fileofs);
+		length = LittleLong(header->lumps[i].filelen);
+		if (!length) continue;
+		if (offset < lastoffset || length < 0)
+		{
+			AAS_Error("aas lump %d out of range\n", i);
+			return qfalse;
+		} //end if
+		if (!end || offset < start) start = offset;
+		if (offset + length > end) end = offset + length;
+	} //end for
+	if (!end) return qtrue;
 	//seek to the data
-	if (offset != *lastoffset)
+	if (start != lastoffset)
 	{
 		botimport.Print(PRT_WARNING, "AAS file not sequentially read\n");
-		if (botimport.FS_Seek(fp, offset, FS_SEEK_SET))
+		if (botimport.FS_Seek(fp, start, FS_SEEK_SET))
 		{
 			AAS_Error("can't seek to aas lump\n");
-			AAS_DumpAASData();
-			botimport.FS_FCloseFile(fp);
-			return 0;
+			return qfalse;
 		} //end if
 	} //end if
 	//allocate memory
-	buf = (char *) GetClearedHunkMemory(length+1);
+	aasworld.lumpdata = (char *) GetClearedHunkMemory(end - start + 1);
+	aasworld.lumpdatastart = start;
+	aasworld.lumpdatasize = end - start;
 	//read the data
-	if (length)
+	botimport.FS_Read(aasworld.lumpdata, end - start, fp);
+	return qtrue;
+} //end of the function AAS_ReadAASLumps
+//===========================================================================
+// get a lump of a AAS file from the block the lumps were read into
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+char *AAS_LoadAASLump(int offset, int length, int size)
+{
+	if (!length)
 	{
-		botimport.FS_Read(buf, length, fp );
-		*lastoffset += length;
+		//just alloc a dummy
+		return (char *) GetClearedHunkMemory(size+1);
 	} //end if
-	return buf;
+	return aasworld.lumpdata + offset - aasworld.lumpdatastart;
 } //end of the function AAS_LoadAASLump
 //===========================================================================
 //
@@ -344,7 +385,7 @@ int AAS_LoadAASFile(char *filename)
 {
 	fileHandle_t fp;
 	aas_header_t header;
-	int offset, length, lastoffset;
+	int offset, length;
 
 	botimport.Print(PRT_MESSAGE, "trying to load %s\n", filename);
 	//dump current loaded aas file
@@ -358,7 +399,6 @@ int AAS_LoadAASFile(char *filename)
 	} //end if
 	//read the header
 	botimport.FS_Read(&header, sizeof(aas_header_t), fp );
-	lastoffset = sizeof(aas_header_t);
 	//check header identification
 	header.ident = LittleLong(header.ident);
 	if (header.ident != AASID)
@@ -389,89 +429,96 @@ int AAS_LoadAASFile(char *filename)
 		botimport.FS_FCloseFile(fp);
 		return BLERR_WRONGAASFILEVERSION;
 	} //end if
+	//read the lumps
+	if (!AAS_ReadAASLumps(fp, &header, sizeof(aas_header_t)))
+	{
+		AAS_DumpAASData();
+		botimport.FS_FCloseFile(fp);
+		return BLERR_CANNOTREADAASLUMP;
+	} //end if
 	//load the lumps:
 	//bounding boxes
 	offset = LittleLong(header.lumps[AASLUMP_BBOXES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_BBOXES].filelen);
-	aasworld.bboxes = (aas_bbox_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_bbox_t));
+	aasworld.bboxes = (aas_bbox_t *) AAS_LoadAASLump(offset, length, sizeof(aas_bbox_t));
 	aasworld.numbboxes = length / sizeof(aas_bbox_t);
 	if (aasworld.numbboxes && !aasworld.bboxes) return BLERR_CANNOTREADAASLUMP;
 	//vertexes
 	offset = LittleLong(header.lumps[AASLUMP_VERTEXES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_VERTEXES].filelen);
-	aasworld.vertexes = (aas_vertex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_vertex_t));
+	aasworld.vertexes = (aas_vertex_t *) AAS_LoadAASLump(offset, length, sizeof(aas_vertex_t));
 	aasworld.numvertexes = length / sizeof(aas_vertex_t);
 	if (aasworld.numvertexes && !aasworld.vertexes) return BLERR_CANNOTREADAASLUMP;
 	//planes
 	offset = LittleLong(header.lumps[AASLUMP_PLANES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_PLANES].filelen);
-	aasworld.planes = (aas_plane_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_plane_t));
+	aasworld.planes = (aas_plane_t *) AAS_LoadAASLump(offset, length, sizeof(aas_plane_t));
 	aasworld.numplanes = length / sizeof(aas_plane_t);
 	if (aasworld.numplanes && !aasworld.planes) return BLERR_CANNOTREADAASLUMP;
 	//edges
 	offset = LittleLong(header.lumps[AASLUMP_EDGES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_EDGES].filelen);
-	aasworld.edges = (aas_edge_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_edge_t));
+	aasworld.edges = (aas_edge_t *) AAS_LoadAASLump(offset, length, sizeof(aas_edge_t));
 	aasworld.numedges = length / sizeof(aas_edge_t);
 	if (aasworld.numedges && !aasworld.edges) return BLERR_CANNOTREADAASLUMP;
 	//edgeindex
 	offset = LittleLong(header.lumps[AASLUMP_EDGEINDEX].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_EDGEINDEX].filelen);
-	aasworld.edgeindex = (aas_edgeindex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_edgeindex_t));
+	aasworld.edgeindex = (aas_edgeindex_t *) AAS_LoadAASLump(offset, length, sizeof(aas_edgeindex_t));
 	aasworld.edgeindexsize = length / sizeof(aas_edgeindex_t);
 	if (aasworld.edgeindexsize && !aasworld.edgeindex) return BLERR_CANNOTREADAASLUMP;
 	//faces
 	offset = LittleLong(header.lumps[AASLUMP_FACES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_FACES].filelen);
-	aasworld.faces = (aas_face_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_face_t));
+	aasworld.faces = (aas_face_t *) AAS_LoadAASLump(offset, length, sizeof(aas_face_t));
 	aasworld.numfaces = length / sizeof(aas_face_t);
 	if (aasworld.numfaces && !aasworld.faces) return BLERR_CANNOTREADAASLUMP;
 	//faceindex
 	offset = LittleLong(header.lumps[AASLUMP_FACEINDEX].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_FACEINDEX].filelen);
-	aasworld.faceindex = (aas_faceindex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_faceindex_t));
+	aasworld.faceindex = (aas_faceindex_t *) AAS_LoadAASLump(offset, length, sizeof(aas_faceindex_t));
 	aasworld.faceindexsize = length / sizeof(aas_faceindex_t);
 	if (aasworld.faceindexsize && !aasworld.faceindex) return BLERR_CANNOTREADAASLUMP;
 	//convex areas
 	offset = LittleLong(header.lumps[AASLUMP_AREAS].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_AREAS].filelen);
-	aasworld.areas = (aas_area_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_area_t));
+	aasworld.areas = (aas_area_t *) AAS_LoadAASLump(offset, length, sizeof(aas_area_t));
 	aasworld.numareas = length / sizeof(aas_area_t);
 	if (aasworld.numareas && !aasworld.areas) return BLERR_CANNOTREADAASLUMP;
 	//area settings
 	offset = LittleLong(header.lumps[AASLUMP_AREASETTINGS].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_AREASETTINGS].filelen);
-	aasworld.areasettings = (aas_areasettings_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_areasettings_t));
+	aasworld.areasettings = (aas_areasettings_t *) AAS_LoadAASLump(offset, length, sizeof(aas_areasettings_t));
 	aasworld.numareasettings = length / sizeof(aas_areasettings_t);
 	if (aasworld.numareasettings && !aasworld.areasettings) return BLERR_CANNOTREADAASLUMP;
 	//reachability list
 	offset = LittleLong(header.lumps[AASLUMP_REACHABILITY].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_REACHABILITY].filelen);
-	aasworld.reachability = (aas_reachability_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_reachability_t));
+	aasworld.reachability = (aas_reachability_t *) AAS_LoadAASLump(offset, length, sizeof(aas_reachability_t));
 	aasworld.reachabilitysize = length / sizeof(aas_reachability_t);
 	if (aasworld.reachabilitysize && !aasworld.reachability) return BLERR_CANNOTREADAASLUMP;
 	//nodes
 	offset = LittleLong(header.lumps[AASLUMP_NODES].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_NODES].filelen);
-	aasworld.nodes = (aas_node_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_node_t));
+	aasworld.nodes = (aas_node_t *) AAS_LoadAASLump(offset, length, sizeof(aas_node_t));
 	aasworld.numnodes = length / sizeof(aas_node_t);
 	if (aasworld.numnodes && !aasworld.nodes) return BLERR_CANNOTREADAASLUMP;
 	//cluster portals
 	offset = LittleLong(header.lumps[AASLUMP_PORTALS].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_PORTALS].filelen);
-	aasworld.portals = (aas_portal_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_portal_t));
+	aasworld.portals = (aas_portal_t *) AAS_LoadAASLump(offset, length, sizeof(aas_portal_t));
 	aasworld.numportals = length / sizeof(aas_portal_t);
 	if (aasworld.numportals && !aasworld.portals) return BLERR_CANNOTREADAASLUMP;
 	//cluster portal index
 	offset = LittleLong(header.lumps[AASLUMP_PORTALINDEX].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_PORTALINDEX].filelen);
-	aasworld.portalindex = (aas_portalindex_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_portalindex_t));
+	aasworld.portalindex = (aas_portalindex_t *) AAS_LoadAASLump(offset, length, sizeof(aas_portalindex_t));
 	aasworld.portalindexsize = length / sizeof(aas_portalindex_t);
 	if (aasworld.portalindexsize && !aasworld.portalindex) return BLERR_CANNOTREADAASLUMP;
 	//clusters
 	offset = LittleLong(header.lumps[AASLUMP_CLUSTERS].fileofs);
 	length = LittleLong(header.lumps[AASLUMP_CLUSTERS].filelen);
-	aasworld.clusters = (aas_cluster_t *) AAS_LoadAASLump(fp, offset, length, &lastoffset, sizeof(aas_cluster_t));
+	aasworld.clusters = (aas_cluster_t *) AAS_LoadAASLump(offset, length, sizeof(aas_cluster_t));
 	aasworld.numclusters = length / sizeof(aas_cluster_t);
 	if (aasworld.numclusters && !aasworld.clusters) return BLERR_CANNOTREADAASLUMP;
 	//swap everything
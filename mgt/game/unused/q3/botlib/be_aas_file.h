@@ -36,6 +36,8 @@ int AAS_LoadAASFile(char *filename);
 qboolean AAS_WriteAASFile(char *filename);
 //dumps the loaded AAS data
 void AAS_DumpAASData(void);
+//frees a lump array unless it points into the block the file was read into
+void AAS_FreeAASLump(void *ptr);
 //print AAS file information
 void AAS_FileInfo(void);
 #endif //AASINTERN
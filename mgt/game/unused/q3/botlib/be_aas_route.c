@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "l_script.h"
 #include "l_precomp.h"
 #include "l_struct.h"
+#include "l_threads.h"
 #include "aasfile.h"
 #include "../game/botlib.h"
 #include "../game/be_aas.h"
@@ -83,6 +84,8 @@ int numportalcacheupdates;
 
 int routingcachesize;
 int max_routingcachesize;
+//number of times a routing area was enabled or disabled
+int routingareachanges;
 
 //===========================================================================
 //
@@ -235,7 +238,7 @@ void AAS_LinkCache(aas_routingcache_t *cache)
 //===========================================================================
 void AAS_FreeRoutingCache(aas_routingcache_t *cache)
 {
-	AAS_UnlinkCache(cache);
+	if (!cache->permanent) AAS_UnlinkCache(cache);
 	routingcachesize -= cache->size;
 	FreeMemory(cache);
 } //end of the function AAS_FreeRoutingCache
@@ -330,6 +333,7 @@ int AAS_EnableRoutingArea(int areanum, int enable)
 	{
 		//remove all routing cache involving this area
 		AAS_RemoveRoutingCacheUsingArea( areanum );
+		routingareachanges++;
 	} //end if
 	return !flags;
 } //end of the function AAS_EnableRoutingArea
@@ -339,6 +343,16 @@ int AAS_EnableRoutingArea(int areanum, int enable)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+int AAS_RoutingAreaChanges(void)
+{
+	return routingareachanges;
+} //end of the function AAS_RoutingAreaChanges
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 __inline float AAS_RoutingTime(void)
 {
 	return AAS_Time();
@@ -418,8 +432,9 @@ void AAS_InitAreaContentsTravelFlags(void)
 //===========================================================================
 void AAS_CreateReversedReachability(void)
 {
-	int i, n;
-	aas_reversedlink_t *revlink;
+	int i, n, *linkcount;
+	aas_reversedlink_t *revlink, *links;
+	aas_reversedreachability_t *revreach;
 	aas_reachability_t *reach;
 	aas_areasettings_t *settings;
 	char *ptr;
@@ -437,7 +452,8 @@ void AAS_CreateReversedReachability(void)
 	aasworld.reversedreachability = (aas_reversedreachability_t *) ptr;
 	//pointer to the memory for the reversed links
 	ptr += aasworld.numareas * sizeof(aas_reversedreachability_t);
-	//check all reachabilities of all areas
+	links = (aas_reversedlink_t *) ptr;
+	//count the reversed links of every area
 	for (i = 1; i < aasworld.numareas; i++)
 	{
 		//settings of the area
@@ -445,22 +461,48 @@ void AAS_CreateReversedReachability(void)
 		//
 		if (settings->numreachableareas >= 128)
 			botimport.Print(PRT_WARNING, "area %d has more than 128 reachabilities\n", i);
+		//
+		for (n = 0; n < settings->numreachableareas && n < 128; n++)
+		{
+			reach = &aasworld.reachability[settings->firstreachablearea + n];
+			aasworld.reversedreachability[reach->areanum].numlinks++;
+		} //end for
+	} //end for
+	//the links of an area are stored one after the other so the routing
+	//walks through memory in order instead of jumping all over the place
+	linkcount = (int *) GetClearedMemory(aasworld.numareas * sizeof(int));
+	for (i = 0; i < aasworld.numareas; i++)
+	{
+		revreach = &aasworld.reversedreachability[i];
+		if (revreach->numlinks) revreach->first = links;
+		links += revreach->numlinks;
+	} //end for
+	//check all reachabilities of all areas
+	for (i = 1; i < aasworld.numareas; i++)
+	{
+		//settings of the area
+		settings = &aasworld.areasettings[i];
 		//create reversed links for the reachabilities
 		for (n = 0; n < settings->numreachableareas && n < 128; n++)
 		{
 			//reachability link
 			reach = &aasworld.reachability[settings->firstreachablearea + n];
-			//
-			revlink = (aas_reversedlink_t *) ptr;
-			ptr += sizeof(aas_reversedlink_t);
+			revreach = &aasworld.reversedreachability[reach->areanum];
+			//fill the links from the back to keep the order of a list the
+			//links are prepended to
+			revlink = revreach->first + revreach->numlinks - 1 - linkcount[reach->areanum]++;
 			//
 			revlink->areanum = i;
 			revlink->linknum = settings->firstreachablearea + n;
-			revlink->next = aasworld.reversedreachability[reach->areanum].first;
-			aasworld.reversedreachability[reach->areanum].first = revlink;
-			aasworld.reversedreachability[reach->areanum].numlinks++;
+			revlink->travelflags = AAS_TravelFlagForType_inline(reach->traveltype) |
+										AAS_AreaContentsTravelFlags_inline(reach->areanum);
+			revlink->cluster = settings->cluster;
+			revlink->traveltime = reach->traveltime;
+			revlink->reachnum = n;
+			if (revlink < revreach->first + revreach->numlinks - 1) revlink->next = revlink + 1;
 		} //end for
 	} //end for
+	FreeMemory(linkcount);
 #ifdef DEBUG
 	botimport.Print(PRT_MESSAGE, "reversed reachability %d msec\n", Sys_MilliSeconds() - starttime);
 #endif
@@ -1039,6 +1081,8 @@ aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
 	botimport.FS_Read((unsigned char *)cache + sizeof(size), size - sizeof(size), fp);
 	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t) - sizeof(unsigned short) +
 		(size - sizeof(aas_routingcache_t) + sizeof(unsigned short)) / 3 * 2;
+	//caches read from file are never linked in the time list
+	cache->permanent = qtrue;
 	return cache;
 } //end of the function AAS_ReadCache
 //===========================================================================
@@ -1241,6 +1285,8 @@ void AAS_InitRouting(void)
 	max_routingcachesize = 1024 * (int) LibVarValue("max_routingcache", "4096");
 	// read any routing cache if available
 	AAS_ReadRouteCache();
+	// precompute the routing cache used by the bots
+	AAS_PrecomputeRoutingCache(TFL_DEFAULT);
 } //end of the function AAS_InitRouting
 //===========================================================================
 //
@@ -1282,26 +1328,21 @@ void AAS_FreeRoutingCaches(void)
 // update the given routing cache
 //
 // Parameter:			areacache		: routing cache to update
+//						areaupdate		: routing update fields to use
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+void AAS_CalculateAreaRoutingCache(aas_routingcache_t *areacache, aas_routingupdate_t *areaupdate)
 {
-	int i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
+	int i, nextareanum, cluster, badtravelflags, clusterareanum;
 	int numreachabilityareas;
 	unsigned short int t, startareatraveltimes[128]; //NOTE: not more than 128 reachabilities per area allowed
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
-	aas_reachability_t *reach;
 	aas_reversedreachability_t *revreach;
 	aas_reversedlink_t *revlink;
 
-#ifdef ROUTING_DEBUG
-	numareacacheupdates++;
-#endif //ROUTING_DEBUG
 	//number of reachability areas within this cluster
 	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
-	//
-	aasworld.frameroutingupdates++;
 	//clear the routing update fields
 //	Com_Memset(aasworld.areaupdate, 0, aasworld.numareas * sizeof(aas_routingupdate_t));
 	//
@@ -1312,7 +1353,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 	//
 	Com_Memset(startareatraveltimes, 0, sizeof(startareatraveltimes));
 	//
-	curupdate = &aasworld.areaupdate[clusterareanum];
+	curupdate = &areaupdate[clusterareanum];
 	curupdate->areanum = areacache->areanum;
 	//VectorCopy(areacache->origin, curupdate->start);
 	curupdate->areatraveltimes = startareatraveltimes;
@@ -1339,18 +1380,14 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 		//
 		for (i = 0, revlink = revreach->first; revlink; revlink = revlink->next, i++)
 		{
-			linknum = revlink->linknum;
-			reach = &aasworld.reachability[linknum];
-			//if there is used an undesired travel type
-			if (AAS_TravelFlagForType_inline(reach->traveltype) & badtravelflags) continue;
+			//if there is used an undesired travel type or the next area has a not allowed travel flag
+			if (revlink->travelflags & badtravelflags) continue;
 			//if not allowed to enter the next area
-			if (aasworld.areasettings[reach->areanum].areaflags & AREA_DISABLED) continue;
-			//if the next area has a not allowed travel flag
-			if (AAS_AreaContentsTravelFlags_inline(reach->areanum) & badtravelflags) continue;
+			if (aasworld.areasettings[curupdate->areanum].areaflags & AREA_DISABLED) continue;
 			//number of the area the reversed reachability leads to
 			nextareanum = revlink->areanum;
 			//get the cluster number of the area
-			cluster = aasworld.areasettings[nextareanum].cluster;
+			cluster = revlink->cluster;
 			//don't leave the cluster
 			if (cluster > 0 && cluster != areacache->cluster) continue;
 			//get the number of the area in the cluster
@@ -1361,19 +1398,18 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			t = curupdate->tmptraveltime +
 						//AAS_AreaTravelTime(curupdate->areanum, curupdate->start, reach->end) +
 						curupdate->areatraveltimes[i] +
-							reach->traveltime;
+							revlink->traveltime;
 			//
 			if (!areacache->traveltimes[clusterareanum] ||
 					areacache->traveltimes[clusterareanum] > t)
 			{
 				areacache->traveltimes[clusterareanum] = t;
-				areacache->reachabilities[clusterareanum] = linknum - aasworld.areasettings[nextareanum].firstreachablearea;
-				nextupdate = &aasworld.areaupdate[clusterareanum];
+				areacache->reachabilities[clusterareanum] = revlink->reachnum;
+				nextupdate = &areaupdate[clusterareanum];
 				nextupdate->areanum = nextareanum;
 				nextupdate->tmptraveltime = t;
 				//VectorCopy(reach->start, nextupdate->start);
-				nextupdate->areatraveltimes = aasworld.areatraveltimes[nextareanum][linknum -
-													aasworld.areasettings[nextareanum].firstreachablearea];
+				nextupdate->areatraveltimes = aasworld.areatraveltimes[nextareanum][revlink->reachnum];
 				if (!nextupdate->inlist)
 				{
 					// we add the update to the end of the list
@@ -1389,6 +1425,21 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			} //end if
 		} //end for
 	} //end while
+} //end of the function AAS_CalculateAreaRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+{
+#ifdef ROUTING_DEBUG
+	numareacacheupdates++;
+#endif //ROUTING_DEBUG
+	//
+	aasworld.frameroutingupdates++;
+	AAS_CalculateAreaRoutingCache(areacache, aasworld.areaupdate);
 } //end of the function AAS_UpdateAreaRoutingCache
 //===========================================================================
 //
@@ -1396,21 +1447,39 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int travelflags)
+aas_routingcache_t *AAS_FindAreaRoutingCache(int clusternum, int clusterareanum, int travelflags)
 {
-	int clusterareanum;
-	aas_routingcache_t *cache, *clustercache;
+	aas_routingcache_t *cache;
 
-	//number of the area in the cluster
-	clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
-	//pointer to the cache for the area in the cluster
-	clustercache = aasworld.clusterareacache[clusternum][clusterareanum];
 	//find the cache without undesired travel flags
-	for (cache = clustercache; cache; cache = cache->next)
+	for (cache = aasworld.clusterareacache[clusternum][clusterareanum]; cache; cache = cache->next)
 	{
 		//if there aren't used any undesired travel types for the cache
 		if (cache->travelflags == travelflags) break;
 	} //end for
+	return cache;
+} //end of the function AAS_FindAreaRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int travelflags)
+{
+	int clusterareanum;
+	aas_routingcache_t *cache, *clustercache;
+
+	//number of the area in the cluster
+	clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
+	//
+	cache = AAS_FindAreaRoutingCache(clusternum, clusterareanum, travelflags);
+	//permanent caches never move or get freed, so they can be used without locking
+	if (cache && cache->permanent) return cache;
+	//
+	ThreadLock();
+	//another thread might have created the cache in the meantime
+	if (!cache) cache = AAS_FindAreaRoutingCache(clusternum, clusterareanum, travelflags);
 	//if there was no cache
 	if (!cache)
 	{
@@ -1420,20 +1489,24 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 		VectorCopy(aasworld.areas[areanum].center, cache->origin);
 		cache->starttraveltime = 1;
 		cache->travelflags = travelflags;
+		AAS_UpdateAreaRoutingCache(cache);
+		//only add the cache to the list once it's complete, other threads search the list without locking
+		clustercache = aasworld.clusterareacache[clusternum][clusterareanum];
 		cache->prev = NULL;
 		cache->next = clustercache;
 		if (clustercache) clustercache->prev = cache;
+		ThreadMemoryBarrier();
 		aasworld.clusterareacache[clusternum][clusterareanum] = cache;
-		AAS_UpdateAreaRoutingCache(cache);
 	} //end if
-	else
+	else if (!cache->permanent)
 	{
 		AAS_UnlinkCache(cache);
 	} //end else
 	//the cache has been accessed
 	cache->time = AAS_RoutingTime();
 	cache->type = CACHETYPE_AREA;
-	AAS_LinkCache(cache);
+	if (!cache->permanent) AAS_LinkCache(cache);
+	ThreadUnlock();
 	return cache;
 } //end of the function AAS_GetAreaRoutingCache
 //===========================================================================
@@ -1442,7 +1515,7 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
+void AAS_CalculatePortalRoutingCache(aas_routingcache_t *portalcache, aas_routingupdate_t *portalupdate)
 {
 	int i, portalnum, clusterareanum, clusternum;
 	unsigned short int t;
@@ -1451,13 +1524,10 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 	aas_routingcache_t *cache;
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
 
-#ifdef ROUTING_DEBUG
-	numportalcacheupdates++;
-#endif //ROUTING_DEBUG
 	//clear the routing update fields
 //	Com_Memset(aasworld.portalupdate, 0, (aasworld.numportals+1) * sizeof(aas_routingupdate_t));
 	//
-	curupdate = &aasworld.portalupdate[aasworld.numportals];
+	curupdate = &portalupdate[aasworld.numportals];
 	curupdate->cluster = portalcache->cluster;
 	curupdate->areanum = portalcache->areanum;
 	curupdate->tmptraveltime = portalcache->starttraveltime;
@@ -1506,7 +1576,7 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 					portalcache->traveltimes[portalnum] > t)
 			{
 				portalcache->traveltimes[portalnum] = t;
-				nextupdate = &aasworld.portalupdate[portalnum];
+				nextupdate = &portalupdate[portalnum];
 				if (portal->frontcluster == curupdate->cluster)
 				{
 					nextupdate->cluster = portal->backcluster;
@@ -1533,6 +1603,19 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 			} //end if
 		} //end for
 	} //end while
+} //end of the function AAS_CalculatePortalRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
+{
+#ifdef ROUTING_DEBUG
+	numportalcacheupdates++;
+#endif //ROUTING_DEBUG
+	AAS_CalculatePortalRoutingCache(portalcache, aasworld.portalupdate);
 } //end of the function AAS_UpdatePortalRoutingCache
 //===========================================================================
 //
@@ -1540,7 +1623,7 @@ void AAS_UpdatePortalRoutingCache(aas_routingcache_t *portalcache)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int travelflags)
+aas_routingcache_t *AAS_FindPortalRoutingCache(int areanum, int travelflags)
 {
 	aas_routingcache_t *cache;
 
@@ -1549,6 +1632,25 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 	{
 		if (cache->travelflags == travelflags) break;
 	} //end for
+	return cache;
+} //end of the function AAS_FindPortalRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int travelflags)
+{
+	aas_routingcache_t *cache;
+
+	cache = AAS_FindPortalRoutingCache(areanum, travelflags);
+	//permanent caches never move or get freed, so they can be used without locking
+	if (cache && cache->permanent) return cache;
+	//
+	ThreadLock();
+	//another thread might have created the cache in the meantime
+	if (!cache) cache = AAS_FindPortalRoutingCache(areanum, travelflags);
 	//if the portal routing isn't cached
 	if (!cache)
 	{
@@ -1558,25 +1660,253 @@ aas_routingcache_t *AAS_GetPortalRoutingCache(int clusternum, int areanum, int t
 		VectorCopy(aasworld.areas[areanum].center, cache->origin);
 		cache->starttraveltime = 1;
 		cache->travelflags = travelflags;
-		//add the cache to the cache list
+		//update the cache
+		AAS_UpdatePortalRoutingCache(cache);
+		//add the cache to the cache list once it's complete
 		cache->prev = NULL;
 		cache->next = aasworld.portalcache[areanum];
 		if (aasworld.portalcache[areanum]) aasworld.portalcache[areanum]->prev = cache;
+		ThreadMemoryBarrier();
 		aasworld.portalcache[areanum] = cache;
-		//update the cache
-		AAS_UpdatePortalRoutingCache(cache);
 	} //end if
-	else
+	else if (!cache->permanent)
 	{
 		AAS_UnlinkCache(cache);
 	} //end else
 	//the cache has been accessed
 	cache->time = AAS_RoutingTime();
 	cache->type = CACHETYPE_PORTAL;
-	AAS_LinkCache(cache);
+	if (!cache->permanent) AAS_LinkCache(cache);
+	ThreadUnlock();
 	return cache;
 } //end of the function AAS_GetPortalRoutingCache
 //===========================================================================
+// the routing caches for the given travel flags are precomputed on all
+// threads when the routing is initialized, for as far as they fit in
+// max_routingcache: first the area caches towards the portals, which all
+// routing between clusters goes through, then the other area caches and
+// last the portal caches
+// precomputed caches are permanent so queries can use them without locking
+//===========================================================================
+
+//routing caches being precomputed
+aas_routingcache_t **precomputecaches;
+//routing update fields for every thread
+aas_routingupdate_t *precomputeupdate[MAX_THREADS];
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_PrecomputeAreaCacheWork(int work, int threadnum)
+{
+	AAS_CalculateAreaRoutingCache(precomputecaches[work], precomputeupdate[threadnum]);
+} //end of the function AAS_PrecomputeAreaCacheWork
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_PrecomputePortalCacheWork(int work, int threadnum)
+{
+	AAS_CalculatePortalRoutingCache(precomputecaches[work], precomputeupdate[threadnum]);
+} //end of the function AAS_PrecomputePortalCacheWork
+//===========================================================================
+// allocates the area caches to precompute
+//
+// Parameter:			portals			: true for the caches towards portal areas
+//						travelflags		: travel flags of the caches
+//						memory			: memory left for caches
+// Returns:				number of caches to precompute
+// Changes Globals:		-
+//===========================================================================
+int AAS_AllocPrecomputeAreaCaches(int portals, int travelflags, int *memory)
+{
+	int areanum, cluster, clusternum, clusterareanum, side, numcaches, numreachabilityareas, size;
+	aas_portal_t *portal;
+	aas_routingcache_t *cache;
+
+	numcaches = 0;
+	for (areanum = 1; areanum < aasworld.numareas; areanum++)
+	{
+		cluster = aasworld.areasettings[areanum].cluster;
+		if (!cluster) continue;
+		if ((cluster < 0) != (portals != 0)) continue;
+		//portal areas have a cache in both clusters they connect
+		for (side = 0; side < 2; side++)
+		{
+			if (cluster > 0)
+			{
+				if (side) break;
+				clusternum = cluster;
+			} //end if
+			else
+			{
+				portal = &aasworld.portals[-cluster];
+				if (side) clusternum = portal->backcluster;
+				else clusternum = portal->frontcluster;
+			} //end else
+			numreachabilityareas = aasworld.clusters[clusternum].numreachabilityareas;
+			//there's no routing towards areas without reachabilities
+			clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
+			if (clusterareanum >= numreachabilityareas) continue;
+			//might have been read from file
+			if (AAS_FindAreaRoutingCache(clusternum, clusterareanum, travelflags)) continue;
+			//
+			size = sizeof(aas_routingcache_t) + numreachabilityareas * (sizeof(unsigned short int) + sizeof(unsigned char));
+			if (size > *memory) return numcaches;
+			*memory -= size;
+			//
+			cache = AAS_AllocRoutingCache(numreachabilityareas);
+			cache->cluster = clusternum;
+			cache->areanum = areanum;
+			VectorCopy(aasworld.areas[areanum].center, cache->origin);
+			cache->starttraveltime = 1;
+			cache->travelflags = travelflags;
+			cache->type = CACHETYPE_AREA;
+			precomputecaches[numcaches++] = cache;
+		} //end for
+	} //end for
+	return numcaches;
+} //end of the function AAS_AllocPrecomputeAreaCaches
+//===========================================================================
+// allocates the portal caches to precompute
+//
+// Parameter:			travelflags		: travel flags of the caches
+//						memory			: memory left for caches
+// Returns:				number of caches to precompute
+// Changes Globals:		-
+//===========================================================================
+int AAS_AllocPrecomputePortalCaches(int travelflags, int *memory)
+{
+	int areanum, clusternum, clusterareanum, numcaches, size;
+	aas_routingcache_t *cache;
+
+	numcaches = 0;
+	size = sizeof(aas_routingcache_t) + aasworld.numportals * (sizeof(unsigned short int) + sizeof(unsigned char));
+	for (areanum = 1; areanum < aasworld.numareas; areanum++)
+	{
+		clusternum = aasworld.areasettings[areanum].cluster;
+		if (!clusternum) continue;
+		//same as AAS_AreaRouteToGoalArea, portal goal areas are part of the front cluster
+		if (clusternum < 0) clusternum = aasworld.portals[-clusternum].frontcluster;
+		//there's no routing towards areas without reachabilities
+		clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
+		if (clusterareanum >= aasworld.clusters[clusternum].numreachabilityareas) continue;
+		//might have been read from file
+		if (AAS_FindPortalRoutingCache(areanum, travelflags)) continue;
+		//
+		if (size > *memory) break;
+		*memory -= size;
+		//
+		cache = AAS_AllocRoutingCache(aasworld.numportals);
+		cache->cluster = clusternum;
+		cache->areanum = areanum;
+		VectorCopy(aasworld.areas[areanum].center, cache->origin);
+		cache->starttraveltime = 1;
+		cache->travelflags = travelflags;
+		cache->type = CACHETYPE_PORTAL;
+		precomputecaches[numcaches++] = cache;
+	} //end for
+	return numcaches;
+} //end of the function AAS_AllocPrecomputePortalCaches
+//===========================================================================
+// adds the precomputed caches to the cache lists as permanent caches
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_LinkPrecomputedCaches(int numcaches)
+{
+	int i, clusterareanum;
+	aas_routingcache_t *cache, **list;
+
+	for (i = 0; i < numcaches; i++)
+	{
+		cache = precomputecaches[i];
+		if (cache->type == CACHETYPE_AREA)
+		{
+			clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
+			list = &aasworld.clusterareacache[cache->cluster][clusterareanum];
+		} //end if
+		else
+		{
+			list = &aasworld.portalcache[cache->areanum];
+		} //end else
+		cache->permanent = qtrue;
+		cache->time = AAS_RoutingTime();
+		cache->prev = NULL;
+		cache->next = *list;
+		if (*list) (*list)->prev = cache;
+		*list = cache;
+	} //end for
+} //end of the function AAS_LinkPrecomputedCaches
+//===========================================================================
+//
+// Parameter:			travelflags		: travel flags to precompute the caches for
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_PrecomputeRoutingCache(int travelflags)
+{
+	int i, memory, numupdates, numcaches, totalcaches;
+#ifdef DEBUG
+	int starttime;
+
+	starttime = Sys_MilliSeconds();
+#endif
+	//stay within the routing cache size and leave memory for the caches created while routing
+	memory = max_routingcachesize - routingcachesize;
+	if (memory > AvailableMemory() - 4 * 1024 * 1024) memory = AvailableMemory() - 4 * 1024 * 1024;
+	if (memory <= 0) return;
+	//
+	ThreadSetDefault();
+	//routing update fields for every thread, big enough for both area and portal caches
+	numupdates = aasworld.numportals + 1;
+	for (i = 0; i < aasworld.numclusters; i++)
+	{
+		if (aasworld.clusters[i].numreachabilityareas > numupdates)
+		{
+			numupdates = aasworld.clusters[i].numreachabilityareas;
+		} //end if
+	} //end for
+	for (i = 0; i < numthreads; i++)
+	{
+		precomputeupdate[i] = (aas_routingupdate_t *) GetClearedMemory(numupdates * sizeof(aas_routingupdate_t));
+	} //end for
+	//portal areas have a cache in both clusters they connect
+	precomputecaches = (aas_routingcache_t **) GetMemory(aasworld.numareas * 2 * sizeof(aas_routingcache_t *));
+	totalcaches = 0;
+	//area caches towards the portal areas first, then the other areas
+	for (i = 0; i < 2; i++)
+	{
+		numcaches = AAS_AllocPrecomputeAreaCaches(i == 0, travelflags, &memory);
+		RunThreadsOnIndividual(numcaches, AAS_PrecomputeAreaCacheWork);
+		AAS_LinkPrecomputedCaches(numcaches);
+		totalcaches += numcaches;
+	} //end for
+	//the portal caches use the area caches precomputed above
+	numcaches = AAS_AllocPrecomputePortalCaches(travelflags, &memory);
+	RunThreadsOnIndividual(numcaches, AAS_PrecomputePortalCacheWork);
+	AAS_LinkPrecomputedCaches(numcaches);
+	totalcaches += numcaches;
+	//
+	FreeMemory(precomputecaches);
+	precomputecaches = NULL;
+	for (i = 0; i < numthreads; i++)
+	{
+		FreeMemory(precomputeupdate[i]);
+		precomputeupdate[i] = NULL;
+	} //end for
+#ifdef DEBUG
+	botimport.Print(PRT_MESSAGE, "%d routing caches precomputed in %d msec\n", totalcaches, Sys_MilliSeconds() - starttime);
+#endif
+} //end of the function AAS_PrecomputeRoutingCache
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -1617,7 +1947,8 @@ int AAS_AreaRouteToGoalArea(int areanum, vec3_t origin, int goalareanum, int tra
 		return qfalse;
 	} //end if
 	// make sure the routing cache doesn't grow to large
-	while(AvailableMemory() < 1 * 1024 * 1024) {
+	// other threads might be using the caches, only free them when not threaded
+	while(!threaded && AvailableMemory() < 1 * 1024 * 1024) {
 		if (!AAS_FreeOldestCache()) break;
 	}
 	//
@@ -1775,6 +2106,36 @@ int AAS_AreaTravelTimeToGoalArea(int areanum, vec3_t origin, int goalareanum, in
 	return 0;
 } //end of the function AAS_AreaTravelTimeToGoalArea
 //===========================================================================
+// AAS_AreaTravelTimeToGoalArea for the botlib threads, doesn't print and
+// doesn't free routing caches. Returns -1 for areas out of range, those are
+// left to an unthreaded AAS_AreaTravelTimeToGoalArea to report
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+int AAS_AreaTravelTimeToGoalAreaThreaded(int areanum, vec3_t origin, int goalareanum, int travelflags)
+{
+	if (areanum <= 0 || areanum >= aasworld.numareas) return -1;
+	if (goalareanum <= 0 || goalareanum >= aasworld.numareas) return -1;
+	return AAS_AreaTravelTimeToGoalArea(areanum, origin, goalareanum, travelflags);
+} //end of the function AAS_AreaTravelTimeToGoalAreaThreaded
+//===========================================================================
+// frees the oldest routing caches until the given amount of memory is
+// available, routing on the botlib threads can only allocate new caches
+//
+// Parameter:			-
+// Returns:				qtrue if the memory is available
+// Changes Globals:		-
+//===========================================================================
+int AAS_ReserveRoutingMemory(int size)
+{
+	while(AvailableMemory() < size) {
+		if (!AAS_FreeOldestCache()) return qfalse;
+	}
+	return qtrue;
+} //end of the function AAS_ReserveRoutingMemory
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
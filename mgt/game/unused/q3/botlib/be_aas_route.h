@@ -34,6 +34,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 void AAS_InitRouting(void);
 //free the AAS routing caches
 void AAS_FreeRoutingCaches(void);
+//precompute the routing caches for the given travel flags on all threads
+void AAS_PrecomputeRoutingCache(int travelflags);
 //returns the travel time from start to end in the given area
 unsigned short int AAS_AreaTravelTime(int areanum, vec3_t start, vec3_t end);
 //
@@ -55,10 +57,16 @@ void AAS_ReachabilityFromNum(int num, struct aas_reachability_s *reach);
 int AAS_RandomGoalArea(int areanum, int travelflags, int *goalareanum, vec3_t goalorigin);
 //enable or disable an area for routing
 int AAS_EnableRoutingArea(int areanum, int enable);
+//returns a number that changes every time an area is enabled or disabled for routing
+int AAS_RoutingAreaChanges(void);
 //returns the travel time within the given area from start to end
 unsigned short int AAS_AreaTravelTime(int areanum, vec3_t start, vec3_t end);
 //returns the travel time from the area to the goal area using the given travel flags
 int AAS_AreaTravelTimeToGoalArea(int areanum, vec3_t origin, int goalareanum, int travelflags);
+//same as above without printing or freeing caches, for the botlib threads, -1 if an area is out of range
+int AAS_AreaTravelTimeToGoalAreaThreaded(int areanum, vec3_t origin, int goalareanum, int travelflags);
+//frees routing caches until the given amount of memory is available
+int AAS_ReserveRoutingMemory(int size);
 //predict a route up to a stop event
 int AAS_PredictRoute(struct aas_predictroute_s *route, int areanum, vec3_t origin,
 							int goalareanum, int travelflags, int maxareas, int maxtime,
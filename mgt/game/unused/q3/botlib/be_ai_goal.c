@@ -37,6 +37,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "l_script.h"
 #include "l_precomp.h"
 #include "l_struct.h"
+#include "l_threads.h"
 #include "aasfile.h"
 #include "../game/botlib.h"
 #include "../game/be_aas.h"
@@ -120,6 +121,13 @@ typedef struct levelitem_s
 	struct levelitem_s *prev, *next;
 } levelitem_t;
 
+//travel time towards a level item
+typedef struct itemtraveltime_s
+{
+	int goalareanum;					//goal area of the item the travel time is for
+	int traveltime;						//travel time towards the item
+} itemtraveltime_t;
+
 typedef struct iteminfo_s
 {
 	char classname[32];					//classname of the item
@@ -174,6 +182,14 @@ typedef struct bot_goalstate_s
 	//
 	int avoidgoals[MAX_AVOIDGOALS];				//goals to avoid
 	float avoidgoaltimes[MAX_AVOIDGOALS];		//times to avoid the goals
+	//
+	itemtraveltime_t *itemtraveltimes;			//prepared travel time towards every level item in the heap
+	int numitemtraveltimes;						//number of prepared travel times
+	int traveltimesareanum;						//area the travel times are from
+	vec3_t traveltimesorigin;					//origin the travel times are from
+	int traveltimesflags;						//travel flags used for the travel times
+	float traveltimestime;						//AAS time the travel times were prepared
+	int traveltimeschanges;						//routing area changes when the travel times were prepared
 } bot_goalstate_t;
 
 bot_goalstate_t *botgoalstates[MAX_CLIENTS + 1]; // bk001206 - FIXME: init?
@@ -182,6 +198,7 @@ itemconfig_t *itemconfig = NULL; // bk001206 - init
 //level items
 levelitem_t *levelitemheap = NULL; // bk001206 - init
 levelitem_t *freelevelitems = NULL; // bk001206 - init
+int levelitemheapsize = 0;
 levelitem_t *levelitems = NULL; // bk001206 - init
 int numlevelitems = 0;
 //map locations
@@ -376,6 +393,7 @@ void InitLevelItemHeap(void)
 
 	max_levelitems = (int) LibVarValue("max_levelitems", "256");
 	levelitemheap = (levelitem_t *) GetClearedMemory(max_levelitems * sizeof(levelitem_t));
+	levelitemheapsize = max_levelitems;
 
 	for (i = 0; i < max_levelitems-1; i++)
 	{
@@ -1259,6 +1277,123 @@ int BotGetTopGoal(int goalstate, bot_goal_t *goal)
 	return qtrue;
 } //end of the function BotGetTopGoal
 //===========================================================================
+// returns the travel time towards the level item, from the travel times
+// prepared for this frame if they are from the same spot
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+int BotItemTravelTime(bot_goalstate_t *gs, int areanum, vec3_t origin, levelitem_t *li, int travelflags)
+{
+	itemtraveltime_t *itt;
+
+	if (gs->itemtraveltimes && gs->numitemtraveltimes == levelitemheapsize &&
+		gs->traveltimesareanum == areanum && gs->traveltimesflags == travelflags &&
+		gs->traveltimestime == AAS_Time() && gs->traveltimeschanges == AAS_RoutingAreaChanges() &&
+		VectorCompare(gs->traveltimesorigin, origin))
+	{
+		itt = &gs->itemtraveltimes[li - levelitemheap];
+		if (itt->goalareanum == li->goalareanum) return itt->traveltime;
+	} //end if
+	return AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
+} //end of the function BotItemTravelTime
+
+//goal states being prepared
+bot_goalstate_t *preparegoalstates[MAX_CLIENTS];
+//memory kept free for the routing caches created while preparing
+#define PREPARE_ROUTING_MEMORY		(4 * 1024 * 1024)
+
+//===========================================================================
+// calculates the travel times towards all level items for one goal state
+// only reads the level items and the AAS and only writes to the goal state
+// items with a goal area out of range keep a goal area of zero, so that
+// BotItemTravelTime reports them from the main thread
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void BotPrepareGoalStateWork(int work, int threadnum)
+{
+	bot_goalstate_t *gs;
+	levelitem_t *li;
+	itemtraveltime_t *itt;
+
+	gs = preparegoalstates[work];
+	for (li = levelitems; li; li = li->next)
+	{
+		itt = &gs->itemtraveltimes[li - levelitemheap];
+		itt->goalareanum = li->goalareanum;
+		itt->traveltime = 0;
+		if (li->flags & IFL_NOTBOT) continue;
+		if (!li->goalareanum) continue;
+		itt->traveltime = AAS_AreaTravelTimeToGoalAreaThreaded(gs->traveltimesareanum, gs->traveltimesorigin,
+												li->goalareanum, gs->traveltimesflags);
+		if (itt->traveltime < 0)
+		{
+			itt->goalareanum = 0;
+			itt->traveltime = 0;
+		} //end if
+	} //end for
+	//the bot will most likely also move towards the goal on top of the stack
+	if (gs->goalstacktop > 0)
+	{
+		AAS_AreaTravelTimeToGoalAreaThreaded(gs->traveltimesareanum, gs->traveltimesorigin,
+						gs->goalstack[gs->goalstacktop].areanum, gs->traveltimesflags);
+	} //end if
+} //end of the function BotPrepareGoalStateWork
+//===========================================================================
+// prepares the travel times towards the level items for the bots that
+// are about to think, one bot per job on the botlib threads
+// the bot think itself still runs one bot at a time, BotChooseLTGItem and
+// BotChooseNBGItem then use the prepared travel times
+// the jobs can only allocate routing caches, so old caches are freed here
+// first, and nothing is prepared if the memory can't be made available
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void BotPrepareGoalStates(int numgoalstates, int *goalstates, vec3_t *origins, int *travelflags)
+{
+	int i, areanum, numprepare;
+	bot_goalstate_t *gs;
+
+	if (!levelitemheap) return;
+	if (!AAS_ReserveRoutingMemory(PREPARE_ROUTING_MEMORY)) return;
+	//
+	numprepare = 0;
+	for (i = 0; i < numgoalstates && numprepare < MAX_CLIENTS; i++)
+	{
+		gs = BotGoalStateFromHandle(goalstates[i]);
+		if (!gs) continue;
+		if (!gs->itemweightconfig) continue;
+		//same area as BotChooseLTGItem will use, the traces can't run on the threads
+		areanum = BotReachabilityArea(origins[i], gs->client);
+		if (!areanum || !AAS_AreaReachability(areanum))
+		{
+			areanum = gs->lastreachabilityarea;
+		} //end if
+		if (!areanum) continue;
+		//
+		if (gs->numitemtraveltimes != levelitemheapsize)
+		{
+			if (gs->itemtraveltimes) FreeMemory(gs->itemtraveltimes);
+			gs->itemtraveltimes = (itemtraveltime_t *) GetClearedMemory(levelitemheapsize * sizeof(itemtraveltime_t));
+			gs->numitemtraveltimes = levelitemheapsize;
+		} //end if
+		gs->traveltimesareanum = areanum;
+		VectorCopy(origins[i], gs->traveltimesorigin);
+		gs->traveltimesflags = travelflags[i];
+		gs->traveltimestime = AAS_Time();
+		gs->traveltimeschanges = AAS_RoutingAreaChanges();
+		preparegoalstates[numprepare++] = gs;
+	} //end for
+	//
+	RunThreadsOnIndividual(numprepare, BotPrepareGoalStateWork);
+} //end of the function BotPrepareGoalStates
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
@@ -1362,7 +1497,7 @@ int BotChooseLTGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 		if (weight > 0)
 		{
 			//get the travel time towards the goal area
-			t = AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
+			t = BotItemTravelTime(gs, areanum, origin, li, travelflags);
 			//if the goal is reachable
 			if (t > 0)
 			{
@@ -1533,7 +1668,7 @@ int BotChooseNBGItem(int goalstate, vec3_t origin, int *inventory, int travelfla
 		if (weight > 0)
 		{
 			//get the travel time towards the goal area
-			t = AAS_AreaTravelTimeToGoalArea(areanum, origin, li->goalareanum, travelflags);
+			t = BotItemTravelTime(gs, areanum, origin, li, travelflags);
 			//if the goal is reachable
 			if (t > 0 && t < maxtime)
 			{
@@ -1762,6 +1897,7 @@ void BotFreeGoalState(int handle)
 		return;
 	} //end if
 	BotFreeItemWeights(handle);
+	if (botgoalstates[handle]->itemtraveltimes) FreeMemory(botgoalstates[handle]->itemtraveltimes);
 	FreeMemory(botgoalstates[handle]);
 	botgoalstates[handle] = NULL;
 } //end of the function BotFreeGoalState
@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "l_script.h"
 #include "l_precomp.h"
 #include "l_struct.h"
+#include "l_threads.h"
 #include "aasfile.h"
 #include "../game/botlib.h"
 #include "../game/be_aas.h"
@@ -189,6 +190,8 @@ int Export_BotLibShutdown(void)
 	AAS_Shutdown();
 	//shut down bot elemantary actions
 	EA_Shutdown();
+	//stop the worker threads
+	ThreadShutdown();
 	//free all libvars
 	LibVarDeAllocAll();
 	//remove all global defines from the pre compiler
@@ -793,6 +796,7 @@ static void Init_AI_Export( ai_export_t *ai ) {
 	ai->BotGetSecondGoal = BotGetSecondGoal;
 	ai->BotChooseLTGItem = BotChooseLTGItem;
 	ai->BotChooseNBGItem = BotChooseNBGItem;
+	ai->BotPrepareGoalStates = BotPrepareGoalStates;
 	ai->BotTouchingGoal = BotTouchingGoal;
 	ai->BotItemGoalInVisButNotVisible = BotItemGoalInVisButNotVisible;
 	ai->BotGetLevelItemGoal = BotGetLevelItemGoal;
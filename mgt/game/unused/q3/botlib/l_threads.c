@@ -0,0 +1,343 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Foobar; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+/*****************************************************************************
+ * name:		l_threads.c
+ *
+ * desc:		worker threads
+ *
+ * $Archive: /source/code/botlib/l_threads.c $
+ *
+ *****************************************************************************/
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "../game/q_shared.h"
+#include "l_libvar.h"
+#include "l_threads.h"
+#include "../game/botlib.h"
+#include "be_interface.h"
+
+//the worker threads are started the first time there is work for them and
+//wait for more work until the library is shut down
+//work numbers are handed out under the work lock, work items are meant to
+//be coarse so this doesn't show
+//the thread number passed to the work function is 0 for the calling
+//thread and 1 to numthreads-1 for the workers
+
+#ifdef _WIN32
+static CRITICAL_SECTION		worklock;
+static CONDITION_VARIABLE	workwake;
+static CONDITION_VARIABLE	workdone;
+static CRITICAL_SECTION		threadlock;
+static HANDLE				workthreads[MAX_THREADS];
+
+#define WORK_LOCK()			EnterCriticalSection(&worklock)
+#define WORK_UNLOCK()		LeaveCriticalSection(&worklock)
+#define WORK_WAIT(cond)		SleepConditionVariableCS(&cond, &worklock, INFINITE)
+#define WORK_SIGNAL(cond)	WakeAllConditionVariable(&cond)
+#else
+static pthread_mutex_t		worklock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		workwake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t		workdone = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t		threadlock;
+static pthread_t			workthreads[MAX_THREADS];
+
+#define WORK_LOCK()			pthread_mutex_lock(&worklock)
+#define WORK_UNLOCK()		pthread_mutex_unlock(&worklock)
+#define WORK_WAIT(cond)		pthread_cond_wait(&cond, &worklock)
+#define WORK_SIGNAL(cond)	pthread_cond_broadcast(&cond)
+#endif
+
+int numthreads = -1;
+int threaded = qfalse;
+
+static int numworkthreads;			//number of started worker threads
+static int workquit;
+static int workgeneration;
+static void (*workfunc)(int work, int threadnum);
+static int workcount;
+static int worknext;
+static int workfinished;
+
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static int ThreadProcessorCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+} //end of the function ThreadProcessorCount
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void ThreadSetDefault(void)
+{
+	if (numthreads != -1) return;
+	//one thread per processor by default
+	numthreads = (int) LibVarValue("bot_threads", "-1");
+	if (numthreads < 1) numthreads = ThreadProcessorCount();
+	if (numthreads < 1) numthreads = 1;
+	if (numthreads > MAX_THREADS) numthreads = MAX_THREADS;
+} //end of the function ThreadSetDefault
+//===========================================================================
+// hands out work numbers until all work is taken
+// called with the work lock held, returns with it held
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void ThreadDoWork(int threadnum)
+{
+	int work;
+
+	while (worknext < workcount)
+	{
+		work = worknext++;
+		//
+		WORK_UNLOCK();
+		workfunc(work, threadnum);
+		WORK_LOCK();
+		//
+		if (++workfinished == workcount) WORK_SIGNAL(workdone);
+	} //end while
+} //end of the function ThreadDoWork
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void ThreadWorker(int threadnum)
+{
+	int seen;
+
+	WORK_LOCK();
+	seen = workgeneration;
+	while (1)
+	{
+		while (workgeneration == seen && !workquit)
+		{
+			WORK_WAIT(workwake);
+		} //end while
+		if (workquit) break;
+		seen = workgeneration;
+		ThreadDoWork(threadnum);
+	} //end while
+	WORK_UNLOCK();
+} //end of the function ThreadWorker
+
+#ifdef _WIN32
+static DWORD WINAPI ThreadWorkerMain(LPVOID arg)
+{
+	ThreadWorker((int) (size_t) arg);
+	return 0;
+} //end of the function ThreadWorkerMain
+#else
+static void *ThreadWorkerMain(void *arg)
+{
+	ThreadWorker((int) (size_t) arg);
+	return NULL;
+} //end of the function ThreadWorkerMain
+#endif
+
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+static void ThreadStartWorkers(void)
+{
+	int i;
+#ifndef _WIN32
+	pthread_mutexattr_t attr;
+#endif
+
+	//the lock is recursive, the routing locks again from within itself
+#ifdef _WIN32
+	InitializeCriticalSection(&worklock);
+	InitializeConditionVariable(&workwake);
+	InitializeConditionVariable(&workdone);
+	InitializeCriticalSection(&threadlock);
+#else
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&threadlock, &attr);
+	pthread_mutexattr_destroy(&attr);
+#endif
+	//
+	workquit = qfalse;
+	numworkthreads = 1;
+	for (i = 1; i < numthreads; i++)
+	{
+#ifdef _WIN32
+		workthreads[i] = CreateThread(NULL, 0, ThreadWorkerMain, (LPVOID) (size_t) i, 0, NULL);
+		if (!workthreads[i]) break;
+#else
+		if (pthread_create(&workthreads[i], NULL, ThreadWorkerMain, (void *) (size_t) i)) break;
+#endif
+		numworkthreads++;
+	} //end for
+	//use the threads that could be started
+	numthreads = numworkthreads;
+	botimport.Print(PRT_MESSAGE, "%d bot threads\n", numthreads);
+} //end of the function ThreadStartWorkers
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void RunThreadsOnIndividual(int workcnt, void (*func)(int work, int threadnum))
+{
+	int i;
+
+	ThreadSetDefault();
+	//
+	if (numthreads == 1 || workcnt < 2)
+	{
+		for (i = 0; i < workcnt; i++)
+		{
+			func(i, 0);
+		} //end for
+		return;
+	} //end if
+	if (!numworkthreads) ThreadStartWorkers();
+	//
+	threaded = qtrue;
+	WORK_LOCK();
+	workfunc = func;
+	workcount = workcnt;
+	worknext = 0;
+	workfinished = 0;
+	workgeneration++;
+	WORK_SIGNAL(workwake);
+	//
+	ThreadDoWork(0);
+	//
+	while (workfinished < workcount)
+	{
+		WORK_WAIT(workdone);
+	} //end while
+	WORK_UNLOCK();
+	threaded = qfalse;
+} //end of the function RunThreadsOnIndividual
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void ThreadShutdown(void)
+{
+	int i;
+
+	if (numworkthreads)
+	{
+		WORK_LOCK();
+		workquit = qtrue;
+		WORK_SIGNAL(workwake);
+		WORK_UNLOCK();
+		//
+		for (i = 1; i < numworkthreads; i++)
+		{
+#ifdef _WIN32
+			WaitForSingleObject(workthreads[i], INFINITE);
+			CloseHandle(workthreads[i]);
+#else
+			pthread_join(workthreads[i], NULL);
+#endif
+		} //end for
+		//
+#ifdef _WIN32
+		DeleteCriticalSection(&worklock);
+		DeleteCriticalSection(&threadlock);
+#else
+		pthread_mutex_destroy(&threadlock);
+#endif
+		numworkthreads = 0;
+	} //end if
+	//read the libvar again the next time
+	numthreads = -1;
+} //end of the function ThreadShutdown
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void ThreadLock(void)
+{
+	if (!threaded) return;
+#ifdef _WIN32
+	EnterCriticalSection(&threadlock);
+#else
+	pthread_mutex_lock(&threadlock);
+#endif
+} //end of the function ThreadLock
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void ThreadUnlock(void)
+{
+	if (!threaded) return;
+#ifdef _WIN32
+	LeaveCriticalSection(&threadlock);
+#else
+	pthread_mutex_unlock(&threadlock);
+#endif
+} //end of the function ThreadUnlock
+//===========================================================================
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+void ThreadMemoryBarrier(void)
+{
+#ifdef _WIN32
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+} //end of the function ThreadMemoryBarrier
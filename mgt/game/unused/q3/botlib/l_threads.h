@@ -0,0 +1,50 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Foobar; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+
+/*****************************************************************************
+ * name:		l_threads.h
+ *
+ * desc:		worker threads
+ *
+ * $Archive: /source/code/botlib/l_threads.h $
+ *
+ *****************************************************************************/
+
+#define MAX_THREADS				16
+
+//number of threads used, the calling thread included
+extern int numthreads;
+//true while work is being done on more than one thread
+extern int threaded;
+
+//set the number of threads from the "bot_threads" libvar
+void ThreadSetDefault(void);
+//run func(work, threadnum) for every work item 0 to workcnt-1 on all threads
+//NOTE: the memory manager isn't thread safe, only allocate memory while holding the lock
+void RunThreadsOnIndividual(int workcnt, void (*func)(int work, int threadnum));
+//stop the worker threads and free the lock
+void ThreadShutdown(void);
+//recursive lock, does nothing when not threaded
+void ThreadLock(void);
+void ThreadUnlock(void);
+//make all memory writes visible before the writes that follow
+void ThreadMemoryBarrier(void);
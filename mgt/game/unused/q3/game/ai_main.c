@@ -1379,6 +1379,8 @@ int BotAIStartFrame(int time) {
 	gentity_t	*ent;
 	bot_entitystate_t state;
 	int elapsed_time, thinktime;
+	int numgoalstates, goalstates[MAX_CLIENTS], travelflags[MAX_CLIENTS];
+	vec3_t origins[MAX_CLIENTS];
 	static int local_time;
 	static int botlib_residual;
 	static int lastbotthink_time;
@@ -1526,6 +1528,28 @@ int BotAIStartFrame(int time) {
 
 	floattime = trap_AAS_Time();
 
+	// let the botlib prepare the goals of the bots that think this frame
+	// on its threads, the bots themselves still think one at a time
+	numgoalstates = 0;
+	for( i = 0; i < MAX_CLIENTS; i++ ) {
+		if( !botstates[i] || !botstates[i]->inuse ) {
+			continue;
+		}
+		if ( botstates[i]->botthink_residual + elapsed_time < thinktime ) {
+			continue;
+		}
+		if( g_entities[i].client->pers.connected != CON_CONNECTED ) {
+			continue;
+		}
+		goalstates[numgoalstates] = botstates[i]->gs;
+		VectorCopy( g_entities[i].client->ps.origin, origins[numgoalstates] );
+		travelflags[numgoalstates] = botstates[i]->tfl;
+		numgoalstates++;
+	}
+	if ( numgoalstates && trap_AAS_Initialized() ) {
+		trap_BotPrepareGoalStates( numgoalstates, goalstates, origins, travelflags );
+	}
+
 	// execute scheduled bot AI
 	for( i = 0; i < MAX_CLIENTS; i++ ) {
 		if( !botstates[i] || !botstates[i]->inuse ) {
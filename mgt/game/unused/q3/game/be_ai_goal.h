@@ -71,6 +71,8 @@ void BotGoalName(int number, char *name, int size);
 int BotGetTopGoal(int goalstate, bot_goal_t *goal);
 //get the second goal on the stack
 int BotGetSecondGoal(int goalstate, bot_goal_t *goal);
+//prepare the travel times towards the level items for the bots about to think
+void BotPrepareGoalStates(int numgoalstates, int *goalstates, vec3_t *origins, int *travelflags);
 //choose the best long term goal item for the bot
 int BotChooseLTGItem(int goalstate, vec3_t origin, int *inventory, int travelflags);
 //choose the best nearby goal item for the bot
@@ -348,6 +348,7 @@ typedef struct ai_export_s
 	int		(*BotChooseLTGItem)(int goalstate, vec3_t origin, int *inventory, int travelflags);
 	int		(*BotChooseNBGItem)(int goalstate, vec3_t origin, int *inventory, int travelflags,
 								struct bot_goal_s *ltg, float maxtime);
+	void	(*BotPrepareGoalStates)(int numgoalstates, int *goalstates, vec3_t *origins, int *travelflags);
 	int		(*BotTouchingGoal)(vec3_t origin, struct bot_goal_s *goal);
 	int		(*BotItemGoalInVisButNotVisible)(int viewer, vec3_t eye, vec3_t viewangles, struct bot_goal_s *goal);
 	int		(*BotGetLevelItemGoal)(int index, char *classname, struct bot_goal_s *goal);
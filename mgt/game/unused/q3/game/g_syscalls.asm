@@ -222,4 +222,6 @@ equ trap_BotLibLoadSource				-579
 equ trap_BotLibFreeSource				-580
 equ trap_BotLibReadToken				-581
 equ trap_BotLibSourceFileAndLine		-582
+
+equ trap_BotPrepareGoalStates			-583
  
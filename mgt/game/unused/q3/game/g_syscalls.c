@@ -631,6 +631,10 @@ int trap_BotChooseNBGItem(int goalstate, vec3_t origin, int *inventory, int trav
 	return syscall( BOTLIB_AI_CHOOSE_NBG_ITEM, goalstate, origin, inventory, travelflags, ltg, PASSFLOAT(maxtime) );
 }
 
+void trap_BotPrepareGoalStates(int numgoalstates, int *goalstates, vec3_t *origins, int *travelflags) {
+	syscall( BOTLIB_AI_PREPARE_GOAL_STATES, numgoalstates, goalstates, origins, travelflags );
+}
+
 int trap_BotTouchingGoal(vec3_t origin, void /* struct bot_goal_s */ *goal) {
 	return syscall( BOTLIB_AI_TOUCHING_GOAL, origin, goal );
 }
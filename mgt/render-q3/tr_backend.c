@@ -922,6 +922,9 @@ const void	*RB_DrawSurfs( const void *data ) {
 	backEnd.refdef = cmd->refdef;
 	backEnd.viewParms = cmd->viewParms;
 
+	// get the cpu side of the models out of the way on the job threads
+	RB_PrelerpMeshes( cmd->drawSurfs, cmd->numDrawSurfs );
+
 	RB_RenderDrawSurfList( cmd->drawSurfs, cmd->numDrawSurfs );
 
 	return (const void *)(cmd + 1);
@@ -1074,13 +1077,16 @@ smp extensions, or asynchronously by another thread.
 */
 void RB_ExecuteRenderCommands( const void *data ) {
 	int		t1, t2;
+	int		i;
 
 	t1 = ri.Milliseconds ();
 
-	if ( !r_smp->integer || data == backEndData[0]->commands.cmds ) {
-		backEnd.smpFrame = 0;
-	} else {
-		backEnd.smpFrame = 1;
+	backEnd.smpFrame = 0;
+	for ( i = 1 ; i < tr.smpFrames ; i++ ) {
+		if ( data == backEndData[i]->commands.cmds ) {
+			backEnd.smpFrame = i;
+			break;
+		}
 	}
 
 	while ( 1 ) {
@@ -1099,6 +1105,14 @@ void RB_ExecuteRenderCommands( const void *data ) {
 			break;
 		case RC_SWAP_BUFFERS:
 			data = RB_SwapBuffers( data );
+
+			// the frame is done, leave its counters with the rest of
+			// its data for the front end to pick up
+			t2 = ri.Milliseconds ();
+			backEnd.pc.msec += t2 - t1;
+			t1 = t2;
+			backEndData[backEnd.smpFrame]->pc = backEnd.pc;
+			Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
 			break;
 		case RC_SCREENSHOT:
 			data = RB_TakeScreenshotCmd( data );
@@ -1108,7 +1122,7 @@ void RB_ExecuteRenderCommands( const void *data ) {
 		default:
 			// stop rendering on this thread
 			t2 = ri.Milliseconds ();
-			backEnd.pc.msec = t2 - t1;
+			backEnd.pc.msec += t2 - t1;
 			return;
 		}
 	}
@@ -1122,22 +1136,25 @@ RB_RenderThread
 ================
 */
 void RB_RenderThread( void ) {
-	const void	*data;
+	renderCommandList_t	*cmdList;
 
 	// wait for either a rendering command or a quit command
 	while ( 1 ) {
 		// sleep until we have work to do
-		data = GLimp_RendererSleep();
-
-		if ( !data ) {
+		if ( !GLimp_RendererSleep() ) {
 			return;	// all done, renderer is shutting down
 		}
 
-		renderThreadActive = qtrue;
+		// keep at it for as long as the front end keeps the queue fed
+		while ( ( cmdList = R_PopRenderCommands() ) != NULL ) {
+			renderThreadActive = qtrue;
 
-		RB_ExecuteRenderCommands( data );
+			RB_ExecuteRenderCommands( cmdList->cmds );
 
-		renderThreadActive = qfalse;
+			renderThreadActive = qfalse;
+
+			R_FinishRenderCommands();
+		}
 	}
 }
 
@@ -367,19 +367,46 @@ static void ParseFace( dsurface_t *ds, drawVert_t *verts, msurface_t *surf, int
 }
 
 
+/*
+===============================================================================
+
+PATCH TESSELATION
+
+ParseMesh only queues the patches it finds.  Once all the surfaces are
+parsed, R_SubdividePatches tessellates them a batch at a time on the job
+threads, and the grids are made on the calling thread since they come out
+of the zone.
+
+===============================================================================
+*/
+
+typedef struct {
+	msurface_t		*surf;
+	dsurface_t		*ds;
+	drawVert_t		*verts;			// control points, still in file order
+} queuedPatch_t;
+
+typedef struct {
+	int				width, height;
+	drawVert_t		ctrl[MAX_GRID_SIZE][MAX_GRID_SIZE];
+	float			errorTable[2][MAX_GRID_SIZE];
+} patchTess_t;
+
+static queuedPatch_t	*patchQueue;
+static int				numQueuedPatches;
+static unsigned			patchSourceHash;		// for the patch cache
+
+static patchTess_t		*patchTess;				// one per job in a batch
+static int				patchBatchStart;
+
 /*
 ===============
 ParseMesh
 ===============
 */
 static void ParseMesh ( dsurface_t *ds, drawVert_t *verts, msurface_t *surf ) {
-	srfGridMesh_t	*grid;
-	int				i, j;
-	int				width, height, numPoints;
-	MAC_STATIC drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE];
+	queuedPatch_t	*qp;
 	int				lightmapNum;
-	vec3_t			bounds[2];
-	vec3_t			tmpVec;
 	static surfaceType_t	skipData = SF_SKIP;
 
 	lightmapNum = LittleLong( ds->lightmapNum );
@@ -400,11 +427,35 @@ static void ParseMesh ( dsurface_t *ds, drawVert_t *verts, msurface_t *surf ) {
 		return;
 	}
 
-	width = LittleLong( ds->patchWidth );
-	height = LittleLong( ds->patchHeight );
+	// pre-tesseleate later, along with all the others
+	qp = &patchQueue[numQueuedPatches++];
+	qp->surf = surf;
+	qp->ds = ds;
+	qp->verts = verts + LittleLong( ds->firstVert );
 
-	verts += LittleLong( ds->firstVert );
-	numPoints = width * height;
+	if ( r_patchCache->integer ) {
+		patchSourceHash = R_HashData( ds, sizeof( *ds ), patchSourceHash );
+		patchSourceHash = R_HashData( qp->verts, LittleLong( ds->patchWidth ) * LittleLong( ds->patchHeight )
+			* sizeof( drawVert_t ), patchSourceHash );
+	}
+}
+
+/*
+===============
+R_LoadPatchPoints
+===============
+*/
+static void R_LoadPatchPoints( queuedPatch_t *qp, int *width, int *height,
+							  drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE] ) {
+	drawVert_t	*verts;
+	int			i, j;
+	int			numPoints;
+
+	*width = LittleLong( qp->ds->patchWidth );
+	*height = LittleLong( qp->ds->patchHeight );
+
+	verts = qp->verts;
+	numPoints = *width * *height;
 	for ( i = 0 ; i < numPoints ; i++ ) {
 		for ( j = 0 ; j < 3 ; j++ ) {
 			points[i].xyz[j] = LittleFloat( verts[i].xyz[j] );
@@ -416,14 +467,22 @@ static void ParseMesh ( dsurface_t *ds, drawVert_t *verts, msurface_t *surf ) {
 		}
 		R_ColorShiftLightingBytes( verts[i].color, points[i].color );
 	}
+}
 
-	// pre-tesseleate
-	grid = R_SubdividePatchToGrid( width, height, points );
-	surf->data = (surfaceType_t *)grid;
+/*
+===============
+R_SetPatchLodOrigin
+
+Copy the level of detail origin, which is the center
+of the group of all curves that must subdivide the same
+to avoid cracking
+===============
+*/
+static void R_SetPatchLodOrigin( srfGridMesh_t *grid, dsurface_t *ds ) {
+	int			i;
+	vec3_t		bounds[2];
+	vec3_t		tmpVec;
 
-	// copy the level of detail origin, which is the center
-	// of the group of all curves that must subdivide the same
-	// to avoid cracking
 	for ( i = 0 ; i < 3 ; i++ ) {
 		bounds[0][i] = LittleFloat( ds->lightmapVecs[0][i] );
 		bounds[1][i] = LittleFloat( ds->lightmapVecs[1][i] );
@@ -434,6 +493,62 @@ static void ParseMesh ( dsurface_t *ds, drawVert_t *verts, msurface_t *surf ) {
 	grid->lodRadius = VectorLength( tmpVec );
 }
 
+/*
+===============
+R_PatchJob
+===============
+*/
+static void R_PatchJob( int job, int thread ) {
+	patchTess_t		*tess;
+	drawVert_t		points[MAX_PATCH_SIZE*MAX_PATCH_SIZE];
+
+	tess = &patchTess[job];
+	R_LoadPatchPoints( &patchQueue[patchBatchStart + job], &tess->width, &tess->height, points );
+	R_TessellatePatch( &tess->width, &tess->height, points, tess->ctrl, tess->errorTable );
+}
+
+/*
+===============
+R_SubdividePatches
+===============
+*/
+static void R_SubdividePatches( void ) {
+	int				i, batch, batchSize;
+	queuedPatch_t	*qp;
+	patchTess_t		*tess;
+	srfGridMesh_t	*grid;
+
+	if ( !numQueuedPatches ) {
+		return;
+	}
+
+	// every job needs room for the biggest grid, so only a couple per thread
+	batchSize = R_NumJobThreads() * 2;
+	if ( batchSize > numQueuedPatches ) {
+		batchSize = numQueuedPatches;
+	}
+	patchTess = ri.Hunk_AllocateTempMemory( batchSize * sizeof( *patchTess ) );
+
+	for ( patchBatchStart = 0 ; patchBatchStart < numQueuedPatches ; patchBatchStart += batch ) {
+		batch = numQueuedPatches - patchBatchStart;
+		if ( batch > batchSize ) {
+			batch = batchSize;
+		}
+
+		R_RunJobs( R_PatchJob, batch );
+
+		for ( i = 0, tess = patchTess ; i < batch ; i++, tess++ ) {
+			qp = &patchQueue[patchBatchStart + i];
+			grid = R_CreateSurfaceGridMesh( tess->width, tess->height, tess->ctrl, tess->errorTable );
+			R_SetPatchLodOrigin( grid, qp->ds );
+			qp->surf->data = (surfaceType_t *)grid;
+		}
+	}
+
+	ri.Hunk_FreeTempMemory( patchTess );
+	patchTess = NULL;
+}
+
 /*
 ===============
 ParseTriSurf
@@ -566,6 +681,141 @@ int R_MergedHeightPoints(srfGridMesh_t *grid, int offset) {
 	return qfalse;
 }
 
+/*
+===============================================================================
+
+LOD GROUPS
+
+Stitching and the LoD error fixes only ever match up grids in the same LoD
+group, which have the exact same lod origin and radius.  R_LinkLodGroups
+hashes the grids on those and chains every group in surface order, so a
+grid is only checked against its own group, and even then only against the
+grids whose bounds come within the .1 the vertex matching allows.
+
+===============================================================================
+*/
+
+#define	LODGROUP_HASH_SIZE	1024
+
+typedef struct {
+	int		first;			// first surface of the group, -1 if not in one
+	int		next;			// next surface in the group, -1 for the last
+	int		last;			// last surface so far, only set on the first
+	int		hashNext;		// next group in the hash chain, only set on the first
+} lodGroupLink_t;
+
+static lodGroupLink_t	*lodGroupLinks;
+
+/*
+=================
+R_SameLodGroup
+=================
+*/
+static qboolean R_SameLodGroup( srfGridMesh_t *grid1, srfGridMesh_t *grid2 ) {
+	// grids in the same LOD group should have the exact same lod radius
+	if ( grid1->lodRadius != grid2->lodRadius ) return qfalse;
+	// grids in the same LOD group should have the exact same lod origin
+	if ( grid1->lodOrigin[0] != grid2->lodOrigin[0] ) return qfalse;
+	if ( grid1->lodOrigin[1] != grid2->lodOrigin[1] ) return qfalse;
+	if ( grid1->lodOrigin[2] != grid2->lodOrigin[2] ) return qfalse;
+	return qtrue;
+}
+
+/*
+=================
+R_LodGroupHash
+=================
+*/
+static int R_LodGroupHash( srfGridMesh_t *grid ) {
+	float	key[4];
+
+	// adding zero turns -0 into 0, they compare the same
+	key[0] = grid->lodOrigin[0] + 0.0f;
+	key[1] = grid->lodOrigin[1] + 0.0f;
+	key[2] = grid->lodOrigin[2] + 0.0f;
+	key[3] = grid->lodRadius + 0.0f;
+	return R_HashData( key, sizeof( key ), 2166136261u ) & ( LODGROUP_HASH_SIZE - 1 );
+}
+
+/*
+=================
+R_LinkLodGroups
+=================
+*/
+static void R_LinkLodGroups( void ) {
+	int				hashTable[LODGROUP_HASH_SIZE];
+	int				i, hash, group;
+	srfGridMesh_t	*grid;
+	lodGroupLink_t	*link;
+
+	lodGroupLinks = ri.Hunk_AllocateTempMemory( s_worldData.numsurfaces * sizeof( *lodGroupLinks ) );
+
+	for ( i = 0 ; i < LODGROUP_HASH_SIZE ; i++ ) {
+		hashTable[i] = -1;
+	}
+
+	for ( i = 0, link = lodGroupLinks ; i < s_worldData.numsurfaces ; i++, link++ ) {
+		link->first = -1;
+		link->next = -1;
+		link->last = -1;
+		link->hashNext = -1;
+
+		grid = (srfGridMesh_t *) s_worldData.surfaces[i].data;
+		// if this surface is not a grid
+		if ( grid->surfaceType != SF_GRID )
+			continue;
+		// a NaN never matched any grid, not even itself
+		if ( !R_SameLodGroup( grid, grid ) )
+			continue;
+
+		hash = R_LodGroupHash( grid );
+		for ( group = hashTable[hash] ; group != -1 ; group = lodGroupLinks[group].hashNext ) {
+			if ( R_SameLodGroup( grid, (srfGridMesh_t *) s_worldData.surfaces[group].data ) ) {
+				break;
+			}
+		}
+
+		if ( group == -1 ) {
+			// start a new group
+			group = i;
+			link->hashNext = hashTable[hash];
+			hashTable[hash] = i;
+		} else {
+			lodGroupLinks[lodGroupLinks[group].last].next = i;
+		}
+		lodGroupLinks[group].last = i;
+		link->first = group;
+	}
+}
+
+/*
+=================
+R_FreeLodGroups
+=================
+*/
+static void R_FreeLodGroups( void ) {
+	ri.Hunk_FreeTempMemory( lodGroupLinks );
+	lodGroupLinks = NULL;
+}
+
+/*
+=================
+R_GridsTouch
+
+Returns false if no vertex of one grid can be within .1 of any
+vertex of the other
+=================
+*/
+static qboolean R_GridsTouch( srfGridMesh_t *grid1, srfGridMesh_t *grid2 ) {
+	int		i;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		if ( grid1->meshBounds[0][i] - grid2->meshBounds[1][i] > .1 ) return qfalse;
+		if ( grid2->meshBounds[0][i] - grid1->meshBounds[1][i] > .1 ) return qfalse;
+	}
+	return qtrue;
+}
+
 /*
 =================
 R_FixSharedVertexLodError_r
@@ -575,23 +825,20 @@ NOTE: never sync LoD through grid edges with merged points!
 FIXME: write generalized version that also avoids cracks between a patch and one that meets half way?
 =================
 */
-void R_FixSharedVertexLodError_r( int start, srfGridMesh_t *grid1 ) {
+void R_FixSharedVertexLodError_r( int start, int grid1num ) {
 	int j, k, l, m, n, offset1, offset2, touch;
-	srfGridMesh_t *grid2;
+	srfGridMesh_t *grid1, *grid2;
 
-	for ( j = start; j < s_worldData.numsurfaces; j++ ) {
+	grid1 = (srfGridMesh_t *) s_worldData.surfaces[grid1num].data;
+	// only the grids in the same LOD group
+	for ( j = lodGroupLinks[grid1num].first; j != -1; j = lodGroupLinks[j].next ) {
+		if ( j < start ) continue;
 		//
 		grid2 = (srfGridMesh_t *) s_worldData.surfaces[j].data;
-		// if this surface is not a grid
-		if ( grid2->surfaceType != SF_GRID ) continue;
 		// if the LOD errors are already fixed for this patch
 		if ( grid2->lodFixed == 2 ) continue;
-		// grids in the same LOD group should have the exact same lod radius
-		if ( grid1->lodRadius != grid2->lodRadius ) continue;
-		// grids in the same LOD group should have the exact same lod origin
-		if ( grid1->lodOrigin[0] != grid2->lodOrigin[0] ) continue;
-		if ( grid1->lodOrigin[1] != grid2->lodOrigin[1] ) continue;
-		if ( grid1->lodOrigin[2] != grid2->lodOrigin[2] ) continue;
+		// if the grids are too far apart to share a vertex
+		if ( !R_GridsTouch( grid1, grid2 ) ) continue;
 		//
 		touch = qfalse;
 		for (n = 0; n < 2; n++) {
@@ -672,7 +919,7 @@ void R_FixSharedVertexLodError_r( int start, srfGridMesh_t *grid1 ) {
 		}
 		if (touch) {
 			grid2->lodFixed = 2;
-			R_FixSharedVertexLodError_r ( start, grid2 );
+			R_FixSharedVertexLodError_r ( start, j );
 			//NOTE: this would be correct but makes things really slow
 			//grid2->lodFixed = 1;
 		}
@@ -703,7 +950,7 @@ void R_FixSharedVertexLodError( void ) {
 		//
 		grid1->lodFixed = 2;
 		// recursively fix other patches in the same LOD group
-		R_FixSharedVertexLodError_r( i + 1, grid1);
+		R_FixSharedVertexLodError_r( i + 1, i );
 	}
 }
 
@@ -1133,18 +1380,13 @@ int R_TryStitchingPatch( int grid1num ) {
 	srfGridMesh_t *grid1, *grid2;
 
 	numstitches = 0;
-	grid1 = (srfGridMesh_t *) s_worldData.surfaces[grid1num].data;
-	for ( j = 0; j < s_worldData.numsurfaces; j++ ) {
-		//
+	// only the grids in the same LOD group
+	for ( j = lodGroupLinks[grid1num].first; j != -1; j = lodGroupLinks[j].next ) {
+		// grid1 is replaced when it gets stitched to itself
+		grid1 = (srfGridMesh_t *) s_worldData.surfaces[grid1num].data;
 		grid2 = (srfGridMesh_t *) s_worldData.surfaces[j].data;
-		// if this surface is not a grid
-		if ( grid2->surfaceType != SF_GRID ) continue;
-		// grids in the same LOD group should have the exact same lod radius
-		if ( grid1->lodRadius != grid2->lodRadius ) continue;
-		// grids in the same LOD group should have the exact same lod origin
-		if ( grid1->lodOrigin[0] != grid2->lodOrigin[0] ) continue;
-		if ( grid1->lodOrigin[1] != grid2->lodOrigin[1] ) continue;
-		if ( grid1->lodOrigin[2] != grid2->lodOrigin[2] ) continue;
+		// if the grids are too far apart to share a vertex
+		if ( !R_GridsTouch( grid1, grid2 ) ) continue;
 		//
 		while (R_StitchPatches(grid1num, j))
 		{
@@ -1211,7 +1453,7 @@ void R_MovePatchSurfacesToHunk(void) {
 		Com_Memcpy( hunkgrid->widthLodError, grid->widthLodError, grid->width * 4 );
 
 		hunkgrid->heightLodError = ri.Hunk_Alloc( grid->height * 4, h_low );
-		Com_Memcpy( grid->heightLodError, grid->heightLodError, grid->height * 4 );
+		Com_Memcpy( hunkgrid->heightLodError, grid->heightLodError, grid->height * 4 );
 
 		R_FreeSurfaceGridMesh( grid );
 
@@ -1219,6 +1461,199 @@ void R_MovePatchSurfacesToHunk(void) {
 	}
 }
 
+/*
+===============================================================================
+
+PATCH CACHE
+
+With r_patchCache on, the grids left after tessellating, stitching and
+fixing up the LoD errors are saved to patchcache/<map>.dat, and the next
+time the map is loaded they are made straight from there.  The file is
+only used if the patch surfaces and control points in the bsp hash the
+same, and so do the settings that change the grids.
+
+===============================================================================
+*/
+
+#define	PATCHCACHE_IDENT	(('C'<<24)+('H'<<16)+('T'<<8)+'P')
+#define	PATCHCACHE_VERSION	1
+
+typedef struct {
+	int			ident;
+	int			version;
+	unsigned	sourceHash;			// of the patch surfaces and control points
+	unsigned	settingsHash;		// of everything else that changes the grids
+	int			numPatches;
+} patchCacheHeader_t;
+
+// every patch follows in surface order, with its error tables and verts
+typedef struct {
+	int			width, height;
+} patchCacheGrid_t;
+
+/*
+================
+R_PatchCacheSettings
+================
+*/
+static unsigned R_PatchCacheSettings( void ) {
+	float		settings[4];
+
+	settings[0] = r_subdivisions->value;
+	// the colors are shifted before tessellating
+	settings[1] = r_mapOverBrightBits->integer;
+	settings[2] = tr.overbrightBits;
+#ifdef PATCH_STITCHING
+	settings[3] = 1;
+#else
+	settings[3] = 0;
+#endif
+
+	return R_HashData( settings, sizeof( settings ), 2166136261u );
+}
+
+/*
+================
+R_PatchCachePath
+================
+*/
+static const char *R_PatchCachePath( void ) {
+	return va( "patchcache/%s.dat", s_worldData.baseName );
+}
+
+/*
+================
+R_PatchCacheGridBytes
+================
+*/
+static int R_PatchCacheGridBytes( int width, int height ) {
+	return sizeof( patchCacheGrid_t ) + ( width + height ) * sizeof( float ) + width * height * sizeof( drawVert_t );
+}
+
+/*
+================
+R_LoadCachedPatches
+
+Returns qfalse if there is nothing usable in the cache
+================
+*/
+static qboolean R_LoadCachedPatches( void ) {
+	patchCacheHeader_t	*header;
+	patchCacheGrid_t	*in;
+	queuedPatch_t		*qp;
+	patchTess_t			*tess;
+	srfGridMesh_t		*grid;
+	byte				*p, *end;
+	int					i, j, length;
+
+	length = ri.FS_ReadFile( R_PatchCachePath(), (void **)&header );
+	if ( !header ) {
+		return qfalse;
+	}
+
+	if ( length < (int)sizeof( *header )
+		|| header->ident != PATCHCACHE_IDENT
+		|| header->version != PATCHCACHE_VERSION
+		|| header->sourceHash != patchSourceHash
+		|| header->settingsHash != R_PatchCacheSettings()
+		|| header->numPatches != numQueuedPatches ) {
+		ri.FS_FreeFile( header );
+		return qfalse;
+	}
+
+	// check all the sizes before making anything
+	p = (byte *)( header + 1 );
+	end = (byte *)header + length;
+	for ( i = 0 ; i < numQueuedPatches ; i++ ) {
+		in = (patchCacheGrid_t *)p;
+		if ( end - p < (int)sizeof( *in )
+			|| in->width < 1 || in->width > MAX_GRID_SIZE
+			|| in->height < 1 || in->height > MAX_GRID_SIZE
+			|| end - p < R_PatchCacheGridBytes( in->width, in->height ) ) {
+			break;
+		}
+		p += R_PatchCacheGridBytes( in->width, in->height );
+	}
+	if ( i != numQueuedPatches || p != end ) {
+		ri.FS_FreeFile( header );
+		return qfalse;
+	}
+
+	tess = ri.Hunk_AllocateTempMemory( sizeof( *tess ) );
+
+	p = (byte *)( header + 1 );
+	for ( i = 0, qp = patchQueue ; i < numQueuedPatches ; i++, qp++ ) {
+		in = (patchCacheGrid_t *)p;
+		p += sizeof( *in );
+
+		Com_Memcpy( tess->errorTable[0], p, in->width * sizeof( float ) );
+		p += in->width * sizeof( float );
+		Com_Memcpy( tess->errorTable[1], p, in->height * sizeof( float ) );
+		p += in->height * sizeof( float );
+		for ( j = 0 ; j < in->height ; j++ ) {
+			Com_Memcpy( tess->ctrl[j], p, in->width * sizeof( drawVert_t ) );
+			p += in->width * sizeof( drawVert_t );
+		}
+
+		grid = R_CreateSurfaceGridMesh( in->width, in->height, tess->ctrl, tess->errorTable );
+		R_SetPatchLodOrigin( grid, qp->ds );
+		qp->surf->data = (surfaceType_t *)grid;
+	}
+
+	ri.Hunk_FreeTempMemory( tess );
+	ri.FS_FreeFile( header );
+
+	ri.Printf( PRINT_ALL, "loaded %d patches from %s\n", numQueuedPatches, R_PatchCachePath() );
+	return qtrue;
+}
+
+/*
+================
+R_SaveCachedPatches
+================
+*/
+static void R_SaveCachedPatches( void ) {
+	patchCacheHeader_t	*header;
+	patchCacheGrid_t	*out;
+	srfGridMesh_t		*grid;
+	byte				*p;
+	int					i, length;
+
+	length = sizeof( *header );
+	for ( i = 0 ; i < numQueuedPatches ; i++ ) {
+		grid = (srfGridMesh_t *)patchQueue[i].surf->data;
+		length += R_PatchCacheGridBytes( grid->width, grid->height );
+	}
+
+	header = ri.Hunk_AllocateTempMemory( length );
+	header->ident = PATCHCACHE_IDENT;
+	header->version = PATCHCACHE_VERSION;
+	header->sourceHash = patchSourceHash;
+	header->settingsHash = R_PatchCacheSettings();
+	header->numPatches = numQueuedPatches;
+
+	p = (byte *)( header + 1 );
+	for ( i = 0 ; i < numQueuedPatches ; i++ ) {
+		grid = (srfGridMesh_t *)patchQueue[i].surf->data;
+
+		out = (patchCacheGrid_t *)p;
+		out->width = grid->width;
+		out->height = grid->height;
+		p += sizeof( *out );
+
+		Com_Memcpy( p, grid->widthLodError, grid->width * sizeof( float ) );
+		p += grid->width * sizeof( float );
+		Com_Memcpy( p, grid->heightLodError, grid->height * sizeof( float ) );
+		p += grid->height * sizeof( float );
+		Com_Memcpy( p, grid->verts, grid->width * grid->height * sizeof( drawVert_t ) );
+		p += grid->width * grid->height * sizeof( drawVert_t );
+	}
+
+	ri.FS_WriteFile( R_PatchCachePath(), header, length );
+
+	ri.Hunk_FreeTempMemory( header );
+}
+
 /*
 ===============
 R_LoadSurfaces
@@ -1255,6 +1690,11 @@ static	void R_LoadSurfaces( lump_t *surfs, lump_t *verts, lump_t *indexLump ) {
 
 	s_worldData.surfaces = out;
 	s_worldData.numsurfaces = count;
+	s_worldData.visSurfaces = ri.Hunk_Alloc ( count * sizeof(*s_worldData.visSurfaces), h_low );
+
+	patchQueue = ri.Hunk_AllocateTempMemory( count * sizeof( *patchQueue ) );
+	numQueuedPatches = 0;
+	patchSourceHash = 2166136261u;
 
 	for ( i = 0 ; i < count ; i++, in++, out++ ) {
 		switch ( LittleLong( in->surfaceType ) ) {
@@ -1279,11 +1719,26 @@ static	void R_LoadSurfaces( lump_t *surfs, lump_t *verts, lump_t *indexLump ) {
 		}
 	}
 
+	if ( !r_patchCache->integer || !R_LoadCachedPatches() ) {
+		R_SubdividePatches();
+
+		R_LinkLodGroups();
+
 #ifdef PATCH_STITCHING
-	R_StitchAllPatches();
+		R_StitchAllPatches();
 #endif
 
-	R_FixSharedVertexLodError();
+		R_FixSharedVertexLodError();
+
+		R_FreeLodGroups();
+
+		if ( r_patchCache->integer ) {
+			R_SaveCachedPatches();
+		}
+	}
+
+	ri.Hunk_FreeTempMemory( patchQueue );
+	patchQueue = NULL;
 
 #ifdef PATCH_STITCHING
 	R_MovePatchSurfacesToHunk();
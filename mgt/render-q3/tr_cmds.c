@@ -32,18 +32,23 @@ R_PerformanceCounters
 =====================
 */
 void R_PerformanceCounters( void ) {
+	backEndCounters_t	*pc;
+
 	if ( !r_speeds->integer ) {
 		// clear the counters even if we aren't printing
 		Com_Memset( &tr.pc, 0, sizeof( tr.pc ) );
-		Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
 		return;
 	}
 
+	// the render thread may still be going at the newer frames,
+	// but it finished with this one's last time around the ring
+	pc = &backEndData[tr.smpFrame]->pc;
+
 	if (r_speeds->integer == 1) {
 		ri.Printf (PRINT_ALL, "%i/%i shaders/surfs %i leafs %i verts %i/%i tris %.2f mtex %.2f dc\n",
-			backEnd.pc.c_shaders, backEnd.pc.c_surfaces, tr.pc.c_leafs, backEnd.pc.c_vertexes, 
-			backEnd.pc.c_indexes/3, backEnd.pc.c_totalIndexes/3, 
-			R_SumOfUsedImages()/(1000000.0f), backEnd.pc.c_overDraw / (float)(glConfig.vidWidth * glConfig.vidHeight) ); 
+			pc->c_shaders, pc->c_surfaces, tr.pc.c_leafs, pc->c_vertexes, 
+			pc->c_indexes/3, pc->c_totalIndexes/3, 
+			R_SumOfUsedImages()/(1000000.0f), pc->c_overDraw / (float)(glConfig.vidWidth * glConfig.vidHeight) ); 
 	} else if (r_speeds->integer == 2) {
 		ri.Printf (PRINT_ALL, "(patch) %i sin %i sclip  %i sout %i bin %i bclip %i bout\n",
 			tr.pc.c_sphere_cull_patch_in, tr.pc.c_sphere_cull_patch_clip, tr.pc.c_sphere_cull_patch_out, 
@@ -54,10 +59,10 @@ void R_PerformanceCounters( void ) {
 	} else if (r_speeds->integer == 3) {
 		ri.Printf (PRINT_ALL, "viewcluster: %i\n", tr.viewCluster );
 	} else if (r_speeds->integer == 4) {
-		if ( backEnd.pc.c_dlightVertexes ) {
+		if ( pc->c_dlightVertexes ) {
 			ri.Printf (PRINT_ALL, "dlight srf:%i  culled:%i  verts:%i  tris:%i\n", 
 				tr.pc.c_dlightSurfaces, tr.pc.c_dlightSurfacesCulled,
-				backEnd.pc.c_dlightVertexes, backEnd.pc.c_dlightIndexes / 3 );
+				pc->c_dlightVertexes, pc->c_dlightIndexes / 3 );
 		}
 	} 
 	else if (r_speeds->integer == 5 )
@@ -67,11 +72,17 @@ void R_PerformanceCounters( void ) {
 	else if (r_speeds->integer == 6 )
 	{
 		ri.Printf( PRINT_ALL, "flare adds:%i tests:%i renders:%i\n", 
-			backEnd.pc.c_flareAdds, backEnd.pc.c_flareTests, backEnd.pc.c_flareRenders );
+			pc->c_flareAdds, pc->c_flareTests, pc->c_flareRenders );
+	}
+	else if (r_speeds->integer == 7 )
+	{
+		ri.Printf( PRINT_ALL, "front:%i blocked:%i back:%i prelerp:%i (%i srf %i verts) queued:%i/%i\n",
+			tr.frontEndMsec, tr.pc.msecBlocked, pc->msec, pc->msecPrelerp,
+			pc->c_prelerpSurfaces, pc->c_prelerpVertexes,
+			glConfig.smpActive ? R_RenderQueueDepth() : 0, tr.smpFrames - 1 );
 	}
 
 	Com_Memset( &tr.pc, 0, sizeof( tr.pc ) );
-	Com_Memset( &backEnd.pc, 0, sizeof( backEnd.pc ) );
 }
 
 
@@ -83,9 +94,11 @@ R_InitCommandBuffers
 void R_InitCommandBuffers( void ) {
 	glConfig.smpActive = qfalse;
 	if ( r_smp->integer ) {
+		R_InitRenderQueue();
+
 		ri.Printf( PRINT_ALL, "Trying SMP acceleration...\n" );
 		if ( GLimp_SpawnRenderThread( RB_RenderThread ) ) {
-			ri.Printf( PRINT_ALL, "...succeeded.\n" );
+			ri.Printf( PRINT_ALL, "...succeeded, %i frames\n", tr.smpFrames );
 			glConfig.smpActive = qtrue;
 		} else {
 			ri.Printf( PRINT_ALL, "...failed.\n" );
@@ -119,6 +132,13 @@ void R_IssueRenderCommands( qboolean runPerformanceCounters ) {
 
 	cmdList = &backEndData[tr.smpFrame]->commands;
 	assert(cmdList); // bk001205
+
+	// queued images have to be up before anything draws with them,
+	// a bare sync has nothing to draw
+	if ( cmdList->used ) {
+		R_FlushImageQueue();
+	}
+
 	// add an end-of-list command
 	*(int *)(cmdList->cmds + cmdList->used) = RC_END_OF_LIST;
 
@@ -126,7 +146,8 @@ void R_IssueRenderCommands( qboolean runPerformanceCounters ) {
 	cmdList->used = 0;
 
 	if ( glConfig.smpActive ) {
-		// if the render thread is not idle, wait for it
+		// no waiting here, R_ToggleSmpFrame only waits when
+		// the ring is full
 		if ( renderThreadActive ) {
 			c_blockedOnRender++;
 			if ( r_showSmp->integer ) {
@@ -138,23 +159,20 @@ void R_IssueRenderCommands( qboolean runPerformanceCounters ) {
 				ri.Printf( PRINT_ALL, "." );
 			}
 		}
-
-		// sleep until the renderer has completed
-		GLimp_FrontEndSleep();
 	}
 
-	// at this point, the back end thread is idle, so it is ok
-	// to look at it's performance counters
 	if ( runPerformanceCounters ) {
 		R_PerformanceCounters();
 	}
 
 	// actually start the commands going
 	if ( !r_skipBackEnd->integer ) {
-		// let it start on the new batch
 		if ( !glConfig.smpActive ) {
 			RB_ExecuteRenderCommands( cmdList->cmds );
-		} else {
+		} else if ( R_PushRenderCommands( cmdList ) ) {
+			// it ran out of work and went to sleep, take it
+			// through the handoff so it gets the gl context back
+			GLimp_FrontEndSleep();
 			GLimp_WakeRenderer( cmdList );
 		}
 	}
@@ -166,7 +184,7 @@ void R_IssueRenderCommands( qboolean runPerformanceCounters ) {
 R_SyncRenderThread
 
 Issue any pending commands and wait for them to complete.
-After exiting, the render thread will have completed its work
+After exiting, the render thread will have emptied the queue
 and will remain idle and the main thread is free to issue
 OpenGL calls until R_IssueRenderCommands is called.
 ====================
@@ -431,7 +449,7 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 
 	R_IssueRenderCommands( qtrue );
 
-	// use the other buffers next frame, because another CPU
+	// use the next buffers in the ring, because another CPU
 	// may still be rendering into the current ones
 	R_ToggleSmpFrame();
 
@@ -440,8 +458,8 @@ void RE_EndFrame( int *frontEndMsec, int *backEndMsec ) {
 	}
 	tr.frontEndMsec = 0;
 	if ( backEndMsec ) {
-		*backEndMsec = backEnd.pc.msec;
+		// the latest frame the back end is done with
+		*backEndMsec = backEndData[tr.smpFrame]->pc.msec;
 	}
-	backEnd.pc.msec = 0;
 }
 
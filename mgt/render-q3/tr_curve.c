@@ -354,18 +354,25 @@ void R_FreeSurfaceGridMesh( srfGridMesh_t *grid ) {
 
 /*
 =================
-R_SubdividePatchToGrid
+R_TessellatePatch
+
+Does all the work of R_SubdividePatchToGrid except for allocating the
+grid, so it can run on the job threads.  The size of the result comes
+back in width and height.
 =================
 */
-srfGridMesh_t *R_SubdividePatchToGrid( int width, int height,
-								drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE] ) {
+void R_TessellatePatch( int *outWidth, int *outHeight,
+								drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE],
+								drawVert_t ctrl[MAX_GRID_SIZE][MAX_GRID_SIZE], float errorTable[2][MAX_GRID_SIZE] ) {
 	int			i, j, k, l;
 	drawVert_t	prev, next, mid;
 	float		len, maxLen;
 	int			dir;
 	int			t;
-	MAC_STATIC drawVert_t	ctrl[MAX_GRID_SIZE][MAX_GRID_SIZE];
-	float		errorTable[2][MAX_GRID_SIZE];
+	int			width, height;
+
+	width = *outWidth;
+	height = *outHeight;
 
 	for ( i = 0 ; i < width ; i++ ) {
 		for ( j = 0 ; j < height ; j++ ) {
@@ -512,6 +519,22 @@ srfGridMesh_t *R_SubdividePatchToGrid( int width, int height,
 	// calculate normals
 	MakeMeshNormals( width, height, ctrl );
 
+	*outWidth = width;
+	*outHeight = height;
+}
+
+/*
+=================
+R_SubdividePatchToGrid
+=================
+*/
+srfGridMesh_t *R_SubdividePatchToGrid( int width, int height,
+								drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE] ) {
+	MAC_STATIC drawVert_t	ctrl[MAX_GRID_SIZE][MAX_GRID_SIZE];
+	float		errorTable[2][MAX_GRID_SIZE];
+
+	R_TessellatePatch( &width, &height, points, ctrl, errorTable );
+
 	return R_CreateSurfaceGridMesh( width, height, ctrl, errorTable );
 }
 
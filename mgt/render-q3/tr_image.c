@@ -22,6 +22,13 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 // tr_image.c
 #include "tr_local.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define	idsse	1
+#include <emmintrin.h>
+#else
+#define	idsse	0
+#endif
+
 /*
  * Include file for users of JPEG library.
  * You will need to have included system headers that define at least
@@ -348,28 +355,35 @@ void R_LightScaleTexture (unsigned *in, int inwidth, int inheight, qboolean only
 ================
 R_MipMap2
 
-Operates in place, quartering the size of the texture
+Quarters the size of the texture into out, which must not overlap in
 Proper linear filter
 ================
 */
-static void R_MipMap2( unsigned *in, int inWidth, int inHeight ) {
+static void R_MipMap2( const unsigned *in, int inWidth, int inHeight, unsigned *out ) {
 	int			i, j, k;
 	byte		*outpix;
 	int			inWidthMask, inHeightMask;
 	int			total;
 	int			outWidth, outHeight;
-	unsigned	*temp;
 
 	outWidth = inWidth >> 1;
 	outHeight = inHeight >> 1;
-	temp = ri.Hunk_AllocateTempMemory( outWidth * outHeight * 4 );
+
+	if ( outWidth == 0 || outHeight == 0 ) {
+		// nothing gets filtered, the smaller level is just the start of this one
+		Com_Memcpy( out, in, ( outWidth + outHeight ) * 4 );
+		if ( outWidth + outHeight == 0 ) {
+			out[0] = in[0];
+		}
+		return;
+	}
 
 	inWidthMask = inWidth - 1;
 	inHeightMask = inHeight - 1;
 
 	for ( i = 0 ; i < outHeight ; i++ ) {
 		for ( j = 0 ; j < outWidth ; j++ ) {
-			outpix = (byte *) ( temp + i * outWidth + j );
+			outpix = (byte *) ( out + i * outWidth + j );
 			for ( k = 0 ; k < 4 ; k++ ) {
 				total = 
 					1 * ((byte *)&in[ ((i*2-1)&inHeightMask)*inWidth + ((j*2-1)&inWidthMask) ])[k] +
@@ -395,34 +409,75 @@ static void R_MipMap2( unsigned *in, int inWidth, int inHeight ) {
 			}
 		}
 	}
+}
 
-	Com_Memcpy( in, temp, outWidth * outHeight * 4 );
-	ri.Hunk_FreeTempMemory( temp );
+#if idsse
+/*
+================
+R_MipMapRowSSE
+
+One row of the 2x2 box filter, four output pixels at a time.  The sums
+are done in 16 bits and shifted the same way as the C loop, so the result
+is exact.  Returns the number of pixels done, the C loop does the rest.
+================
+*/
+static int R_MipMapRowSSE( const byte *in, int row, int width, byte *out ) {
+	int			j;
+	__m128i		zero, a0, a1, b0, b1, s0, s1, s2, s3;
+
+	zero = _mm_setzero_si128();
+	for ( j = 0 ; j + 4 <= width ; j += 4, in += 32, out += 16 ) {
+		a0 = _mm_loadu_si128( (const __m128i *)in );
+		a1 = _mm_loadu_si128( (const __m128i *)( in + 16 ) );
+		b0 = _mm_loadu_si128( (const __m128i *)( in + row ) );
+		b1 = _mm_loadu_si128( (const __m128i *)( in + row + 16 ) );
+
+		// top and bottom rows added, two input pixels per register
+		s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+		s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+		s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+		s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+
+		// then the left and right pixels
+		s0 = _mm_add_epi16( s0, _mm_srli_si128( s0, 8 ) );
+		s1 = _mm_add_epi16( s1, _mm_srli_si128( s1, 8 ) );
+		s2 = _mm_add_epi16( s2, _mm_srli_si128( s2, 8 ) );
+		s3 = _mm_add_epi16( s3, _mm_srli_si128( s3, 8 ) );
+
+		s0 = _mm_srli_epi16( _mm_unpacklo_epi64( s0, s1 ), 2 );
+		s2 = _mm_srli_epi16( _mm_unpacklo_epi64( s2, s3 ), 2 );
+
+		// when working in place, this has all been read already
+		_mm_storeu_si128( (__m128i *)out, _mm_packus_epi16( s0, s2 ) );
+	}
+
+	return j;
 }
+#endif
 
 /*
 ================
 R_MipMap
 
-Operates in place, quartering the size of the texture
+Quarters the size of the texture into out.  Only the simple filter can
+work in place
 ================
 */
-static void R_MipMap (byte *in, int width, int height) {
-	int		i, j;
-	byte	*out;
+static void R_MipMap( const byte *in, int width, int height, byte *out ) {
+	int		i, j, done;
 	int		row;
 
 	if ( !r_simpleMipMaps->integer ) {
-		R_MipMap2( (unsigned *)in, width, height );
+		R_MipMap2( (const unsigned *)in, width, height, (unsigned *)out );
 		return;
 	}
 
 	if ( width == 1 && height == 1 ) {
+		*(unsigned *)out = *(const unsigned *)in;
 		return;
 	}
 
 	row = width * 4;
-	out = in;
 	width >>= 1;
 	height >>= 1;
 
@@ -438,7 +493,15 @@ static void R_MipMap (byte *in, int width, int height) {
 	}
 
 	for (i=0 ; i<height ; i++, in+=row) {
-		for (j=0 ; j<width ; j++, out+=4, in+=8) {
+		done = 0;
+#if idsse
+		if ( r_simd->integer ) {
+			done = R_MipMapRowSSE( in, row, width, out );
+			in += done * 8;
+			out += done * 4;
+		}
+#endif
+		for (j=done ; j<width ; j++, out+=4, in+=8) {
 			out[0] = (in[0] + in[4] + in[row+0] + in[row+4])>>2;
 			out[1] = (in[1] + in[5] + in[row+1] + in[row+5])>>2;
 			out[2] = (in[2] + in[6] + in[row+2] + in[row+6])>>2;
@@ -493,28 +556,80 @@ byte	mipBlendColors[16][4] = {
 
 
 /*
-===============
-Upload32
+===============================================================================
 
-===============
+UPLOADS
+
+An upload is done in three steps, so that the filtering in the middle can
+run on the job threads.  R_PrepareUpload works out the sizes, R_AllocUpload
+gets the buffers (temp hunk memory, or the image queue's own block),
+R_ProcessUpload resamples, scales and builds every mip level without
+touching anything but the upload itself, and R_FinishUpload hands the levels
+to OpenGL.
+
+===============================================================================
 */
-extern qboolean charSet;
-static void Upload32( unsigned *data, 
-						  int width, int height, 
-						  qboolean mipmap, 
-						  qboolean picmip, 
-							qboolean lightMap,
-						  int *format, 
-						  int *pUploadWidth, int *pUploadHeight )
-{
-	int			samples;
-	unsigned	*scaledBuffer = NULL;
-	unsigned	*resampledBuffer = NULL;
+
+typedef struct {
+	unsigned	*data;					// as loaded, mipped down in place if it is too big
+	int			width, height;
+	qboolean	mipmap;
+	qboolean	lightMap;
+
+	unsigned	*resampled;				// power of two copy of data, if it wasn't
+	int			baseWidth, baseHeight;	// power of two size
+	unsigned	*scratch;				// for R_MipMap2 on the way down to the upload size
+	unsigned	*levels;				// every level to upload, largest first, NULL if data goes as is
+	int			uploadWidth, uploadHeight;
+	int			internalFormat;
+
+	int			resampledBytes;			// buffer sizes for R_AllocUpload, 0 if not needed
+	int			scratchBytes;
+	int			levelBytes;
+	int			bytes;					// all of the above, data included
+} imageUpload_t;
+
+/*
+================
+R_LevelBytes
+
+Size of the top level and, if mipmap is set, everything below it
+================
+*/
+static int R_LevelBytes( int width, int height, qboolean mipmap ) {
+	int		bytes;
+
+	bytes = width * height * 4;
+	if ( mipmap ) {
+		while ( width > 1 || height > 1 ) {
+			width >>= 1;
+			height >>= 1;
+			if (width < 1)
+				width = 1;
+			if (height < 1)
+				height = 1;
+			bytes += width * height * 4;
+		}
+	}
+	return bytes;
+}
+
+/*
+================
+R_PrepareUpload
+================
+*/
+static void R_PrepareUpload( imageUpload_t *up, unsigned *data, int width, int height,
+							qboolean mipmap, qboolean picmip, qboolean lightMap ) {
 	int			scaled_width, scaled_height;
-	int			i, c;
-	byte		*scan;
-	GLenum		internalFormat = GL_RGB;
-	float		rMax = 0, gMax = 0, bMax = 0;
+
+	Com_Memset( up, 0, sizeof( *up ) );
+	up->data = data;
+	up->width = width;
+	up->height = height;
+	up->mipmap = mipmap;
+	up->lightMap = lightMap;
+	up->bytes = width * height * 4;
 
 	//
 	// convert to exact power of 2 sizes
@@ -529,12 +644,15 @@ static void Upload32( unsigned *data,
 		scaled_height >>= 1;
 
 	if ( scaled_width != width || scaled_height != height ) {
-		resampledBuffer = ri.Hunk_AllocateTempMemory( scaled_width * scaled_height * 4 );
-		ResampleTexture (data, width, height, resampledBuffer, scaled_width, scaled_height);
-		data = resampledBuffer;
-		width = scaled_width;
-		height = scaled_height;
+		// ResampleTexture can't drop from a job thread
+		if ( scaled_width > 2048 ) {
+			ri.Error( ERR_DROP, "ResampleTexture: max width" );
+		}
+		up->resampledBytes = scaled_width * scaled_height * 4;
+		up->bytes += up->resampledBytes;
 	}
+	up->baseWidth = scaled_width;
+	up->baseHeight = scaled_height;
 
 	//
 	// perform optional picmip operation
@@ -565,7 +683,69 @@ static void Upload32( unsigned *data,
 		scaled_height >>= 1;
 	}
 
-	scaledBuffer = ri.Hunk_AllocateTempMemory( sizeof( unsigned ) * scaled_width * scaled_height );
+	up->uploadWidth = scaled_width;
+	up->uploadHeight = scaled_height;
+
+	if ( scaled_width == up->baseWidth && scaled_height == up->baseHeight && !mipmap ) {
+		// goes up as it is, not even light scaled
+		return;
+	}
+
+	if ( !r_simpleMipMaps->integer && ( scaled_width < up->baseWidth || scaled_height < up->baseHeight ) ) {
+		// the first step down is the biggest
+		up->scratchBytes = ( up->baseWidth > 1 ? up->baseWidth >> 1 : 1 ) * ( up->baseHeight > 1 ? up->baseHeight >> 1 : 1 ) * 4;
+		up->bytes += up->scratchBytes;
+	}
+
+	up->levelBytes = R_LevelBytes( scaled_width, scaled_height, mipmap );
+	up->bytes += up->levelBytes;
+}
+
+/*
+================
+R_AllocUpload
+================
+*/
+static void R_AllocUpload( imageUpload_t *up, void *(*alloc)( int size ) ) {
+	if ( up->resampledBytes ) {
+		up->resampled = alloc( up->resampledBytes );
+	}
+	if ( up->scratchBytes ) {
+		up->scratch = alloc( up->scratchBytes );
+	}
+	if ( up->levelBytes ) {
+		up->levels = alloc( up->levelBytes );
+	}
+}
+
+/*
+================
+R_ProcessUpload
+
+Safe to run on a job thread
+================
+*/
+static void R_ProcessUpload( imageUpload_t *up ) {
+	int			samples;
+	unsigned	*data, *in, *out;
+	int			width, height;
+	int			scaled_width, scaled_height;
+	int			i, c;
+	int			miplevel;
+	byte		*scan;
+	GLenum		internalFormat = GL_RGB;
+	float		rMax = 0, gMax = 0, bMax = 0;
+
+	data = up->data;
+	width = up->width;
+	height = up->height;
+
+	if ( up->resampled ) {
+		ResampleTexture (data, width, height, up->resampled, up->baseWidth, up->baseHeight);
+		data = up->resampled;
+		width = up->baseWidth;
+		height = up->baseHeight;
+	}
 
 	//
 	// scan the texture for each channel's max values
@@ -574,7 +754,7 @@ static void Upload32( unsigned *data,
 	c = width*height;
 	scan = ((byte *)data);
 	samples = 3;
-	if (!lightMap) {
+	if (!up->lightMap) {
 		for ( i = 0; i < c; i++ )
 		{
 			if ( scan[i*4+0] > rMax )
@@ -589,7 +769,7 @@ static void Upload32( unsigned *data,
 			{
 				bMax = scan[i*4+2];
 			}
-			if ( scan[i*4 + 3] != 255 ) 
+			if ( scan[i*4 + 3] != 255 )
 			{
 				samples = 4;
 				break;
@@ -633,71 +813,126 @@ static void Upload32( unsigned *data,
 	} else {
 		internalFormat = 3;
 	}
-	// copy or resample data as appropriate for first MIP level
-	if ( ( scaled_width == width ) && 
-		( scaled_height == height ) ) {
-		if (!mipmap)
-		{
-			qglTexImage2D (GL_TEXTURE_2D, 0, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-			*pUploadWidth = scaled_width;
-			*pUploadHeight = scaled_height;
-			*format = internalFormat;
+	up->internalFormat = internalFormat;
+
+	if ( !up->levels ) {
+		return;
+	}
 
-			goto done;
+	// use the normal mip-mapping function to go down to the upload size
+	scaled_width = up->uploadWidth;
+	scaled_height = up->uploadHeight;
+	while ( width > scaled_width || height > scaled_height ) {
+		if ( up->scratch ) {
+			R_MipMap( (byte *)data, width, height, (byte *)up->scratch );
+		} else {
+			R_MipMap( (byte *)data, width, height, (byte *)data );
+		}
+		width >>= 1;
+		height >>= 1;
+		if ( width < 1 ) {
+			width = 1;
+		}
+		if ( height < 1 ) {
+			height = 1;
+		}
+		if ( up->scratch ) {
+			Com_Memcpy( data, up->scratch, width * height * 4 );
 		}
-		Com_Memcpy (scaledBuffer, data, width*height*4);
 	}
-	else
+	Com_Memcpy( up->levels, data, width * height * 4 );
+
+	R_LightScaleTexture (up->levels, scaled_width, scaled_height, !up->mipmap );
+
+	if ( !up->mipmap ) {
+		return;
+	}
+
+	// each level goes right after the one it is made from
+	in = up->levels;
+	miplevel = 0;
+	while (scaled_width > 1 || scaled_height > 1)
 	{
-		// use the normal mip-mapping function to go down from here
-		while ( width > scaled_width || height > scaled_height ) {
-			R_MipMap( (byte *)data, width, height );
-			width >>= 1;
-			height >>= 1;
-			if ( width < 1 ) {
-				width = 1;
-			}
-			if ( height < 1 ) {
-				height = 1;
-			}
+		out = in + scaled_width * scaled_height;
+		R_MipMap( (byte *)in, scaled_width, scaled_height, (byte *)out );
+		scaled_width >>= 1;
+		scaled_height >>= 1;
+		if (scaled_width < 1)
+			scaled_width = 1;
+		if (scaled_height < 1)
+			scaled_height = 1;
+		miplevel++;
+
+		if ( r_colorMipLevels->integer ) {
+			R_BlendOverTexture( (byte *)out, scaled_width * scaled_height, mipBlendColors[miplevel] );
 		}
-		Com_Memcpy( scaledBuffer, data, width * height * 4 );
+		in = out;
 	}
+}
 
-	R_LightScaleTexture (scaledBuffer, scaled_width, scaled_height, !mipmap );
+/*
+================
+R_FreeUpload
 
-	*pUploadWidth = scaled_width;
-	*pUploadHeight = scaled_height;
-	*format = internalFormat;
+Everything R_AllocUpload took from the temp hunk, in reverse order.
+Data belongs to the caller.
+================
+*/
+static void R_FreeUpload( imageUpload_t *up ) {
+	if ( up->levels ) {
+		ri.Hunk_FreeTempMemory( up->levels );
+	}
+	if ( up->scratch ) {
+		ri.Hunk_FreeTempMemory( up->scratch );
+	}
+	if ( up->resampled ) {
+		ri.Hunk_FreeTempMemory( up->resampled );
+	}
+	up->resampled = up->scratch = up->levels = NULL;
+}
 
-	qglTexImage2D (GL_TEXTURE_2D, 0, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledBuffer );
+/*
+================
+R_FinishUpload
 
-	if (mipmap)
-	{
-		int		miplevel;
+Uploads to the currently bound texture
+================
+*/
+static void R_FinishUpload( imageUpload_t *up ) {
+	unsigned	*level;
+	int			scaled_width, scaled_height;
+	int			miplevel;
 
+	scaled_width = up->uploadWidth;
+	scaled_height = up->uploadHeight;
+
+	if ( !up->levels ) {
+		qglTexImage2D (GL_TEXTURE_2D, 0, up->internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+			up->resampled ? up->resampled : up->data );
+	} else {
+		level = up->levels;
 		miplevel = 0;
-		while (scaled_width > 1 || scaled_height > 1)
+		qglTexImage2D (GL_TEXTURE_2D, 0, up->internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level );
+
+		if (up->mipmap)
 		{
-			R_MipMap( (byte *)scaledBuffer, scaled_width, scaled_height );
-			scaled_width >>= 1;
-			scaled_height >>= 1;
-			if (scaled_width < 1)
-				scaled_width = 1;
-			if (scaled_height < 1)
-				scaled_height = 1;
-			miplevel++;
-
-			if ( r_colorMipLevels->integer ) {
-				R_BlendOverTexture( (byte *)scaledBuffer, scaled_width * scaled_height, mipBlendColors[miplevel] );
+			while (scaled_width > 1 || scaled_height > 1)
+			{
+				level += scaled_width * scaled_height;
+				scaled_width >>= 1;
+				scaled_height >>= 1;
+				if (scaled_width < 1)
+					scaled_width = 1;
+				if (scaled_height < 1)
+					scaled_height = 1;
+				miplevel++;
+
+				qglTexImage2D (GL_TEXTURE_2D, miplevel, up->internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level );
 			}
-
-			qglTexImage2D (GL_TEXTURE_2D, miplevel, internalFormat, scaled_width, scaled_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, scaledBuffer );
 		}
 	}
-done:
 
-	if (mipmap)
+	if (up->mipmap)
 	{
 		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
 		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
@@ -709,33 +944,25 @@ done:
 	}
 
 	GL_CheckErrors();
-
-	if ( scaledBuffer != 0 )
-		ri.Hunk_FreeTempMemory( scaledBuffer );
-	if ( resampledBuffer != 0 )
-		ri.Hunk_FreeTempMemory( resampledBuffer );
 }
 
 
 /*
 ================
-R_CreateImage
+R_NewImage
 
-This is the only way any image_t are created
+This is the only way any image_t are created.  The texture data is up
+to the caller
 ================
 */
-image_t *R_CreateImage( const char *name, const byte *pic, int width, int height, 
+static image_t *R_NewImage( const char *name, int width, int height,
 					   qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
 	image_t		*image;
-	qboolean	isLightmap = qfalse;
 	long		hash;
 
 	if (strlen(name) >= MAX_QPATH ) {
 		ri.Error (ERR_DROP, "R_CreateImage: \"%s\" is too long\n", name);
 	}
-	if ( !strncmp( name, "*lightmap", 9 ) ) {
-		isLightmap = qtrue;
-	}
 
 	if ( tr.numImages == MAX_DRAWIMAGES ) {
 		ri.Error( ERR_DROP, "R_CreateImage: MAX_DRAWIMAGES hit\n");
@@ -755,28 +982,42 @@ image_t *R_CreateImage( const char *name, const byte *pic, int width, int height
 	image->wrapClampMode = glWrapClampMode;
 
 	// lightmaps are always allocated on TMU 1
-	if ( qglActiveTextureARB && isLightmap ) {
+	if ( qglActiveTextureARB && !strncmp( name, "*lightmap", 9 ) ) {
 		image->TMU = 1;
 	} else {
 		image->TMU = 0;
 	}
 
+	hash = generateHashValue(name);
+	image->next = hashTable[hash];
+	hashTable[hash] = image;
+
+	return image;
+}
+
+static void R_SaveCachedImage( image_t *image, imageUpload_t *up, unsigned sourceHash );
+
+/*
+================
+R_UploadImage
+
+Also writes it to the image cache if sourceHash is set
+================
+*/
+static void R_UploadImage( image_t *image, imageUpload_t *up, unsigned sourceHash ) {
 	if ( qglActiveTextureARB ) {
 		GL_SelectTexture( image->TMU );
 	}
 
 	GL_Bind(image);
 
-	Upload32( (unsigned *)pic, image->width, image->height, 
-								image->mipmap,
-								allowPicmip,
-								isLightmap,
-								&image->internalFormat,
-								&image->uploadWidth,
-								&image->uploadHeight );
+	R_FinishUpload( up );
+	image->internalFormat = up->internalFormat;
+	image->uploadWidth = up->uploadWidth;
+	image->uploadHeight = up->uploadHeight;
 
-	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, glWrapClampMode );
-	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, glWrapClampMode );
+	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, image->wrapClampMode );
+	qglTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, image->wrapClampMode );
 
 	qglBindTexture( GL_TEXTURE_2D, 0 );
 
@@ -784,13 +1025,410 @@ image_t *R_CreateImage( const char *name, const byte *pic, int width, int height
 		GL_SelectTexture( 0 );
 	}
 
-	hash = generateHashValue(name);
-	image->next = hashTable[hash];
-	hashTable[hash] = image;
+	if ( sourceHash ) {
+		R_SaveCachedImage( image, up, sourceHash );
+	}
+}
+
+/*
+================
+R_CreateImage
+
+Creates and uploads an image from a picture in memory
+================
+*/
+image_t *R_CreateImage( const char *name, const byte *pic, int width, int height,
+					   qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
+	image_t			*image;
+	imageUpload_t	upload;
+
+	image = R_NewImage( name, width, height, mipmap, allowPicmip, glWrapClampMode );
+
+	R_PrepareUpload( &upload, (unsigned *)pic, width, height, mipmap, allowPicmip,
+		!strncmp( name, "*lightmap", 9 ) );
+	R_AllocUpload( &upload, ri.Hunk_AllocateTempMemory );
+	R_ProcessUpload( &upload );
+	R_UploadImage( image, &upload, 0 );
+	R_FreeUpload( &upload );
+
+	return image;
+}
+
+
+/*
+===============================================================================
+
+IMAGE QUEUE
+
+While r_imageJobs is on, R_FindImageFile only loads the picture and hands
+out the image_t; the resampling and mip filtering is saved up and done on
+the job threads all at once, and then everything is uploaded in the order
+it was asked for.  Nothing can draw with a queued image, so the queue is
+flushed before any command list that has something in it goes to the back
+end, at the end of registration, and when too much memory is waiting.
+
+Every queued image was found after the render thread was synced, so the
+front end has the gl context whenever there is something to flush.
+
+===============================================================================
+*/
+
+#define	MAX_QUEUED_IMAGES		256
+#define	IMAGE_QUEUE_BYTES		( 8 * 1024 * 1024 )		// hunk block for the queued pictures and buffers
+
+typedef struct {
+	image_t			*image;
+	unsigned		sourceHash;		// for the image cache
+	imageUpload_t	upload;
+} queuedImage_t;
+
+static queuedImage_t	imageQueue[MAX_QUEUED_IMAGES];
+static int				imageJobOrder[MAX_QUEUED_IMAGES];
+static int				numQueuedImages;
+static byte				*imageQueueMemory;		// allocated on the first queued image of a level
+static int				imageQueueUsed;
+
+/*
+================
+R_QueueAlloc
+
+Everything a queued image needs comes out of imageQueueMemory, so
+nothing waiting in the queue holds zone memory, and the whole block
+is reused once the queue is flushed
+================
+*/
+static void *R_QueueAlloc( int size ) {
+	void	*buf;
+
+	buf = imageQueueMemory + imageQueueUsed;
+	imageQueueUsed += ( size + 15 ) & ~15;
+	return buf;
+}
+
+/*
+================
+R_QueueBytes
+================
+*/
+static int R_QueueBytes( imageUpload_t *up ) {
+	return ( ( up->width * up->height * 4 + 15 ) & ~15 ) + ( ( up->resampledBytes + 15 ) & ~15 )
+		+ ( ( up->scratchBytes + 15 ) & ~15 ) + ( ( up->levelBytes + 15 ) & ~15 );
+}
+
+/*
+================
+R_ImageJob
+================
+*/
+static void R_ImageJob( int job, int thread ) {
+	R_ProcessUpload( &imageQueue[imageJobOrder[job]].upload );
+}
+
+/*
+================
+R_CompareQueuedImages
+
+Biggest first, so a large one doesn't start last
+================
+*/
+static int R_CompareQueuedImages( const void *a, const void *b ) {
+	return imageQueue[*(const int *)b].upload.bytes - imageQueue[*(const int *)a].upload.bytes;
+}
+
+/*
+================
+R_FlushImageQueue
+================
+*/
+void R_FlushImageQueue( void ) {
+	int				i;
+	queuedImage_t	*qi;
+
+	if ( !numQueuedImages ) {
+		return;
+	}
+
+	for ( i = 0 ; i < numQueuedImages ; i++ ) {
+		imageJobOrder[i] = i;
+	}
+	qsort( imageJobOrder, numQueuedImages, sizeof( imageJobOrder[0] ), R_CompareQueuedImages );
+
+	R_RunJobs( R_ImageJob, numQueuedImages );
+
+	for ( i = 0, qi = imageQueue ; i < numQueuedImages ; i++, qi++ ) {
+		R_UploadImage( qi->image, &qi->upload, qi->sourceHash );
+	}
+
+	numQueuedImages = 0;
+	imageQueueUsed = 0;
+}
+
+/*
+================
+R_ClearImageQueue
+
+Drops anything still queued, the textures are going away
+================
+*/
+static void R_ClearImageQueue( void ) {
+	numQueuedImages = 0;
+	imageQueueUsed = 0;
+}
+
+/*
+================
+R_QueueImage
+
+Returns qfalse if the picture doesn't fit in the queue at all,
+otherwise it is copied in and pic is freed
+================
+*/
+static qboolean R_QueueImage( image_t *image, byte *pic, unsigned sourceHash ) {
+	imageUpload_t	upload;
+	queuedImage_t	*qi;
+	int				bytes;
+
+	R_PrepareUpload( &upload, (unsigned *)pic, image->width, image->height,
+		image->mipmap, image->allowPicmip, qfalse );
+
+	bytes = R_QueueBytes( &upload );
+	if ( bytes > IMAGE_QUEUE_BYTES ) {
+		return qfalse;
+	}
+
+	if ( numQueuedImages == MAX_QUEUED_IMAGES || imageQueueUsed + bytes > IMAGE_QUEUE_BYTES ) {
+		R_FlushImageQueue();
+	}
+
+	if ( !imageQueueMemory ) {
+		imageQueueMemory = ri.Hunk_Alloc( IMAGE_QUEUE_BYTES, h_low );
+	}
+
+	qi = &imageQueue[numQueuedImages++];
+	qi->image = image;
+	qi->sourceHash = sourceHash;
+	qi->upload = upload;
+	qi->upload.data = R_QueueAlloc( upload.width * upload.height * 4 );
+	Com_Memcpy( qi->upload.data, pic, upload.width * upload.height * 4 );
+	R_AllocUpload( &qi->upload, R_QueueAlloc );
+
+	ri.Free( pic );
+	return qtrue;
+}
+
 
+/*
+===============================================================================
+
+IMAGE CACHE
+
+With r_imageCache on, R_FindImageFile saves the levels it uploads to
+imagecache/<image name>.dat, and the next time the same picture is asked
+for they are uploaded straight from there, skipping the decode and all the
+filtering.  A file is only used if the picture it came from hashes the
+same, and so does everything else that goes into the levels (picmip,
+gamma and intensity tables, texture bits and so on); anything stale is
+overwritten when the image is loaded the long way.
+
+===============================================================================
+*/
+
+#define	IMAGECACHE_IDENT	(('C'<<24)+('G'<<16)+('M'<<8)+'I')
+#define	IMAGECACHE_VERSION	1
+
+typedef struct {
+	int			ident;
+	int			version;
+	unsigned	sourceHash;			// of the file the picture is loaded from
+	unsigned	settingsHash;		// of everything else that changes the levels
+	int			width, height;		// as loaded
+	int			uploadWidth, uploadHeight;
+	int			internalFormat;
+	int			mipmap;
+} imageCacheHeader_t;
+
+/*
+================
+R_HashData
+
+FNV-1a
+================
+*/
+unsigned R_HashData( const void *data, int length, unsigned hash ) {
+	const byte	*p;
+	int			i;
+
+	p = data;
+	for ( i = 0 ; i < length ; i++ ) {
+		hash = ( hash ^ p[i] ) * 16777619;
+	}
+	return hash;
+}
+
+/*
+================
+R_HashImageFile
+
+Hashes the file R_FindImageFile would load name from, or returns 0 if
+there isn't one
+================
+*/
+static unsigned R_HashImageFile( const char *name ) {
+	char		altname[MAX_QPATH];
+	byte		*buffer;
+	int			i, len, length;
+	unsigned	hash;
+
+	len = strlen( name );
+	if ( len < 5 ) {
+		return 0;
+	}
+
+	// same order as R_LoadImage and the upper case retry
+	for ( i = 0 ; i < 3 ; i++ ) {
+		strcpy( altname, name );
+		if ( i == 1 ) {
+			if ( Q_stricmp( name+len-4, ".tga" ) ) {
+				continue;
+			}
+			altname[len-3] = 'j';
+			altname[len-2] = 'p';
+			altname[len-1] = 'g';
+		} else if ( i == 2 ) {
+			altname[len-3] = toupper( altname[len-3] );
+			altname[len-2] = toupper( altname[len-2] );
+			altname[len-1] = toupper( altname[len-1] );
+		}
+
+		length = ri.FS_ReadFile( altname, (void **)&buffer );
+		if ( buffer ) {
+			hash = R_HashData( buffer, length, 2166136261u );
+			ri.FS_FreeFile( buffer );
+			return hash ? hash : 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+================
+R_ImageCacheSettings
+================
+*/
+static unsigned R_ImageCacheSettings( qboolean mipmap, qboolean allowPicmip ) {
+	int			settings[9];
+	unsigned	hash;
+
+	settings[0] = mipmap;
+	settings[1] = allowPicmip ? r_picmip->integer : -1;
+	settings[2] = r_roundImagesDown->integer;
+	settings[3] = r_simpleMipMaps->integer;
+	settings[4] = r_colorMipLevels->integer;
+	settings[5] = r_texturebits->integer;
+	settings[6] = glConfig.textureCompression;
+	settings[7] = glConfig.maxTextureSize;
+	settings[8] = glConfig.deviceSupportsGamma;
+
+	// r_gamma, r_intensity and the overbright bits all end up in the tables
+	hash = R_HashData( settings, sizeof( settings ), 2166136261u );
+	hash = R_HashData( s_gammatable, sizeof( s_gammatable ), hash );
+	hash = R_HashData( s_intensitytable, sizeof( s_intensitytable ), hash );
+	return hash;
+}
+
+/*
+================
+R_ImageCachePath
+================
+*/
+static const char *R_ImageCachePath( const char *name ) {
+	return va( "imagecache/%s.dat", name );
+}
+
+/*
+================
+R_LoadCachedImage
+
+Returns NULL if there is nothing usable in the cache
+================
+*/
+static image_t *R_LoadCachedImage( const char *name, unsigned sourceHash,
+								  qboolean mipmap, qboolean allowPicmip, int glWrapClampMode ) {
+	imageCacheHeader_t	*header;
+	imageUpload_t		upload;
+	image_t				*image;
+	int					length;
+
+	length = ri.FS_ReadFile( R_ImageCachePath( name ), (void **)&header );
+	if ( !header ) {
+		return NULL;
+	}
+
+	if ( length < (int)sizeof( *header )
+		|| header->ident != IMAGECACHE_IDENT
+		|| header->version != IMAGECACHE_VERSION
+		|| header->sourceHash != sourceHash
+		|| header->settingsHash != R_ImageCacheSettings( mipmap, allowPicmip )
+		|| header->mipmap != mipmap
+		|| header->uploadWidth < 1 || header->uploadWidth > glConfig.maxTextureSize
+		|| header->uploadHeight < 1 || header->uploadHeight > glConfig.maxTextureSize
+		|| length != (int)sizeof( *header ) + R_LevelBytes( header->uploadWidth, header->uploadHeight, mipmap ) ) {
+		ri.FS_FreeFile( header );
+		return NULL;
+	}
+
+	image = R_NewImage( name, header->width, header->height, mipmap, allowPicmip, glWrapClampMode );
+
+	Com_Memset( &upload, 0, sizeof( upload ) );
+	upload.mipmap = mipmap;
+	upload.levels = (unsigned *)( header + 1 );
+	upload.uploadWidth = header->uploadWidth;
+	upload.uploadHeight = header->uploadHeight;
+	upload.internalFormat = header->internalFormat;
+	R_UploadImage( image, &upload, 0 );
+
+	ri.FS_FreeFile( header );
 	return image;
 }
 
+/*
+================
+R_SaveCachedImage
+================
+*/
+static void R_SaveCachedImage( image_t *image, imageUpload_t *up, unsigned sourceHash ) {
+	imageCacheHeader_t	*header;
+	const unsigned		*levels;
+	int					levelBytes;
+
+	if ( up->levels ) {
+		levels = up->levels;
+	} else if ( up->resampled ) {
+		levels = up->resampled;
+	} else {
+		levels = up->data;
+	}
+	levelBytes = R_LevelBytes( up->uploadWidth, up->uploadHeight, up->mipmap );
+
+	header = ri.Hunk_AllocateTempMemory( sizeof( *header ) + levelBytes );
+	header->ident = IMAGECACHE_IDENT;
+	header->version = IMAGECACHE_VERSION;
+	header->sourceHash = sourceHash;
+	header->settingsHash = R_ImageCacheSettings( image->mipmap, image->allowPicmip );
+	header->width = image->width;
+	header->height = image->height;
+	header->uploadWidth = up->uploadWidth;
+	header->uploadHeight = up->uploadHeight;
+	header->internalFormat = up->internalFormat;
+	header->mipmap = up->mipmap;
+	Com_Memcpy( header + 1, levels, levelBytes );
+
+	ri.FS_WriteFile( R_ImageCachePath( image->imgName ), header, sizeof( *header ) + levelBytes );
+
+	ri.Hunk_FreeTempMemory( header );
+}
+
 
 /*
 =========================================================
@@ -1858,6 +2496,8 @@ image_t	*R_FindImageFile( const char *name, qboolean mipmap, qboolean allowPicmi
 	int		width, height;
 	byte	*pic;
 	long	hash;
+	unsigned		sourceHash;
+	imageUpload_t	upload;
 
 	if (!name) {
 		return NULL;
@@ -1886,6 +2526,20 @@ image_t	*R_FindImageFile( const char *name, qboolean mipmap, qboolean allowPicmi
 		}
 	}
 
+	//
+	// see if the image cache has it
+	//
+	sourceHash = 0;
+	if ( r_imageCache->integer ) {
+		sourceHash = R_HashImageFile( name );
+		if ( sourceHash ) {
+			image = R_LoadCachedImage( name, sourceHash, mipmap, allowPicmip, glWrapClampMode );
+			if ( image ) {
+				return image;
+			}
+		}
+	}
+
 	//
 	// load the pic from disk
 	//
@@ -1905,7 +2559,19 @@ image_t	*R_FindImageFile( const char *name, qboolean mipmap, qboolean allowPicmi
     }
 	}
 
-	image = R_CreateImage( ( char * ) name, pic, width, height, mipmap, allowPicmip, glWrapClampMode );
+	image = R_NewImage( name, width, height, mipmap, allowPicmip, glWrapClampMode );
+
+	if ( r_imageJobs->integer && R_NumJobThreads() > 1 ) {
+		if ( R_QueueImage( image, pic, sourceHash ) ) {
+			return image;
+		}
+	}
+
+	R_PrepareUpload( &upload, (unsigned *)pic, width, height, mipmap, allowPicmip, qfalse );
+	R_AllocUpload( &upload, ri.Hunk_AllocateTempMemory );
+	R_ProcessUpload( &upload );
+	R_UploadImage( image, &upload, sourceHash );
+	R_FreeUpload( &upload );
 	ri.Free( pic );
 	return image;
 }
@@ -2209,6 +2875,9 @@ R_InitImages
 */
 void	R_InitImages( void ) {
 	Com_Memset(hashTable, 0, sizeof(hashTable));
+	// the queue block went with the hunk
+	imageQueueMemory = NULL;
+	R_ClearImageQueue();
 	// build brightness translation tables
 	R_SetColorMappings();
 
@@ -2224,6 +2893,8 @@ R_DeleteTextures
 void R_DeleteTextures( void ) {
 	int		i;
 
+	R_ClearImageQueue();
+
 	for ( i=0; i<tr.numImages ; i++ ) {
 		qglDeleteTextures( 1, &tr.images[i]->texnum );
 	}
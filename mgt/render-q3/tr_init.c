@@ -48,6 +48,12 @@ cvar_t	*r_znear;
 
 cvar_t	*r_smp;
 cvar_t	*r_showSmp;
+cvar_t	*r_smpFrames;
+cvar_t	*r_jobThreads;
+cvar_t	*r_simd;
+cvar_t	*r_imageJobs;
+cvar_t	*r_imageCache;
+cvar_t	*r_patchCache;
 cvar_t	*r_skipBackEnd;
 
 cvar_t	*r_ignorehwgamma;
@@ -141,6 +147,7 @@ cvar_t	*r_directedScale;
 cvar_t	*r_debugLight;
 cvar_t	*r_debugSort;
 cvar_t	*r_printShaders;
+cvar_t	*r_shaderCache;
 cvar_t	*r_saveFontData;
 
 cvar_t	*r_maxpolys;
@@ -900,7 +907,13 @@ void R_Register( void )
 #else        
 	r_smp = ri.Cvar_Get( "r_smp", "0", CVAR_ARCHIVE | CVAR_LATCH);
 #endif
+	r_smpFrames = ri.Cvar_Get( "r_smpFrames", "2", CVAR_ARCHIVE | CVAR_LATCH );
 	r_ignoreFastPath = ri.Cvar_Get( "r_ignoreFastPath", "1", CVAR_ARCHIVE | CVAR_LATCH );
+	r_jobThreads = ri.Cvar_Get( "r_jobThreads", "-1", CVAR_ARCHIVE | CVAR_LATCH );
+	r_simd = ri.Cvar_Get( "r_simd", "1", CVAR_ARCHIVE | CVAR_LATCH );
+	r_imageJobs = ri.Cvar_Get( "r_imageJobs", "1", CVAR_ARCHIVE );
+	r_imageCache = ri.Cvar_Get( "r_imageCache", "0", CVAR_ARCHIVE );
+	r_patchCache = ri.Cvar_Get( "r_patchCache", "0", CVAR_ARCHIVE );
 
 	//
 	// temporary latched variables that can only change over a restart
@@ -953,6 +966,7 @@ void R_Register( void )
 	r_debugLight = ri.Cvar_Get( "r_debuglight", "0", CVAR_TEMP );
 	r_debugSort = ri.Cvar_Get( "r_debugSort", "0", CVAR_CHEAT );
 	r_printShaders = ri.Cvar_Get( "r_printShaders", "0", 0 );
+	r_shaderCache = ri.Cvar_Get( "r_shaderCache", "1", CVAR_ARCHIVE );
 	r_saveFontData = ri.Cvar_Get( "r_saveFontData", "0", 0 );
 
 	r_nocurves = ri.Cvar_Get ("r_nocurves", "0", CVAR_CHEAT );
@@ -1003,6 +1017,7 @@ void R_Register( void )
 	ri.Cmd_AddCommand( "screenshot", R_ScreenShot_f );
 	ri.Cmd_AddCommand( "screenshotJPEG", R_ScreenShotJPEG_f );
 	ri.Cmd_AddCommand( "gfxinfo", GfxInfo_f );
+	ri.Cmd_AddCommand( "shadecalcbench", R_ShadeCalcBench_f );
 }
 
 /*
@@ -1070,20 +1085,32 @@ void R_Init( void ) {
 	if (max_polyverts < MAX_POLYVERTS)
 		max_polyverts = MAX_POLYVERTS;
 
-	ptr = ri.Hunk_Alloc( sizeof( *backEndData[0] ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
-	backEndData[0] = (backEndData_t *) ptr;
-	backEndData[0]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData[0] ));
-	backEndData[0]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData[0] ) + sizeof(srfPoly_t) * max_polys);
+	// one set of back end data for every frame that can be in flight
+	tr.smpFrames = 1;
 	if ( r_smp->integer ) {
-		ptr = ri.Hunk_Alloc( sizeof( *backEndData[1] ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
-		backEndData[1] = (backEndData_t *) ptr;
-		backEndData[1]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData[1] ));
-		backEndData[1]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData[1] ) + sizeof(srfPoly_t) * max_polys);
-	} else {
-		backEndData[1] = NULL;
+		tr.smpFrames = r_smpFrames->integer;
+		if ( tr.smpFrames < 2 ) {
+			tr.smpFrames = 2;
+		} else if ( tr.smpFrames > SMP_FRAMES ) {
+			tr.smpFrames = SMP_FRAMES;
+		}
+	}
+	for ( i = 0 ; i < SMP_FRAMES ; i++ ) {
+		if ( i >= tr.smpFrames ) {
+			backEndData[i] = NULL;
+			continue;
+		}
+		ptr = ri.Hunk_Alloc( sizeof( *backEndData[i] ) + sizeof(srfPoly_t) * max_polys + sizeof(polyVert_t) * max_polyverts, h_low);
+		backEndData[i] = (backEndData_t *) ptr;
+		backEndData[i]->polys = (srfPoly_t *) ((char *) ptr + sizeof( *backEndData[i] ));
+		backEndData[i]->polyVerts = (polyVert_t *) ((char *) ptr + sizeof( *backEndData[i] ) + sizeof(srfPoly_t) * max_polys);
 	}
 	R_ToggleSmpFrame();
 
+	R_InitJobs();
+
+	RB_InitShadeCalc();
+
 	InitOpenGL();
 
 	R_InitImages();
@@ -1122,12 +1149,15 @@ void RE_Shutdown( qboolean destroyWindow ) {
 	ri.Cmd_RemoveCommand ("gfxinfo");
 	ri.Cmd_RemoveCommand( "modelist" );
 	ri.Cmd_RemoveCommand( "shaderstate" );
+	ri.Cmd_RemoveCommand( "shadecalcbench" );
 
 
 	if ( tr.registered ) {
+		R_SaveShaderCache();
 		R_SyncRenderThread();
 		R_ShutdownCommandBuffers();
 		R_DeleteTextures();
+		R_ShutdownJobs();
 	}
 
 	R_DoneFreeType();
@@ -1150,6 +1180,7 @@ Touch all images to make sure they are resident
 */
 void RE_EndRegistration( void ) {
 	R_SyncRenderThread();
+	R_FlushImageQueue();
 	if (!Sys_LowPhysicalMemory()) {
 		RB_ShowImages();
 	}
@@ -0,0 +1,434 @@
+/*
+===========================================================================
+Copyright (C) 1999-2005 Id Software, Inc.
+
+This file is part of Quake III Arena source code.
+
+Quake III Arena source code is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Quake III Arena source code is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Foobar; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+===========================================================================
+*/
+// tr_jobs.c -- worker threads for splitting renderer work, and the queue
+// that feeds the render thread
+
+#include "tr_local.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*
+
+R_RunJobs hands out job numbers 0 .. numJobs-1 to the workers and the
+calling thread until they are all done.  Jobs are meant to be coarse
+(a few per thread), so a single lock guards the whole thing.
+
+The thread number passed to the job function is 0 for the calling thread
+and 1 .. numJobThreads-1 for the workers, so jobs can keep per thread
+results without locking.
+
+Both the front end and the render thread run jobs, so a second lock
+makes them take turns with the workers.
+
+*/
+
+#ifdef _WIN32
+static CRITICAL_SECTION		jobLock;
+static CRITICAL_SECTION		jobRunLock;
+static CONDITION_VARIABLE	jobWake;
+static CONDITION_VARIABLE	jobDone;
+static HANDLE				jobThreads[MAX_JOB_THREADS];
+
+#define	LOCK( lock )			EnterCriticalSection( &lock )
+#define	UNLOCK( lock )			LeaveCriticalSection( &lock )
+#define	WAIT( cond, lock )		SleepConditionVariableCS( &cond, &lock, INFINITE )
+#define	SIGNAL( cond )			WakeAllConditionVariable( &cond )
+
+#define	MEMORY_BARRIER()		MemoryBarrier()
+#define	COMPARE_EXCHANGE( dest, exchange, comparand )	InterlockedCompareExchange( (volatile LONG *)(dest), exchange, comparand )
+#else
+static pthread_mutex_t		jobLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t		jobRunLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		jobWake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t		jobDone = PTHREAD_COND_INITIALIZER;
+static pthread_t			jobThreads[MAX_JOB_THREADS];
+
+#define	LOCK( lock )			pthread_mutex_lock( &lock )
+#define	UNLOCK( lock )			pthread_mutex_unlock( &lock )
+#define	WAIT( cond, lock )		pthread_cond_wait( &cond, &lock )
+#define	SIGNAL( cond )			pthread_cond_broadcast( &cond )
+
+#define	MEMORY_BARRIER()		__sync_synchronize()
+#define	COMPARE_EXCHANGE( dest, exchange, comparand )	__sync_val_compare_and_swap( dest, comparand, exchange )
+#endif
+
+#define	JOB_LOCK()			LOCK( jobLock )
+#define	JOB_UNLOCK()		UNLOCK( jobLock )
+#define	JOB_WAIT( cond )	WAIT( cond, jobLock )
+#define	JOB_SIGNAL( cond )	SIGNAL( cond )
+
+static int			numJobThreads = 1;		// including the calling thread
+static qboolean		jobsQuit;
+
+static int			jobGeneration;
+static jobFunc_t	jobFunc;
+static int			jobCount;
+static int			jobNext;
+static int			jobsFinished;
+
+#ifdef _WIN32
+static CRITICAL_SECTION		queueLock;
+static CONDITION_VARIABLE	queueDone;
+#else
+static pthread_mutex_t		queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t		queueDone = PTHREAD_COND_INITIALIZER;
+#endif
+
+static renderCommandList_t * volatile	renderQueue[SMP_FRAMES];
+static volatile int		renderQueueHead;		// only the front end writes it
+static volatile int		renderQueueTail;		// only the render thread writes it, under queueLock
+static volatile int		renderThreadAwake;
+
+/*
+===============
+R_DoJobs
+
+Called with the lock held, returns with it held
+===============
+*/
+static void R_DoJobs( int thread ) {
+	int		job;
+
+	while ( jobNext < jobCount ) {
+		job = jobNext++;
+
+		JOB_UNLOCK();
+		jobFunc( job, thread );
+		JOB_LOCK();
+
+		if ( ++jobsFinished == jobCount ) {
+			JOB_SIGNAL( jobDone );
+		}
+	}
+}
+
+/*
+===============
+R_JobThread
+===============
+*/
+static void R_JobThread( int thread ) {
+	int		seen;
+
+	JOB_LOCK();
+	seen = jobGeneration;
+	while ( 1 ) {
+		while ( jobGeneration == seen && !jobsQuit ) {
+			JOB_WAIT( jobWake );
+		}
+		if ( jobsQuit ) {
+			break;
+		}
+		seen = jobGeneration;
+		R_DoJobs( thread );
+	}
+	JOB_UNLOCK();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI R_JobThreadMain( LPVOID arg ) {
+	R_JobThread( (int)(size_t)arg );
+	return 0;
+}
+#else
+static void *R_JobThreadMain( void *arg ) {
+	R_JobThread( (int)(size_t)arg );
+	return NULL;
+}
+#endif
+
+/*
+===============
+R_ProcessorCount
+===============
+*/
+static int R_ProcessorCount( void ) {
+#ifdef _WIN32
+	SYSTEM_INFO	info;
+
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+}
+
+/*
+===============
+R_InitJobs
+===============
+*/
+void R_InitJobs( void ) {
+	int		i, count;
+
+	count = r_jobThreads->integer;
+	if ( count < 0 ) {
+		// one per processor, the calling thread included
+		count = R_ProcessorCount() - 1;
+	}
+	if ( count > MAX_JOB_THREADS - 1 ) {
+		count = MAX_JOB_THREADS - 1;
+	}
+
+#ifdef _WIN32
+	InitializeCriticalSection( &jobLock );
+	InitializeCriticalSection( &jobRunLock );
+	InitializeConditionVariable( &jobWake );
+	InitializeConditionVariable( &jobDone );
+	InitializeCriticalSection( &queueLock );
+	InitializeConditionVariable( &queueDone );
+#endif
+
+	jobsQuit = qfalse;
+	numJobThreads = 1;
+	for ( i = 1 ; i <= count ; i++ ) {
+#ifdef _WIN32
+		jobThreads[i] = CreateThread( NULL, 0, R_JobThreadMain, (LPVOID)(size_t)i, 0, NULL );
+		if ( !jobThreads[i] ) {
+			break;
+		}
+#else
+		if ( pthread_create( &jobThreads[i], NULL, R_JobThreadMain, (void *)(size_t)i ) ) {
+			break;
+		}
+#endif
+		numJobThreads++;
+	}
+
+	if ( numJobThreads > 1 ) {
+		ri.Printf( PRINT_ALL, "...using %i front end job threads\n", numJobThreads - 1 );
+	}
+}
+
+/*
+===============
+R_ShutdownJobs
+===============
+*/
+void R_ShutdownJobs( void ) {
+	int		i;
+
+	JOB_LOCK();
+	jobsQuit = qtrue;
+	JOB_SIGNAL( jobWake );
+	JOB_UNLOCK();
+
+	for ( i = 1 ; i < numJobThreads ; i++ ) {
+#ifdef _WIN32
+		WaitForSingleObject( jobThreads[i], INFINITE );
+		CloseHandle( jobThreads[i] );
+#else
+		pthread_join( jobThreads[i], NULL );
+#endif
+	}
+	numJobThreads = 1;
+
+#ifdef _WIN32
+	DeleteCriticalSection( &jobLock );
+	DeleteCriticalSection( &jobRunLock );
+	DeleteCriticalSection( &queueLock );
+#endif
+}
+
+/*
+===============
+R_NumJobThreads
+===============
+*/
+int R_NumJobThreads( void ) {
+	return numJobThreads;
+}
+
+/*
+===============
+R_RunJobs
+
+Runs func for every job number and returns when they are all done.  Not
+reentrant: jobs must not start jobs of their own.  Callers on different
+threads take turns.
+===============
+*/
+void R_RunJobs( jobFunc_t func, int numJobs ) {
+	int		i;
+
+	if ( numJobThreads == 1 || numJobs < 2 ) {
+		for ( i = 0 ; i < numJobs ; i++ ) {
+			func( i, 0 );
+		}
+		return;
+	}
+
+	LOCK( jobRunLock );
+	JOB_LOCK();
+	jobFunc = func;
+	jobCount = numJobs;
+	jobNext = 0;
+	jobsFinished = 0;
+	jobGeneration++;
+	JOB_SIGNAL( jobWake );
+
+	R_DoJobs( 0 );
+
+	while ( jobsFinished < jobCount ) {
+		JOB_WAIT( jobDone );
+	}
+	JOB_UNLOCK();
+	UNLOCK( jobRunLock );
+}
+
+
+/*
+===============================================================================
+
+RENDER QUEUE
+
+The front end hands finished command lists to the render thread through a
+single producer, single consumer ring, so it can get up to r_smpFrames
+frames ahead.  Pushing and popping don't lock; the render thread keeps
+going for as long as there is something in the ring.
+
+The render thread only goes through GLimp_RendererSleep / GLimp_WakeRenderer,
+which is also what moves the gl context between the threads, once the ring
+has run dry.  renderThreadAwake decides who does what: the render thread
+drops it before it gives up on an empty ring, and whoever puts it back up
+owns the next wakeup.
+
+The lock is only there for the front end to sleep on while the ring is full.
+
+===============================================================================
+*/
+
+/*
+===============
+R_InitRenderQueue
+===============
+*/
+void R_InitRenderQueue( void ) {
+	renderQueueHead = 0;
+	renderQueueTail = 0;
+	renderThreadAwake = 0;
+}
+
+/*
+===============
+R_PushRenderCommands
+
+Returns qtrue if the render thread has gone to sleep and the caller has to
+wake it.
+===============
+*/
+qboolean R_PushRenderCommands( renderCommandList_t *cmdList ) {
+	renderQueue[renderQueueHead % SMP_FRAMES] = cmdList;
+	MEMORY_BARRIER();
+	renderQueueHead++;
+
+	// also a full barrier, so the render thread either sees the new
+	// head before it sleeps or leaves the flag down for us
+	return COMPARE_EXCHANGE( &renderThreadAwake, 1, 0 ) == 0;
+}
+
+/*
+===============
+R_PopRenderCommands
+
+Render thread only.  Returns the oldest list in the ring without taking it
+out, or NULL when the thread should go back to GLimp_RendererSleep.
+===============
+*/
+renderCommandList_t *R_PopRenderCommands( void ) {
+	while ( 1 ) {
+		if ( renderQueueTail != renderQueueHead ) {
+			MEMORY_BARRIER();
+			return renderQueue[renderQueueTail % SMP_FRAMES];
+		}
+
+		// looks empty, put the flag down and look again
+		renderThreadAwake = 0;
+		MEMORY_BARRIER();
+
+		if ( renderQueueTail == renderQueueHead ) {
+			return NULL;
+		}
+
+		// something came in after all, keep going unless the front
+		// end has already seen the flag down and is going to wake us
+		if ( COMPARE_EXCHANGE( &renderThreadAwake, 1, 0 ) != 0 ) {
+			return NULL;
+		}
+	}
+}
+
+/*
+===============
+R_FinishRenderCommands
+
+Render thread only.  The list R_PopRenderCommands returned has been run and
+its frame can be reused.
+===============
+*/
+void R_FinishRenderCommands( void ) {
+	LOCK( queueLock );
+	renderQueueTail++;
+	SIGNAL( queueDone );
+	UNLOCK( queueLock );
+}
+
+/*
+===============
+R_RenderQueueDepth
+
+Lists pushed that the render thread hasn't finished yet
+===============
+*/
+int R_RenderQueueDepth( void ) {
+	return renderQueueHead - renderQueueTail;
+}
+
+/*
+===============
+R_WaitRenderQueue
+
+Sleeps until no more than maxDepth lists are left in the ring, returns the
+msec spent waiting
+===============
+*/
+int R_WaitRenderQueue( int maxDepth ) {
+	int		start;
+
+	if ( renderQueueHead - renderQueueTail <= maxDepth ) {
+		return 0;
+	}
+
+	start = ri.Milliseconds();
+	LOCK( queueLock );
+	while ( renderQueueHead - renderQueueTail > maxDepth ) {
+		WAIT( queueDone, queueLock );
+	}
+	UNLOCK( queueLock );
+
+	return ri.Milliseconds() - start;
+}
@@ -42,9 +42,9 @@ long myftol( float f );
 
 
 // everything that is needed by the backend needs
-// to be double buffered to allow it to run in
-// parallel on a dual cpu machine
-#define	SMP_FRAMES		2
+// to be kept once per frame in flight to allow it
+// to run in parallel on a dual cpu machine
+#define	SMP_FRAMES		4		// most r_smpFrames can ask for
 
 // 12 bits
 // see QSORT_SHADERNUM_SHIFT
@@ -687,6 +687,13 @@ typedef struct {
 	int			numSurfaces;
 } bmodel_t;
 
+// world surfaces that passed the PVS, queued up for the job threads to
+// cull and dlight before they are added as drawsurfs
+typedef struct {
+	msurface_t	*surf;
+	int			dlightBits;		// -1 once culled
+} visSurface_t;
+
 typedef struct {
 	char		name[MAX_QPATH];		// ie: maps/tim_dm2.bsp
 	char		baseName[MAX_QPATH];	// ie: tim_dm2
@@ -729,6 +736,8 @@ typedef struct {
 
 	char		*entityString;
 	char		*entityParsePoint;
+
+	visSurface_t	*visSurfaces;	// numsurfaces, for R_AddWorldSurfaces
 } world_t;
 
 //======================================================================
@@ -812,6 +821,8 @@ typedef struct {
 	int		c_leafs;
 	int		c_dlightSurfaces;
 	int		c_dlightSurfacesCulled;
+
+	int		msecBlocked;		// waiting for the render thread to free a frame
 } frontEndCounters_t;
 
 #define	FOG_TABLE_SIZE		256
@@ -842,6 +853,9 @@ typedef struct {
 	int		c_flareTests;
 	int		c_flareRenders;
 
+	int		c_prelerpSurfaces, c_prelerpVertexes;
+	int		msecPrelerp;	// md3 vertexes lerped by the job threads
+
 	int		msec;			// total msec for backend run
 } backEndCounters_t;
 
@@ -880,7 +894,8 @@ typedef struct {
 	int						viewCount;		// incremented every view (twice a scene if portaled)
 											// and every R_MarkFragments call
 
-	int						smpFrame;		// toggles from 0 to 1 every endFrame
+	int						smpFrame;		// goes around the ring every endFrame
+	int						smpFrames;		// backEndData allocated, 1 without r_smp
 
 	int						frameSceneNum;	// zeroed at RE_BeginFrame
 
@@ -1069,6 +1084,12 @@ extern	cvar_t	*r_subdivisions;
 extern	cvar_t	*r_lodCurveError;
 extern	cvar_t	*r_smp;
 extern	cvar_t	*r_showSmp;
+extern	cvar_t	*r_smpFrames;					// frames the front end can get ahead of the render thread, plus one
+extern	cvar_t	*r_jobThreads;					// front end worker threads, -1 for one per cpu
+extern	cvar_t	*r_simd;						// SSE2 versions of the tess kernels
+extern	cvar_t	*r_imageJobs;					// filter loaded images on the job threads
+extern	cvar_t	*r_imageCache;					// keep the uploaded levels of loaded images on disk
+extern	cvar_t	*r_patchCache;					// keep the tessellated and stitched patches of a map on disk
 extern	cvar_t	*r_skipBackEnd;
 
 extern	cvar_t	*r_ignoreGLErrors;
@@ -1083,6 +1104,7 @@ extern	cvar_t	*r_showImages;
 extern	cvar_t	*r_debugSort;
 
 extern	cvar_t	*r_printShaders;
+extern	cvar_t	*r_shaderCache;
 extern	cvar_t	*r_saveFontData;
 
 //====================================================================
@@ -1201,6 +1223,8 @@ void	R_InitFogTable( void );
 float	R_FogFactor( float s, float t );
 void	R_InitImages( void );
 void	R_DeleteTextures( void );
+void	R_FlushImageQueue( void );
+unsigned	R_HashData( const void *data, int length, unsigned hash );
 int		R_SumOfUsedImages( void );
 void	R_InitSkins( void );
 skin_t	*R_GetSkinByHandle( qhandle_t hSkin );
@@ -1219,6 +1243,7 @@ shader_t	*R_GetShaderByHandle( qhandle_t hShader );
 shader_t	*R_GetShaderByState( int index, long *cycleTime );
 shader_t *R_FindShaderByName( const char *name );
 void		R_InitShaders( void );
+void		R_SaveShaderCache( void );
 void		R_ShaderList_f( void );
 void    R_RemapShader(const char *oldShader, const char *newShader, const char *timeOffset);
 
@@ -1308,6 +1333,8 @@ void RB_AddQuadStampExt( vec3_t origin, vec3_t left, vec3_t up, byte *color, flo
 
 void RB_ShowImages( void );
 
+void RB_PrelerpMeshes( drawSurf_t *drawSurfs, int numDrawSurfs );
+
 
 /*
 ============================================================
@@ -1322,6 +1349,24 @@ void R_AddWorldSurfaces( void );
 qboolean R_inPVS( const vec3_t p1, const vec3_t p2 );
 
 
+/*
+============================================================
+
+JOBS
+
+============================================================
+*/
+
+#define	MAX_JOB_THREADS		16
+
+typedef void (*jobFunc_t)( int job, int thread );
+
+void	R_InitJobs( void );
+void	R_ShutdownJobs( void );
+int		R_NumJobThreads( void );
+void	R_RunJobs( jobFunc_t func, int numJobs );
+
+
 /*
 ============================================================
 
@@ -1386,6 +1431,11 @@ CURVE TESSELATION
 
 #define PATCH_STITCHING
 
+void R_TessellatePatch( int *width, int *height,
+								drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE],
+								drawVert_t ctrl[MAX_GRID_SIZE][MAX_GRID_SIZE], float errorTable[2][MAX_GRID_SIZE] );
+srfGridMesh_t *R_CreateSurfaceGridMesh( int width, int height,
+								drawVert_t ctrl[MAX_GRID_SIZE][MAX_GRID_SIZE], float errorTable[2][MAX_GRID_SIZE] );
 srfGridMesh_t *R_SubdividePatchToGrid( int width, int height,
 								drawVert_t points[MAX_PATCH_SIZE*MAX_PATCH_SIZE] );
 srfGridMesh_t *R_GridInsertColumn( srfGridMesh_t *grid, int column, int row, vec3_t point, float loderror );
@@ -1463,6 +1513,9 @@ void	RB_CalcColorFromOneMinusEntity( unsigned char *dstColors );
 void	RB_CalcSpecularAlpha( unsigned char *alphas );
 void	RB_CalcDiffuseColor( unsigned char *colors );
 
+void	RB_InitShadeCalc( void );
+void	R_ShadeCalcBench_f( void );
+
 /*
 =============================================================
 
@@ -1571,12 +1624,13 @@ typedef struct {
 	srfPoly_t	*polys;//[MAX_POLYS];
 	polyVert_t	*polyVerts;//[MAX_POLYVERTS];
 	renderCommandList_t	commands;
+	backEndCounters_t	pc;		// the back end's, left here when the frame is done
 } backEndData_t;
 
 extern	int		max_polys;
 extern	int		max_polyverts;
 
-extern	backEndData_t	*backEndData[SMP_FRAMES];	// the second one may not be allocated
+extern	backEndData_t	*backEndData[SMP_FRAMES];	// only tr.smpFrames are allocated
 
 extern	volatile renderCommandList_t	*renderCommandList;
 
@@ -1591,6 +1645,13 @@ void R_ShutdownCommandBuffers( void );
 
 void R_SyncRenderThread( void );
 
+void R_InitRenderQueue( void );
+qboolean R_PushRenderCommands( renderCommandList_t *cmdList );
+renderCommandList_t *R_PopRenderCommands( void );
+void R_FinishRenderCommands( void );
+int R_RenderQueueDepth( void );
+int R_WaitRenderQueue( int maxDepth );
+
 void R_AddDrawSurfCmd( drawSurf_t *drawSurfs, int numDrawSurfs );
 
 void RE_SetColor( const float *rgba );
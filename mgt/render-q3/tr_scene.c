@@ -43,12 +43,13 @@ R_ToggleSmpFrame
 ====================
 */
 void R_ToggleSmpFrame( void ) {
-	if ( r_smp->integer ) {
-		// use the other buffers next frame, because another CPU
-		// may still be rendering into the current ones
-		tr.smpFrame ^= 1;
-	} else {
-		tr.smpFrame = 0;
+	// use the next buffers in the ring, because another CPU
+	// may still be rendering into the current ones
+	tr.smpFrame = ( tr.smpFrame + 1 ) % tr.smpFrames;
+
+	// and make sure it is done with the ones we are about to reuse
+	if ( glConfig.smpActive ) {
+		tr.pc.msecBlocked += R_WaitRenderQueue( tr.smpFrames - 1 );
 	}
 
 	backEndData[tr.smpFrame]->commands.used = 0;
@@ -23,6 +23,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "tr_local.h"
 
+// the kernels convert with _mm_cvttps_epi32, which truncates, so they are only
+// used where myftol is the (int) cast macro and not the rounding fistp version
+#if ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) ) && defined( myftol )
+#define	idsse	1
+#include <emmintrin.h>
+#else
+#define	idsse	0
+#endif
 
 #define	WAVEVALUE( table, base, amplitude, phase, freq )  ((base) + table[ myftol( ( ( (phase) + tess.shaderTime * (freq) ) * FUNCTABLE_SIZE ) ) & FUNCTABLE_MASK ] * (amplitude))
 
@@ -80,6 +88,371 @@ static float EvalWaveFormClamped( const waveForm_t *wf )
 	return glow;
 }
 
+/*
+====================================================================
+
+SSE2 KERNELS
+
+Four vertexes at a time, transposed so that each register holds one
+component of all four.  The function table lookups stay scalar (there
+is no gather in SSE2), everything else does the same float operations
+in the same order as the C loops and truncates like myftol, so the
+results are bit identical as long as the C code does its float math in
+SSE registers too (always on x64).
+Chosen by r_simd at startup; shadecalcbench times both.
+
+====================================================================
+*/
+
+#if idsse
+
+static qboolean	useSSE;
+
+static ID_INLINE void SSE_LoadVerts( const float *v, __m128 *x, __m128 *y, __m128 *z, __m128 *w ) {
+	*x = _mm_loadu_ps( v );
+	*y = _mm_loadu_ps( v + 4 );
+	*z = _mm_loadu_ps( v + 8 );
+	*w = _mm_loadu_ps( v + 12 );
+	_MM_TRANSPOSE4_PS( *x, *y, *z, *w );
+}
+
+static ID_INLINE void SSE_StoreVerts( float *v, __m128 x, __m128 y, __m128 z, __m128 w ) {
+	_MM_TRANSPOSE4_PS( x, y, z, w );
+	_mm_storeu_ps( v, x );
+	_mm_storeu_ps( v + 4, y );
+	_mm_storeu_ps( v + 8, z );
+	_mm_storeu_ps( v + 12, w );
+}
+
+static ID_INLINE __m128 SSE_Lookup( const float *table, __m128i index ) {
+	int		i[4];
+
+	_mm_storeu_si128( (__m128i *)i, index );
+	return _mm_setr_ps( table[i[0]], table[i[1]], table[i[2]], table[i[3]] );
+}
+
+// Q_rsqrt, magic constant and one newton step included
+static ID_INLINE __m128 SSE_RSqrt( __m128 number ) {
+	__m128	x2, y;
+
+	x2 = _mm_mul_ps( number, _mm_set1_ps( 0.5f ) );
+	y = _mm_castsi128_ps( _mm_sub_epi32( _mm_set1_epi32( 0x5f3759df ),
+		_mm_srai_epi32( _mm_castps_si128( number ), 1 ) ) );
+	return _mm_mul_ps( y, _mm_sub_ps( _mm_set1_ps( 1.5f ), _mm_mul_ps( _mm_mul_ps( x2, y ), y ) ) );
+}
+
+/*
+** RB_DeformWaveSSE
+*/
+static void RB_DeformWaveSSE( const deformStage_t *ds, const float *table ) {
+	float	*xyz = ( float * ) tess.xyz;
+	float	*normal = ( float * ) tess.normal;
+	__m128	phase, spread, now, size, base, amplitude;
+	__m128	x, y, z, w, nx, ny, nz, nw, scale;
+	__m128i	mask;
+	int		i;
+
+	phase = _mm_set1_ps( ds->deformationWave.phase );
+	spread = _mm_set1_ps( ds->deformationSpread );
+	now = _mm_set1_ps( tess.shaderTime * ds->deformationWave.frequency );
+	size = _mm_set1_ps( FUNCTABLE_SIZE );
+	base = _mm_set1_ps( ds->deformationWave.base );
+	amplitude = _mm_set1_ps( ds->deformationWave.amplitude );
+	mask = _mm_set1_epi32( FUNCTABLE_MASK );
+
+	for ( i = 0; i + 4 <= tess.numVertexes; i += 4, xyz += 16, normal += 16 ) {
+		SSE_LoadVerts( xyz, &x, &y, &z, &w );
+		SSE_LoadVerts( normal, &nx, &ny, &nz, &nw );
+
+		// WAVEVALUE with the phase pushed by the position
+		scale = _mm_mul_ps( _mm_add_ps( _mm_add_ps( x, y ), z ), spread );
+		scale = _mm_mul_ps( _mm_add_ps( _mm_add_ps( phase, scale ), now ), size );
+		scale = SSE_Lookup( table, _mm_and_si128( _mm_cvttps_epi32( scale ), mask ) );
+		scale = _mm_add_ps( base, _mm_mul_ps( scale, amplitude ) );
+
+		x = _mm_add_ps( x, _mm_mul_ps( nx, scale ) );
+		y = _mm_add_ps( y, _mm_mul_ps( ny, scale ) );
+		z = _mm_add_ps( z, _mm_mul_ps( nz, scale ) );
+		SSE_StoreVerts( xyz, x, y, z, w );
+	}
+
+	for ( ; i < tess.numVertexes; i++, xyz += 4, normal += 4 ) {
+		float off = ( xyz[0] + xyz[1] + xyz[2] ) * ds->deformationSpread;
+		float s = WAVEVALUE( table, ds->deformationWave.base,
+			ds->deformationWave.amplitude,
+			ds->deformationWave.phase + off,
+			ds->deformationWave.frequency );
+
+		xyz[0] += normal[0] * s;
+		xyz[1] += normal[1] * s;
+		xyz[2] += normal[2] * s;
+	}
+}
+
+/*
+** RB_FillColorsSSE
+*/
+static void RB_FillColorsSSE( int *colors, int color ) {
+	__m128i	v;
+	int		i;
+
+	v = _mm_set1_epi32( color );
+	for ( i = 0; i + 4 <= tess.numVertexes; i += 4 ) {
+		_mm_storeu_si128( (__m128i *)( colors + i ), v );
+	}
+	for ( ; i < tess.numVertexes; i++ ) {
+		colors[i] = color;
+	}
+}
+
+/*
+** RB_FogModulateSSE
+**
+** Same as RB_FogModulate, the untouched channels are multiplied by 1
+*/
+static void RB_FogModulateSSE( unsigned char *colors, float texCoords[][2], qboolean rgb, qboolean alpha ) {
+	__m128	s, t, zero, one, d, f;
+	__m128	a, b, inside, keep;
+	__m128i	packed, lo, hi, c[4], zeroi;
+	float	factors[4];
+	int		i, j;
+
+	zero = _mm_setzero_ps();
+	one = _mm_set1_ps( 1.0f );
+	zeroi = _mm_setzero_si128();
+
+	for ( i = 0; i + 4 <= tess.numVertexes; i += 4, colors += 16 ) {
+		// R_FogFactor for four vertexes
+		a = _mm_loadu_ps( texCoords[i] );
+		b = _mm_loadu_ps( texCoords[i + 2] );
+		s = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+		t = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+
+		s = _mm_sub_ps( s, _mm_set1_ps( 1.0f/512 ) );
+		inside = _mm_and_ps( _mm_cmpge_ps( s, zero ), _mm_cmpge_ps( t, _mm_set1_ps( 1.0f/32 ) ) );
+
+		keep = _mm_cmplt_ps( t, _mm_set1_ps( 31.0f/32 ) );
+		d = _mm_mul_ps( s, _mm_div_ps( _mm_sub_ps( t, _mm_set1_ps( 1.0f/32.0f ) ), _mm_set1_ps( 30.0f/32.0f ) ) );
+		s = _mm_or_ps( _mm_and_ps( keep, d ), _mm_andnot_ps( keep, s ) );
+
+		s = _mm_min_ps( _mm_mul_ps( s, _mm_set1_ps( 8 ) ), one );
+		s = _mm_max_ps( s, zero );		// keeps the outside lanes in the table
+		d = SSE_Lookup( tr.fogTable, _mm_cvttps_epi32( _mm_mul_ps( s, _mm_set1_ps( FOG_TABLE_SIZE-1 ) ) ) );
+		f = _mm_sub_ps( one, _mm_and_ps( inside, d ) );
+		_mm_storeu_ps( factors, f );
+
+		// colors * f, a vertex per register
+		packed = _mm_loadu_si128( (__m128i *)colors );
+		lo = _mm_unpacklo_epi8( packed, zeroi );
+		hi = _mm_unpackhi_epi8( packed, zeroi );
+		c[0] = _mm_unpacklo_epi16( lo, zeroi );
+		c[1] = _mm_unpackhi_epi16( lo, zeroi );
+		c[2] = _mm_unpacklo_epi16( hi, zeroi );
+		c[3] = _mm_unpackhi_epi16( hi, zeroi );
+
+		for ( j = 0 ; j < 4 ; j++ ) {
+			f = _mm_setr_ps( rgb ? factors[j] : 1.0f, rgb ? factors[j] : 1.0f, rgb ? factors[j] : 1.0f,
+				alpha ? factors[j] : 1.0f );
+			c[j] = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( c[j] ), f ) );
+		}
+
+		packed = _mm_packus_epi16( _mm_packs_epi32( c[0], c[1] ), _mm_packs_epi32( c[2], c[3] ) );
+		_mm_storeu_si128( (__m128i *)colors, packed );
+	}
+
+	for ( ; i < tess.numVertexes; i++, colors += 4 ) {
+		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
+
+		if ( rgb ) {
+			colors[0] *= f;
+			colors[1] *= f;
+			colors[2] *= f;
+		}
+		if ( alpha ) {
+			colors[3] *= f;
+		}
+	}
+}
+
+/*
+** RB_EnvironmentSSE
+*/
+static void RB_EnvironmentSSE( float *st ) {
+	float	*v = tess.xyz[0];
+	float	*normal = tess.normal[0];
+	__m128	ox, oy, oz, half, two;
+	__m128	x, y, z, w, nx, ny, nz, nw, d;
+	int		i;
+
+	ox = _mm_set1_ps( backEnd.or.viewOrigin[0] );
+	oy = _mm_set1_ps( backEnd.or.viewOrigin[1] );
+	oz = _mm_set1_ps( backEnd.or.viewOrigin[2] );
+	half = _mm_set1_ps( 0.5f );
+	two = _mm_set1_ps( 2.0f );
+
+	for ( i = 0; i + 4 <= tess.numVertexes; i += 4, v += 16, normal += 16, st += 8 ) {
+		SSE_LoadVerts( v, &x, &y, &z, &w );
+		SSE_LoadVerts( normal, &nx, &ny, &nz, &nw );
+
+		// viewer, normalized
+		x = _mm_sub_ps( ox, x );
+		y = _mm_sub_ps( oy, y );
+		z = _mm_sub_ps( oz, z );
+		d = SSE_RSqrt( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+		x = _mm_mul_ps( x, d );
+		y = _mm_mul_ps( y, d );
+		z = _mm_mul_ps( z, d );
+
+		d = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, x ), _mm_mul_ps( ny, y ) ), _mm_mul_ps( nz, z ) );
+
+		// reflected y and z turned into s and t
+		y = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( ny, two ), d ), y );
+		z = _mm_sub_ps( _mm_mul_ps( _mm_mul_ps( nz, two ), d ), z );
+		y = _mm_add_ps( half, _mm_mul_ps( y, half ) );
+		z = _mm_sub_ps( half, _mm_mul_ps( z, half ) );
+
+		_mm_storeu_ps( st, _mm_unpacklo_ps( y, z ) );
+		_mm_storeu_ps( st + 4, _mm_unpackhi_ps( y, z ) );
+	}
+
+	for ( ; i < tess.numVertexes; i++, v += 4, normal += 4, st += 2 ) {
+		vec3_t	viewer, reflected;
+		float	dot;
+
+		VectorSubtract (backEnd.or.viewOrigin, v, viewer);
+		VectorNormalizeFast (viewer);
+
+		dot = DotProduct (normal, viewer);
+
+		reflected[1] = normal[1]*2*dot - viewer[1];
+		reflected[2] = normal[2]*2*dot - viewer[2];
+
+		st[0] = 0.5 + reflected[1] * 0.5;
+		st[1] = 0.5 - reflected[2] * 0.5;
+	}
+}
+
+/*
+** RB_TurbulentSSE
+**
+** The table index is worked out in double like the C version does
+*/
+static void RB_TurbulentSSE( const waveForm_t *wf, float *st, float now ) {
+	const float	*xyz = tess.xyz[0];
+	__m128		x, y, z, w, s, t, a, b, amplitude;
+	__m128d		scale, vnow, size;
+	__m128i		mask, is, it;
+	int			i;
+
+	amplitude = _mm_set1_ps( wf->amplitude );
+	scale = _mm_set1_pd( 1.0/128 * 0.125 );
+	vnow = _mm_set1_pd( now );
+	size = _mm_set1_pd( FUNCTABLE_SIZE );
+	mask = _mm_set1_epi32( FUNCTABLE_MASK );
+
+	for ( i = 0; i + 4 <= tess.numVertexes; i += 4, xyz += 16, st += 8 ) {
+		SSE_LoadVerts( xyz, &x, &y, &z, &w );
+		x = _mm_add_ps( x, z );
+
+#define	TURB_INDEX( v ) _mm_unpacklo_epi64( \
+			_mm_cvttpd_epi32( _mm_mul_pd( _mm_add_pd( _mm_mul_pd( _mm_cvtps_pd( v ), scale ), vnow ), size ) ), \
+			_mm_cvttpd_epi32( _mm_mul_pd( _mm_add_pd( _mm_mul_pd( _mm_cvtps_pd( _mm_movehl_ps( v, v ) ), scale ), vnow ), size ) ) )
+		is = _mm_and_si128( TURB_INDEX( x ), mask );
+		it = _mm_and_si128( TURB_INDEX( y ), mask );
+#undef TURB_INDEX
+
+		a = _mm_loadu_ps( st );
+		b = _mm_loadu_ps( st + 4 );
+		s = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+		t = _mm_shuffle_ps( a, b, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+
+		s = _mm_add_ps( s, _mm_mul_ps( SSE_Lookup( tr.sinTable, is ), amplitude ) );
+		t = _mm_add_ps( t, _mm_mul_ps( SSE_Lookup( tr.sinTable, it ), amplitude ) );
+
+		_mm_storeu_ps( st, _mm_unpacklo_ps( s, t ) );
+		_mm_storeu_ps( st + 4, _mm_unpackhi_ps( s, t ) );
+	}
+
+	for ( ; i < tess.numVertexes; i++, st += 2 ) {
+		st[0] += tr.sinTable[ ( ( int ) ( ( ( tess.xyz[i][0] + tess.xyz[i][2] )* 1.0/128 * 0.125 + now ) * FUNCTABLE_SIZE ) ) & ( FUNCTABLE_MASK ) ] * wf->amplitude;
+		st[1] += tr.sinTable[ ( ( int ) ( ( tess.xyz[i][1] * 1.0/128 * 0.125 + now ) * FUNCTABLE_SIZE ) ) & ( FUNCTABLE_MASK ) ] * wf->amplitude;
+	}
+}
+
+/*
+** RB_DiffuseSSE
+*/
+static void RB_DiffuseSSE( unsigned char *colors, const trRefEntity_t *ent ) {
+	float	*normal = tess.normal[0];
+	__m128	lx, ly, lz, ar, ag, ab, dr, dg, db, max;
+	__m128	nx, ny, nz, nw, incoming, lit;
+	__m128i	r, g, b, pixels, ambient, alpha;
+	int		i;
+
+	lx = _mm_set1_ps( ent->lightDir[0] );
+	ly = _mm_set1_ps( ent->lightDir[1] );
+	lz = _mm_set1_ps( ent->lightDir[2] );
+	ar = _mm_set1_ps( ent->ambientLight[0] );
+	ag = _mm_set1_ps( ent->ambientLight[1] );
+	ab = _mm_set1_ps( ent->ambientLight[2] );
+	dr = _mm_set1_ps( ent->directedLight[0] );
+	dg = _mm_set1_ps( ent->directedLight[1] );
+	db = _mm_set1_ps( ent->directedLight[2] );
+	max = _mm_set1_ps( 255 );
+	ambient = _mm_set1_epi32( ent->ambientLightInt );
+	alpha = _mm_set1_epi32( 0xff << 24 );
+
+	for ( i = 0; i + 4 <= tess.numVertexes; i += 4, normal += 16 ) {
+		SSE_LoadVerts( normal, &nx, &ny, &nz, &nw );
+
+		incoming = _mm_add_ps( _mm_add_ps( _mm_mul_ps( nx, lx ), _mm_mul_ps( ny, ly ) ), _mm_mul_ps( nz, lz ) );
+		lit = _mm_cmpgt_ps( incoming, _mm_setzero_ps() );
+
+		r = _mm_cvttps_epi32( _mm_min_ps( _mm_add_ps( ar, _mm_mul_ps( incoming, dr ) ), max ) );
+		g = _mm_cvttps_epi32( _mm_min_ps( _mm_add_ps( ag, _mm_mul_ps( incoming, dg ) ), max ) );
+		b = _mm_cvttps_epi32( _mm_min_ps( _mm_add_ps( ab, _mm_mul_ps( incoming, db ) ), max ) );
+
+		// bytes are RGBA in memory
+		pixels = _mm_or_si128( _mm_or_si128( r, _mm_slli_epi32( g, 8 ) ), _mm_or_si128( _mm_slli_epi32( b, 16 ), alpha ) );
+		pixels = _mm_or_si128( _mm_and_si128( _mm_castps_si128( lit ), pixels ), _mm_andnot_si128( _mm_castps_si128( lit ), ambient ) );
+		_mm_storeu_si128( (__m128i *)( colors + i*4 ), pixels );
+	}
+
+	for ( ; i < tess.numVertexes; i++, normal += 4 ) {
+		float	in;
+		int		j;
+
+		in = DotProduct (normal, ent->lightDir);
+		if ( in <= 0 ) {
+			*(int *)&colors[i*4] = ent->ambientLightInt;
+			continue;
+		}
+		j = myftol( ent->ambientLight[0] + in * ent->directedLight[0] );
+		colors[i*4+0] = j > 255 ? 255 : j;
+		j = myftol( ent->ambientLight[1] + in * ent->directedLight[1] );
+		colors[i*4+1] = j > 255 ? 255 : j;
+		j = myftol( ent->ambientLight[2] + in * ent->directedLight[2] );
+		colors[i*4+2] = j > 255 ? 255 : j;
+		colors[i*4+3] = 255;
+	}
+}
+
+#endif // idsse
+
+/*
+** RB_InitShadeCalc
+**
+** Picks the kernels, called once from R_Init
+*/
+void RB_InitShadeCalc( void ) {
+#if idsse
+	useSSE = r_simd->integer ? qtrue : qfalse;
+	if ( useSSE ) {
+		ri.Printf( PRINT_ALL, "...using SSE2 tess kernels\n" );
+	}
+#endif
+}
+
 /*
 ** RB_CalcStretchTexCoords
 */
@@ -141,6 +514,13 @@ void RB_CalcDeformVertexes( deformStage_t *ds )
 	{
 		table = TableForFunc( ds->deformationWave.func );
 
+#if idsse
+		if ( useSSE ) {
+			RB_DeformWaveSSE( ds, table );
+			return;
+		}
+#endif
+
 		for ( i = 0; i < tess.numVertexes; i++, xyz += 4, normal += 4 )
 		{
 			float off = ( xyz[0] + xyz[1] + xyz[2] ) * ds->deformationSpread;
@@ -700,7 +1080,14 @@ void RB_CalcWaveColor( const waveForm_t *wf, unsigned char *dstColors )
 	color[0] = color[1] = color[2] = v;
 	color[3] = 255;
 	v = *(int *)color;
-	
+
+#if idsse
+	if ( useSSE ) {
+		RB_FillColorsSSE( colors, v );
+		return;
+	}
+#endif
+
 	for ( i = 0; i < tess.numVertexes; i++, colors++ ) {
 		*colors = v;
 	}
@@ -725,11 +1112,40 @@ void RB_CalcWaveAlpha( const waveForm_t *wf, unsigned char *dstColors )
 	}
 }
 
+/*
+** RB_FogModulate
+**
+** Scales the rgb and/or alpha of colors by how much of the
+** fog they are out of
+*/
+static void RB_FogModulate( unsigned char *colors, float texCoords[][2], qboolean rgb, qboolean alpha ) {
+	int		i;
+
+#if idsse
+	if ( useSSE ) {
+		RB_FogModulateSSE( colors, texCoords, rgb, alpha );
+		return;
+	}
+#endif
+
+	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
+		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
+
+		if ( rgb ) {
+			colors[0] *= f;
+			colors[1] *= f;
+			colors[2] *= f;
+		}
+		if ( alpha ) {
+			colors[3] *= f;
+		}
+	}
+}
+
 /*
 ** RB_CalcModulateColorsByFog
 */
 void RB_CalcModulateColorsByFog( unsigned char *colors ) {
-	int		i;
 	float	texCoords[SHADER_MAX_VERTEXES][2];
 
 	// calculate texcoords so we can derive density
@@ -737,19 +1153,13 @@ void RB_CalcModulateColorsByFog( unsigned char *colors ) {
 	// been previously called if the surface was opaque
 	RB_CalcFogTexCoords( texCoords[0] );
 
-	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
-		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
-		colors[0] *= f;
-		colors[1] *= f;
-		colors[2] *= f;
-	}
+	RB_FogModulate( colors, texCoords, qtrue, qfalse );
 }
 
 /*
 ** RB_CalcModulateAlphasByFog
 */
 void RB_CalcModulateAlphasByFog( unsigned char *colors ) {
-	int		i;
 	float	texCoords[SHADER_MAX_VERTEXES][2];
 
 	// calculate texcoords so we can derive density
@@ -757,17 +1167,13 @@ void RB_CalcModulateAlphasByFog( unsigned char *colors ) {
 	// been previously called if the surface was opaque
 	RB_CalcFogTexCoords( texCoords[0] );
 
-	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
-		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
-		colors[3] *= f;
-	}
+	RB_FogModulate( colors, texCoords, qfalse, qtrue );
 }
 
 /*
 ** RB_CalcModulateRGBAsByFog
 */
 void RB_CalcModulateRGBAsByFog( unsigned char *colors ) {
-	int		i;
 	float	texCoords[SHADER_MAX_VERTEXES][2];
 
 	// calculate texcoords so we can derive density
@@ -775,13 +1181,7 @@ void RB_CalcModulateRGBAsByFog( unsigned char *colors ) {
 	// been previously called if the surface was opaque
 	RB_CalcFogTexCoords( texCoords[0] );
 
-	for ( i = 0; i < tess.numVertexes; i++, colors += 4 ) {
-		float f = 1.0 - R_FogFactor( texCoords[i][0], texCoords[i][1] );
-		colors[0] *= f;
-		colors[1] *= f;
-		colors[2] *= f;
-		colors[3] *= f;
-	}
+	RB_FogModulate( colors, texCoords, qtrue, qtrue );
 }
 
 
@@ -892,6 +1292,13 @@ void RB_CalcEnvironmentTexCoords( float *st )
 	vec3_t		viewer, reflected;
 	float		d;
 
+#if idsse
+	if ( useSSE ) {
+		RB_EnvironmentSSE( st );
+		return;
+	}
+#endif
+
 	v = tess.xyz[0];
 	normal = tess.normal[0];
 
@@ -921,6 +1328,13 @@ void RB_CalcTurbulentTexCoords( const waveForm_t *wf, float *st )
 
 	now = ( wf->phase + tess.shaderTime * wf->frequency );
 
+#if idsse
+	if ( useSSE ) {
+		RB_TurbulentSSE( wf, st, now );
+		return;
+	}
+#endif
+
 	for ( i = 0; i < tess.numVertexes; i++, st += 2 )
 	{
 		float s = st[0];
@@ -1122,6 +1536,12 @@ void RB_CalcDiffuseColor( unsigned char *colors )
 #endif
 	ent = backEnd.currentEntity;
 	ambientLightInt = ent->ambientLightInt;
+#if idsse
+	if ( useSSE ) {
+		RB_DiffuseSSE( colors, ent );
+		return;
+	}
+#endif
 #if idppc_altivec
 	// A lot of this could be simplified if we made sure
 	// entities light info was 16-byte aligned.
@@ -1203,3 +1623,202 @@ void RB_CalcDiffuseColor( unsigned char *colors )
 	}
 }
 
+
+/*
+====================================================================
+
+SHADECALCBENCH
+
+====================================================================
+*/
+
+#if idsse
+
+#define	BENCH_VERTEXES	1000
+#define	BENCH_PASSES	20000
+
+typedef struct {
+	vec4_t		xyz[SHADER_MAX_VERTEXES];
+	vec2_t		st[SHADER_MAX_VERTEXES];
+	color4ub_t	colors[SHADER_MAX_VERTEXES];
+} benchVerts_t;
+
+static benchVerts_t		benchInput, benchResult;
+static deformStage_t	benchDeform;
+static waveForm_t		benchWave;
+static trRefEntity_t	benchEntity;
+static float			benchFogCoords[SHADER_MAX_VERTEXES][2];
+
+static void SCB_Deform( void ) { RB_CalcDeformVertexes( &benchDeform ); }
+static void SCB_WaveColor( void ) { RB_CalcWaveColor( &benchWave, tess.svars.colors[0] ); }
+static void SCB_Turbulent( void ) { RB_CalcTurbulentTexCoords( &benchWave, tess.svars.texcoords[0][0] ); }
+static void SCB_Environment( void ) { RB_CalcEnvironmentTexCoords( tess.svars.texcoords[0][0] ); }
+static void SCB_Diffuse( void ) { RB_CalcDiffuseColor( tess.svars.colors[0] ); }
+static void SCB_Fog( void ) { RB_FogModulate( tess.svars.colors[0], benchFogCoords, qtrue, qtrue ); }
+
+static const struct {
+	const char	*name;
+	void		(*func)( void );
+} benchKernels[] = {
+	{ "deform wave", SCB_Deform },
+	{ "wave color", SCB_WaveColor },
+	{ "turbulent", SCB_Turbulent },
+	{ "environment", SCB_Environment },
+	{ "diffuse", SCB_Diffuse },
+	{ "fog modulate", SCB_Fog }
+};
+
+static void SCB_Save( benchVerts_t *verts ) {
+	Com_Memcpy( verts->xyz, tess.xyz, sizeof( verts->xyz ) );
+	Com_Memcpy( verts->st, tess.svars.texcoords[0], sizeof( verts->st ) );
+	Com_Memcpy( verts->colors, tess.svars.colors, sizeof( verts->colors ) );
+}
+
+static void SCB_Restore( const benchVerts_t *verts ) {
+	Com_Memcpy( tess.xyz, verts->xyz, sizeof( verts->xyz ) );
+	Com_Memcpy( tess.svars.texcoords[0], verts->st, sizeof( verts->st ) );
+	Com_Memcpy( tess.svars.colors, verts->colors, sizeof( verts->colors ) );
+}
+
+/*
+** SCB_Time
+**
+** Milliseconds for BENCH_PASSES runs of func
+*/
+static int SCB_Time( void (*func)( void ) ) {
+	int		i, start;
+
+	SCB_Restore( &benchInput );
+	start = ri.Milliseconds();
+	for ( i = 0 ; i < BENCH_PASSES ; i++ ) {
+		func();
+	}
+	return ri.Milliseconds() - start;
+}
+
+/*
+** SCB_Mismatches
+**
+** Vertexes where one run of func differs between the C and SSE paths
+*/
+static int SCB_Mismatches( void (*func)( void ) ) {
+	int		i, count;
+
+	useSSE = qfalse;
+	SCB_Restore( &benchInput );
+	func();
+	SCB_Save( &benchResult );
+
+	useSSE = qtrue;
+	SCB_Restore( &benchInput );
+	func();
+
+	count = 0;
+	for ( i = 0 ; i < tess.numVertexes ; i++ ) {
+		if ( memcmp( tess.xyz[i], benchResult.xyz[i], sizeof( vec3_t ) )
+			|| memcmp( tess.svars.texcoords[0][i], benchResult.st[i], sizeof( vec2_t ) )
+			|| memcmp( tess.svars.colors[i], benchResult.colors[i], sizeof( color4ub_t ) ) ) {
+			count++;
+		}
+	}
+	return count;
+}
+
+/*
+** SCB_Setup
+**
+** Random vertexes, a sin wave deform and a lit entity
+*/
+static void SCB_Setup( void ) {
+	int		i;
+
+	srand( 1234 );
+	tess.numVertexes = BENCH_VERTEXES;
+	tess.shaderTime = 12.345f;
+
+	for ( i = 0 ; i < BENCH_VERTEXES ; i++ ) {
+		benchInput.xyz[i][0] = crandom() * 2048;
+		benchInput.xyz[i][1] = crandom() * 2048;
+		benchInput.xyz[i][2] = crandom() * 2048;
+		benchInput.xyz[i][3] = 1;
+		tess.normal[i][0] = crandom();
+		tess.normal[i][1] = crandom();
+		tess.normal[i][2] = crandom();
+		VectorNormalize( tess.normal[i] );
+		tess.texCoords[i][0][0] = benchInput.st[i][0] = random() * 4;
+		tess.texCoords[i][0][1] = benchInput.st[i][1] = random() * 4;
+		benchInput.colors[i][0] = rand() & 255;
+		benchInput.colors[i][1] = rand() & 255;
+		benchInput.colors[i][2] = rand() & 255;
+		benchInput.colors[i][3] = rand() & 255;
+		benchFogCoords[i][0] = random() * 0.2f;
+		benchFogCoords[i][1] = random();
+	}
+
+	Com_Memset( &benchDeform, 0, sizeof( benchDeform ) );
+	benchDeform.deformation = DEFORM_WAVE;
+	benchDeform.deformationSpread = 1.0f / 64;
+	benchDeform.deformationWave.func = GF_SIN;
+	benchDeform.deformationWave.base = 0.5f;
+	benchDeform.deformationWave.amplitude = 3;
+	benchDeform.deformationWave.phase = 0.25f;
+	benchDeform.deformationWave.frequency = 0.7f;
+
+	benchWave = benchDeform.deformationWave;
+
+	Com_Memset( &benchEntity, 0, sizeof( benchEntity ) );
+	VectorSet( benchEntity.ambientLight, 40, 50, 60 );
+	VectorSet( benchEntity.directedLight, 180, 160, 320 );
+	VectorSet( benchEntity.lightDir, 0.48f, 0.6f, 0.64f );
+	benchEntity.ambientLightInt = 40 | ( 50 << 8 ) | ( 60 << 16 ) | ( 0xff << 24 );
+	backEnd.currentEntity = &benchEntity;
+}
+
+/*
+** R_ShadeCalcBench_f
+**
+** Times the C and SSE2 versions of the tess kernels on the same
+** random vertexes and checks that they give the same results
+*/
+void R_ShadeCalcBench_f( void ) {
+	trRefEntity_t	*oldEntity;
+	qboolean		oldSSE;
+	float			oldTime;
+	int				i, oldNumVertexes;
+	int				c, sse;
+
+	R_SyncRenderThread();
+
+	oldEntity = backEnd.currentEntity;
+	oldNumVertexes = tess.numVertexes;
+	oldTime = tess.shaderTime;
+	oldSSE = useSSE;
+
+	SCB_Setup();
+
+	ri.Printf( PRINT_ALL, "%i vertexes, %i passes\n", BENCH_VERTEXES, BENCH_PASSES );
+	ri.Printf( PRINT_ALL, "kernel          C usec  SSE usec  speedup  mismatches\n" );
+	for ( i = 0 ; i < (int)( sizeof( benchKernels ) / sizeof( benchKernels[0] ) ) ; i++ ) {
+		useSSE = qfalse;
+		c = SCB_Time( benchKernels[i].func );
+		useSSE = qtrue;
+		sse = SCB_Time( benchKernels[i].func );
+
+		ri.Printf( PRINT_ALL, "%-14s %7.2f %9.2f %7.2fx %11i\n", benchKernels[i].name,
+			c * 1000.0f / BENCH_PASSES, sse * 1000.0f / BENCH_PASSES,
+			sse ? (float)c / sse : 0.0f, SCB_Mismatches( benchKernels[i].func ) );
+	}
+
+	useSSE = oldSSE;
+	tess.shaderTime = oldTime;
+	tess.numVertexes = oldNumVertexes;
+	backEnd.currentEntity = oldEntity;
+}
+
+#else
+
+void R_ShadeCalcBench_f( void ) {
+	ri.Printf( PRINT_ALL, "shadecalcbench: built without SSE2 kernels\n" );
+}
+
+#endif // idsse
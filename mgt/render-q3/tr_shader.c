@@ -35,8 +35,60 @@ static	qboolean		deferLoad;
 #define FILE_HASH_SIZE		1024
 static	shader_t*		hashTable[FILE_HASH_SIZE];
 
+// every shader definition in the scripts, hashed by name in text order
+// so the first definition of a name wins
+typedef struct shaderText_s {
+	char					*name;
+	char					*text;			// just past the name
+	int						file;			// index into shaderFileHashes
+	struct compiledShader_s	*compiled;		// parsed before, see SHADER CACHE
+	struct shaderText_s		*next;
+} shaderText_t;
+
 #define MAX_SHADERTEXT_HASH		2048
-static char **shaderTextHashTable[MAX_SHADERTEXT_HASH];
+static shaderText_t	*shaderTextHashTable[MAX_SHADERTEXT_HASH];
+static shaderText_t	*shaderTextEntries;
+static int			numShaderTextEntries;
+static char			*shaderTextNames;
+static int			shaderTextNamesLength;
+
+#define	MAX_SHADER_FILES	4096
+static unsigned		shaderFileHashes[MAX_SHADER_FILES];
+static int			numShaderFiles;
+static unsigned		shaderTextHash;			// all of the above
+static int			shaderTextLength;
+
+// where the images of the shader being parsed came from, so a compiled
+// shader can look them up again without the text
+typedef enum {
+	SIR_FILE,
+	SIR_SKY,				// the default image if it can't be found
+	SIR_WHITE,
+	SIR_LIGHTMAP,
+	SIR_VIDEO
+} shaderImageType_t;
+
+typedef struct {
+	char	name[MAX_QPATH];
+	int		type;
+	int		stage;			// -1 for the sky boxes
+	int		index;			// animation frame, or sky side (6 - 11 are the inner box)
+	int		mipmap;
+	int		picmip;
+	int		wrap;
+} shaderImageRef_t;
+
+#define	MAX_SHADER_IMAGE_REFS	( MAX_SHADER_STAGES * MAX_IMAGE_ANIMATIONS + 12 )
+
+static	shaderImageRef_t	imageRefs[MAX_SHADER_IMAGE_REFS];
+static	int					numImageRefs;
+
+// what ParseShader did besides filling in the shader
+#define	PF_SUN			1			// q3map_sun set tr.sunLight
+#define	PF_SKYCOORDS	2			// skyParms called R_InitSkyTexCoords
+#define	PF_NOCACHE		4			// can't be replayed from imageRefs
+
+static	int			parseFlags;
 
 /*
 ================
@@ -579,6 +631,81 @@ static void ParseTexMod( char *_text, shaderStage_t *stage )
 }
 
 
+/*
+===================
+FindShaderImage
+===================
+*/
+static image_t *FindShaderImage( int type, const char *name, qboolean mipmap, qboolean picmip, int wrap ) {
+	image_t		*image;
+
+	switch ( type ) {
+	case SIR_WHITE:
+		return tr.whiteImage;
+	case SIR_LIGHTMAP:
+		if ( shader.lightmapIndex < 0 ) {
+			return tr.whiteImage;
+		}
+		return tr.lightmaps[shader.lightmapIndex];
+	case SIR_SKY:
+		image = R_FindImageFile( name, mipmap, picmip, wrap );
+		if ( !image ) {
+			image = tr.defaultImage;
+		}
+		return image;
+	default:
+		return R_FindImageFile( name, mipmap, picmip, wrap );
+	}
+}
+
+/*
+===================
+NoteShaderImage
+===================
+*/
+static void NoteShaderImage( int type, int stage, int index, const char *name, qboolean mipmap, qboolean picmip, int wrap ) {
+	shaderImageRef_t	*ref;
+
+	if ( numImageRefs == MAX_SHADER_IMAGE_REFS || strlen( name ) >= sizeof( ref->name ) ) {
+		parseFlags |= PF_NOCACHE;
+		return;
+	}
+
+	ref = &imageRefs[numImageRefs++];
+	Q_strncpyz( ref->name, name, sizeof( ref->name ) );
+	ref->type = type;
+	ref->stage = stage;
+	ref->index = index;
+	ref->mipmap = mipmap;
+	ref->picmip = picmip;
+	ref->wrap = wrap;
+}
+
+/*
+===================
+ShaderImage
+
+Looks up an image for the shader being parsed and notes down where it came from
+===================
+*/
+static image_t *ShaderImage( int type, int stage, int index, const char *name, qboolean mipmap, qboolean picmip, int wrap ) {
+	NoteShaderImage( type, stage, index, name, mipmap, picmip, wrap );
+	return FindShaderImage( type, name, mipmap, picmip, wrap );
+}
+
+/*
+===================
+StartVideoMap
+===================
+*/
+static void StartVideoMap( textureBundle_t *bundle, const char *name ) {
+	bundle->videoMapHandle = ri.CIN_PlayCinematic( name, 0, 0, 256, 256, (CIN_loop | CIN_silent | CIN_shader));
+	if (bundle->videoMapHandle != -1) {
+		bundle->isVideoMap = qtrue;
+		bundle->image[0] = tr.scratchImage[bundle->videoMapHandle];
+	}
+}
+
 /*
 ===================
 ParseStage
@@ -619,22 +746,18 @@ static qboolean ParseStage( shaderStage_t *stage, char **text )
 
 			if ( !Q_stricmp( token, "$whiteimage" ) )
 			{
-				stage->bundle[0].image[0] = tr.whiteImage;
+				stage->bundle[0].image[0] = ShaderImage( SIR_WHITE, stage - stages, 0, token, qfalse, qfalse, 0 );
 				continue;
 			}
 			else if ( !Q_stricmp( token, "$lightmap" ) )
 			{
 				stage->bundle[0].isLightmap = qtrue;
-				if ( shader.lightmapIndex < 0 ) {
-					stage->bundle[0].image[0] = tr.whiteImage;
-				} else {
-					stage->bundle[0].image[0] = tr.lightmaps[shader.lightmapIndex];
-				}
+				stage->bundle[0].image[0] = ShaderImage( SIR_LIGHTMAP, stage - stages, 0, token, qfalse, qfalse, 0 );
 				continue;
 			}
 			else
 			{
-				stage->bundle[0].image[0] = R_FindImageFile( token, !shader.noMipMaps, !shader.noPicMip, GL_REPEAT );
+				stage->bundle[0].image[0] = ShaderImage( SIR_FILE, stage - stages, 0, token, !shader.noMipMaps, !shader.noPicMip, GL_REPEAT );
 				if ( !stage->bundle[0].image[0] )
 				{
 					ri.Printf( PRINT_WARNING, "WARNING: R_FindImageFile could not find '%s' in shader '%s'\n", token, shader.name );
@@ -654,7 +777,7 @@ static qboolean ParseStage( shaderStage_t *stage, char **text )
 				return qfalse;
 			}
 
-			stage->bundle[0].image[0] = R_FindImageFile( token, !shader.noMipMaps, !shader.noPicMip, GL_CLAMP );
+			stage->bundle[0].image[0] = ShaderImage( SIR_FILE, stage - stages, 0, token, !shader.noMipMaps, !shader.noPicMip, GL_CLAMP );
 			if ( !stage->bundle[0].image[0] )
 			{
 				ri.Printf( PRINT_WARNING, "WARNING: R_FindImageFile could not find '%s' in shader '%s'\n", token, shader.name );
@@ -684,7 +807,7 @@ static qboolean ParseStage( shaderStage_t *stage, char **text )
 				}
 				num = stage->bundle[0].numImageAnimations;
 				if ( num < MAX_IMAGE_ANIMATIONS ) {
-					stage->bundle[0].image[num] = R_FindImageFile( token, !shader.noMipMaps, !shader.noPicMip, GL_REPEAT );
+					stage->bundle[0].image[num] = ShaderImage( SIR_FILE, stage - stages, num, token, !shader.noMipMaps, !shader.noPicMip, GL_REPEAT );
 					if ( !stage->bundle[0].image[num] )
 					{
 						ri.Printf( PRINT_WARNING, "WARNING: R_FindImageFile could not find '%s' in shader '%s'\n", token, shader.name );
@@ -702,11 +825,8 @@ static qboolean ParseStage( shaderStage_t *stage, char **text )
 				ri.Printf( PRINT_WARNING, "WARNING: missing parameter for 'videoMmap' keyword in shader '%s'\n", shader.name );
 				return qfalse;
 			}
-			stage->bundle[0].videoMapHandle = ri.CIN_PlayCinematic( token, 0, 0, 256, 256, (CIN_loop | CIN_silent | CIN_shader));
-			if (stage->bundle[0].videoMapHandle != -1) {
-				stage->bundle[0].isVideoMap = qtrue;
-				stage->bundle[0].image[0] = tr.scratchImage[stage->bundle[0].videoMapHandle];
-			}
+			NoteShaderImage( SIR_VIDEO, stage - stages, 0, token, qfalse, qfalse, 0 );
+			StartVideoMap( &stage->bundle[0], token );
 		}
 		//
 		// alphafunc <func>
@@ -1227,10 +1347,7 @@ static void ParseSkyParms( char **text ) {
 		for (i=0 ; i<6 ; i++) {
 			Com_sprintf( pathname, sizeof(pathname), "%s_%s.tga"
 				, token, suf[i] );
-			shader.sky.outerbox[i] = R_FindImageFile( ( char * ) pathname, qtrue, qtrue, GL_CLAMP );
-			if ( !shader.sky.outerbox[i] ) {
-				shader.sky.outerbox[i] = tr.defaultImage;
-			}
+			shader.sky.outerbox[i] = ShaderImage( SIR_SKY, -1, i, pathname, qtrue, qtrue, GL_CLAMP );
 		}
 	}
 
@@ -1245,6 +1362,7 @@ static void ParseSkyParms( char **text ) {
 		shader.sky.cloudHeight = 512;
 	}
 	R_InitSkyTexCoords( shader.sky.cloudHeight );
+	parseFlags |= PF_SKYCOORDS;
 
 
 	// innerbox
@@ -1257,10 +1375,7 @@ static void ParseSkyParms( char **text ) {
 		for (i=0 ; i<6 ; i++) {
 			Com_sprintf( pathname, sizeof(pathname), "%s_%s.tga"
 				, token, suf[i] );
-			shader.sky.innerbox[i] = R_FindImageFile( ( char * ) pathname, qtrue, qtrue, GL_REPEAT );
-			if ( !shader.sky.innerbox[i] ) {
-				shader.sky.innerbox[i] = tr.defaultImage;
-			}
+			shader.sky.innerbox[i] = ShaderImage( SIR_SKY, -1, 6 + i, pathname, qtrue, qtrue, GL_REPEAT );
 		}
 	}
 
@@ -1466,6 +1581,8 @@ static qboolean ParseShader( char **text )
 			tr.sunDirection[0] = cos( a ) * cos( b );
 			tr.sunDirection[1] = sin( a ) * cos( b );
 			tr.sunDirection[2] = sin( b );
+
+			parseFlags |= PF_SUN;
 		}
 		else if ( !Q_stricmp( token, "deformVertexes" ) ) {
 			ParseDeform( text );
@@ -2284,55 +2401,606 @@ static shader_t *FinishShader( void ) {
 ====================
 FindShaderInShaderText
 
-Scans the combined text description of all the shader files for
-the given shader name.
-
-return NULL if not found
+Looks the given shader name up in the index of the shader text.
 
-If found, it will return a valid shader
+return NULL if no script defines it
 =====================
 */
-static char *FindShaderInShaderText( const char *shadername ) {
+static shaderText_t *FindShaderInShaderText( const char *shadername ) {
+	shaderText_t	*entry;
+	int				hash;
 
-	char *token, *p;
+	hash = generateHashValue(shadername, MAX_SHADERTEXT_HASH);
+
+	for ( entry = shaderTextHashTable[hash] ; entry ; entry = entry->next ) {
+		if ( !Q_stricmp( entry->name, shadername ) ) {
+			return entry;
+		}
+	}
 
-	int i, hash;
+	return NULL;
+}
 
-	hash = generateHashValue(shadername, MAX_SHADERTEXT_HASH);
+/*
+========================================================================================
+
+SHADER CACHE
+
+The first time a shader is parsed, what ParseShader left in the global
+shader and stages is copied into a compiled shader, with the images it used
+noted down by name.  R_SaveShaderCache writes those, along with the index of
+the shader text, to SHADERCACHE_FILE, and the next ScanAndLoadShaderFiles
+hangs them back on the index as long as the script each one came from
+hashes the same.  R_FindShader then only looks the images up again.
+
+========================================================================================
+*/
+
+#define	SHADERCACHE_FILE		"shadercache.dat"
+#define	SHADERCACHE_IDENT		(('C'<<24)+('D'<<16)+('H'<<8)+'S')
+#define	SHADERCACHE_VERSION		1
+
+typedef struct compiledShader_s {
+	unsigned	fileHash;			// script the text came from
+	int			size;				// including everything that follows
+	int			numStages;
+	int			numImageRefs;
+	int			parseFlags;
+	vec3_t		sunLight;
+	vec3_t		sunDirection;
+	shader_t	shader;
+	// followed by the stages, the texMods of every stage and the image refs
+} compiledShader_t;
+
+typedef struct {
+	int			ident;
+	int			version;
+	int			shaderSize;			// the records are straight copies, so
+	int			stageSize;			// any change to these throws them out
+	int			texModSize;
+	unsigned	textHash;			// the index is only good for the same text
+	int			textLength;
+	int			numEntries;
+	int			namesLength;
+	int			compiledLength;
+	unsigned	checksum;			// everything after the header
+} shaderCacheHeader_t;
+
+typedef struct {
+	int			name;				// offset into the names
+	int			text;				// offset into s_shaderText
+	int			file;
+} shaderCacheEntry_t;
+
+static qboolean		shaderCacheDirty;
+static qboolean		shaderCacheShadowed;	// a pak has one, ours could never be read
+
+/*
+================
+HashShaderText
+
+FNV-1a
+================
+*/
+static unsigned HashShaderText( const void *data, int length, unsigned hash ) {
+	const byte	*p;
+	int			i;
+
+	p = data;
+	for ( i = 0 ; i < length ; i++ ) {
+		hash = ( hash ^ p[i] ) * 16777619;
+	}
+	return hash;
+}
+
+/*
+================
+StripCompiledShader
+
+Clears everything in a compiled shader that points somewhere or that only
+FinishShader fills in, both before it is written and after it is read back
+================
+*/
+static void StripCompiledShader( compiledShader_t *cs ) {
+	shaderStage_t	*stage;
+	int				i;
+
+	cs->shader.index = 0;
+	cs->shader.sortedIndex = 0;
+	Com_Memset( cs->shader.sky.outerbox, 0, sizeof( cs->shader.sky.outerbox ) );
+	Com_Memset( cs->shader.sky.innerbox, 0, sizeof( cs->shader.sky.innerbox ) );
+	cs->shader.multitextureEnv = 0;
+	cs->shader.numUnfoggedPasses = 0;
+	Com_Memset( cs->shader.stages, 0, sizeof( cs->shader.stages ) );
+	cs->shader.optimalStageIteratorFunc = NULL;
+	cs->shader.numStates = 0;
+	cs->shader.currentShader = NULL;
+	cs->shader.parentShader = NULL;
+	cs->shader.remappedShader = NULL;
+	cs->shader.next = NULL;
+
+	stage = (shaderStage_t *)( cs + 1 );
+	for ( i = 0 ; i < cs->numStages ; i++ ) {
+		Com_Memset( stage[i].bundle[0].image, 0, sizeof( stage[i].bundle[0].image ) );
+		stage[i].bundle[0].texMods = NULL;
+		stage[i].bundle[0].videoMapHandle = 0;
+		stage[i].bundle[0].isVideoMap = qfalse;
+		// only CollapseMultitexture fills in the second bundle
+		Com_Memset( &stage[i].bundle[1], 0, sizeof( stage[i].bundle[1] ) );
+	}
+}
+
+/*
+================
+CompileShader
+
+Copies the shader ParseShader just filled in into a compiled shader for entry
+================
+*/
+static void CompileShader( shaderText_t *entry ) {
+	compiledShader_t	*cs;
+	shaderStage_t		*stage;
+	texModInfo_t		*texMod;
+	int					i, numStages, size;
 
-	for (i = 0; shaderTextHashTable[hash][i]; i++) {
-		p = shaderTextHashTable[hash][i];
-		token = COM_ParseExt(&p, qtrue);
-		if ( !Q_stricmp( token, shadername ) ) {
-			return p;
+	if ( !r_shaderCache->integer || ( parseFlags & PF_NOCACHE ) ) {
+		return;
+	}
+
+	for ( numStages = 0 ; numStages < MAX_SHADER_STAGES && stages[numStages].active ; numStages++ ) {
+	}
+
+	size = sizeof( *cs ) + numStages * sizeof( shaderStage_t ) + numImageRefs * sizeof( shaderImageRef_t );
+	for ( i = 0 ; i < numStages ; i++ ) {
+		size += stages[i].bundle[0].numTexMods * sizeof( texModInfo_t );
+	}
+	size = ( size + 7 ) & ~7;
+
+	cs = ri.Hunk_Alloc( size, h_low );
+	cs->fileHash = shaderFileHashes[entry->file];
+	cs->size = size;
+	cs->numStages = numStages;
+	cs->numImageRefs = numImageRefs;
+	cs->parseFlags = parseFlags;
+	VectorCopy( tr.sunLight, cs->sunLight );
+	VectorCopy( tr.sunDirection, cs->sunDirection );
+
+	cs->shader = shader;
+
+	stage = (shaderStage_t *)( cs + 1 );
+	texMod = (texModInfo_t *)( stage + numStages );
+	for ( i = 0 ; i < numStages ; i++ ) {
+		stage[i] = stages[i];
+		Com_Memcpy( texMod, texMods[i], stages[i].bundle[0].numTexMods * sizeof( texModInfo_t ) );
+		texMod += stages[i].bundle[0].numTexMods;
+	}
+
+	Com_Memcpy( texMod, imageRefs, numImageRefs * sizeof( shaderImageRef_t ) );
+
+	// the images are looked up again by name
+	StripCompiledShader( cs );
+
+	entry->compiled = cs;
+	shaderCacheDirty = qtrue;
+}
+
+/*
+================
+LinkCompiledShader
+
+Sets up the global shader the way ParseShader would have.  Returns qfalse
+if one of the images can't be found any more, the text has to be parsed
+to get the same result then.
+================
+*/
+static qboolean LinkCompiledShader( const compiledShader_t *cs ) {
+	const shaderStage_t		*stage;
+	const texModInfo_t		*texMod;
+	const shaderImageRef_t	*refs;
+	image_t					*image;
+	char					name[MAX_QPATH];
+	int						i, lightmapIndex;
+
+	Q_strncpyz( name, shader.name, sizeof( name ) );
+	lightmapIndex = shader.lightmapIndex;
+
+	shader = cs->shader;
+	Q_strncpyz( shader.name, name, sizeof( shader.name ) );
+	shader.lightmapIndex = lightmapIndex;
+
+	stage = (const shaderStage_t *)( cs + 1 );
+	texMod = (const texModInfo_t *)( stage + cs->numStages );
+	for ( i = 0 ; i < cs->numStages ; i++ ) {
+		stages[i] = stage[i];
+		stages[i].bundle[0].texMods = texMods[i];
+		Com_Memcpy( texMods[i], texMod, stage[i].bundle[0].numTexMods * sizeof( texModInfo_t ) );
+		texMod += stage[i].bundle[0].numTexMods;
+	}
+
+	// images before cinematics, so a missing one doesn't leave a video playing
+	refs = (const shaderImageRef_t *)texMod;
+	for ( i = 0 ; i < cs->numImageRefs ; i++ ) {
+		if ( refs[i].type == SIR_VIDEO ) {
+			continue;
+		}
+
+		image = FindShaderImage( refs[i].type, refs[i].name, refs[i].mipmap, refs[i].picmip, refs[i].wrap );
+		if ( !image ) {
+			return qfalse;
+		}
+
+		if ( refs[i].stage >= 0 ) {
+			stages[refs[i].stage].bundle[0].image[refs[i].index] = image;
+		} else if ( refs[i].index < 6 ) {
+			shader.sky.outerbox[refs[i].index] = image;
+		} else {
+			shader.sky.innerbox[refs[i].index - 6] = image;
 		}
 	}
 
-	p = s_shaderText;
+	for ( i = 0 ; i < cs->numImageRefs ; i++ ) {
+		if ( refs[i].type == SIR_VIDEO ) {
+			StartVideoMap( &stages[refs[i].stage].bundle[0], refs[i].name );
+		}
+	}
+
+	if ( cs->parseFlags & PF_SUN ) {
+		VectorCopy( cs->sunLight, tr.sunLight );
+		VectorCopy( cs->sunDirection, tr.sunDirection );
+	}
+	if ( cs->parseFlags & PF_SKYCOORDS ) {
+		R_InitSkyTexCoords( shader.sky.cloudHeight );
+	}
+
+	return qtrue;
+}
+
+/*
+================
+WaveFormValid
+================
+*/
+static qboolean WaveFormValid( const waveForm_t *wave ) {
+	return wave->func >= GF_NONE && wave->func <= GF_NOISE;
+}
+
+/*
+================
+CompiledShaderValid
+
+Bounds checks a compiled shader read from the cache file, including every
+enum something indexes a table or switches with
+================
+*/
+static qboolean CompiledShaderValid( const compiledShader_t *cs, int length ) {
+	const shaderStage_t		*stage;
+	const texModInfo_t		*texMod;
+	const shaderImageRef_t	*refs;
+	int						i, j, size;
+
+	if ( length < (int)sizeof( *cs ) || cs->size < (int)sizeof( *cs ) || cs->size > length || ( cs->size & 7 ) ) {
+		return qfalse;
+	}
+	if ( cs->numStages < 0 || cs->numStages > MAX_SHADER_STAGES ) {
+		return qfalse;
+	}
+	if ( cs->numImageRefs < 0 || cs->numImageRefs > MAX_SHADER_IMAGE_REFS ) {
+		return qfalse;
+	}
+	if ( cs->shader.numDeforms < 0 || cs->shader.numDeforms > MAX_SHADER_DEFORMS ) {
+		return qfalse;
+	}
+	for ( i = 0 ; i < cs->shader.numDeforms ; i++ ) {
+		// the text deforms index backEnd.refdef.text
+		if ( cs->shader.deforms[i].deformation < DEFORM_NONE || cs->shader.deforms[i].deformation > DEFORM_TEXT7 ) {
+			return qfalse;
+		}
+		if ( !WaveFormValid( &cs->shader.deforms[i].deformationWave ) ) {
+			return qfalse;
+		}
+	}
+	if ( cs->shader.cullType < CT_FRONT_SIDED || cs->shader.cullType > CT_TWO_SIDED ) {
+		return qfalse;
+	}
+	if ( cs->shader.fogPass < FP_NONE || cs->shader.fogPass > FP_LE ) {
+		return qfalse;
+	}
+
+	stage = (const shaderStage_t *)( cs + 1 );
+	size = sizeof( *cs ) + cs->numStages * sizeof( shaderStage_t ) + cs->numImageRefs * sizeof( shaderImageRef_t );
+	if ( size > cs->size ) {
+		return qfalse;
+	}
+	for ( i = 0 ; i < cs->numStages ; i++ ) {
+		if ( stage[i].bundle[0].numTexMods < 0 || stage[i].bundle[0].numTexMods > TR_MAX_TEXMODS ) {
+			return qfalse;
+		}
+		if ( stage[i].bundle[0].numImageAnimations < 0 || stage[i].bundle[0].numImageAnimations > MAX_IMAGE_ANIMATIONS ) {
+			return qfalse;
+		}
+		if ( stage[i].bundle[0].tcGen < TCGEN_BAD || stage[i].bundle[0].tcGen > TCGEN_VECTOR ) {
+			return qfalse;
+		}
+		if ( stage[i].rgbGen < CGEN_BAD || stage[i].rgbGen > CGEN_CONST ) {
+			return qfalse;
+		}
+		if ( stage[i].alphaGen < AGEN_IDENTITY || stage[i].alphaGen > AGEN_CONST ) {
+			return qfalse;
+		}
+		if ( stage[i].adjustColorsForFog < ACFF_NONE || stage[i].adjustColorsForFog > ACFF_MODULATE_ALPHA ) {
+			return qfalse;
+		}
+		if ( !WaveFormValid( &stage[i].rgbWave ) || !WaveFormValid( &stage[i].alphaWave ) ) {
+			return qfalse;
+		}
+		size += stage[i].bundle[0].numTexMods * sizeof( texModInfo_t );
+	}
+	if ( size > cs->size ) {
+		return qfalse;
+	}
+
+	texMod = (const texModInfo_t *)( stage + cs->numStages );
+	for ( i = 0 ; i < cs->numStages ; i++ ) {
+		for ( j = 0 ; j < stage[i].bundle[0].numTexMods ; j++, texMod++ ) {
+			if ( texMod->type < TMOD_NONE || texMod->type > TMOD_ENTITY_TRANSLATE ) {
+				return qfalse;
+			}
+			if ( !WaveFormValid( &texMod->wave ) ) {
+				return qfalse;
+			}
+		}
+	}
+
+	refs = (const shaderImageRef_t *)( (const byte *)cs + size - cs->numImageRefs * sizeof( shaderImageRef_t ) );
+	for ( i = 0 ; i < cs->numImageRefs ; i++ ) {
+		if ( refs[i].type < SIR_FILE || refs[i].type > SIR_VIDEO ) {
+			return qfalse;
+		}
+		// only the sky boxes are outside the stages
+		if ( refs[i].type == SIR_SKY ) {
+			if ( refs[i].stage != -1 || refs[i].index < 0 || refs[i].index >= 12 ) {
+				return qfalse;
+			}
+		} else if ( refs[i].stage < 0 || refs[i].stage >= cs->numStages
+			|| refs[i].index < 0 || refs[i].index >= MAX_IMAGE_ANIMATIONS ) {
+			return qfalse;
+		}
+		if ( !memchr( refs[i].name, 0, sizeof( refs[i].name ) ) ) {
+			return qfalse;
+		}
+	}
+
+	return qtrue;
+}
+
+/*
+================
+LinkShaderIndex
+
+Chains the index entries into the hash table in text order
+================
+*/
+static void LinkShaderIndex( void ) {
+	shaderText_t	*entry;
+	int				i, hash;
+
+	Com_Memset( shaderTextHashTable, 0, sizeof( shaderTextHashTable ) );
+	for ( i = numShaderTextEntries - 1 ; i >= 0 ; i-- ) {
+		entry = &shaderTextEntries[i];
+		hash = generateHashValue( entry->name, MAX_SHADERTEXT_HASH );
+		entry->next = shaderTextHashTable[hash];
+		shaderTextHashTable[hash] = entry;
+	}
+}
+
+/*
+================
+ReadShaderCache
+
+Returns the cache file if it was written by this build, NULL otherwise
+================
+*/
+static shaderCacheHeader_t *ReadShaderCache( void ) {
+	shaderCacheHeader_t	*header;
+	int					length;
+
+	if ( !r_shaderCache->integer ) {
+		return NULL;
+	}
+
+	// only the copy R_SaveShaderCache wrote, FS_FileExists looks in the
+	// write dir alone, and with no pak holding the name FS_ReadFile finds
+	// that same file
+	if ( !ri.FS_FileExists( SHADERCACHE_FILE ) ) {
+		return NULL;
+	}
+	if ( ri.FS_FileIsInPAK( SHADERCACHE_FILE, NULL ) == 1 ) {
+		ri.Printf( PRINT_WARNING, "WARNING: %s found in a pak, shader cache disabled\n", SHADERCACHE_FILE );
+		shaderCacheShadowed = qtrue;
+		return NULL;
+	}
+
+	length = ri.FS_ReadFile( SHADERCACHE_FILE, (void **)&header );
+	if ( !header ) {
+		return NULL;
+	}
 
-	if ( !p ) {
+	if ( length < sizeof( *header )
+		|| header->ident != SHADERCACHE_IDENT
+		|| header->version != SHADERCACHE_VERSION
+		|| header->shaderSize != sizeof( shader_t )
+		|| header->stageSize != sizeof( shaderStage_t )
+		|| header->texModSize != sizeof( texModInfo_t )
+		|| header->numEntries < 0 || header->numEntries > ( length - sizeof( *header ) ) / sizeof( shaderCacheEntry_t )
+		|| header->namesLength < 0 || header->namesLength > length
+		|| header->compiledLength < 0 || header->compiledLength > length
+		|| sizeof( *header ) + header->numEntries * sizeof( shaderCacheEntry_t )
+			+ ( ( header->namesLength + 7 ) & ~7 ) + header->compiledLength != length
+		|| HashShaderText( header + 1, length - sizeof( *header ), 2166136261u ) != header->checksum ) {
+		ri.Printf( PRINT_DEVELOPER, "%s is out of date\n", SHADERCACHE_FILE );
+		ri.FS_FreeFile( header );
 		return NULL;
 	}
 
-	// look for label
-	while ( 1 ) {
-		token = COM_ParseExt( &p, qtrue );
-		if ( token[0] == 0 ) {
+	return header;
+}
+
+/*
+================
+LoadShaderIndex
+
+Takes the index from the cache if the text hasn't changed since it was written
+================
+*/
+static qboolean LoadShaderIndex( const shaderCacheHeader_t *header ) {
+	const shaderCacheEntry_t	*entries;
+	const char					*names;
+	int							i;
+
+	entries = (const shaderCacheEntry_t *)( header + 1 );
+	names = (const char *)( entries + header->numEntries );
+
+	if ( header->textHash != shaderTextHash || header->textLength != shaderTextLength ) {
+		return qfalse;
+	}
+	if ( !header->namesLength || names[header->namesLength - 1] ) {
+		return qfalse;
+	}
+	for ( i = 0 ; i < header->numEntries ; i++ ) {
+		if ( entries[i].name < 0 || entries[i].name >= header->namesLength
+			|| entries[i].text < 0 || entries[i].text > shaderTextLength
+			|| entries[i].file < 0 || entries[i].file >= numShaderFiles ) {
+			return qfalse;
+		}
+	}
+
+	shaderTextNamesLength = header->namesLength;
+	shaderTextNames = ri.Hunk_Alloc( shaderTextNamesLength, h_low );
+	Com_Memcpy( shaderTextNames, names, shaderTextNamesLength );
+
+	numShaderTextEntries = header->numEntries;
+	shaderTextEntries = ri.Hunk_Alloc( numShaderTextEntries * sizeof( shaderText_t ), h_low );
+	for ( i = 0 ; i < numShaderTextEntries ; i++ ) {
+		shaderTextEntries[i].name = shaderTextNames + entries[i].name;
+		shaderTextEntries[i].text = s_shaderText + entries[i].text;
+		shaderTextEntries[i].file = entries[i].file;
+	}
+	LinkShaderIndex();
+
+	return qtrue;
+}
+
+/*
+================
+LoadCompiledShaders
+
+Hangs the compiled shaders from the cache on the index, unless the script
+their text came from has changed
+================
+*/
+static void LoadCompiledShaders( const shaderCacheHeader_t *header ) {
+	compiledShader_t	*cs;
+	shaderText_t		*entry;
+	byte				*compiled;
+	int					ofs, count;
+
+	if ( !header->compiledLength ) {
+		return;
+	}
+
+	compiled = ri.Hunk_Alloc( header->compiledLength, h_low );
+	Com_Memcpy( compiled, (const byte *)( header + 1 ) + header->numEntries * sizeof( shaderCacheEntry_t )
+		+ ( ( header->namesLength + 7 ) & ~7 ), header->compiledLength );
+
+	count = 0;
+	for ( ofs = 0 ; ofs < header->compiledLength ; ofs += cs->size ) {
+		cs = (compiledShader_t *)( compiled + ofs );
+		if ( !CompiledShaderValid( cs, header->compiledLength - ofs ) ) {
+			shaderCacheDirty = qtrue;
 			break;
 		}
 
-		if ( !Q_stricmp( token, shadername ) ) {
-			return p;
+		cs->shader.name[sizeof( cs->shader.name ) - 1] = 0;
+		StripCompiledShader( cs );
+		entry = FindShaderInShaderText( cs->shader.name );
+		if ( !entry || entry->compiled || shaderFileHashes[entry->file] != cs->fileHash ) {
+			// dropped when the cache is written again
+			shaderCacheDirty = qtrue;
+			continue;
 		}
-		else {
-			// skip the definition
-			SkipBracedSection( &p );
+		entry->compiled = cs;
+		count++;
+	}
+
+	ri.Printf( PRINT_ALL, "...%i compiled shaders from %s\n", count, SHADERCACHE_FILE );
+}
+
+/*
+================
+R_SaveShaderCache
+
+Called at shutdown, while the hunk is still there
+================
+*/
+void R_SaveShaderCache( void ) {
+	shaderCacheHeader_t	*header;
+	shaderCacheEntry_t	*entries;
+	shaderText_t		*entry;
+	byte				*buffer, *compiled;
+	int					i, length, namesLength, compiledLength;
+
+	if ( !r_shaderCache->integer || !shaderCacheDirty || shaderCacheShadowed || !s_shaderText ) {
+		return;
+	}
+	shaderCacheDirty = qfalse;
+
+	namesLength = ( shaderTextNamesLength + 7 ) & ~7;
+	compiledLength = 0;
+	for ( i = 0 ; i < numShaderTextEntries ; i++ ) {
+		if ( shaderTextEntries[i].compiled ) {
+			compiledLength += shaderTextEntries[i].compiled->size;
 		}
 	}
 
-	return NULL;
+	length = sizeof( *header ) + numShaderTextEntries * sizeof( *entries ) + namesLength + compiledLength;
+	buffer = ri.Hunk_AllocateTempMemory( length );
+	Com_Memset( buffer, 0, length );
+
+	header = (shaderCacheHeader_t *)buffer;
+	header->ident = SHADERCACHE_IDENT;
+	header->version = SHADERCACHE_VERSION;
+	header->shaderSize = sizeof( shader_t );
+	header->stageSize = sizeof( shaderStage_t );
+	header->texModSize = sizeof( texModInfo_t );
+	header->textHash = shaderTextHash;
+	header->textLength = shaderTextLength;
+	header->numEntries = numShaderTextEntries;
+	header->namesLength = shaderTextNamesLength;
+	header->compiledLength = compiledLength;
+
+	entries = (shaderCacheEntry_t *)( header + 1 );
+	for ( i = 0, entry = shaderTextEntries ; i < numShaderTextEntries ; i++, entry++ ) {
+		entries[i].name = entry->name - shaderTextNames;
+		entries[i].text = entry->text - s_shaderText;
+		entries[i].file = entry->file;
+	}
+	Com_Memcpy( entries + numShaderTextEntries, shaderTextNames, shaderTextNamesLength );
+
+	compiled = (byte *)( entries + numShaderTextEntries ) + namesLength;
+	for ( i = 0, entry = shaderTextEntries ; i < numShaderTextEntries ; i++, entry++ ) {
+		if ( entry->compiled ) {
+			Com_Memcpy( compiled, entry->compiled, entry->compiled->size );
+			compiled += entry->compiled->size;
+		}
+	}
+
+	header->checksum = HashShaderText( header + 1, length - sizeof( *header ), 2166136261u );
+
+	ri.FS_WriteFile( SHADERCACHE_FILE, buffer, length );
+	ri.Hunk_FreeTempMemory( buffer );
 }
 
+//========================================================================================
 
 /*
 ==================
@@ -2373,6 +3041,33 @@ shader_t *R_FindShaderByName( const char *name ) {
 }
 
 
+/*
+===============
+ClearGlobalShader
+===============
+*/
+static void ClearGlobalShader( const char *name, int lightmapIndex ) {
+	int		i;
+
+	Com_Memset( &shader, 0, sizeof( shader ) );
+	Com_Memset( &stages, 0, sizeof( stages ) );
+	Q_strncpyz(shader.name, name, sizeof(shader.name));
+	shader.lightmapIndex = lightmapIndex;
+	for ( i = 0 ; i < MAX_SHADER_STAGES ; i++ ) {
+		stages[i].bundle[0].texMods = texMods[i];
+	}
+
+	// FIXME: set these "need" values apropriately
+	shader.needsNormal = qtrue;
+	shader.needsST1 = qtrue;
+	shader.needsST2 = qtrue;
+	shader.needsColor = qtrue;
+
+	numImageRefs = 0;
+	parseFlags = 0;
+}
+
+
 /*
 ===============
 R_FindShader
@@ -2404,8 +3099,9 @@ most world construction surfaces.
 shader_t *R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImage ) {
 	char		strippedName[MAX_QPATH];
 	char		fileName[MAX_QPATH];
-	int			i, hash;
+	int			hash;
 	char		*shaderText;
+	shaderText_t	*entry;
 	image_t		*image;
 	shader_t	*sh;
 
@@ -2444,35 +3140,33 @@ shader_t *R_FindShader( const char *name, int lightmapIndex, qboolean mipRawImag
 		R_SyncRenderThread();
 	}
 
-	// clear the global shader
-	Com_Memset( &shader, 0, sizeof( shader ) );
-	Com_Memset( &stages, 0, sizeof( stages ) );
-	Q_strncpyz(shader.name, strippedName, sizeof(shader.name));
-	shader.lightmapIndex = lightmapIndex;
-	for ( i = 0 ; i < MAX_SHADER_STAGES ; i++ ) {
-		stages[i].bundle[0].texMods = texMods[i];
-	}
-
-	// FIXME: set these "need" values apropriately
-	shader.needsNormal = qtrue;
-	shader.needsST1 = qtrue;
-	shader.needsST2 = qtrue;
-	shader.needsColor = qtrue;
+	ClearGlobalShader( strippedName, lightmapIndex );
 
 	//
 	// attempt to define shader from an explicit parameter file
 	//
-	shaderText = FindShaderInShaderText( strippedName );
-	if ( shaderText ) {
+	entry = FindShaderInShaderText( strippedName );
+	if ( entry ) {
 		// enable this when building a pak file to get a global list
 		// of all explicit shaders
 		if ( r_printShaders->integer ) {
 			ri.Printf( PRINT_ALL, "*SHADER* %s\n", name );
 		}
 
+		// parsed before, unless one of its images has gone missing since
+		if ( entry->compiled ) {
+			if ( LinkCompiledShader( entry->compiled ) ) {
+				return FinishShader();
+			}
+			ClearGlobalShader( strippedName, lightmapIndex );
+		}
+
+		shaderText = entry->text;
 		if ( !ParseShader( &shaderText ) ) {
 			// had errors, so use default shader
 			shader.defaultShader = qtrue;
+		} else if ( !entry->compiled ) {
+			CompileShader( entry );
 		}
 		sh = FinishShader();
 		return sh;
@@ -2833,6 +3527,60 @@ void	R_ShaderList_f (void) {
 }
 
 
+/*
+====================
+BuildShaderIndex
+
+Finds every shader name in the text.  The scripts are scanned in the order
+they sit in s_shaderText, each one only up to where the next one starts.
+====================
+*/
+static void BuildShaderIndex( char **buffers, int numShaders, char *textEnd ) {
+	shaderText_t	*entry;
+	char			*p, *end, *token;
+	int				i, pass, numEntries, namesLength;
+
+	numEntries = namesLength = 0;
+	for ( pass = 0 ; pass < 2 ; pass++ ) {
+		numEntries = 0;
+		namesLength = 0;
+
+		for ( i = numShaders - 1 ; i >= 0 ; i-- ) {
+			p = buffers[i];
+			end = i ? buffers[i-1] : textEnd;
+
+			// look for label
+			while ( p && p < end ) {
+				token = COM_ParseExt( &p, qtrue );
+				if ( token[0] == 0 || p > end ) {
+					break;
+				}
+
+				if ( pass ) {
+					entry = &shaderTextEntries[numEntries];
+					entry->name = shaderTextNames + namesLength;
+					strcpy( entry->name, token );
+					entry->text = p;
+					entry->file = i;
+				}
+				numEntries++;
+				namesLength += strlen( token ) + 1;
+
+				SkipBracedSection( &p );
+			}
+		}
+
+		if ( !pass ) {
+			shaderTextEntries = ri.Hunk_Alloc( numEntries * sizeof( shaderText_t ), h_low );
+			shaderTextNames = ri.Hunk_Alloc( namesLength, h_low );
+		}
+	}
+
+	numShaderTextEntries = numEntries;
+	shaderTextNamesLength = namesLength;
+	LinkShaderIndex();
+}
+
 /*
 ====================
 ScanAndLoadShaderFiles
@@ -2841,16 +3589,14 @@ Finds and loads all .shader files, combining them into
 a single large text block that can be scanned for shader names
 =====================
 */
-#define	MAX_SHADER_FILES	4096
 static void ScanAndLoadShaderFiles( void )
 {
 	char **shaderFiles;
 	char *buffers[MAX_SHADER_FILES];
 	char *p;
 	int numShaders;
-	int i;
-	char *oldp, *token, *hashMem;
-	int shaderTextHashTableSizes[MAX_SHADERTEXT_HASH], hash, size;
+	int i, length;
+	shaderCacheHeader_t *cache;
 
 	long sum = 0;
 	// scan for shader files
@@ -2883,81 +3629,41 @@ static void ScanAndLoadShaderFiles( void )
 	s_shaderText = ri.Hunk_Alloc( sum + numShaders*2, h_low );
 
 	// free in reverse order, so the temp files are all dumped
+	p = s_shaderText;
 	for ( i = numShaders - 1; i >= 0 ; i-- ) {
-		strcat( s_shaderText, "\n" );
-		p = &s_shaderText[strlen(s_shaderText)];
-		strcat( s_shaderText, buffers[i] );
+		*p++ = '\n';
+		strcpy( p, buffers[i] );
 		ri.FS_FreeFile( buffers[i] );
 		buffers[i] = p;
 		COM_Compress(p);
+		p += strlen( p );
 	}
 
 	// free up memory
 	ri.FS_FreeFileList( shaderFiles );
 
-	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
-	size = 0;
 	//
+	// hash the scripts, so the cache can tell what has changed
+	//
+	numShaderFiles = numShaders;
+	shaderTextHash = 2166136261u;
 	for ( i = 0; i < numShaders; i++ ) {
-		// pointer to the first shader file
-		p = buffers[i];
-		// look for label
-		while ( 1 ) {
-			token = COM_ParseExt( &p, qtrue );
-			if ( token[0] == 0 ) {
-				break;
-			}
-
-			hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
-			shaderTextHashTableSizes[hash]++;
-			size++;
-			SkipBracedSection(&p);
-			// if we passed the pointer to the next shader file
-			if ( i < numShaders - 1 ) {
-				if ( p > buffers[i+1] ) {
-					break;
-				}
-			}
-		}
+		length = strlen( buffers[i] );
+		shaderFileHashes[i] = HashShaderText( buffers[i], length, 2166136261u );
+		shaderTextHash = HashShaderText( &shaderFileHashes[i], sizeof( shaderFileHashes[i] ), shaderTextHash );
+		shaderTextHash = HashShaderText( &length, sizeof( length ), shaderTextHash );
 	}
+	shaderTextLength = p - s_shaderText;
 
-	size += MAX_SHADERTEXT_HASH;
-
-	hashMem = ri.Hunk_Alloc( size * sizeof(char *), h_low );
-
-	for (i = 0; i < MAX_SHADERTEXT_HASH; i++) {
-		shaderTextHashTable[i] = (char **) hashMem;
-		hashMem = ((char *) hashMem) + ((shaderTextHashTableSizes[i] + 1) * sizeof(char *));
+	cache = ReadShaderCache();
+	if ( !cache || !LoadShaderIndex( cache ) ) {
+		BuildShaderIndex( buffers, numShaders, p );
+		shaderCacheDirty = qtrue;
 	}
-
-	Com_Memset(shaderTextHashTableSizes, 0, sizeof(shaderTextHashTableSizes));
-	//
-	for ( i = 0; i < numShaders; i++ ) {
-		// pointer to the first shader file
-		p = buffers[i];
-		// look for label
-		while ( 1 ) {
-			oldp = p;
-			token = COM_ParseExt( &p, qtrue );
-			if ( token[0] == 0 ) {
-				break;
-			}
-
-			hash = generateHashValue(token, MAX_SHADERTEXT_HASH);
-			shaderTextHashTable[hash][shaderTextHashTableSizes[hash]++] = oldp;
-
-			SkipBracedSection(&p);
-			// if we passed the pointer to the next shader file
-			if ( i < numShaders - 1 ) {
-				if ( p > buffers[i+1] ) {
-					break;
-				}
-			}
-		}
+	if ( cache ) {
+		LoadCompiledShaders( cache );
+		ri.FS_FreeFile( cache );
 	}
-
-	return;
-
 }
 
 
@@ -3002,6 +3708,12 @@ void R_InitShaders( void ) {
 	ri.Printf( PRINT_ALL, "Initializing Shaders\n" );
 
 	Com_Memset(hashTable, 0, sizeof(hashTable));
+	Com_Memset(shaderTextHashTable, 0, sizeof(shaderTextHashTable));
+
+	s_shaderText = NULL;
+	numShaderTextEntries = 0;
+	shaderCacheDirty = qfalse;
+	shaderCacheShadowed = qfalse;
 
 	deferLoad = qfalse;
 
@@ -604,24 +604,65 @@ static void VectorArrayNormalize(vec4_t *normals, unsigned int count)
 
 
 
+/*
+===============================================================================
+
+MD3 PRELERP
+
+LerpMeshVertexes is most of the back end's cpu time in model heavy scenes,
+and it only depends on the surface and the entity.  Before a view is drawn
+the job threads lerp its md3 surfaces into prelerpXyz / prelerpNormal, in
+the order RB_RenderDrawSurfList will get to them, and RB_SurfaceMesh just
+copies the results into tess.
+
+===============================================================================
+*/
+
+#define	MAX_PRELERP_SURFACES	1024
+#define	MAX_PRELERP_VERTEXES	32768
+#define	PRELERP_JOBS_PER_THREAD	4
+
+typedef struct {
+	md3Surface_t	*surface;
+	trRefEntity_t	*entity;
+	int				firstVertex;
+} prelerpSurface_t;
+
+static prelerpSurface_t	prelerpSurfaces[MAX_PRELERP_SURFACES];
+static int				numPrelerpSurfaces;
+static int				nextPrelerpSurface;		// the one RB_SurfaceMesh should get next
+static int				numPrelerpJobs;
+
+static vec4_t			prelerpXyz[MAX_PRELERP_VERTEXES];
+static vec4_t			prelerpNormal[MAX_PRELERP_VERTEXES];
+
 /*
 ** LerpMeshVertexes
+**
+** Only touches ent and the output arrays, so the job threads can run it
 */
-static void LerpMeshVertexes (md3Surface_t *surf, float backlerp) 
+static void LerpMeshVertexes (md3Surface_t *surf, const trRefEntity_t *ent, vec4_t *xyz, vec4_t *normals) 
 {
 	short	*oldXyz, *newXyz, *oldNormals, *newNormals;
 	float	*outXyz, *outNormal;
 	float	oldXyzScale, newXyzScale;
 	float	oldNormalScale, newNormalScale;
+	float	backlerp;
 	int		vertNum;
 	unsigned lat, lng;
 	int		numVerts;
 
-	outXyz = tess.xyz[tess.numVertexes];
-	outNormal = tess.normal[tess.numVertexes];
+	if (  ent->e.oldframe == ent->e.frame ) {
+		backlerp = 0;
+	} else  {
+		backlerp = ent->e.backlerp;
+	}
+
+	outXyz = xyz[0];
+	outNormal = normals[0];
 
 	newXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-		+ (backEnd.currentEntity->e.frame * surf->numVerts * 4);
+		+ (ent->e.frame * surf->numVerts * 4);
 	newNormals = newXyz + 3;
 
 	newXyzScale = MD3_XYZ_SCALE * (1.0 - backlerp);
@@ -717,7 +758,7 @@ static void LerpMeshVertexes (md3Surface_t *surf, float backlerp)
 		// interpolate and copy the vertex and normal
 		//
 		oldXyz = (short *)((byte *)surf + surf->ofsXyzNormals)
-			+ (backEnd.currentEntity->e.oldframe * surf->numVerts * 4);
+			+ (ent->e.oldframe * surf->numVerts * 4);
 		oldNormals = oldXyz + 3;
 
 		oldXyzScale = MD3_XYZ_SCALE * backlerp;
@@ -758,10 +799,88 @@ static void LerpMeshVertexes (md3Surface_t *surf, float backlerp)
 
 //			VectorNormalize (outNormal);
 		}
-    	VectorArrayNormalize((vec4_t *)tess.normal[tess.numVertexes], numVerts);
+    	VectorArrayNormalize(normals, numVerts);
    	}
 }
 
+/*
+** RB_PrelerpJob
+*/
+static void RB_PrelerpJob( int job, int thread ) {
+	prelerpSurface_t	*ps;
+	int					i;
+
+	for ( i = job ; i < numPrelerpSurfaces ; i += numPrelerpJobs ) {
+		ps = &prelerpSurfaces[i];
+		LerpMeshVertexes( ps->surface, ps->entity, prelerpXyz + ps->firstVertex, prelerpNormal + ps->firstVertex );
+	}
+}
+
+/*
+=============
+RB_PrelerpMeshes
+
+Called with backEnd.refdef set up for the view
+=============
+*/
+void RB_PrelerpMeshes( drawSurf_t *drawSurfs, int numDrawSurfs ) {
+	int					i, start;
+	int					numVertexes;
+	int					entityNum, fogNum, dlighted;
+	shader_t			*shader;
+	md3Surface_t		*surface;
+	prelerpSurface_t	*ps;
+
+	numPrelerpSurfaces = 0;
+	nextPrelerpSurface = 0;
+
+	if ( R_NumJobThreads() == 1 ) {
+		return;
+	}
+
+	numVertexes = 0;
+	for ( i = 0 ; i < numDrawSurfs ; i++ ) {
+		if ( *drawSurfs[i].surface != SF_MD3 ) {
+			continue;
+		}
+		surface = (md3Surface_t *)drawSurfs[i].surface;
+
+		if ( numPrelerpSurfaces == MAX_PRELERP_SURFACES
+			|| numVertexes + surface->numVerts > MAX_PRELERP_VERTEXES ) {
+			break;		// the rest get done as they are drawn
+		}
+
+		R_DecomposeSort( drawSurfs[i].sort, &entityNum, &shader, &fogNum, &dlighted );
+
+		ps = &prelerpSurfaces[numPrelerpSurfaces++];
+		ps->surface = surface;
+		if ( entityNum == ENTITYNUM_WORLD ) {
+			ps->entity = &tr.worldEntity;
+		} else {
+			ps->entity = &backEnd.refdef.entities[entityNum];
+		}
+		ps->firstVertex = numVertexes;
+		numVertexes += surface->numVerts;
+	}
+
+	if ( numPrelerpSurfaces < 2 ) {
+		numPrelerpSurfaces = 0;		// not worth waking anyone up for
+		return;
+	}
+
+	start = ri.Milliseconds();
+
+	numPrelerpJobs = R_NumJobThreads() * PRELERP_JOBS_PER_THREAD;
+	if ( numPrelerpJobs > numPrelerpSurfaces ) {
+		numPrelerpJobs = numPrelerpSurfaces;
+	}
+	R_RunJobs( RB_PrelerpJob, numPrelerpJobs );
+
+	backEnd.pc.c_prelerpSurfaces += numPrelerpSurfaces;
+	backEnd.pc.c_prelerpVertexes += numVertexes;
+	backEnd.pc.msecPrelerp += ri.Milliseconds() - start;
+}
+
 /*
 =============
 RB_SurfaceMesh
@@ -769,22 +888,25 @@ RB_SurfaceMesh
 */
 void RB_SurfaceMesh(md3Surface_t *surface) {
 	int				j;
-	float			backlerp;
 	int				*triangles;
 	float			*texCoords;
 	int				indexes;
 	int				Bob, Doug;
 	int				numVerts;
-
-	if (  backEnd.currentEntity->e.oldframe == backEnd.currentEntity->e.frame ) {
-		backlerp = 0;
-	} else  {
-		backlerp = backEnd.currentEntity->e.backlerp;
-	}
+	prelerpSurface_t	*ps;
 
 	RB_CHECKOVERFLOW( surface->numVerts, surface->numTriangles*3 );
 
-	LerpMeshVertexes (surface, backlerp);
+	// the job threads may have done this one already
+	ps = &prelerpSurfaces[nextPrelerpSurface];
+	if ( nextPrelerpSurface < numPrelerpSurfaces
+		&& ps->surface == surface && ps->entity == backEnd.currentEntity ) {
+		nextPrelerpSurface++;
+		Com_Memcpy( tess.xyz[tess.numVertexes], prelerpXyz[ps->firstVertex], surface->numVerts * sizeof( vec4_t ) );
+		Com_Memcpy( tess.normal[tess.numVertexes], prelerpNormal[ps->firstVertex], surface->numVerts * sizeof( vec4_t ) );
+	} else {
+		LerpMeshVertexes (surface, backEnd.currentEntity, tess.xyz + tess.numVertexes, tess.normal + tess.numVertexes);
+	}
 
 	triangles = (int *) ((byte *)surface + surface->ofsTriangles);
 	indexes = surface->numTriangles * 3;
@@ -21,6 +21,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 #include "tr_local.h"
 
+// below this many surfaces the world is not worth splitting up
+#define	MIN_VIS_SURFACE_JOB			256
+#define	VIS_SURFACE_JOBS_PER_THREAD	4
+
+static qboolean				deferWorldSurfaces;
+static int					numVisSurfaces;
+static int					numVisSurfaceJobs;
+static frontEndCounters_t	jobCounters[MAX_JOB_THREADS];
 
 
 /*
@@ -50,7 +58,7 @@ Returns true if the grid is completely culled away.
 Also sets the clipped hint bit in tess
 =================
 */
-static qboolean	R_CullGrid( srfGridMesh_t *cv ) {
+static qboolean	R_CullGrid( srfGridMesh_t *cv, frontEndCounters_t *pc ) {
 	int 	boxCull;
 	int 	sphereCull;
 
@@ -68,33 +76,33 @@ static qboolean	R_CullGrid( srfGridMesh_t *cv ) {
 	// check for trivial reject
 	if ( sphereCull == CULL_OUT )
 	{
-		tr.pc.c_sphere_cull_patch_out++;
+		pc->c_sphere_cull_patch_out++;
 		return qtrue;
 	}
 	// check bounding box if necessary
 	else if ( sphereCull == CULL_CLIP )
 	{
-		tr.pc.c_sphere_cull_patch_clip++;
+		pc->c_sphere_cull_patch_clip++;
 
 		boxCull = R_CullLocalBox( cv->meshBounds );
 
 		if ( boxCull == CULL_OUT ) 
 		{
-			tr.pc.c_box_cull_patch_out++;
+			pc->c_box_cull_patch_out++;
 			return qtrue;
 		}
 		else if ( boxCull == CULL_IN )
 		{
-			tr.pc.c_box_cull_patch_in++;
+			pc->c_box_cull_patch_in++;
 		}
 		else
 		{
-			tr.pc.c_box_cull_patch_clip++;
+			pc->c_box_cull_patch_clip++;
 		}
 	}
 	else
 	{
-		tr.pc.c_sphere_cull_patch_in++;
+		pc->c_sphere_cull_patch_in++;
 	}
 
 	return qfalse;
@@ -111,7 +119,7 @@ added to the sorting list.
 This will also allow mirrors on both sides of a model without recursion.
 ================
 */
-static qboolean	R_CullSurface( surfaceType_t *surface, shader_t *shader ) {
+static qboolean	R_CullSurface( surfaceType_t *surface, shader_t *shader, frontEndCounters_t *pc ) {
 	srfSurfaceFace_t *sface;
 	float			d;
 
@@ -120,7 +128,7 @@ static qboolean	R_CullSurface( surfaceType_t *surface, shader_t *shader ) {
 	}
 
 	if ( *surface == SF_GRID ) {
-		return R_CullGrid( (srfGridMesh_t *)surface );
+		return R_CullGrid( (srfGridMesh_t *)surface, pc );
 	}
 
 	if ( *surface == SF_TRIANGLES ) {
@@ -160,7 +168,7 @@ static qboolean	R_CullSurface( surfaceType_t *surface, shader_t *shader ) {
 }
 
 
-static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
+static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits, frontEndCounters_t *pc ) {
 	float		d;
 	int			i;
 	dlight_t	*dl;
@@ -178,14 +186,14 @@ static int R_DlightFace( srfSurfaceFace_t *face, int dlightBits ) {
 	}
 
 	if ( !dlightBits ) {
-		tr.pc.c_dlightSurfacesCulled++;
+		pc->c_dlightSurfacesCulled++;
 	}
 
 	face->dlightBits[ tr.smpFrame ] = dlightBits;
 	return dlightBits;
 }
 
-static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits ) {
+static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits, frontEndCounters_t *pc ) {
 	int			i;
 	dlight_t	*dl;
 
@@ -206,7 +214,7 @@ static int R_DlightGrid( srfGridMesh_t *grid, int dlightBits ) {
 	}
 
 	if ( !dlightBits ) {
-		tr.pc.c_dlightSurfacesCulled++;
+		pc->c_dlightSurfacesCulled++;
 	}
 
 	grid->dlightBits[ tr.smpFrame ] = dlightBits;
@@ -256,11 +264,11 @@ that is touched by one or more dlights, so try to throw out
 more dlights if possible.
 ====================
 */
-static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
+static int R_DlightSurface( msurface_t *surf, int dlightBits, frontEndCounters_t *pc ) {
 	if ( *surf->data == SF_FACE ) {
-		dlightBits = R_DlightFace( (srfSurfaceFace_t *)surf->data, dlightBits );
+		dlightBits = R_DlightFace( (srfSurfaceFace_t *)surf->data, dlightBits, pc );
 	} else if ( *surf->data == SF_GRID ) {
-		dlightBits = R_DlightGrid( (srfGridMesh_t *)surf->data, dlightBits );
+		dlightBits = R_DlightGrid( (srfGridMesh_t *)surf->data, dlightBits, pc );
 	} else if ( *surf->data == SF_TRIANGLES ) {
 		dlightBits = R_DlightTrisurf( (srfTriangles_t *)surf->data, dlightBits );
 	} else {
@@ -268,7 +276,7 @@ static int R_DlightSurface( msurface_t *surf, int dlightBits ) {
 	}
 
 	if ( dlightBits ) {
-		tr.pc.c_dlightSurfaces++;
+		pc->c_dlightSurfaces++;
 	}
 
 	return dlightBits;
@@ -282,6 +290,8 @@ R_AddWorldSurface
 ======================
 */
 static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
+	visSurface_t	*vis;
+
 	if ( surf->viewCount == tr.viewCount ) {
 		return;		// already in this view
 	}
@@ -289,20 +299,97 @@ static void R_AddWorldSurface( msurface_t *surf, int dlightBits ) {
 	surf->viewCount = tr.viewCount;
 	// FIXME: bmodel fog?
 
+	// the world walk leaves culling and dlighting to the job threads
+	if ( deferWorldSurfaces ) {
+		vis = &tr.world->visSurfaces[numVisSurfaces++];
+		vis->surf = surf;
+		vis->dlightBits = dlightBits;
+		return;
+	}
+
 	// try to cull before dlighting or adding
-	if ( R_CullSurface( surf->data, surf->shader ) ) {
+	if ( R_CullSurface( surf->data, surf->shader, &tr.pc ) ) {
 		return;
 	}
 
 	// check for dlighting
 	if ( dlightBits ) {
-		dlightBits = R_DlightSurface( surf, dlightBits );
+		dlightBits = R_DlightSurface( surf, dlightBits, &tr.pc );
 		dlightBits = ( dlightBits != 0 );
 	}
 
 	R_AddDrawSurf( surf->data, surf->shader, surf->fogIndex, dlightBits );
 }
 
+/*
+======================
+R_VisSurfaceJob
+
+Culls and dlights one slice of the queued world surfaces, same as
+R_AddWorldSurface does for a single one
+======================
+*/
+static void R_VisSurfaceJob( int job, int thread ) {
+	frontEndCounters_t	*pc;
+	visSurface_t		*vis;
+	int					i, start, end;
+
+	pc = &jobCounters[thread];
+	start = job * numVisSurfaces / numVisSurfaceJobs;
+	end = ( job + 1 ) * numVisSurfaces / numVisSurfaceJobs;
+
+	for ( i = start, vis = tr.world->visSurfaces + start ; i < end ; i++, vis++ ) {
+		if ( R_CullSurface( vis->surf->data, vis->surf->shader, pc ) ) {
+			vis->dlightBits = -1;
+			continue;
+		}
+
+		if ( vis->dlightBits ) {
+			vis->dlightBits = ( R_DlightSurface( vis->surf, vis->dlightBits, pc ) != 0 );
+		}
+	}
+}
+
+/*
+======================
+R_AddVisSurfaces
+
+Splits the queued world surfaces over the job threads, then adds the ones
+that are left in the order the world walk found them
+======================
+*/
+static void R_AddVisSurfaces( void ) {
+	frontEndCounters_t	*pc;
+	visSurface_t		*vis;
+	int					i;
+
+	if ( numVisSurfaces < MIN_VIS_SURFACE_JOB ) {
+		numVisSurfaceJobs = 1;
+	} else {
+		numVisSurfaceJobs = R_NumJobThreads() * VIS_SURFACE_JOBS_PER_THREAD;
+	}
+
+	Com_Memset( jobCounters, 0, sizeof( jobCounters ) );
+	R_RunJobs( R_VisSurfaceJob, numVisSurfaceJobs );
+
+	for ( i = 0, pc = jobCounters ; i < R_NumJobThreads() ; i++, pc++ ) {
+		tr.pc.c_sphere_cull_patch_in += pc->c_sphere_cull_patch_in;
+		tr.pc.c_sphere_cull_patch_clip += pc->c_sphere_cull_patch_clip;
+		tr.pc.c_sphere_cull_patch_out += pc->c_sphere_cull_patch_out;
+		tr.pc.c_box_cull_patch_in += pc->c_box_cull_patch_in;
+		tr.pc.c_box_cull_patch_clip += pc->c_box_cull_patch_clip;
+		tr.pc.c_box_cull_patch_out += pc->c_box_cull_patch_out;
+		tr.pc.c_dlightSurfaces += pc->c_dlightSurfaces;
+		tr.pc.c_dlightSurfacesCulled += pc->c_dlightSurfacesCulled;
+	}
+
+	for ( i = 0, vis = tr.world->visSurfaces ; i < numVisSurfaces ; i++, vis++ ) {
+		if ( vis->dlightBits >= 0 ) {
+			R_AddDrawSurf( vis->surf->data, vis->surf->shader, vis->surf->fogIndex, vis->dlightBits );
+		}
+	}
+}
+
 /*
 =============================================================
 
@@ -664,5 +751,14 @@ void R_AddWorldSurfaces (void) {
 	if ( tr.refdef.num_dlights > 32 ) {
 		tr.refdef.num_dlights = 32 ;
 	}
+	// with job threads the walk only queues the surfaces
+	deferWorldSurfaces = ( R_NumJobThreads() > 1 );
+	numVisSurfaces = 0;
+
 	R_RecursiveWorldNode( tr.world->nodes, 15, ( 1 << tr.refdef.num_dlights ) - 1 );
+
+	if ( deferWorldSurfaces ) {
+		deferWorldSurfaces = qfalse;
+		R_AddVisSurfaces();
+	}
 }
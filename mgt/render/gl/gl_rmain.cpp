@@ -90,6 +90,8 @@ cvar_t	gl_finish = {"gl_finish","0"};
 cvar_t	gl_clear = {"gl_clear","0"};
 cvar_t	gl_cull = {"gl_cull","1"};
 cvar_t	gl_texsort = {"gl_texsort","1"};
+cvar_t	gl_vertexbuffers = {"gl_vertexbuffers","1"};
+cvar_t	gl_worldcache = {"gl_worldcache","1"};
 cvar_t	gl_smoothmodels = {"gl_smoothmodels","1"};
 cvar_t	gl_affinemodels = {"gl_affinemodels","0"};
 cvar_t	gl_polyblend = {"gl_polyblend","1"};
@@ -1109,6 +1111,8 @@ void R_RenderView ()
 		time1 = Sys_FloatTime ();
 		c_brush_polys = 0;
 		c_alias_polys = 0;
+		c_lightmap_uploads = 0;
+		c_lightmap_bytes = 0;
 	}
 
 	mirror = false;
@@ -1145,6 +1149,6 @@ void R_RenderView ()
 	{
 //		qglFinish ();
 		time2 = Sys_FloatTime ();
-		gpSystem->Printf ("%3i ms  %4i wpoly %4i epoly\n", (int)((time2-time1)*1000), c_brush_polys, c_alias_polys); 
+		gpSystem->Printf ("%3i ms  %4i wpoly %4i epoly %3i lmrect %5i lmbytes\n", (int)((time2-time1)*1000), c_brush_polys, c_alias_polys, c_lightmap_uploads, c_lightmap_bytes); 
 	}
 }
@@ -21,6 +21,7 @@
 /// @file
 
 #include "quakedef.h"
+#include "r_lightmap.h"
 
 /*
 ==================
@@ -174,6 +175,7 @@ void R_Init ()
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);	
 	Cmd_AddCommand ("envmap", R_Envmap_f);	
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);	
+	Cmd_AddCommand ("lightmapbench", R_LightmapBench_f);
 
 	Cvar_RegisterVariable (&r_norefresh);
 	Cvar_RegisterVariable (&r_lightmap);
@@ -190,6 +192,8 @@ void R_Init ()
 	Cvar_RegisterVariable (&gl_finish);
 	Cvar_RegisterVariable (&gl_clear);
 	Cvar_RegisterVariable (&gl_texsort);
+	Cvar_RegisterVariable (&gl_vertexbuffers);
+	Cvar_RegisterVariable (&gl_worldcache);
 
  	if (gl_mtexable)
 		Cvar_SetValue ("gl_texsort", 0.0);
@@ -393,6 +397,7 @@ void R_NewMap ()
 	R_ClearParticles ();
 
 	GL_BuildLightmaps ();
+	R_ClearWorldCache ();
 
 	// identify sky texture
 	skytexturenum = -1;
@@ -444,6 +449,29 @@ void R_TimeRefresh_f ()
 	GL_EndRendering ();
 }
 
+/*
+====================
+R_LightmapBench_f
+
+Times the C and the vector lightmap kernels against each other
+====================
+*/
+void R_LightmapBench_f ()
+{
+	double		ctime, vectime;
+	int			diff;
+
+	diff = R_LightmapBench (40, &ctime, &vectime);
+	if (diff < 0)
+	{
+		gpSystem->Printf ("no vector lightmap kernels in this build\n");
+		return;
+	}
+
+	gpSystem->Printf ("C %.2f ms, vector %.2f ms (%.2fx), largest difference %i\n",
+			ctime*1000, vectime*1000, ctime/vectime, diff);
+}
+
 void D_FlushCaches ()
 {
 }
@@ -22,6 +22,8 @@
 /// @brief surface-related refresh code
 
 #include "quakedef.h"
+#include "r_lightmap.h"
+#include "r_pvscache.h"
 
 int			skytexturenum;
 
@@ -34,7 +36,7 @@ int		lightmap_bytes;		// 1, 2, or 4
 
 int		lightmap_textures;
 
-unsigned		blocklights[18*18];
+unsigned		blocklights[LIGHTMAP_MAX_LUXELS];
 
 #define	BLOCK_WIDTH		128
 #define	BLOCK_HEIGHT	128
@@ -46,9 +48,43 @@ typedef struct glRect_s {
 	unsigned char l,t,w,h;
 } glRect_t;
 
-glpoly_t	*lightmap_polys[MAX_LIGHTMAPS];
-qboolean	lightmap_modified[MAX_LIGHTMAPS];
-glRect_t	lightmap_rectchange[MAX_LIGHTMAPS];
+// changed areas of a lightmap waiting to be uploaded, nearby ones are
+// merged so a page goes up in a few texsubimage calls however many of
+// its surfaces changed
+#define	MAX_LIGHTMAP_RECTS		8
+#define	LIGHTMAP_MERGE_WASTE	256		// unchanged luxels a merge may upload
+
+typedef struct
+{
+	int			numrects;
+	glRect_t	rects[MAX_LIGHTMAP_RECTS];
+} lightmapdirty_t;
+
+glpoly_t		*lightmap_polys[MAX_LIGHTMAPS];
+lightmapdirty_t	lightmap_dirty[MAX_LIGHTMAPS];
+
+// with pixel buffers the dirty rects are copied into a staging buffer that
+// is orphaned on every batch, so the copies never wait on the gpu still
+// reading the last one; large enough for the biggest rect at 4 bytes
+#define	LIGHTMAP_STAGING_SIZE	(4*BLOCK_WIDTH*BLOCK_HEIGHT*4)
+
+GLuint		lightmap_pbo;
+
+int			c_lightmap_uploads, c_lightmap_bytes;
+
+// the vertices of every brush poly, put in one static buffer at load time
+// so the world goes down as a few indexed draws instead of a glBegin per
+// poly; brush_verts stays around for drivers without buffer objects
+float		*brush_verts;
+int			brush_numverts;
+GLuint		brush_vbo;
+
+// indexes of the polys gathered for the current draw, as a triangle list
+#define	MAX_BATCH_INDEXES	(3*8192)
+
+unsigned	batch_indexes[MAX_BATCH_INDEXES];
+int			batch_numindexes;
+float		*batch_base;
 
 int			allocated[MAX_LIGHTMAPS][BLOCK_WIDTH];
 
@@ -70,10 +106,8 @@ R_AddDynamicLights
 void R_AddDynamicLights (msurface_t *surf)
 {
 	int			lnum;
-	int			sd, td;
 	float		dist, rad, minlight;
 	vec3_t		impact, local;
-	int			s, t;
 	int			i;
 	int			smax, tmax;
 	mtexinfo_t	*tex;
@@ -107,25 +141,8 @@ void R_AddDynamicLights (msurface_t *surf)
 
 		local[0] -= surf->texturemins[0];
 		local[1] -= surf->texturemins[1];
-		
-		for (t = 0 ; t<tmax ; t++)
-		{
-			td = local[1] - t*16;
-			if (td < 0)
-				td = -td;
-			for (s=0 ; s<smax ; s++)
-			{
-				sd = local[0] - s*16;
-				if (sd < 0)
-					sd = -sd;
-				if (sd > td)
-					dist = sd + (td>>1);
-				else
-					dist = td + (sd>>1);
-				if (dist < minlight)
-					blocklights[t*smax + s] += (rad - dist)*256;
-			}
-		}
+
+		R_LightmapAddDlight (blocklights, smax, tmax, local, rad, minlight);
 	}
 }
 
@@ -140,13 +157,10 @@ Combine and scale multiple lightmaps into the 8.8 format in blocklights
 void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 {
 	int			smax, tmax;
-	int			t;
-	int			i, j, size;
+	int			size;
 	byte		*lightmap;
 	unsigned	scale;
 	int			maps;
-	int			lightadj[4];
-	unsigned	*bl;
 
 	surf->cached_dlight = (surf->dlightframe == r_framecount);
 
@@ -158,14 +172,12 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 // set to full bright if no light data
 	if (r_fullbright.value || !cl.worldmodel->lightdata)
 	{
-		for (i=0 ; i<size ; i++)
-			blocklights[i] = 255*256;
+		R_LightmapFill (blocklights, size, 255*256);
 		goto store;
 	}
 
 // clear to no light
-	for (i=0 ; i<size ; i++)
-		blocklights[i] = 0;
+	R_LightmapFill (blocklights, size, 0);
 
 // add all the lightmaps
 	if (lightmap)
@@ -174,8 +186,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 		{
 			scale = d_lightstylevalue[surf->styles[maps]];
 			surf->cached_light[maps] = scale;	// 8.8 fraction
-			for (i=0 ; i<size ; i++)
-				blocklights[i] += lightmap[i] * scale;
+			R_LightmapAddStyle (blocklights, lightmap, size, scale);
 			lightmap += size;	// skip to next lightmap
 		}
 
@@ -188,40 +199,218 @@ store:
 	switch (gl_lightmap_format)
 	{
 	case GL_RGBA:
-		stride -= (smax<<2);
-		bl = blocklights;
-		for (i=0 ; i<tmax ; i++, dest += stride)
-		{
-			for (j=0 ; j<smax ; j++)
-			{
-				t = *bl++;
-				t >>= 7;
-				if (t > 255)
-					t = 255;
-				dest[3] = 255-t;
-				dest += 4;
-			}
-		}
+		R_LightmapStore (blocklights, smax, tmax, dest + 3, stride, 4);
 		break;
 	case GL_ALPHA:
 	case GL_LUMINANCE:
 	case GL_INTENSITY:
-		bl = blocklights;
-		for (i=0 ; i<tmax ; i++, dest += stride)
+		R_LightmapStore (blocklights, smax, tmax, dest, stride, 1);
+		break;
+	default:
+		gpSystem->Error ("Bad lightmap format");
+	}
+}
+
+
+/*
+=============================================================================
+
+  LIGHTMAP UPLOADS
+
+=============================================================================
+*/
+
+typedef struct
+{
+	int			lmap;
+	glRect_t	rect;
+	int			offset;		// into the staging buffer
+} stagedrect_t;
+
+/*
+===============
+R_MarkLightmapDirty
+
+Queues a changed area of a lightmap for upload, it is merged into the
+queued rect that grows the least when that wastes few enough luxels or
+when the list is full
+===============
+*/
+void R_MarkLightmapDirty (int lmap, int s, int t, int w, int h)
+{
+	lightmapdirty_t	*dirty;
+	glRect_t		*r, *best;
+	int				i, l, top, right, bottom;
+	int				waste, bestwaste;
+
+	dirty = &lightmap_dirty[lmap];
+	best = NULL;
+	bestwaste = 0;
+
+	for (i=0, r=dirty->rects ; i<dirty->numrects ; i++, r++)
+	{
+		l = r->l < s ? r->l : s;
+		top = r->t < t ? r->t : t;
+		right = r->l + r->w > s + w ? r->l + r->w : s + w;
+		bottom = r->t + r->h > t + h ? r->t + r->h : t + h;
+
+		// overlapping rects come out negative, which is fine
+		waste = (right - l)*(bottom - top) - r->w*r->h - w*h;
+		if (!best || waste < bestwaste)
 		{
-			for (j=0 ; j<smax ; j++)
+			best = r;
+			bestwaste = waste;
+		}
+	}
+
+	if (!best || (bestwaste > LIGHTMAP_MERGE_WASTE && dirty->numrects < MAX_LIGHTMAP_RECTS))
+	{
+		r = &dirty->rects[dirty->numrects++];
+		r->l = s;
+		r->t = t;
+		r->w = w;
+		r->h = h;
+		return;
+	}
+
+	right = best->l + best->w > s + w ? best->l + best->w : s + w;
+	bottom = best->t + best->h > t + h ? best->t + best->h : t + h;
+	if (s < best->l)
+		best->l = s;
+	if (t < best->t)
+		best->t = t;
+	best->w = right - best->l;
+	best->h = bottom - best->t;
+}
+
+
+/*
+===============
+R_SendStagedLightmaps
+
+Unmaps the staging buffer and points the texture updates at it
+===============
+*/
+static void R_SendStagedLightmaps (stagedrect_t *staged, int numstaged)
+{
+	int		i;
+
+	qglUnmapBufferARB (PIXEL_UNPACK_BUFFER_ARB);
+
+	for (i=0 ; i<numstaged ; i++, staged++)
+	{
+		GL_Bind (lightmap_textures + staged->lmap);
+		qglTexSubImage2D (GL_TEXTURE_2D, 0, staged->rect.l, staged->rect.t,
+			staged->rect.w, staged->rect.h, gl_lightmap_format, GL_UNSIGNED_BYTE,
+			(const GLvoid *)(size_t)staged->offset);
+		c_lightmap_uploads++;
+		c_lightmap_bytes += staged->rect.w*staged->rect.h*lightmap_bytes;
+	}
+}
+
+
+/*
+===============
+R_UploadLightmaps
+
+Sends the queued rects of the given lightmaps, copying them into the
+staging buffer first if there is one. Leaves some of the lightmaps bound
+===============
+*/
+void R_UploadLightmaps (const int *pages, int numpages)
+{
+	static stagedrect_t	staged[MAX_LIGHTMAPS*MAX_LIGHTMAP_RECTS];
+	lightmapdirty_t	*dirty;
+	glRect_t		*r;
+	byte			*src, *dest;
+	int				i, j, k, row, lmap;
+	int				numstaged, offset, rowbytes, size;
+
+	if (!lightmap_pbo)
+	{
+		// straight from the lightmap copy in main memory
+		qglPixelStorei (GL_UNPACK_ROW_LENGTH, BLOCK_WIDTH);
+		for (i=0 ; i<numpages ; i++)
+		{
+			lmap = pages[i];
+			dirty = &lightmap_dirty[lmap];
+			GL_Bind (lightmap_textures + lmap);
+			for (j=0, r=dirty->rects ; j<dirty->numrects ; j++, r++)
 			{
-				t = *bl++;
-				t >>= 7;
-				if (t > 255)
-					t = 255;
-				dest[j] = 255-t;
+				qglTexSubImage2D (GL_TEXTURE_2D, 0, r->l, r->t, r->w, r->h,
+					gl_lightmap_format, GL_UNSIGNED_BYTE,
+					lightmaps + ((lmap*BLOCK_HEIGHT + r->t)*BLOCK_WIDTH + r->l)*lightmap_bytes);
+				c_lightmap_uploads++;
+				c_lightmap_bytes += r->w*r->h*lightmap_bytes;
 			}
+			dirty->numrects = 0;
+		}
+		qglPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+		return;
+	}
+
+	qglBindBufferARB (PIXEL_UNPACK_BUFFER_ARB, lightmap_pbo);
+
+	dest = NULL;
+	numstaged = offset = 0;
+
+	for (i=0 ; i<numpages ; i++)
+	{
+		lmap = pages[i];
+		dirty = &lightmap_dirty[lmap];
+		for (j=0, r=dirty->rects ; j<dirty->numrects ; j++, r++)
+		{
+			// rows are padded to the default unpack alignment
+			rowbytes = (r->w*lightmap_bytes + 3) & ~3;
+			size = rowbytes*r->h;
+
+			if (!dest || offset + size > LIGHTMAP_STAGING_SIZE)
+			{
+				if (dest)
+					R_SendStagedLightmaps (staged, numstaged);
+
+				// orphan the old storage instead of waiting for it
+				qglBufferDataARB (PIXEL_UNPACK_BUFFER_ARB, LIGHTMAP_STAGING_SIZE, NULL, STREAM_DRAW_ARB);
+				dest = (byte *)qglMapBufferARB (PIXEL_UNPACK_BUFFER_ARB, WRITE_ONLY_ARB);
+				numstaged = offset = 0;
+
+				if (!dest)
+				{	// no mapping, use plain uploads from now on
+					gpSystem->Printf ("R_UploadLightmaps: can't map the staging buffer\n");
+					qglBindBufferARB (PIXEL_UNPACK_BUFFER_ARB, 0);
+					qglDeleteBuffersARB (1, &lightmap_pbo);
+					lightmap_pbo = 0;
+
+					// everything before this rect has been sent already
+					for (k=0 ; k<i ; k++)
+						lightmap_dirty[pages[k]].numrects = 0;
+					dirty->numrects -= j;
+					memmove (dirty->rects, r, dirty->numrects*sizeof(*r));
+					R_UploadLightmaps (pages + i, numpages - i);
+					return;
+				}
+			}
+
+			src = lightmaps + ((lmap*BLOCK_HEIGHT + r->t)*BLOCK_WIDTH + r->l)*lightmap_bytes;
+			for (row=0 ; row<r->h ; row++)
+				memcpy (dest + offset + row*rowbytes, src + row*BLOCK_WIDTH*lightmap_bytes,
+					r->w*lightmap_bytes);
+
+			staged[numstaged].lmap = lmap;
+			staged[numstaged].rect = *r;
+			staged[numstaged].offset = offset;
+			numstaged++;
+			offset += size;
 		}
-		break;
-	default:
-		gpSystem->Error ("Bad lightmap format");
 	}
+
+	if (dest)
+		R_SendStagedLightmaps (staged, numstaged);
+
+	qglBindBufferARB (PIXEL_UNPACK_BUFFER_ARB, 0);
+
+	for (i=0 ; i<numpages ; i++)
+		lightmap_dirty[pages[i]].numrects = 0;
 }
 
 
@@ -281,6 +470,54 @@ void DrawGLWaterPolyLightmap (glpoly_t *p);
 lpMTexFUNC qglMTexCoord2fSGIS = NULL;
 lpSelTexFUNC qglSelectTextureSGIS = NULL;
 
+lpGenBuffersFUNC qglGenBuffersARB = NULL;
+lpDeleteBuffersFUNC qglDeleteBuffersARB = NULL;
+lpBindBufferFUNC qglBindBufferARB = NULL;
+lpBufferDataFUNC qglBufferDataARB = NULL;
+lpMapBufferFUNC qglMapBufferARB = NULL;
+lpUnmapBufferFUNC qglUnmapBufferARB = NULL;
+
+/*
+===============
+GL_CheckBufferObjectExtensions
+
+Resolves the buffer object entry points through the vid file's symbol
+lookup. Software rasterizers keep buffers in main memory anyway, so the
+lightmap staging copy is skipped there unless -pbo asks for it
+===============
+*/
+void GL_CheckBufferObjectExtensions (void *(*getproc) (const char *name))
+{
+	if (!strstr(gl_extensions, "GL_ARB_vertex_buffer_object") || COM_CheckParm("-novbo"))
+		return;
+
+	qglGenBuffersARB = (lpGenBuffersFUNC) getproc("glGenBuffersARB");
+	qglDeleteBuffersARB = (lpDeleteBuffersFUNC) getproc("glDeleteBuffersARB");
+	qglBindBufferARB = (lpBindBufferFUNC) getproc("glBindBufferARB");
+	qglBufferDataARB = (lpBufferDataFUNC) getproc("glBufferDataARB");
+	qglMapBufferARB = (lpMapBufferFUNC) getproc("glMapBufferARB");
+	qglUnmapBufferARB = (lpUnmapBufferFUNC) getproc("glUnmapBufferARB");
+
+	if (!qglGenBuffersARB || !qglDeleteBuffersARB || !qglBindBufferARB ||
+		!qglBufferDataARB || !qglMapBufferARB || !qglUnmapBufferARB)
+	{
+		gpSystem->Printf ("Buffer object symbols not found, disabled.\n");
+		return;
+	}
+
+	gpSystem->Printf ("Buffer object extensions found.\n");
+	gl_vboable = true;
+
+	if (!strstr(gl_extensions, "GL_ARB_pixel_buffer_object") || COM_CheckParm("-nopbo"))
+		return;
+	if (gl_renderer && strstr(gl_renderer, "llvmpipe") && !COM_CheckParm("-pbo"))
+	{
+		gpSystem->Printf ("Software renderer, lightmap staging disabled (-pbo to force it).\n");
+		return;
+	}
+	gl_pboable = true;
+}
+
 qboolean mtexenabled = false;
 
 void GL_SelectTexture (GLenum target);
@@ -418,7 +655,6 @@ void R_DrawSequentialPoly (msurface_t *s)
 	vec3_t		nv, dir;
 	float		ss, ss2, length;
 	float		s1, t1;
-	glRect_t	*theRect;
 
 	//
 	// normal lightmaped poly
@@ -439,18 +675,8 @@ void R_DrawSequentialPoly (msurface_t *s)
 			GL_EnableMultitexture(); // Same as SelectTexture (TEXTURE1)
 			GL_Bind (lightmap_textures + s->lightmaptexturenum);
 			i = s->lightmaptexturenum;
-			if (lightmap_modified[i])
-			{
-				lightmap_modified[i] = false;
-				theRect = &lightmap_rectchange[i];
-				qglTexSubImage2D(GL_TEXTURE_2D, 0, 0, theRect->t, 
-					BLOCK_WIDTH, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-					lightmaps+(i* BLOCK_HEIGHT + theRect->t) *BLOCK_WIDTH*lightmap_bytes);
-				theRect->l = BLOCK_WIDTH;
-				theRect->t = BLOCK_HEIGHT;
-				theRect->h = 0;
-				theRect->w = 0;
-			}
+			if (lightmap_dirty[i].numrects)
+				R_UploadLightmaps (&i, 1);
 			qglTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
 			qglBegin(GL_POLYGON);
 			v = p->verts[0];
@@ -541,18 +767,8 @@ void R_DrawSequentialPoly (msurface_t *s)
 		GL_EnableMultitexture();
 		GL_Bind (lightmap_textures + s->lightmaptexturenum);
 		i = s->lightmaptexturenum;
-		if (lightmap_modified[i])
-		{
-			lightmap_modified[i] = false;
-			theRect = &lightmap_rectchange[i];
-			qglTexSubImage2D(GL_TEXTURE_2D, 0, 0, theRect->t, 
-				BLOCK_WIDTH, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-				lightmaps+(i* BLOCK_HEIGHT + theRect->t) *BLOCK_WIDTH*lightmap_bytes);
-			theRect->l = BLOCK_WIDTH;
-			theRect->t = BLOCK_HEIGHT;
-			theRect->h = 0;
-			theRect->w = 0;
-		}
+		if (lightmap_dirty[i].numrects)
+			R_UploadLightmaps (&i, 1);
 		qglTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_BLEND);
 		qglBegin (GL_TRIANGLE_FAN);
 		v = p->verts[0];
@@ -659,6 +875,106 @@ void DrawGLPoly (glpoly_t *p)
 }
 
 
+/*
+================
+R_BrushBatchable
+
+True if the poly can be drawn from the brush vertex buffer, underwater
+polys are warped as they are drawn so they stay in immediate mode
+================
+*/
+qboolean R_BrushBatchable (glpoly_t *p)
+{
+	return brush_numverts && gl_vertexbuffers.value
+		&& p->firstvert >= 0 && !(p->flags & SURF_UNDERWATER);
+}
+
+
+/*
+================
+R_BeginBrushBatch
+
+Points the vertex arrays at the brush vertex buffer, st is the offset of
+the texture coords to use (3 for the texture, 5 for the lightmap)
+================
+*/
+void R_BeginBrushBatch (int st)
+{
+	if (brush_vbo)
+	{
+		qglBindBufferARB (ARRAY_BUFFER_ARB, brush_vbo);
+		batch_base = NULL;		// offsets into the buffer
+	}
+	else
+		batch_base = brush_verts;
+
+	qglVertexPointer (3, GL_FLOAT, VERTEXSIZE*sizeof(float), batch_base);
+	qglTexCoordPointer (2, GL_FLOAT, VERTEXSIZE*sizeof(float), batch_base + st);
+	qglEnableClientState (GL_VERTEX_ARRAY);
+	qglEnableClientState (GL_TEXTURE_COORD_ARRAY);
+
+	batch_numindexes = 0;
+}
+
+
+/*
+================
+R_FlushBrushBatch
+================
+*/
+void R_FlushBrushBatch ()
+{
+	if (!batch_numindexes)
+		return;
+
+	qglDrawElements (GL_TRIANGLES, batch_numindexes, GL_UNSIGNED_INT, batch_indexes);
+	batch_numindexes = 0;
+}
+
+
+/*
+================
+R_BatchBrushPoly
+
+Adds the poly to the current draw as a fan of triangles
+================
+*/
+void R_BatchBrushPoly (glpoly_t *p)
+{
+	int			i;
+	unsigned	*index;
+
+	if (batch_numindexes + (p->numverts-2)*3 > MAX_BATCH_INDEXES)
+		R_FlushBrushBatch ();
+
+	index = batch_indexes + batch_numindexes;
+	for (i=2 ; i<p->numverts ; i++)
+	{
+		*index++ = p->firstvert;
+		*index++ = p->firstvert + i - 1;
+		*index++ = p->firstvert + i;
+	}
+	batch_numindexes = index - batch_indexes;
+}
+
+
+/*
+================
+R_EndBrushBatch
+================
+*/
+void R_EndBrushBatch ()
+{
+	R_FlushBrushBatch ();
+
+	qglDisableClientState (GL_VERTEX_ARRAY);
+	qglDisableClientState (GL_TEXTURE_COORD_ARRAY);
+
+	if (brush_vbo)
+		qglBindBufferARB (ARRAY_BUFFER_ARB, 0);
+}
+
+
 /*
 ================
 R_BlendLightmaps
@@ -669,7 +985,7 @@ void R_BlendLightmaps ()
 	int			i, j;
 	glpoly_t	*p;
 	float		*v;
-	glRect_t	*theRect;
+	int			pages[MAX_LIGHTMAPS], numpages;
 
 	if (r_fullbright.value)
 		return;
@@ -692,32 +1008,32 @@ void R_BlendLightmaps ()
 		qglEnable (GL_BLEND);
 	}
 
+	// send everything that changed this frame in one batch before drawing
+	numpages = 0;
+	for (i=0 ; i<MAX_LIGHTMAPS ; i++)
+		if (lightmap_polys[i] && lightmap_dirty[i].numrects)
+			pages[numpages++] = i;
+	if (numpages)
+		R_UploadLightmaps (pages, numpages);
+
 	for (i=0 ; i<MAX_LIGHTMAPS ; i++)
 	{
 		p = lightmap_polys[i];
 		if (!p)
 			continue;
 		GL_Bind(lightmap_textures+i);
-		if (lightmap_modified[i])
-		{
-			lightmap_modified[i] = false;
-			theRect = &lightmap_rectchange[i];
-//			qglTexImage2D (GL_TEXTURE_2D, 0, lightmap_bytes
-//			, BLOCK_WIDTH, BLOCK_HEIGHT, 0, 
-//			gl_lightmap_format, GL_UNSIGNED_BYTE, lightmaps+i*BLOCK_WIDTH*BLOCK_HEIGHT*lightmap_bytes);
-//			qglTexImage2D (GL_TEXTURE_2D, 0, lightmap_bytes
-//				, BLOCK_WIDTH, theRect->h, 0, 
-//				gl_lightmap_format, GL_UNSIGNED_BYTE, lightmaps+(i*BLOCK_HEIGHT+theRect->t)*BLOCK_WIDTH*lightmap_bytes);
-			qglTexSubImage2D(GL_TEXTURE_2D, 0, 0, theRect->t, 
-				BLOCK_WIDTH, theRect->h, gl_lightmap_format, GL_UNSIGNED_BYTE,
-				lightmaps+(i* BLOCK_HEIGHT + theRect->t) *BLOCK_WIDTH*lightmap_bytes);
-			theRect->l = BLOCK_WIDTH;
-			theRect->t = BLOCK_HEIGHT;
-			theRect->h = 0;
-			theRect->w = 0;
-		}
+
+		// everything on this lightmap in one draw
+		R_BeginBrushBatch (5);
 		for ( ; p ; p=p->chain)
+			if (R_BrushBatchable (p))
+				R_BatchBrushPoly (p);
+		R_EndBrushBatch ();
+
+		for (p = lightmap_polys[i] ; p ; p=p->chain)
 		{
+			if (R_BrushBatchable (p))
+				continue;
 			if (p->flags & SURF_UNDERWATER)
 				DrawGLWaterPolyLightmap (p);
 			else
@@ -756,7 +1072,6 @@ void R_RenderBrushPoly (msurface_t *fa)
 	texture_t	*t;
 	byte		*base;
 	int			maps;
-	glRect_t    *theRect;
 	int smax, tmax;
 
 	c_brush_polys++;
@@ -798,24 +1113,9 @@ void R_RenderBrushPoly (msurface_t *fa)
 dynamic:
 		if (r_dynamic.value)
 		{
-			lightmap_modified[fa->lightmaptexturenum] = true;
-			theRect = &lightmap_rectchange[fa->lightmaptexturenum];
-			if (fa->light_t < theRect->t) {
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l) {
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
-			}
 			smax = (fa->extents[0]>>4)+1;
 			tmax = (fa->extents[1]>>4)+1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s-theRect->l)+smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t-theRect->t)+tmax;
+			R_MarkLightmapDirty (fa->lightmaptexturenum, fa->light_s, fa->light_t, smax, tmax);
 			base = lightmaps + fa->lightmaptexturenum*lightmap_bytes*BLOCK_WIDTH*BLOCK_HEIGHT;
 			base += fa->light_t * BLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
 			R_BuildLightMap (fa, base, BLOCK_WIDTH*lightmap_bytes);
@@ -833,7 +1133,6 @@ void R_RenderDynamicLightmaps (msurface_t *fa)
 {
 	byte		*base;
 	int			maps;
-	glRect_t    *theRect;
 	int smax, tmax;
 
 	c_brush_polys++;
@@ -856,24 +1155,9 @@ void R_RenderDynamicLightmaps (msurface_t *fa)
 dynamic:
 		if (r_dynamic.value)
 		{
-			lightmap_modified[fa->lightmaptexturenum] = true;
-			theRect = &lightmap_rectchange[fa->lightmaptexturenum];
-			if (fa->light_t < theRect->t) {
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l) {
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
-			}
 			smax = (fa->extents[0]>>4)+1;
 			tmax = (fa->extents[1]>>4)+1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s-theRect->l)+smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t-theRect->t)+tmax;
+			R_MarkLightmapDirty (fa->lightmaptexturenum, fa->light_s, fa->light_t, smax, tmax);
 			base = lightmaps + fa->lightmaptexturenum*lightmap_bytes*BLOCK_WIDTH*BLOCK_HEIGHT;
 			base += fa->light_t * BLOCK_WIDTH * lightmap_bytes + fa->light_s * lightmap_bytes;
 			R_BuildLightMap (fa, base, BLOCK_WIDTH*lightmap_bytes);
@@ -1017,6 +1301,47 @@ void R_DrawWaterSurfaces ()
 
 #endif
 
+/*
+================
+R_DrawTextureChain
+
+R_RenderBrushPoly for a whole texture chain, the polys that are in the
+brush vertex buffer go down as one draw
+================
+*/
+void R_DrawTextureChain (msurface_t *chain)
+{
+	msurface_t	*s;
+	texture_t	*t;
+
+	if (!brush_numverts || !gl_vertexbuffers.value)
+	{
+		for (s=chain ; s ; s=s->texturechain)
+			R_RenderBrushPoly (s);
+		return;
+	}
+
+	// the chain is all one texture
+	t = R_TextureAnimation (chain->texinfo->texture);
+	GL_Bind (t->gl_texturenum);
+
+	R_BeginBrushBatch (3);
+	for (s=chain ; s ; s=s->texturechain)
+	{
+		if ((s->flags & (SURF_DRAWSKY|SURF_DRAWTURB)) || !R_BrushBatchable (s->polys))
+			continue;
+		R_BatchBrushPoly (s->polys);
+		R_RenderDynamicLightmaps (s);	// lightmap chain and relighting
+	}
+	R_EndBrushBatch ();
+
+	for (s=chain ; s ; s=s->texturechain)
+	{
+		if ((s->flags & (SURF_DRAWSKY|SURF_DRAWTURB)) || !R_BrushBatchable (s->polys))
+			R_RenderBrushPoly (s);
+	}
+}
+
 /*
 ================
 DrawTextureChains
@@ -1058,8 +1383,7 @@ void DrawTextureChains ()
 		{
 			if ((s->flags & SURF_DRAWTURB) && r_wateralpha.value != 1.0)
 				continue;	// draw translucent water later
-			for ( ; s ; s=s->texturechain)
-				R_RenderBrushPoly (s);
+			R_DrawTextureChain (s);
 		}
 
 		t->texturechain = NULL;
@@ -1178,6 +1502,35 @@ e->angles[0] = -e->angles[0];	// stupid quake bug
 =============================================================
 */
 
+/*
+================
+R_ChainWorldSurface
+
+Puts a visible, front facing world surface on its texture chain, or draws
+it right away when not sorting by texture
+================
+*/
+void R_ChainWorldSurface (msurface_t *surf)
+{
+	// if sorting by texture, just store it out
+	if (gl_texsort.value)
+	{
+		if (!mirror
+		|| surf->texinfo->texture != cl.worldmodel->textures[mirrortexturenum])
+		{
+			surf->texturechain = surf->texinfo->texture->texturechain;
+			surf->texinfo->texture->texturechain = surf;
+		}
+	} else if (surf->flags & SURF_DRAWSKY) {
+		surf->texturechain = skychain;
+		skychain = surf;
+	} else if (surf->flags & SURF_DRAWTURB) {
+		surf->texturechain = waterchain;
+		waterchain = surf;
+	} else
+		R_DrawSequentialPoly (surf);
+}
+
 /*
 ================
 R_RecursiveWorldNode
@@ -1275,24 +1628,7 @@ void R_RecursiveWorldNode (mnode_t *node)
 				if ( !(surf->flags & SURF_UNDERWATER) && ( (dot < 0) ^ !!(surf->flags & SURF_PLANEBACK)) )
 					continue;		// wrong side
 
-				// if sorting by texture, just store it out
-				if (gl_texsort.value)
-				{
-					if (!mirror
-					|| surf->texinfo->texture != cl.worldmodel->textures[mirrortexturenum])
-					{
-						surf->texturechain = surf->texinfo->texture->texturechain;
-						surf->texinfo->texture->texturechain = surf;
-					}
-				} else if (surf->flags & SURF_DRAWSKY) {
-					surf->texturechain = skychain;
-					skychain = surf;
-				} else if (surf->flags & SURF_DRAWTURB) {
-					surf->texturechain = waterchain;
-					waterchain = surf;
-				} else
-					R_DrawSequentialPoly (surf);
-
+				R_ChainWorldSurface (surf);
 			}
 		}
 
@@ -1304,6 +1640,233 @@ void R_RecursiveWorldNode (mnode_t *node)
 
 
 
+/*
+=============================================================================
+
+  WORLD SURFACE LIST
+
+The world walk is done against a frustum opened up by WORLDCACHE_ANGLE
+degrees and pulled back by WORLDCACHE_DIST units, and the surfaces and
+leafs it finds are kept. While the view stays in the same PVS and turns or
+moves less than half of that, the following frames reuse the list and
+only redo the backface tests.
+
+=============================================================================
+*/
+
+#define	WORLDCACHE_ANGLE	8
+#define	WORLDCACHE_DIST		32
+
+int SignbitsForPlane (mplane_t *out);
+
+msurface_t	**r_worldsurfs;
+int			r_numworldsurfs;
+mleaf_t		**r_worldleafs;
+int			r_numworldleafs;
+
+qboolean	r_worldcachevalid;
+int			r_worldcachevisframe;
+vec3_t		r_worldcacheorigin;
+vec3_t		r_worldcacheangles;
+float		r_worldcachefov_x, r_worldcachefov_y;
+mplane_t	r_worldcachefrustum[4];
+
+/*
+===============
+R_ClearWorldCache
+
+Called from R_NewMap, both lists go on the hunk with the map
+===============
+*/
+void R_ClearWorldCache ()
+{
+	r_worldsurfs = (msurface_t **)Hunk_AllocName (cl.worldmodel->numsurfaces * sizeof(*r_worldsurfs), "worldsurfs");
+	r_worldleafs = (mleaf_t **)Hunk_AllocName ((cl.worldmodel->numleafs + 1) * sizeof(*r_worldleafs), "worldleafs");
+	r_numworldsurfs = 0;
+	r_numworldleafs = 0;
+	r_worldcachevalid = false;
+
+	R_ClearPVSCache (cl.worldmodel);
+}
+
+/*
+===============
+R_SetWorldCacheFrustum
+
+Same as R_SetFrustum, only wider and further back
+===============
+*/
+void R_SetWorldCacheFrustum ()
+{
+	int		i;
+	float	fov_x, fov_y;
+
+	fov_x = r_refdef.fov_x + 2*WORLDCACHE_ANGLE;
+	fov_y = r_refdef.fov_y + 2*WORLDCACHE_ANGLE;
+	if (fov_x > 178)
+		fov_x = 178;
+	if (fov_y > 178)
+		fov_y = 178;
+
+	RotatePointAroundVector( r_worldcachefrustum[0].normal, vup, vpn, -(90-fov_x / 2 ) );
+	RotatePointAroundVector( r_worldcachefrustum[1].normal, vup, vpn, 90-fov_x / 2 );
+	RotatePointAroundVector( r_worldcachefrustum[2].normal, vright, vpn, 90-fov_y / 2 );
+	RotatePointAroundVector( r_worldcachefrustum[3].normal, vright, vpn, -( 90 - fov_y / 2 ) );
+
+	for (i=0 ; i<4 ; i++)
+	{
+		r_worldcachefrustum[i].type = PLANE_ANYZ;
+		r_worldcachefrustum[i].dist = DotProduct (r_origin, r_worldcachefrustum[i].normal) - WORLDCACHE_DIST;
+		r_worldcachefrustum[i].signbits = SignbitsForPlane (&r_worldcachefrustum[i]);
+	}
+}
+
+/*
+================
+R_WorldCacheNode
+
+R_RecursiveWorldNode without the drawing. The surfaces of a node are taken
+after both of its sides, so that all the leafs that can mark them have been
+seen whichever side of the node the view ends up on
+================
+*/
+void R_WorldCacheNode (mnode_t *node)
+{
+	int			i, c, side;
+	mplane_t	*plane;
+	msurface_t	*surf, **mark;
+	mleaf_t		*pleaf;
+	double		dot;
+
+	if (node->contents == CONTENTS_SOLID)
+		return;		// solid
+
+	if (node->visframe != r_visframecount)
+		return;
+	for (i=0 ; i<4 ; i++)
+		if (BoxOnPlaneSide (node->minmaxs, node->minmaxs+3, &r_worldcachefrustum[i]) == 2)
+			return;
+
+	if (node->contents < 0)
+	{
+		pleaf = (mleaf_t *)node;
+
+		mark = pleaf->firstmarksurface;
+		for (c = pleaf->nummarksurfaces ; c ; c--, mark++)
+			(*mark)->visframe = r_framecount;
+
+		r_worldleafs[r_numworldleafs++] = pleaf;
+		return;
+	}
+
+	plane = node->plane;
+	dot = DotProduct (modelorg, plane->normal) - plane->dist;
+	side = dot < 0;
+
+	R_WorldCacheNode (node->children[side]);
+	R_WorldCacheNode (node->children[!side]);
+
+	surf = cl.worldmodel->surfaces + node->firstsurface;
+	for (c = node->numsurfaces ; c ; c--, surf++)
+		if (surf->visframe == r_framecount)
+			r_worldsurfs[r_numworldsurfs++] = surf;
+}
+
+/*
+================
+R_AngleDelta
+================
+*/
+float R_AngleDelta (float a, float b)
+{
+	float	d;
+
+	d = fmod (fabs (a - b), 360);
+	if (d > 180)
+		d = 360 - d;
+	return d;
+}
+
+/*
+================
+R_WorldCacheCurrent
+
+Rebuilds the list if the view got out of what it covers. Returns false if
+the world has to be walked the old way (mirror and envmap views)
+================
+*/
+qboolean R_WorldCacheCurrent ()
+{
+	vec3_t	delta;
+	float	turn;
+
+	if (!gl_worldcache.value || mirror || envmap || !r_worldsurfs)
+		return false;
+
+	if (r_worldcachevalid && r_worldcachevisframe == r_visframecount
+	&& r_worldcachefov_x == r_refdef.fov_x && r_worldcachefov_y == r_refdef.fov_y)
+	{
+		VectorSubtract (r_origin, r_worldcacheorigin, delta);
+		turn = R_AngleDelta (r_refdef.viewangles[0], r_worldcacheangles[0])
+			+ R_AngleDelta (r_refdef.viewangles[1], r_worldcacheangles[1])
+			+ R_AngleDelta (r_refdef.viewangles[2], r_worldcacheangles[2]);
+
+		// any view ray moves by at most the sum of the three turns
+		if (turn < WORLDCACHE_ANGLE/2 && Length (delta) < WORLDCACHE_DIST/2)
+			return true;
+	}
+
+	R_SetWorldCacheFrustum ();
+
+	r_numworldsurfs = 0;
+	r_numworldleafs = 0;
+	R_WorldCacheNode (cl.worldmodel->nodes);
+
+	r_worldcachevalid = true;
+	r_worldcachevisframe = r_visframecount;
+	r_worldcachefov_x = r_refdef.fov_x;
+	r_worldcachefov_y = r_refdef.fov_y;
+	VectorCopy (r_origin, r_worldcacheorigin);
+	VectorCopy (r_refdef.viewangles, r_worldcacheangles);
+	return true;
+}
+
+/*
+================
+R_DrawWorldList
+================
+*/
+void R_DrawWorldList ()
+{
+	int			i;
+	msurface_t	*surf;
+	mleaf_t		*pleaf;
+	double		dot;
+
+	for (i=0 ; i<r_numworldleafs ; i++)
+	{
+		pleaf = r_worldleafs[i];
+		if (pleaf->efrags)
+			R_StoreEfrags (&pleaf->efrags);
+	}
+
+	for (i=0 ; i<r_numworldsurfs ; i++)
+	{
+		surf = r_worldsurfs[i];
+		surf->visframe = r_framecount;
+
+		dot = DotProduct (modelorg, surf->plane->normal) - surf->plane->dist;
+
+		// don't backface underwater surfaces, because they warp
+		if ( !(surf->flags & SURF_UNDERWATER) && ( (dot < 0) ^ !!(surf->flags & SURF_PLANEBACK)) )
+			continue;		// wrong side
+
+		R_ChainWorldSurface (surf);
+	}
+}
+
+
+
 /*
 =============
 R_DrawWorld
@@ -1328,7 +1891,10 @@ void R_DrawWorld ()
 	R_ClearSkyBox ();
 #endif
 
-	R_RecursiveWorldNode (cl.worldmodel->nodes);
+	if (R_WorldCacheCurrent ())
+		R_DrawWorldList ();
+	else
+		R_RecursiveWorldNode (cl.worldmodel->nodes);
 
 	DrawTextureChains ();
 
@@ -1347,9 +1913,6 @@ R_MarkLeaves
 */
 void R_MarkLeaves ()
 {
-	byte	*vis;
-	mnode_t	*node;
-	int		i;
 	byte	solid[4096];
 
 	if (r_oldviewleaf == r_viewleaf && !r_novis.value)
@@ -1363,26 +1926,11 @@ void R_MarkLeaves ()
 
 	if (r_novis.value)
 	{
-		vis = solid;
 		memset (solid, 0xff, (cl.worldmodel->numleafs+7)>>3);
+		R_MarkPVS (cl.worldmodel, solid, r_visframecount, nullptr);
 	}
 	else
-		vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel);
-		
-	for (i=0 ; i<cl.worldmodel->numleafs ; i++)
-	{
-		if (vis[i>>3] & (1<<(i&7)))
-		{
-			node = (mnode_t *)&cl.worldmodel->leafs[i+1];
-			do
-			{
-				if (node->visframe == r_visframecount)
-					break;
-				node->visframe = r_visframecount;
-				node = node->parent;
-			} while (node);
-		}
-	}
+		R_MarkLeavesCached (cl.worldmodel, r_viewleaf, r_visframecount);
 }
 
 
@@ -1395,33 +1943,51 @@ void R_MarkLeaves ()
 =============================================================================
 */
 
-// returns a texture number and the position inside it
+/*
+================
+AllocBlock
+
+Returns a texture number and the position inside it. Each lightmap keeps a
+skyline of its filled columns; the block goes in the first lightmap that
+has room, at the lowest spot, and of those the one leaving the least unused
+space under the block
+================
+*/
 int AllocBlock (int w, int h, int *x, int *y)
 {
 	int		i, j;
 	int		best, best2;
-	int		bestx;
+	int		waste, bestwaste;
 	int		texnum;
 
 	for (texnum=0 ; texnum<MAX_LIGHTMAPS ; texnum++)
 	{
 		best = BLOCK_HEIGHT;
+		bestwaste = 0;
 
-		for (i=0 ; i<BLOCK_WIDTH-w ; i++)
+		for (i=0 ; i<=BLOCK_WIDTH-w ; i++)
 		{
 			best2 = 0;
 
 			for (j=0 ; j<w ; j++)
 			{
-				if (allocated[texnum][i+j] >= best)
+				if (allocated[texnum][i+j] > best)
 					break;
 				if (allocated[texnum][i+j] > best2)
 					best2 = allocated[texnum][i+j];
 			}
-			if (j == w)
-			{	// this is a valid spot
+			if (j < w)
+				continue;
+
+			waste = 0;
+			for (j=0 ; j<w ; j++)
+				waste += best2 - allocated[texnum][i+j];
+
+			if (best2 < best || (best2 == best && waste < bestwaste))
+			{	// this is a better spot
 				*x = i;
 				*y = best = best2;
+				bestwaste = waste;
 			}
 		}
 
@@ -1435,6 +2001,27 @@ int AllocBlock (int w, int h, int *x, int *y)
 	}
 
 	gpSystem->Error ("AllocBlock: full");
+	return 0;
+}
+
+
+/*
+================
+LightmapSizeCompare
+
+qsort order for GL_BuildLightmaps, tallest lightmaps first, then widest
+================
+*/
+static int LightmapSizeCompare (const void *a, const void *b)
+{
+	msurface_t	*s1, *s2;
+
+	s1 = *(msurface_t **)a;
+	s2 = *(msurface_t **)b;
+
+	if (s1->extents[1] != s2->extents[1])
+		return s2->extents[1] - s1->extents[1];
+	return s2->extents[0] - s1->extents[0];
 }
 
 
@@ -1475,6 +2062,7 @@ void BuildSurfaceDisplayList (msurface_t *fa)
 	poly->flags = fa->flags;
 	fa->polys = poly;
 	poly->numverts = lnumverts;
+	poly->firstvert = -1;		// set by GL_BuildBrushVertexBuffer
 
 	for (i=0 ; i<lnumverts ; i++)
 	{
@@ -1586,6 +2174,78 @@ void GL_CreateSurfaceLightmap (msurface_t *surf)
 }
 
 
+/*
+==================
+GL_BuildBrushVertexBuffer
+
+Copies the polys of all the brush models into one vertex buffer, the
+polys remember where their vertices went
+==================
+*/
+void GL_BuildBrushVertexBuffer ()
+{
+	int			i, j;
+	model_t		*m;
+	msurface_t	*fa;
+	glpoly_t	*p;
+	float		*v;
+
+	brush_numverts = 0;
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		for (i=0, fa=m->surfaces ; i<m->numsurfaces ; i++, fa++)
+		{
+			if (fa->flags & (SURF_DRAWSKY|SURF_DRAWTURB))
+				continue;
+			for (p=fa->polys ; p ; p=p->next)
+				brush_numverts += p->numverts;
+		}
+	}
+
+	if (!brush_numverts)
+		return;
+
+	brush_verts = (float *)Hunk_AllocName (brush_numverts*VERTEXSIZE*sizeof(float), "brushverts");
+
+	v = brush_verts;
+	brush_numverts = 0;
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		for (i=0, fa=m->surfaces ; i<m->numsurfaces ; i++, fa++)
+		{
+			if (fa->flags & (SURF_DRAWSKY|SURF_DRAWTURB))
+				continue;
+			for (p=fa->polys ; p ; p=p->next)
+			{
+				p->firstvert = brush_numverts;
+				memcpy (v, p->verts[0], p->numverts*VERTEXSIZE*sizeof(float));
+				v += p->numverts*VERTEXSIZE;
+				brush_numverts += p->numverts;
+			}
+		}
+	}
+
+	if (!gl_vboable)
+		return;
+
+	if (!brush_vbo)
+		qglGenBuffersARB (1, &brush_vbo);
+	qglBindBufferARB (ARRAY_BUFFER_ARB, brush_vbo);
+	qglBufferDataARB (ARRAY_BUFFER_ARB, brush_numverts*VERTEXSIZE*sizeof(float), brush_verts, STATIC_DRAW_ARB);
+	qglBindBufferARB (ARRAY_BUFFER_ARB, 0);
+}
+
+
 /*
 ==================
 GL_BuildLightmaps
@@ -1598,6 +2258,8 @@ void GL_BuildLightmaps ()
 {
 	int		i, j;
 	model_t	*m;
+	msurface_t	**surfs;
+	int		numsurfs, mark;
 	extern qboolean isPermedia;
 
 	memset (allocated, 0, sizeof(allocated));
@@ -1641,6 +2303,38 @@ void GL_BuildLightmaps ()
 		break;
 	}
 
+	// place the lightmaps tallest first, they pack much tighter that way
+	numsurfs = 0;
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] != '*')
+			numsurfs += m->numsurfaces;
+	}
+
+	mark = Hunk_LowMark ();
+	surfs = (msurface_t **)Hunk_Alloc (numsurfs * sizeof(*surfs));
+
+	numsurfs = 0;
+	for (j=1 ; j<MAX_MODELS ; j++)
+	{
+		m = cl.model_precache[j];
+		if (!m)
+			break;
+		if (m->name[0] == '*')
+			continue;
+		for (i=0 ; i<m->numsurfaces ; i++)
+			surfs[numsurfs++] = m->surfaces + i;
+	}
+
+	qsort (surfs, numsurfs, sizeof(*surfs), LightmapSizeCompare);
+	for (i=0 ; i<numsurfs ; i++)
+		GL_CreateSurfaceLightmap (surfs[i]);
+
+	Hunk_FreeToLowMark (mark);
+
 	for (j=1 ; j<MAX_MODELS ; j++)
 	{
 		m = cl.model_precache[j];
@@ -1652,7 +2346,6 @@ void GL_BuildLightmaps ()
 		currentmodel = m;
 		for (i=0 ; i<m->numsurfaces ; i++)
 		{
-			GL_CreateSurfaceLightmap (m->surfaces + i);
 			if ( m->surfaces[i].flags & SURF_DRAWTURB )
 				continue;
 #ifndef QUAKE2
@@ -1663,6 +2356,8 @@ void GL_BuildLightmaps ()
 		}
 	}
 
+	GL_BuildBrushVertexBuffer ();
+
  	if (!gl_texsort.value)
  		GL_SelectTexture(TEXTURE1_SGIS);
 
@@ -1673,11 +2368,7 @@ void GL_BuildLightmaps ()
 	{
 		if (!allocated[i][0])
 			break;		// no more used
-		lightmap_modified[i] = false;
-		lightmap_rectchange[i].l = BLOCK_WIDTH;
-		lightmap_rectchange[i].t = BLOCK_HEIGHT;
-		lightmap_rectchange[i].w = 0;
-		lightmap_rectchange[i].h = 0;
+		lightmap_dirty[i].numrects = 0;
 		GL_Bind(lightmap_textures + i);
 		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		qglTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -1689,5 +2380,7 @@ void GL_BuildLightmaps ()
  	if (!gl_texsort.value)
  		GL_SelectTexture(TEXTURE0_SGIS);
 
+	if (gl_pboable && !lightmap_pbo)
+		qglGenBuffersARB (1, &lightmap_pbo);
 }
 
@@ -126,6 +126,7 @@ void SubdividePolygon (int numverts, float *verts)
 	poly->next = warpface->polys;
 	warpface->polys = poly;
 	poly->numverts = numverts;
+	poly->firstvert = -1;
 	for (i=0 ; i<numverts ; i++, verts+= 3)
 	{
 		VectorCopy (verts, poly->verts[i]);
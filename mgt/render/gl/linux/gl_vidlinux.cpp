@@ -128,6 +128,8 @@ static float vid_gamma = 1.0;
 qboolean is8bit = false;
 qboolean isPermedia = false;
 qboolean gl_mtexable = false;
+qboolean gl_vboable = false;
+qboolean gl_pboable = false;
 
 /*-----------------------------------------------------------------------*/
 void D_BeginDirectRect (int x, int y, byte *pbitmap, int width, int height)
@@ -296,6 +298,26 @@ void CheckMultiTextureExtensions()
 	}
 }
 
+static void *buffer_prjobj;
+
+static void *GetBufferObjectProc (const char *name)
+{
+	return dlsym(buffer_prjobj, name);
+}
+
+void CheckBufferObjectExtensions() 
+{
+	if ((buffer_prjobj = dlopen(NULL, RTLD_LAZY)) == NULL) {
+		Con_Printf("Unable to open symbol list for main program.\n");
+		return;
+	}
+
+	GL_CheckBufferObjectExtensions (GetBufferObjectProc);
+
+	dlclose(buffer_prjobj);
+	buffer_prjobj = NULL;
+}
+
 /*
 ===============
 GL_Init
@@ -316,6 +338,7 @@ void GL_Init ()
 //	Con_Printf ("%s %s\n", gl_renderer, gl_version);
 
 	CheckMultiTextureExtensions ();
+	CheckBufferObjectExtensions ();
 
 	glClearColor (1,0,0,0);
 	glCullFace(GL_FRONT);
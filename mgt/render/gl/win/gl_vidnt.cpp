@@ -139,6 +139,8 @@ lp3DFXFUNC glColorTableEXT;
 qboolean is8bit = false;
 qboolean isPermedia = false;
 qboolean gl_mtexable = false;
+qboolean gl_vboable = false;
+qboolean gl_pboable = false;
 
 //====================================
 
@@ -586,11 +588,25 @@ void CheckMultiTextureExtensions()
 		gl_mtexable = true;
 	}
 }
+
+static void *GetBufferObjectProc (const char *name)
+{
+	return (void *) wglGetProcAddress(name);
+}
+
+void CheckBufferObjectExtensions() 
+{
+	GL_CheckBufferObjectExtensions (GetBufferObjectProc);
+}
 #else
 void CheckMultiTextureExtensions() 
 {
 		gl_mtexable = true;
 }
+
+void CheckBufferObjectExtensions() 
+{
+}
 #endif
 
 /*
@@ -620,6 +636,7 @@ void GL_Init ()
 
 	CheckTextureExtensions ();
 	CheckMultiTextureExtensions ();
+	CheckBufferObjectExtensions ();
 
 	glClearColor (1,0,0,0);
 	glCullFace(GL_FRONT);
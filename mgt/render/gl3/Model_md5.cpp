@@ -35,6 +35,12 @@ If you have questions concerning this license or the applicable additional terms
 
 static const __m128 vector_float_posInfinity = { idMath::INFINITY, idMath::INFINITY, idMath::INFINITY, idMath::INFINITY };
 static const __m128 vector_float_negInfinity = { -idMath::INFINITY, -idMath::INFINITY, -idMath::INFINITY, -idMath::INFINITY };
+static const __m128 vector_float_zero = { 0.0f, 0.0f, 0.0f, 0.0f };
+static const __m128 vector_float_half = { 0.5f, 0.5f, 0.5f, 0.5f };
+static const __m128 vector_float_one = { 1.0f, 1.0f, 1.0f, 1.0f };
+static const __m128 vector_float_inv255 = { 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f, 1.0f / 255.0f };
+static const __m128 vector_float_byteToFloat = { 2.0f / 255.0f, 2.0f / 255.0f, 2.0f / 255.0f, 2.0f / 255.0f };
+static const __m128 vector_float_floatToByte = { 255.0f / 2.0f, 255.0f / 2.0f, 255.0f / 2.0f, 255.0f / 2.0f };
 
 #endif
 
@@ -450,6 +456,86 @@ TransformVertsAndTangents
 */
 void TransformVertsAndTangents(idDrawVert *targetVerts, const int numVerts, const idDrawVert *baseVerts, const idJointMat *joints)
 {
+#ifdef ID_WIN_X86_SSE2_INTRIN
+
+	// the normal and tangent bytes are loaded and stored together
+	compile_time_assert(offsetof(idDrawVert, tangent) == offsetof(idDrawVert, normal) + 4);
+
+	const __m128i vector_int_zero = _mm_setzero_si128();
+
+	for(int i = 0; i < numVerts; i++)
+	{
+		const idDrawVert &base = baseVerts[i];
+
+		const float *j0 = joints[base.color[0]].ToFloatPtr();
+		const float *j1 = joints[base.color[1]].ToFloatPtr();
+		const float *j2 = joints[base.color[2]].ToFloatPtr();
+		const float *j3 = joints[base.color[3]].ToFloatPtr();
+
+		// all four weights at once, unused ones are zero
+		__m128 w = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int *)base.color2), vector_int_zero), vector_int_zero));
+		w = _mm_mul_ps(w, vector_float_inv255);
+		const __m128 w0 = _mm_splat_ps(w, 0);
+		const __m128 w1 = _mm_splat_ps(w, 1);
+		const __m128 w2 = _mm_splat_ps(w, 2);
+		const __m128 w3 = _mm_splat_ps(w, 3);
+
+		// blend the joint matrices a row at a time, in the same order as idJointMat::Mul / Mad
+		__m128 ra = _mm_mul_ps(_mm_load_ps(j0 + 0 * 4), w0);
+		__m128 rb = _mm_mul_ps(_mm_load_ps(j0 + 1 * 4), w0);
+		__m128 rc = _mm_mul_ps(_mm_load_ps(j0 + 2 * 4), w0);
+		ra = _mm_add_ps(ra, _mm_mul_ps(_mm_load_ps(j1 + 0 * 4), w1));
+		rb = _mm_add_ps(rb, _mm_mul_ps(_mm_load_ps(j1 + 1 * 4), w1));
+		rc = _mm_add_ps(rc, _mm_mul_ps(_mm_load_ps(j1 + 2 * 4), w1));
+		ra = _mm_add_ps(ra, _mm_mul_ps(_mm_load_ps(j2 + 0 * 4), w2));
+		rb = _mm_add_ps(rb, _mm_mul_ps(_mm_load_ps(j2 + 1 * 4), w2));
+		rc = _mm_add_ps(rc, _mm_mul_ps(_mm_load_ps(j2 + 2 * 4), w2));
+		ra = _mm_add_ps(ra, _mm_mul_ps(_mm_load_ps(j3 + 0 * 4), w3));
+		rb = _mm_add_ps(rb, _mm_mul_ps(_mm_load_ps(j3 + 1 * 4), w3));
+		rc = _mm_add_ps(rc, _mm_mul_ps(_mm_load_ps(j3 + 2 * 4), w3));
+
+		// transpose to columns so each vector is three multiply-adds
+		__m128 t0 = _mm_unpacklo_ps(ra, rb);
+		__m128 t1 = _mm_unpackhi_ps(ra, rb);
+		__m128 t2 = _mm_unpacklo_ps(rc, vector_float_zero);
+		__m128 t3 = _mm_unpackhi_ps(rc, vector_float_zero);
+		__m128 cx = _mm_movelh_ps(t0, t2);
+		__m128 cy = _mm_movehl_ps(t2, t0);
+		__m128 cz = _mm_movelh_ps(t1, t3);
+		__m128 ct = _mm_movehl_ps(t3, t1);
+
+		// VERTEX_BYTE_TO_FLOAT on the normal and tangent
+		__m128i nt = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)base.normal), vector_int_zero);
+		__m128 n = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(nt, vector_int_zero)), vector_float_byteToFloat), vector_float_one);
+		__m128 t = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(nt, vector_int_zero)), vector_float_byteToFloat), vector_float_one);
+
+		__m128 xyz = _mm_add_ps(_mm_mul_ps(cx, _mm_load1_ps(&base.xyz.x)), _mm_mul_ps(cy, _mm_load1_ps(&base.xyz.y)));
+		__m128 nrm = _mm_add_ps(_mm_mul_ps(cx, _mm_splat_ps(n, 0)), _mm_mul_ps(cy, _mm_splat_ps(n, 1)));
+		__m128 tan = _mm_add_ps(_mm_mul_ps(cx, _mm_splat_ps(t, 0)), _mm_mul_ps(cy, _mm_splat_ps(t, 1)));
+		xyz = _mm_add_ps(_mm_add_ps(xyz, _mm_mul_ps(cz, _mm_load1_ps(&base.xyz.z))), ct);
+		nrm = _mm_add_ps(nrm, _mm_mul_ps(cz, _mm_splat_ps(n, 2)));
+		tan = _mm_add_ps(tan, _mm_mul_ps(cz, _mm_splat_ps(t, 2)));
+
+		// VERTEX_FLOAT_TO_BYTE, the packs clamp like idMath::Ftob
+		__m128i nb = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(nrm, vector_float_one), vector_float_floatToByte), vector_float_half));
+		__m128i tb = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_add_ps(tan, vector_float_one), vector_float_floatToByte), vector_float_half));
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(nb, tb), vector_int_zero);
+
+		ALIGN16(float pos[4]);
+		_mm_store_ps(pos, xyz);
+		targetVerts[i].xyz.x = pos[0];
+		targetVerts[i].xyz.y = pos[1];
+		targetVerts[i].xyz.z = pos[2];
+
+		// the fourth normal byte is left alone and the fourth tangent byte is the bitangent sign
+		const unsigned int normalBytes = _mm_cvtsi128_si32(bytes);
+		const unsigned int tangentBytes = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 4));
+		*(unsigned int *)targetVerts[i].normal = (normalBytes & 0x00FFFFFF) | (*(unsigned int *)targetVerts[i].normal & 0xFF000000);
+		*(unsigned int *)targetVerts[i].tangent = (tangentBytes & 0x00FFFFFF) | (*(const unsigned int *)base.tangent & 0xFF000000);
+	}
+
+#else
+
 	for(int i = 0; i < numVerts; i++)
 	{
 		const idDrawVert &base = baseVerts[i];
@@ -475,6 +561,8 @@ void TransformVertsAndTangents(idDrawVert *targetVerts, const int numVerts, cons
 		targetVerts[i].SetTangent(accum * base.GetTangent());
 		targetVerts[i].tangent[3] = base.tangent[3];
 	}
+
+#endif
 }
 
 /*
@@ -80,14 +80,14 @@ D_DrawSolidSurface
 
 // FIXME: clean this up
 
-void D_DrawSolidSurface (surf_t *surf, int color)
+void D_DrawSolidSurface (espan_t *pspan, int color)
 {
 	espan_t	*span;
 	byte	*pdest;
 	int		u, u2, pix;
 	
 	pix = (color<<24) | (color<<16) | (color<<8) | color;
-	for (span=surf->spans ; span ; span=span->pnext)
+	for (span=pspan ; span ; span=span->pnext)
 	{
 		pdest = (byte *)d_viewbuffer + screenwidth*span->v;
 		u = span->u;
@@ -166,6 +166,297 @@ void D_CalcGradients (msurface_t *pface)
 }
 
 
+/*
+=============================================================================
+
+SURFACE BATCHES
+
+D_DrawSurfaces only records what each surface needs to be drawn, the spans
+are rasterized when the batch is flushed. The flush sorts the spans of every
+recorded surface into horizontal bands of the view and draws the bands on
+r_rasterthreads threads, each with its own copy of the drawing globals.
+
+A batch is flushed at the end of D_DrawSurfaces, and early when the surface
+cache wants to free or rebuild a block that a recorded surface still
+points at.
+
+=============================================================================
+*/
+
+typedef enum
+{
+	ds_solid,
+	ds_sky,
+	ds_turb,
+	ds_spans
+} drawkind_t;
+
+typedef struct
+{
+	drawkind_t	kind;
+	int			color;			// ds_solid
+	espan_t		*spans[MAX_RASTER_BANDS];
+
+	float		zistepu, zistepv, ziorigin;
+	float		sdivzstepu, tdivzstepu, sdivzstepv, tdivzstepv;
+	float		sdivzorigin, tdivzorigin;
+	fixed16_t	sadjust, tadjust;
+	fixed16_t	bbextents, bbextentt;
+	pixel_t		*cacheblock;
+	int			cachewidth;
+} batchsurf_t;
+
+int				d_drawbatch;
+
+static batchsurf_t	*d_batchsurfs;
+static int			d_numbatchsurfs, d_maxbatchsurfs;
+
+
+/*
+==============
+D_SaveDrawState
+
+Copies the per thread drawing globals a surface is drawn with
+==============
+*/
+static void D_SaveDrawState (batchsurf_t *ds)
+{
+	ds->zistepu = d_zistepu;
+	ds->zistepv = d_zistepv;
+	ds->ziorigin = d_ziorigin;
+	ds->sdivzstepu = d_sdivzstepu;
+	ds->tdivzstepu = d_tdivzstepu;
+	ds->sdivzstepv = d_sdivzstepv;
+	ds->tdivzstepv = d_tdivzstepv;
+	ds->sdivzorigin = d_sdivzorigin;
+	ds->tdivzorigin = d_tdivzorigin;
+	ds->sadjust = sadjust;
+	ds->tadjust = tadjust;
+	ds->bbextents = bbextents;
+	ds->bbextentt = bbextentt;
+	ds->cacheblock = cacheblock;
+	ds->cachewidth = cachewidth;
+}
+
+
+/*
+==============
+D_LoadDrawState
+==============
+*/
+static void D_LoadDrawState (const batchsurf_t *ds)
+{
+	d_zistepu = ds->zistepu;
+	d_zistepv = ds->zistepv;
+	d_ziorigin = ds->ziorigin;
+	d_sdivzstepu = ds->sdivzstepu;
+	d_tdivzstepu = ds->tdivzstepu;
+	d_sdivzstepv = ds->sdivzstepv;
+	d_tdivzstepv = ds->tdivzstepv;
+	d_sdivzorigin = ds->sdivzorigin;
+	d_tdivzorigin = ds->tdivzorigin;
+	sadjust = ds->sadjust;
+	tadjust = ds->tadjust;
+	bbextents = ds->bbextents;
+	bbextentt = ds->bbextentt;
+	cacheblock = ds->cacheblock;
+	cachewidth = ds->cachewidth;
+}
+
+
+/*
+==============
+D_RecordSurface
+
+Takes a copy of the current drawing globals
+==============
+*/
+static void D_RecordSurface (drawkind_t kind, int color, espan_t *spans)
+{
+	batchsurf_t	*ds;
+
+	if (d_numbatchsurfs == d_maxbatchsurfs)
+	{
+		d_maxbatchsurfs = d_maxbatchsurfs ? d_maxbatchsurfs * 2 : 256;
+		d_batchsurfs = (batchsurf_t *)realloc (d_batchsurfs,
+				d_maxbatchsurfs * sizeof(*d_batchsurfs));
+		if (!d_batchsurfs)
+			Sys_Error ("D_RecordSurface: couldn't allocate %i surfaces",
+					d_maxbatchsurfs);
+	}
+
+	ds = &d_batchsurfs[d_numbatchsurfs++];
+	ds->kind = kind;
+	ds->color = color;
+	ds->spans[0] = spans;
+
+	D_SaveDrawState (ds);
+}
+
+
+/*
+==============
+D_RasterBands
+==============
+*/
+static int D_RasterBands (void)
+{
+#if id386
+	return 1;	// the assembly drawers use the shared globals
+#else
+	int		bands;
+
+	bands = (int)r_rasterthreads.value;
+	if (bands > MAX_RASTER_BANDS)
+		bands = MAX_RASTER_BANDS;
+	if (bands > r_refdef.vrect.height)
+		bands = r_refdef.vrect.height;
+	if (bands < 1)
+		bands = 1;
+
+	return bands;
+#endif
+}
+
+
+/*
+==============
+D_SplitSpans
+
+Sorts the span list of every recorded surface into bands of bandheight
+scan lines
+==============
+*/
+static void D_SplitSpans (int numbands, int bandheight)
+{
+	int			i, band;
+	batchsurf_t	*ds;
+	espan_t		*span, *next;
+	espan_t		*tails[MAX_RASTER_BANDS];
+
+	for (i=0, ds=d_batchsurfs ; i<d_numbatchsurfs ; i++, ds++)
+	{
+		span = ds->spans[0];
+
+		for (band=0 ; band<numbands ; band++)
+		{
+			ds->spans[band] = NULL;
+			tails[band] = NULL;
+		}
+
+		for ( ; span ; span=next)
+		{
+			next = span->pnext;
+			span->pnext = NULL;
+
+			band = (span->v - r_refdef.vrect.y) / bandheight;
+			if (band < 0)
+				band = 0;
+			else if (band >= numbands)
+				band = numbands - 1;
+
+			if (tails[band])
+				tails[band]->pnext = span;
+			else
+				ds->spans[band] = span;
+			tails[band] = span;
+		}
+	}
+}
+
+
+/*
+==============
+D_DrawBand
+==============
+*/
+static void D_DrawBand (int band)
+{
+	int			i;
+	batchsurf_t	*ds;
+	espan_t		*spans;
+
+	for (i=0, ds=d_batchsurfs ; i<d_numbatchsurfs ; i++, ds++)
+	{
+		spans = ds->spans[band];
+		if (!spans)
+			continue;
+
+		d_zistepu = ds->zistepu;
+		d_zistepv = ds->zistepv;
+		d_ziorigin = ds->ziorigin;
+
+		switch (ds->kind)
+		{
+		case ds_solid:
+			D_DrawSolidSurface (spans, ds->color);
+			break;
+
+		case ds_sky:
+			D_DrawSkyScans8 (spans);
+			break;
+
+		case ds_turb:
+		case ds_spans:
+			D_LoadDrawState (ds);
+
+			if (ds->kind == ds_turb)
+				Turbulent8 (spans);
+			else
+				(*d_drawspans) (spans);
+			break;
+		}
+
+		D_DrawZSpans (spans);
+	}
+}
+
+
+/*
+==============
+D_FlushSurfaceBatch
+==============
+*/
+void D_FlushSurfaceBatch (void)
+{
+	int			numbands;
+	vec3_t		save_vpn, save_vup, save_vright;
+	batchsurf_t	save_state;
+
+	if (d_numbatchsurfs)
+	{
+		numbands = D_RasterBands ();
+		if (numbands > 1)
+			D_SplitSpans (numbands,
+					(r_refdef.vrect.height + numbands - 1) / numbands);
+
+	// the sky is drawn from the world orientation, a flush can come in
+	// while a brush model has rotated the view
+		VectorCopy (vpn, save_vpn);
+		VectorCopy (vup, save_vup);
+		VectorCopy (vright, save_vright);
+		VectorCopy (base_vpn, vpn);
+		VectorCopy (base_vup, vup);
+		VectorCopy (base_vright, vright);
+
+	// the calling thread draws a band too, and a flush from D_CacheSurface
+	// comes in with the gradients of a surface not recorded yet
+		D_SaveDrawState (&save_state);
+
+		D_RunJobs (numbands, numbands, D_DrawBand);
+
+		D_LoadDrawState (&save_state);
+		VectorCopy (save_vpn, vpn);
+		VectorCopy (save_vup, vup);
+		VectorCopy (save_vright, vright);
+
+		d_numbatchsurfs = 0;
+	}
+
+	d_drawbatch++;
+}
+
+
 /*
 ==============
 D_DrawSurfaces
@@ -179,6 +470,8 @@ void D_DrawSurfaces (void)
 	vec3_t			world_transformed_modelorg;
 	vec3_t			local_modelorg;
 
+	D_FinishPrebuild ();
+
 	currententity = &cl_entities[0];
 	TransformVector (modelorg, transformed_modelorg);
 	VectorCopy (transformed_modelorg, world_transformed_modelorg);
@@ -196,11 +489,10 @@ void D_DrawSurfaces (void)
 			d_ziorigin = s->d_ziorigin;
 
 #ifdef __alpha__
-			D_DrawSolidSurface (s, (int)((long)s->data & 0xFF));
+			D_RecordSurface (ds_solid, (int)((long)s->data & 0xFF), s->spans);
 #else
-			D_DrawSolidSurface (s, (int)s->data & 0xFF);
+			D_RecordSurface (ds_solid, (int)s->data & 0xFF, s->spans);
 #endif
-			D_DrawZSpans (s->spans);
 		}
 	}
 	else
@@ -223,8 +515,7 @@ void D_DrawSurfaces (void)
 					R_MakeSky ();
 				}
 
-				D_DrawSkyScans8 (s->spans);
-				D_DrawZSpans (s->spans);
+				D_RecordSurface (ds_sky, 0, s->spans);
 			}
 			else if (s->flags & SURF_DRAWBACKGROUND)
 			{
@@ -234,8 +525,8 @@ void D_DrawSurfaces (void)
 				d_zistepv = 0;
 				d_ziorigin = -0.9;
 
-				D_DrawSolidSurface (s, (int)r_clearcolor.value & 0xFF);
-				D_DrawZSpans (s->spans);
+				D_RecordSurface (ds_solid, (int)r_clearcolor.value & 0xFF,
+						s->spans);
 			}
 			else if (s->flags & SURF_DRAWTURB)
 			{
@@ -262,8 +553,7 @@ void D_DrawSurfaces (void)
 
 				D_CalcGradients (pface);
 
-				Turbulent8 (s->spans);
-				D_DrawZSpans (s->spans);
+				D_RecordSurface (ds_turb, 0, s->spans);
 
 				if (s->insubmodel)
 				{
@@ -303,15 +593,14 @@ void D_DrawSurfaces (void)
 
 			// FIXME: make this passed in to D_CacheSurface
 				pcurrentcache = D_CacheSurface (pface, miplevel);
+				pcurrentcache->drawbatch = d_drawbatch;
 
 				cacheblock = (pixel_t *)pcurrentcache->data;
 				cachewidth = pcurrentcache->width;
 
 				D_CalcGradients (pface);
 
-				(*d_drawspans) (s->spans);
-
-				D_DrawZSpans (s->spans);
+				D_RecordSurface (ds_spans, 0, s->spans);
 
 				if (s->insubmodel)
 				{
@@ -332,5 +621,6 @@ void D_DrawSurfaces (void)
 			}
 		}
 	}
-}
 
+	D_FlushSurfaceBatch ();
+}
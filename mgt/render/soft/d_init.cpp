@@ -27,9 +27,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 cvar_t	d_subdiv16 = {"d_subdiv16", "1"};
 cvar_t	d_mipcap = {"d_mipcap", "0"};
 cvar_t	d_mipscale = {"d_mipscale", "1"};
+cvar_t	d_simdspans = {"d_simdspans", "1"};
+cvar_t	r_rasterthreads = {"r_rasterthreads", "0"};	// 0 or 1 draws on the main thread
+cvar_t	d_scprebuild = {"d_scprebuild", "1"};
 
-surfcache_t		*d_initial_rover;
-qboolean		d_roverwrapped;
 int				d_minmip;
 float			d_scalemip[NUM_MIPS-1];
 
@@ -37,6 +38,8 @@ static float	basemip[NUM_MIPS-1] = {1.0, 0.5*0.8, 0.25*0.8};
 
 extern int			d_aflatcolor;
 
+extern void			D_SCStats_f (void);
+
 void (*d_drawspans) (espan_t *pspan);
 
 
@@ -53,6 +56,14 @@ void D_Init (void)
 	Cvar_RegisterVariable (&d_subdiv16);
 	Cvar_RegisterVariable (&d_mipcap);
 	Cvar_RegisterVariable (&d_mipscale);
+	Cvar_RegisterVariable (&d_simdspans);
+	Cvar_RegisterVariable (&r_rasterthreads);
+	Cvar_RegisterVariable (&d_scprebuild);
+
+	Cmd_AddCommand ("surfcachestats", D_SCStats_f);
+#if D_SIMDSPANS
+	Cmd_AddCommand ("spanbench", D_SpanBench_f);
+#endif
 
 	r_drawpolys = false;
 	r_worldpolysbacktofront = false;
@@ -133,9 +144,6 @@ void D_SetupFrame (void)
 	else
 		screenwidth = vid.rowbytes;
 
-	d_roverwrapped = false;
-	d_initial_rover = sc_rover;
-
 	d_minmip = d_mipcap.value;
 	if (d_minmip > 3)
 		d_minmip = 3;
@@ -151,10 +159,17 @@ void D_SetupFrame (void)
 				else
 					d_drawspans = D_DrawSpans8;
 #else
+#if D_SIMDSPANS
+				if (d_simdspans.value)
+					d_drawspans = D_VectorDrawSpans8 ();
+				else
+#endif
 				d_drawspans = D_DrawSpans8;
 #endif
 
 	d_aflatcolor = 0;
+
+	D_PrebuildSurfaces ();
 }
 
 
@@ -0,0 +1,204 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// d_jobs.c: worker threads for the rasterization driver
+
+#include "quakedef.h"
+#include "d_local.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef struct
+{
+	std::mutex				mutex;
+	std::condition_variable	wake, done;
+} jobsync_t;
+
+// workers are started on first use and never exit, they sleep on wake
+// between runs. the sync objects are never freed, destroying them at
+// process exit would block on the sleeping workers
+static jobsync_t	*d_jobsync;
+
+static int			d_jobgeneration;
+static int			d_numworkers;		// threads started so far
+static int			d_activeworkers;	// workers taking part in the current run
+static int			d_busyworkers;		// active workers that have not finished
+
+static void			(*d_jobfunc) (int job);
+static int			d_numjobs;
+static std::atomic<int>	d_nextjob;
+
+static bool			d_jobspending;		// started and not waited for yet
+
+
+/*
+=============
+D_RunJobList
+
+Takes jobs until the list is empty, the calling thread is one of the workers
+=============
+*/
+static void D_RunJobList (void)
+{
+	int		job;
+
+	while ((job = d_nextjob.fetch_add (1)) < d_numjobs)
+		d_jobfunc (job);
+}
+
+
+/*
+=============
+D_JobWorker
+=============
+*/
+static void D_JobWorker (int index, int generation)
+{
+	std::unique_lock<std::mutex>	lock (d_jobsync->mutex);
+
+	for ( ; ; )
+	{
+		d_jobsync->wake.wait (lock, [&] { return d_jobgeneration != generation; });
+		generation = d_jobgeneration;
+
+		if (index >= d_activeworkers)
+			continue;
+
+		lock.unlock ();
+		D_RunJobList ();
+		lock.lock ();
+
+		if (--d_busyworkers == 0)
+			d_jobsync->done.notify_one ();
+	}
+}
+
+
+/*
+=============
+D_BeginJobs
+=============
+*/
+static void D_BeginJobs (int numworkers, int numjobs, void (*func) (int job))
+{
+	if (!d_jobsync)
+		d_jobsync = new jobsync_t;
+
+	{
+		std::lock_guard<std::mutex>	lock (d_jobsync->mutex);
+
+		for ( ; d_numworkers < numworkers ; d_numworkers++)
+			std::thread (D_JobWorker, d_numworkers, d_jobgeneration).detach ();
+
+		d_jobfunc = func;
+		d_numjobs = numjobs;
+		d_nextjob = 0;
+		d_activeworkers = numworkers;
+		d_busyworkers = numworkers;
+		d_jobgeneration++;
+	}
+	d_jobsync->wake.notify_all ();
+
+	d_jobspending = true;
+}
+
+
+/*
+=============
+D_WaitJobs
+
+Helps with what is left of a D_StartJobs run and returns when it is done
+=============
+*/
+void D_WaitJobs (void)
+{
+	if (!d_jobspending)
+		return;
+
+	D_RunJobList ();
+
+	std::unique_lock<std::mutex>	lock (d_jobsync->mutex);
+	d_jobsync->done.wait (lock, [] { return d_busyworkers == 0; });
+
+	d_jobspending = false;
+}
+
+
+/*
+=============
+D_StartJobs
+
+Hands the jobs to numthreads workers and returns at once, the caller has to
+D_WaitJobs before it touches anything the jobs use
+=============
+*/
+void D_StartJobs (int numthreads, int numjobs, void (*func) (int job))
+{
+	int		i;
+
+	D_WaitJobs ();
+
+	if (numthreads > numjobs)
+		numthreads = numjobs;
+	if (numthreads > MAX_RASTER_BANDS)
+		numthreads = MAX_RASTER_BANDS;
+
+	if (numthreads < 1)
+	{
+		for (i=0 ; i<numjobs ; i++)
+			func (i);
+		return;
+	}
+
+	D_BeginJobs (numthreads, numjobs, func);
+}
+
+
+/*
+=============
+D_RunJobs
+
+Calls func for every job in [0, numjobs) on up to numthreads threads, the
+calling thread included, and returns when all of them are done
+=============
+*/
+void D_RunJobs (int numthreads, int numjobs, void (*func) (int job))
+{
+	int		i;
+
+	D_WaitJobs ();
+
+	if (numthreads > numjobs)
+		numthreads = numjobs;
+	if (numthreads > MAX_RASTER_BANDS)
+		numthreads = MAX_RASTER_BANDS;
+
+	if (numthreads <= 1)
+	{
+		for (i=0 ; i<numjobs ; i++)
+			func (i);
+		return;
+	}
+
+	D_BeginJobs (numthreads - 1, numjobs, func);
+	D_WaitJobs ();
+}
@@ -0,0 +1,492 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// d_scansse.c: SSE2/AVX2 replacement for the C D_DrawSpans8, stands in for
+// the i386 assembly span drawer on 64 bit builds
+
+#include "quakedef.h"
+#include "d_local.h"
+
+#if D_SIMDSPANS
+
+#include <string.h>
+#include <emmintrin.h>
+#if D_AVX2SPANS
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// the AVX2 drawer is built into every binary and picked at run time, so
+// only its own functions may use the wider instructions
+#if D_AVX2SPANS && defined(__GNUC__)
+#define D_AVX2FUNC	__attribute__((target("avx2")))
+#define D_INLINE	inline __attribute__((always_inline))
+#elif D_AVX2SPANS
+#define D_AVX2FUNC
+#define D_INLINE	__forceinline
+#else
+#define D_INLINE	inline
+#endif
+
+/*
+=============
+D_ClampSpanEnds
+
+Same clamping as D_DrawSpans8 does on the far end of a subdivision, for
+four ends at once. SSE2 has no 32 bit min/max, so select by compare masks
+=============
+*/
+static inline __m128i D_ClampSpanEnds (__m128i v, __m128i hi, __m128i lo)
+{
+	__m128i		mask;
+
+	mask = _mm_cmpgt_epi32 (v, hi);
+	v = _mm_or_si128 (_mm_and_si128 (mask, hi), _mm_andnot_si128 (mask, v));
+	mask = _mm_cmplt_epi32 (v, lo);
+	v = _mm_or_si128 (_mm_and_si128 (mask, lo), _mm_andnot_si128 (mask, v));
+
+	return v;
+}
+
+
+#if D_AVX2SPANS
+/*
+=============
+D_DrawSpan8PixelsAVX2
+
+Draws 8 texels stepping s and t, the texel offsets of all 8 pixels are
+worked out in one register and fetched with a gather
+=============
+*/
+static D_AVX2FUNC inline void D_DrawSpan8PixelsAVX2 (unsigned char *pdest, unsigned char *pbase,
+		fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep, int cachewidth)
+{
+	const __m256i	ramp = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i	lowbytes = _mm256_setr_epi8 (
+			0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	__m256i		vs, vt, offs, texels;
+	__m128i		lo, hi;
+
+	vs = _mm256_add_epi32 (_mm256_set1_epi32 (s),
+			_mm256_mullo_epi32 (_mm256_set1_epi32 (sstep), ramp));
+	vt = _mm256_add_epi32 (_mm256_set1_epi32 (t),
+			_mm256_mullo_epi32 (_mm256_set1_epi32 (tstep), ramp));
+
+	offs = _mm256_add_epi32 (_mm256_srai_epi32 (vs, 16),
+			_mm256_mullo_epi32 (_mm256_srai_epi32 (vt, 16),
+			_mm256_set1_epi32 (cachewidth)));
+
+// each gather reads a dword, at most 3 bytes past the last texel, which is
+// still inside the surface cache (blocks are dword padded, and the guard
+// bytes follow the last one)
+	texels = _mm256_i32gather_epi32 ((const int *)pbase, offs, 1);
+	texels = _mm256_shuffle_epi8 (texels, lowbytes);
+
+	lo = _mm256_castsi256_si128 (texels);
+	hi = _mm256_extracti128_si256 (texels, 1);
+	_mm_storel_epi64 ((__m128i *)pdest, _mm_unpacklo_epi32 (lo, hi));
+}
+#endif
+
+
+/*
+=============
+D_DrawSpan8PixelsSSE2
+
+Draws 8 texels stepping s and t, the texel offsets are worked out four at
+a time and pulled out of the registers one by one
+=============
+*/
+static inline void D_DrawSpan8PixelsSSE2 (unsigned char *pdest, unsigned char *pbase,
+		fixed16_t s, fixed16_t t, fixed16_t sstep, fixed16_t tstep, int cachewidth)
+{
+	__m128i		vs0, vs1, vt0, vt1, width;
+	__m128i		offs0, offs1;
+	unsigned char	pix[8];
+
+	vs0 = _mm_setr_epi32 (s, s + sstep, s + sstep*2, s + sstep*3);
+	vt0 = _mm_setr_epi32 (t, t + tstep, t + tstep*2, t + tstep*3);
+	vs1 = _mm_add_epi32 (vs0, _mm_set1_epi32 (sstep*4));
+	vt1 = _mm_add_epi32 (vt0, _mm_set1_epi32 (tstep*4));
+
+// t>>16 and cachewidth are both below 0x8000 (surface extents are capped
+// at 256), so the 16 bit multiply-add gives the full product
+	width = _mm_set1_epi32 (cachewidth);
+	offs0 = _mm_add_epi32 (_mm_srai_epi32 (vs0, 16),
+			_mm_madd_epi16 (_mm_srai_epi32 (vt0, 16), width));
+	offs1 = _mm_add_epi32 (_mm_srai_epi32 (vs1, 16),
+			_mm_madd_epi16 (_mm_srai_epi32 (vt1, 16), width));
+
+// the offsets fit in 16 bits, so they can be pulled straight out of the
+// registers
+	pix[0] = pbase[_mm_extract_epi16 (offs0, 0)];
+	pix[1] = pbase[_mm_extract_epi16 (offs0, 2)];
+	pix[2] = pbase[_mm_extract_epi16 (offs0, 4)];
+	pix[3] = pbase[_mm_extract_epi16 (offs0, 6)];
+	pix[4] = pbase[_mm_extract_epi16 (offs1, 0)];
+	pix[5] = pbase[_mm_extract_epi16 (offs1, 2)];
+	pix[6] = pbase[_mm_extract_epi16 (offs1, 4)];
+	pix[7] = pbase[_mm_extract_epi16 (offs1, 6)];
+	memcpy (pdest, pix, 8);
+}
+
+
+/*
+=============
+D_DrawSpans8Vector
+
+Works like D_DrawSpans8, but the perspective correct s and t at the far end
+of each 8 pixel subdivision are solved four subdivisions at a time. Inlined
+into one entry point per instruction set
+=============
+*/
+static D_INLINE void D_DrawSpans8Vector (espan_t *pspan, qboolean avx2)
+{
+	int				count, spancount, numchunks, chunk, i;
+	unsigned char	*pbase, *pdest;
+	fixed16_t		s, t, sstep, tstep;
+	float			sdivz, tdivz, zi, z, du, dv;
+	float			sdivzstepu, tdivzstepu, zistepu;
+	int				width;
+	__m128			ends, vsdivz, vtdivz, vzi, vz;
+	__m128i			vsnext, vtnext;
+	__m128i			sadj, tadj, smax, tmax, minstep;
+	alignas(16) int	snext[4], tnext[4];
+
+	pbase = (unsigned char *)cacheblock;
+	width = cachewidth;
+
+// the drawing globals are per thread, keep them in registers
+	sdivzstepu = d_sdivzstepu;
+	tdivzstepu = d_tdivzstepu;
+	zistepu = d_zistepu;
+
+	sadj = _mm_set1_epi32 (sadjust);
+	tadj = _mm_set1_epi32 (tadjust);
+	smax = _mm_set1_epi32 (bbextents);
+	tmax = _mm_set1_epi32 (bbextentt);
+	minstep = _mm_set1_epi32 (8);	// see D_DrawSpans8 for the round-off guard
+
+	do
+	{
+		pdest = (unsigned char *)((byte *)d_viewbuffer +
+				(screenwidth * pspan->v) + pspan->u);
+
+		count = pspan->count;
+
+	// calculate the initial s/z, t/z, 1/z, s, and t and clamp
+		du = (float)pspan->u;
+		dv = (float)pspan->v;
+
+		sdivz = d_sdivzorigin + dv*d_sdivzstepv + du*sdivzstepu;
+		tdivz = d_tdivzorigin + dv*d_tdivzstepv + du*tdivzstepu;
+		zi = d_ziorigin + dv*d_zistepv + du*zistepu;
+		z = (float)0x10000 / zi;	// prescale to 16.16 fixed-point
+
+		s = (int)(sdivz * z) + sadjust;
+		if (s > bbextents)
+			s = bbextents;
+		else if (s < 0)
+			s = 0;
+
+		t = (int)(tdivz * z) + tadjust;
+		if (t > bbextentt)
+			t = bbextentt;
+		else if (t < 0)
+			t = 0;
+
+		numchunks = (count + 7) >> 3;
+
+		for (chunk=0 ; chunk<numchunks ; chunk+=4)
+		{
+		// far ends are 8 pixels apart, except the last one which is the
+		// last pixel of the span so we can't step off the polygon
+			ends = _mm_min_ps (_mm_setr_ps ((float)(chunk*8 + 8),
+					(float)(chunk*8 + 16), (float)(chunk*8 + 24),
+					(float)(chunk*8 + 32)), _mm_set1_ps ((float)(count - 1)));
+
+			vsdivz = _mm_add_ps (_mm_set1_ps (sdivz),
+					_mm_mul_ps (ends, _mm_set1_ps (sdivzstepu)));
+			vtdivz = _mm_add_ps (_mm_set1_ps (tdivz),
+					_mm_mul_ps (ends, _mm_set1_ps (tdivzstepu)));
+			vzi = _mm_add_ps (_mm_set1_ps (zi),
+					_mm_mul_ps (ends, _mm_set1_ps (zistepu)));
+			vz = _mm_div_ps (_mm_set1_ps ((float)0x10000), vzi);
+
+			vsnext = _mm_add_epi32 (_mm_cvttps_epi32 (_mm_mul_ps (vsdivz, vz)), sadj);
+			vtnext = _mm_add_epi32 (_mm_cvttps_epi32 (_mm_mul_ps (vtdivz, vz)), tadj);
+
+			_mm_store_si128 ((__m128i *)snext, D_ClampSpanEnds (vsnext, smax, minstep));
+			_mm_store_si128 ((__m128i *)tnext, D_ClampSpanEnds (vtnext, tmax, minstep));
+
+			for (i=0 ; i<4 && chunk+i<numchunks ; i++)
+			{
+				if (chunk+i < numchunks-1)
+				{
+					spancount = 8;
+					sstep = (snext[i] - s) >> 3;
+					tstep = (tnext[i] - t) >> 3;
+				}
+				else
+				{
+				// biasing steps low so we don't run off the texture
+					spancount = count - ((numchunks-1) << 3);
+					sstep = 0;
+					tstep = 0;
+					if (spancount > 1)
+					{
+						sstep = (snext[i] - s) / (spancount - 1);
+						tstep = (tnext[i] - t) / (spancount - 1);
+					}
+				}
+
+				if (spancount == 8)
+				{
+#if D_AVX2SPANS
+					if (avx2)
+						D_DrawSpan8PixelsAVX2 (pdest, pbase, s, t, sstep, tstep, width);
+					else
+#endif
+					D_DrawSpan8PixelsSSE2 (pdest, pbase, s, t, sstep, tstep, width);
+					pdest += 8;
+				}
+				else
+				{
+					do
+					{
+						*pdest++ = *(pbase + (s >> 16) + (t >> 16) * width);
+						s += sstep;
+						t += tstep;
+					} while (--spancount > 0);
+				}
+
+				s = snext[i];
+				t = tnext[i];
+			}
+		}
+
+	} while ((pspan = pspan->pnext) != NULL);
+}
+
+
+/*
+=============
+D_DrawSpans8SSE
+=============
+*/
+void D_DrawSpans8SSE (espan_t *pspan)
+{
+	D_DrawSpans8Vector (pspan, false);
+}
+
+
+#if D_AVX2SPANS
+/*
+=============
+D_DrawSpans8AVX2
+=============
+*/
+D_AVX2FUNC void D_DrawSpans8AVX2 (espan_t *pspan)
+{
+	D_DrawSpans8Vector (pspan, true);
+}
+
+
+/*
+=============
+D_CPUHasAVX2
+
+The OS has to save the ymm registers as well, which cpuid alone doesn't say
+=============
+*/
+static qboolean D_CPUHasAVX2 (void)
+{
+#ifdef __GNUC__
+	__builtin_cpu_init ();
+	return __builtin_cpu_supports ("avx2") ? true : false;
+#else
+	int		regs[4];
+
+	__cpuid (regs, 0);
+	if (regs[0] < 7)
+		return false;
+	__cpuid (regs, 1);
+	if ((regs[2] & (1<<27|1<<28)) != (1<<27|1<<28))	// osxsave, avx
+		return false;
+	if ((_xgetbv (0) & 6) != 6)						// xmm and ymm state
+		return false;
+	__cpuidex (regs, 7, 0);
+	return (regs[1] & (1<<5)) ? true : false;
+#endif
+}
+#endif
+
+
+/*
+=============
+D_VectorDrawSpans8
+
+The fastest span drawer this cpu can run
+=============
+*/
+void (*D_VectorDrawSpans8 (void)) (espan_t *pspan)
+{
+#if D_AVX2SPANS
+	static int	hasavx2 = -1;
+
+	if (hasavx2 < 0)
+		hasavx2 = D_CPUHasAVX2 ();
+	if (hasavx2)
+		return D_DrawSpans8AVX2;
+#endif
+	return D_DrawSpans8SSE;
+}
+
+
+/*
+=============================================================================
+
+SPAN BENCHMARK
+
+=============================================================================
+*/
+
+#define	SPANBENCH_WIDTH		320
+#define	SPANBENCH_HEIGHT	240
+#define	SPANBENCH_SURFACES	400
+
+static float D_SpanBenchRandom (unsigned *seed, float lo, float hi)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return lo + (hi - lo) * ((*seed >> 8) & 0xffff) / (float)0xffff;
+}
+
+/*
+=============
+D_SpanBench_f
+
+Draws the same random surfaces with the C drawer and the vector ones and
+reports the time taken and the pixels that came out different
+=============
+*/
+void D_SpanBench_f (void)
+{
+	static byte		texture[256*256 + 4];	// dword guard, as in the cache
+	static byte		output[3][SPANBENCH_WIDTH*SPANBENCH_HEIGHT];
+	static espan_t	spans[SPANBENCH_HEIGHT];
+	void			(*drawers[3]) (espan_t *pspan);
+	const char		*names[3];
+	double			times[3], start;
+	int				diffs[3];
+	int				numdrawers, numpixels, surf, d, i, v, w, h;
+	unsigned		seed;
+	pixel_t			*oldviewbuffer;
+	int				oldscreenwidth;
+
+	drawers[0] = D_DrawSpans8;
+	names[0] = "C";
+	drawers[1] = D_DrawSpans8SSE;
+	names[1] = "SSE2";
+	numdrawers = 2;
+#if D_AVX2SPANS
+	if (D_VectorDrawSpans8 () == D_DrawSpans8AVX2)
+	{
+		drawers[2] = D_DrawSpans8AVX2;
+		names[2] = "AVX2";
+		numdrawers = 3;
+	}
+#endif
+
+	oldviewbuffer = d_viewbuffer;
+	oldscreenwidth = screenwidth;
+	screenwidth = SPANBENCH_WIDTH;
+
+	for (d=0 ; d<numdrawers ; d++)
+		times[d] = diffs[d] = 0;
+	numpixels = 0;
+	seed = 0x1234567;
+
+	for (surf=0 ; surf<SPANBENCH_SURFACES ; surf++)
+	{
+	// a random surface block seen at a random slant, z between 1 and 10
+		w = 16 << (surf % 5);
+		h = 16 << ((surf / 5) % 5);
+		for (i=0 ; i<w*h + 4 ; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			texture[i] = seed >> 16;
+		}
+
+		cacheblock = texture;
+		cachewidth = w;
+		bbextents = (w << 16) - 1;
+		bbextentt = (h << 16) - 1;
+
+		d_ziorigin = D_SpanBenchRandom (&seed, 0.1f, 1.0f);
+		d_zistepu = D_SpanBenchRandom (&seed, -0.0005f, 0.0005f);
+		d_zistepv = D_SpanBenchRandom (&seed, -0.0005f, 0.0005f);
+		d_sdivzorigin = D_SpanBenchRandom (&seed, -50, 50) * d_ziorigin;
+		d_sdivzstepu = D_SpanBenchRandom (&seed, -0.3f, 0.3f);
+		d_sdivzstepv = D_SpanBenchRandom (&seed, -0.3f, 0.3f);
+		d_tdivzorigin = D_SpanBenchRandom (&seed, -50, 50) * d_ziorigin;
+		d_tdivzstepu = D_SpanBenchRandom (&seed, -0.3f, 0.3f);
+		d_tdivzstepv = D_SpanBenchRandom (&seed, -0.3f, 0.3f);
+		sadjust = (int)D_SpanBenchRandom (&seed, 0, (float)bbextents);
+		tadjust = (int)D_SpanBenchRandom (&seed, 0, (float)bbextentt);
+
+	// one span of random extent on every line
+		for (v=0 ; v<SPANBENCH_HEIGHT ; v++)
+		{
+			seed = seed * 1103515245 + 12345;
+			spans[v].u = (seed >> 16) % SPANBENCH_WIDTH;
+			seed = seed * 1103515245 + 12345;
+			spans[v].count = 1 + (seed >> 16) % (SPANBENCH_WIDTH - spans[v].u);
+			spans[v].v = v;
+			spans[v].pnext = v < SPANBENCH_HEIGHT-1 ? &spans[v+1] : NULL;
+			numpixels += spans[v].count;
+		}
+
+		for (d=0 ; d<numdrawers ; d++)
+		{
+			d_viewbuffer = output[d];
+			start = Sys_FloatTime ();
+			drawers[d] (spans);
+			times[d] += Sys_FloatTime () - start;
+		}
+
+		for (v=0 ; v<SPANBENCH_HEIGHT ; v++)
+			for (i=spans[v].u ; i<spans[v].u + spans[v].count ; i++)
+				for (d=1 ; d<numdrawers ; d++)
+					if (output[d][v*SPANBENCH_WIDTH + i] != output[0][v*SPANBENCH_WIDTH + i])
+						diffs[d]++;
+	}
+
+	d_viewbuffer = oldviewbuffer;
+	screenwidth = oldscreenwidth;
+
+	Con_Printf ("C %.2f ms for %i pixels\n", times[0]*1000, numpixels);
+	for (d=1 ; d<numdrawers ; d++)
+		Con_Printf ("%s %.2f ms (%.2fx), %i pixels differ\n",
+				names[d], times[d]*1000, times[0]/times[d], diffs[d]);
+}
+
+#endif	// D_SIMDSPANS
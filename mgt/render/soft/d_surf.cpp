@@ -23,14 +23,68 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "d_local.h"
 #include "r_local.h"
 
+#include <stddef.h>
+#include <atomic>
+
 float           surfscale;
 qboolean        r_cache_thrash;         // set if surface cache is thrashing
 
 int                                     sc_size;
-surfcache_t                     *sc_rover, *sc_base;
+surfcache_t                     *sc_base;
 
 #define GUARDSIZE       4
 
+#define SC_MINBLOCK     64
+#define SC_MAXCLASSES   32
+
+// blocks of one size class, the lru list runs from most to least recently
+// used
+typedef struct
+{
+	int             size;
+	surfcache_t     lru;
+	surfcache_t     free;
+} scclass_t;
+
+typedef struct
+{
+	int             sizeclass;              // -1 while not carved
+	int             lastframe;              // newest lastframe of its blocks
+} scslab_t;
+
+typedef struct
+{
+	int             hits;
+	int             misses;                 // no block, allocated one
+	int             rebuilds;               // block was stale and relit
+	int             evictions;
+	int             steals;                 // slabs taken from another class
+	int             frames;
+	std::atomic<int>        prebuilds;
+} scstats_t;
+
+// a surface used last frame, the prebuild jobs relight them for the next
+typedef struct
+{
+	surfcache_t     *cache;
+	msurface_t      *surface;
+	int             miplevel;
+} scuse_t;
+
+static scclass_t        sc_classes[SC_MAXCLASSES];
+static int              sc_numclasses;
+
+static scslab_t         sc_slabs[SURFCACHE_MAX_SLABS];
+static int              sc_numslabs;
+
+static scstats_t        sc_stats;
+
+static scuse_t          *sc_used, *sc_prebuild;
+static int              sc_numused, sc_maxused;
+static int              sc_numprebuild, sc_maxprebuild;
+
+#define SC_PREBUILD_BATCH       16      // surfaces per prebuild job
+
 
 int     D_SurfaceCacheForRes (int width, int height)
 {
@@ -39,15 +93,19 @@ int     D_SurfaceCacheForRes (int width, int height)
 	if (COM_CheckParm ("-surfcachesize"))
 	{
 		size = Q_atoi(com_argv[COM_CheckParm("-surfcachesize")+1]) * 1024;
-		return size;
 	}
-	
-	size = SURFCACHE_SIZE_AT_320X200;
+	else
+	{
+		size = SURFCACHE_SIZE_AT_320X200;
 
-	pix = width*height;
-	if (pix > 64000)
-		size += (pix-64000)*3;
-		
+		pix = width*height;
+		if (pix > 64000)
+			size += (pix-64000)*3;
+	}
+
+// every size class in use needs a slab of its own
+	if (size < SURFCACHE_MIN_SLABS * SURFCACHE_SLAB_SIZE + GUARDSIZE)
+		size = SURFCACHE_MIN_SLABS * SURFCACHE_SLAB_SIZE + GUARDSIZE;
 
 	return size;
 }
@@ -74,6 +132,66 @@ void D_ClearCacheGuard (void)
 }
 
 
+/*
+=================
+D_SCUnlink / D_SCLink
+=================
+*/
+static void D_SCUnlink (surfcache_t *c)
+{
+	c->prev->next = c->next;
+	c->next->prev = c->prev;
+}
+
+static void D_SCLink (surfcache_t *head, surfcache_t *c)
+{
+	c->next = head->next;
+	c->prev = head;
+	head->next->prev = c;
+	head->next = c;
+}
+
+
+/*
+================
+D_SCResetClasses
+
+Forgets every block, all slabs are free to be carved again
+================
+*/
+static void D_SCResetClasses (void)
+{
+	int             i, size;
+	scclass_t       *cls;
+
+// power of two sizes with a step half way between them, the largest class
+// fits a 256*256 surface
+	sc_numclasses = 0;
+	for (size = SC_MINBLOCK ; ; size <<= 1)
+	{
+		sc_classes[sc_numclasses++].size = size;
+		if (size >= SURFCACHE_SLAB_SIZE)
+			break;
+		sc_classes[sc_numclasses++].size = size + (size >> 1);
+	}
+
+	for (i=0, cls=sc_classes ; i<sc_numclasses ; i++, cls++)
+	{
+		cls->lru.next = cls->lru.prev = &cls->lru;
+		cls->free.next = cls->free.prev = &cls->free;
+	}
+
+	for (i=0 ; i<sc_numslabs ; i++)
+	{
+		sc_slabs[i].sizeclass = -1;
+		sc_slabs[i].lastframe = 0;
+	}
+
+	sc_numused = 0;
+	sc_numprebuild = 0;
+}
+
+
 /*
 ================
 D_InitCaches
@@ -82,17 +200,22 @@ D_InitCaches
 */
 void D_InitCaches (void *buffer, int size)
 {
+	D_FinishPrebuild ();
+
 	if (!msg_suppress_1)
 		Con_Printf ("%ik surface cache\n", size/1024);
 
 	sc_size = size - GUARDSIZE;
 	sc_base = (surfcache_t *)buffer;
-	sc_rover = sc_base;
-	
-	sc_base->next = NULL;
-	sc_base->owner = NULL;
-	sc_base->size = sc_size;
-	
+
+	sc_numslabs = sc_size / SURFCACHE_SLAB_SIZE;
+	if (sc_numslabs > SURFCACHE_MAX_SLABS)
+		sc_numslabs = SURFCACHE_MAX_SLABS;
+	if (!sc_numslabs)
+		Sys_Error ("D_InitCaches: %i is smaller than a slab", size);
+
+	D_SCResetClasses ();
+
 	D_ClearCacheGuard ();
 }
 
@@ -104,111 +227,257 @@ D_FlushCaches
 */
 void D_FlushCaches (void)
 {
+	int             i;
 	surfcache_t     *c;
+	scclass_t       *cls;
 	
 	if (!sc_base)
 		return;
 
-	for (c = sc_base ; c ; c = c->next)
+	D_FinishPrebuild ();
+
+	for (i=0, cls=sc_classes ; i<sc_numclasses ; i++, cls++)
 	{
-		if (c->owner)
-			*c->owner = NULL;
+		for (c = cls->lru.next ; c != &cls->lru ; c = c->next)
+		{
+			if (c->owner)
+				*c->owner = NULL;
+		}
 	}
-	
-	sc_rover = sc_base;
-	sc_base->next = NULL;
-	sc_base->owner = NULL;
-	sc_base->size = sc_size;
+
+	D_SCResetClasses ();
 }
 
+
 /*
 =================
-D_SCAlloc
+D_SCEvict
+
+Frees a block, spans recorded from it have to be drawn before it goes away
 =================
 */
-surfcache_t     *D_SCAlloc (int width, int size)
+static void D_SCEvict (surfcache_t *c)
 {
-	surfcache_t             *new;
-	qboolean                wrapped_this_time;
+	if (c->owner)
+	{
+		if (c->drawbatch == d_drawbatch)
+			D_FlushSurfaceBatch ();
+		*c->owner = NULL;
+		c->owner = NULL;
 
-	if ((width < 0) || (width > 256))
-		Sys_Error ("D_SCAlloc: bad cache width %d\n", width);
+		if (c->lastframe == r_framecount)
+			r_cache_thrash = true;
+		sc_stats.evictions++;
+	}
 
-	if ((size <= 0) || (size > 0x10000))
-		Sys_Error ("D_SCAlloc: bad cache size %d\n", size);
-	
-#ifdef __alpha__
-	size = (int)((long)&((surfcache_t *)0)->data[size]);
-#else
-	size = (int)&((surfcache_t *)0)->data[size];
-#endif
-	size = (size + 3) & ~3;
-	if (size > sc_size)
-		Sys_Error ("D_SCAlloc: %i > cache size",size);
+	D_SCUnlink (c);
+	D_SCLink (&sc_classes[sc_slabs[c->slab].sizeclass].free, c);
+}
 
-// if there is not size bytes after the rover, reset to the start
-	wrapped_this_time = false;
 
-	if ( !sc_rover || (byte *)sc_rover - (byte *)sc_base > sc_size - size)
+/*
+=================
+D_SCCarveSlab
+=================
+*/
+static void D_SCCarveSlab (int slab, int sizeclass)
+{
+	int             i, size, count;
+	byte            *base;
+	surfcache_t     *c;
+
+	size = sc_classes[sizeclass].size;
+	count = SURFCACHE_SLAB_SIZE / size;
+	base = (byte *)sc_base + slab*SURFCACHE_SLAB_SIZE;
+
+	sc_slabs[slab].sizeclass = sizeclass;
+
+	for (i=0 ; i<count ; i++)
 	{
-		if (sc_rover)
+		c = (surfcache_t *)(base + i*size);
+		c->owner = NULL;
+		c->size = size;
+		c->slab = slab;
+		c->width = 0;
+		c->drawbatch = -1;
+		c->lastframe = 0;
+		D_SCLink (&sc_classes[sizeclass].free, c);
+	}
+}
+
+
+/*
+=================
+D_SCStealSlab
+
+Evicts every block of a slab that belongs to another class
+=================
+*/
+static void D_SCStealSlab (int slab)
+{
+	int             i, size, count;
+	byte            *base;
+	surfcache_t     *c;
+
+	size = sc_classes[sc_slabs[slab].sizeclass].size;
+	count = SURFCACHE_SLAB_SIZE / size;
+	base = (byte *)sc_base + slab*SURFCACHE_SLAB_SIZE;
+
+	if (sc_slabs[slab].lastframe == r_framecount)
+		r_cache_thrash = true;
+
+	for (i=0 ; i<count ; i++)
+	{
+		c = (surfcache_t *)(base + i*size);
+		if (c->owner)
 		{
-			wrapped_this_time = true;
+			if (c->drawbatch == d_drawbatch)
+				D_FlushSurfaceBatch ();
+			*c->owner = NULL;
+			c->owner = NULL;
+			sc_stats.evictions++;
 		}
-		sc_rover = sc_base;
+		D_SCUnlink (c);
 	}
-		
-// colect and free surfcache_t blocks until the rover block is large enough
-	new = sc_rover;
-	if (sc_rover->owner)
-		*sc_rover->owner = NULL;
-	
-	while (new->size < size)
+
+	sc_slabs[slab].sizeclass = -1;
+	sc_stats.steals++;
+}
+
+
+/*
+=================
+D_SCRefill
+
+Makes a free block for the class: from a slab nobody uses, else by evicting
+whichever was used least recently, the class' own oldest block or a whole
+slab of another class
+=================
+*/
+static void D_SCRefill (int sizeclass)
+{
+	int             i, oldest;
+	scclass_t       *cls;
+	surfcache_t     *tail;
+
+	for (i=0 ; i<sc_numslabs ; i++)
+	{
+		if (sc_slabs[i].sizeclass == -1)
+		{
+			D_SCCarveSlab (i, sizeclass);
+			return;
+		}
+	}
+
+	oldest = -1;
+	for (i=0 ; i<sc_numslabs ; i++)
 	{
-	// free another
-		sc_rover = sc_rover->next;
-		if (!sc_rover)
-			Sys_Error ("D_SCAlloc: hit the end of memory");
-		if (sc_rover->owner)
-			*sc_rover->owner = NULL;
-			
-		new->size += sc_rover->size;
-		new->next = sc_rover->next;
+		if (sc_slabs[i].sizeclass == sizeclass)
+			continue;
+		if (oldest == -1 || sc_slabs[i].lastframe < sc_slabs[oldest].lastframe)
+			oldest = i;
 	}
 
-// create a fragment out of any leftovers
-	if (new->size - size > 256)
+	cls = &sc_classes[sizeclass];
+	tail = cls->lru.prev;
+	if (tail == &cls->lru)
+		tail = NULL;
+
+	if (tail && (oldest == -1 || tail->lastframe <= sc_slabs[oldest].lastframe))
 	{
-		sc_rover = (surfcache_t *)( (byte *)new + size);
-		sc_rover->size = new->size - size;
-		sc_rover->next = new->next;
-		sc_rover->width = 0;
-		sc_rover->owner = NULL;
-		new->next = sc_rover;
-		new->size = size;
+		D_SCEvict (tail);
+		return;
 	}
-	else
-		sc_rover = new->next;
+
+	if (oldest == -1)
+		Sys_Error ("D_SCAlloc: surface cache too small");
+
+	D_SCStealSlab (oldest);
+	D_SCCarveSlab (oldest, sizeclass);
+}
+
+
+/*
+=================
+D_SCAlloc
+=================
+*/
+surfcache_t     *D_SCAlloc (int width, int size)
+{
+	surfcache_t             *block;
+	scclass_t               *cls;
+	int                     sizeclass;
+
+	if ((width < 0) || (width > 256))
+		Sys_Error ("D_SCAlloc: bad cache width %d\n", width);
+
+	if ((size <= 0) || (size > 0x10000))
+		Sys_Error ("D_SCAlloc: bad cache size %d\n", size);
 	
-	new->width = width;
+	size += (int)offsetof(surfcache_t, data);
+
+	for (sizeclass=0 ; sizeclass<sc_numclasses ; sizeclass++)
+		if (sc_classes[sizeclass].size >= size)
+			break;
+	if (sizeclass == sc_numclasses)
+		Sys_Error ("D_SCAlloc: %i > slab size", size);
+
+	cls = &sc_classes[sizeclass];
+	if (cls->free.next == &cls->free)
+		D_SCRefill (sizeclass);
+
+	block = cls->free.next;
+	D_SCUnlink (block);
+	D_SCLink (&cls->lru, block);
+
+	block->width = width;
 // DEBUG
 	if (width > 0)
-		new->height = (size - sizeof(*new) + sizeof(new->data)) / width;
+		block->height = (size - sizeof(*block) + sizeof(block->data)) / width;
+
+	block->owner = NULL;              // should be set properly after return
+	block->drawbatch = -1;
+	block->lastframe = 0;
+
+D_CheckCacheGuard ();   // DEBUG
+	return block;
+}
 
-	new->owner = NULL;              // should be set properly after return
 
-	if (d_roverwrapped)
+/*
+=================
+D_SCTouch
+
+Moves the block to the front of its lru list, and remembers the surface so
+it can be prebuilt next frame
+=================
+*/
+static void D_SCTouch (surfcache_t *c, msurface_t *surface, int miplevel)
+{
+	scuse_t         *use;
+
+	if (c->lastframe != r_framecount)
 	{
-		if (wrapped_this_time || (sc_rover >= d_initial_rover))
-			r_cache_thrash = true;
-	}
-	else if (wrapped_this_time)
-	{       
-		d_roverwrapped = true;
+		c->lastframe = r_framecount;
+
+		if (sc_numused == sc_maxused)
+		{
+			sc_maxused = sc_maxused ? sc_maxused * 2 : 1024;
+			sc_used = (scuse_t *)realloc (sc_used, sc_maxused * sizeof(*sc_used));
+			if (!sc_used)
+				Sys_Error ("D_SCTouch: couldn't allocate %i uses", sc_maxused);
+		}
+
+		use = &sc_used[sc_numused++];
+		use->cache = c;
+		use->surface = surface;
+		use->miplevel = miplevel;
 	}
 
-D_CheckCacheGuard ();   // DEBUG
-	return new;
+	sc_slabs[c->slab].lastframe = r_framecount;
+
+	D_SCUnlink (c);
+	D_SCLink (&sc_classes[sc_slabs[c->slab].sizeclass].lru, c);
 }
 
 
@@ -219,16 +488,64 @@ D_SCDump
 */
 void D_SCDump (void)
 {
-	surfcache_t             *test;
+	int             i, j, used, blocks;
+	surfcache_t     *c;
 
-	for (test = sc_base ; test ; test = test->next)
+	for (i=0 ; i<sc_numclasses ; i++)
 	{
-		if (test == sc_rover)
-			Sys_Printf ("ROVER:\n");
-		printf ("%p : %i bytes     %i width\n",test, test->size, test->width);
+		used = 0;
+		for (c = sc_classes[i].lru.next ; c != &sc_classes[i].lru ; c = c->next)
+			used++;
+
+		blocks = 0;
+		for (j=0 ; j<sc_numslabs ; j++)
+			if (sc_slabs[j].sizeclass == i)
+				blocks += SURFCACHE_SLAB_SIZE / sc_classes[i].size;
+
+		if (blocks)
+			Sys_Printf ("%6i bytes : %4i of %4i blocks used\n",
+					sc_classes[i].size, used, blocks);
 	}
 }
 
+
+/*
+=================
+D_SCStats_f
+
+Prints the surface cache counters gathered since the last call
+=================
+*/
+void D_SCStats_f (void)
+{
+	int             i, carved;
+	int             frames;
+
+	frames = sc_stats.frames ? sc_stats.frames : 1;
+
+	carved = 0;
+	for (i=0 ; i<sc_numslabs ; i++)
+		if (sc_slabs[i].sizeclass != -1)
+			carved++;
+
+	Con_Printf ("%i frames, per frame:\n", sc_stats.frames);
+	Con_Printf ("%6.1f hits %6.1f misses %6.1f rebuilds %6.1f prebuilds\n",
+			(float)sc_stats.hits / frames, (float)sc_stats.misses / frames,
+			(float)sc_stats.rebuilds / frames,
+			(float)sc_stats.prebuilds / frames);
+	Con_Printf ("%6.1f evictions %6.1f slab steals\n",
+			(float)sc_stats.evictions / frames, (float)sc_stats.steals / frames);
+	Con_Printf ("%i of %i slabs carved\n", carved, sc_numslabs);
+
+	sc_stats.hits = 0;
+	sc_stats.misses = 0;
+	sc_stats.rebuilds = 0;
+	sc_stats.evictions = 0;
+	sc_stats.steals = 0;
+	sc_stats.frames = 0;
+	sc_stats.prebuilds = 0;
+}
+
 //=============================================================================
 
 // if the num is not a power of 2, assume it will not repeat
@@ -259,6 +576,64 @@ int D_log2 (int num)
 
 //=============================================================================
 
+/*
+================
+D_SCValid
+
+True if the block still holds the surface as it has to look this frame
+================
+*/
+static qboolean D_SCValid (surfcache_t *cache, msurface_t *surface,
+		texture_t *texture, int *lightadj)
+{
+	if (cache->texture != texture
+			|| cache->lightadj[0] != lightadj[0]
+			|| cache->lightadj[1] != lightadj[1]
+			|| cache->lightadj[2] != lightadj[2]
+			|| cache->lightadj[3] != lightadj[3])
+		return false;
+
+// a block with dynamic lights is only good for the frame it was lit in
+	if (surface->dlightframe == r_framecount)
+		return cache->dlight && cache->lightframe == r_framecount;
+
+	return !cache->dlight;
+}
+
+
+/*
+================
+D_BuildSurface
+
+Lights and draws the surface into its block, r_drawsurf texture and lightadj
+are set up by the caller
+================
+*/
+static void D_BuildSurface (surfcache_t *cache, msurface_t *surface, int miplevel)
+{
+	r_drawsurf.surfmip = miplevel;
+	r_drawsurf.surfwidth = surface->extents[0] >> miplevel;
+	r_drawsurf.rowbytes = r_drawsurf.surfwidth;
+	r_drawsurf.surfheight = surface->extents[1] >> miplevel;
+	r_drawsurf.surfdat = (pixel_t *)cache->data;
+	r_drawsurf.surf = surface;
+
+	if (surface->dlightframe == r_framecount)
+		cache->dlight = 1;
+	else
+		cache->dlight = 0;
+	cache->lightframe = r_framecount;
+
+	cache->texture = r_drawsurf.texture;
+	cache->lightadj[0] = r_drawsurf.lightadj[0];
+	cache->lightadj[1] = r_drawsurf.lightadj[1];
+	cache->lightadj[2] = r_drawsurf.lightadj[2];
+	cache->lightadj[3] = r_drawsurf.lightadj[3];
+
+	R_DrawSurface ();
+}
+
+
 /*
 ================
 D_CacheSurface
@@ -282,57 +657,168 @@ surfcache_t *D_CacheSurface (msurface_t *surface, int miplevel)
 //
 	cache = surface->cachespots[miplevel];
 
-	if (cache && !cache->dlight && surface->dlightframe != r_framecount
-			&& cache->texture == r_drawsurf.texture
-			&& cache->lightadj[0] == r_drawsurf.lightadj[0]
-			&& cache->lightadj[1] == r_drawsurf.lightadj[1]
-			&& cache->lightadj[2] == r_drawsurf.lightadj[2]
-			&& cache->lightadj[3] == r_drawsurf.lightadj[3] )
-		return cache;
+	if (cache)
+	{
+		D_SCTouch (cache, surface, miplevel);
+
+		if (D_SCValid (cache, surface, r_drawsurf.texture, r_drawsurf.lightadj))
+		{
+			sc_stats.hits++;
+			return cache;
+		}
+
+	// the old contents are about to be overwritten
+		if (cache->drawbatch == d_drawbatch)
+			D_FlushSurfaceBatch ();
+
+		sc_stats.rebuilds++;
+	}
 
 //
 // determine shape of surface
 //
 	surfscale = 1.0 / (1<<miplevel);
-	r_drawsurf.surfmip = miplevel;
-	r_drawsurf.surfwidth = surface->extents[0] >> miplevel;
-	r_drawsurf.rowbytes = r_drawsurf.surfwidth;
-	r_drawsurf.surfheight = surface->extents[1] >> miplevel;
 	
 //
 // allocate memory if needed
 //
 	if (!cache)     // if a texture just animated, don't reallocate it
 	{
-		cache = D_SCAlloc (r_drawsurf.surfwidth,
-						   r_drawsurf.surfwidth * r_drawsurf.surfheight);
+		cache = D_SCAlloc (surface->extents[0] >> miplevel,
+				(surface->extents[0] >> miplevel) * (surface->extents[1] >> miplevel));
 		surface->cachespots[miplevel] = cache;
 		cache->owner = &surface->cachespots[miplevel];
 		cache->mipscale = surfscale;
-	}
-	
-	if (surface->dlightframe == r_framecount)
-		cache->dlight = 1;
-	else
-		cache->dlight = 0;
+		D_SCTouch (cache, surface, miplevel);
 
-	r_drawsurf.surfdat = (pixel_t *)cache->data;
-	
-	cache->texture = r_drawsurf.texture;
-	cache->lightadj[0] = r_drawsurf.lightadj[0];
-	cache->lightadj[1] = r_drawsurf.lightadj[1];
-	cache->lightadj[2] = r_drawsurf.lightadj[2];
-	cache->lightadj[3] = r_drawsurf.lightadj[3];
+		sc_stats.misses++;
+	}
 
 //
 // draw and light the surface texture
 //
-	r_drawsurf.surf = surface;
-
 	c_surf++;
-	R_DrawSurface ();
+	D_BuildSurface (cache, surface, miplevel);
 
 	return surface->cachespots[miplevel];
 }
 
 
+/*
+=============================================================================
+
+SURFACE PREBUILD
+
+Relighting blocks whose lightstyles have changed is most of the surface
+cache cost when lights flicker. At the start of a frame, after the
+lightstyles are animated and the world dlights are marked, the surfaces
+drawn last frame are relit on the worker threads while the main thread
+walks the world. The blocks are already allocated, so the jobs only write
+their own block and never touch the lists.
+
+=============================================================================
+*/
+
+/*
+================
+D_PrebuildJob
+================
+*/
+static void D_PrebuildJob (int job)
+{
+	int             i, last, built;
+	scuse_t         *use;
+	msurface_t      *surface;
+	surfcache_t     *cache;
+
+	i = job * SC_PREBUILD_BATCH;
+	last = i + SC_PREBUILD_BATCH;
+	if (last > sc_numprebuild)
+		last = sc_numprebuild;
+
+	built = 0;
+	for (use = &sc_prebuild[i] ; i<last ; i++, use++)
+	{
+		surface = use->surface;
+		cache = use->cache;
+
+	// evicted or reused for another surface since
+		if (cache->owner != &surface->cachespots[use->miplevel])
+			continue;
+
+	// animations follow the entity frame, which isn't known here, keep the
+	// texture and let D_CacheSurface catch a change
+		r_drawsurf.texture = cache->texture;
+		r_drawsurf.lightadj[0] = d_lightstylevalue[surface->styles[0]];
+		r_drawsurf.lightadj[1] = d_lightstylevalue[surface->styles[1]];
+		r_drawsurf.lightadj[2] = d_lightstylevalue[surface->styles[2]];
+		r_drawsurf.lightadj[3] = d_lightstylevalue[surface->styles[3]];
+
+		if (D_SCValid (cache, surface, r_drawsurf.texture, r_drawsurf.lightadj))
+			continue;
+
+		D_BuildSurface (cache, surface, use->miplevel);
+		built++;
+	}
+
+	sc_stats.prebuilds += built;
+}
+
+
+/*
+================
+D_PrebuildSurfaces
+
+Called from D_SetupFrame
+================
+*/
+void D_PrebuildSurfaces (void)
+{
+	scuse_t         *swap;
+	int             threads;
+
+	D_FinishPrebuild ();
+
+	sc_stats.frames++;
+
+// what was used last frame is the guess for this one
+	swap = sc_prebuild;
+	sc_prebuild = sc_used;
+	sc_used = swap;
+
+	threads = sc_maxprebuild;
+	sc_maxprebuild = sc_maxused;
+	sc_maxused = threads;
+
+	sc_numprebuild = sc_numused;
+	sc_numused = 0;
+
+#if id386
+	sc_numprebuild = 0;	// the assembly surface builders use the shared globals
+#else
+	threads = (int)r_rasterthreads.value;
+	if (!d_scprebuild.value || threads <= 1)
+		sc_numprebuild = 0;
+#endif
+
+	if (!sc_numprebuild)
+		return;
+
+	D_StartJobs (threads, (sc_numprebuild + SC_PREBUILD_BATCH - 1) / SC_PREBUILD_BATCH,
+			D_PrebuildJob);
+}
+
+
+/*
+================
+D_FinishPrebuild
+
+Has to be called before anything else reads or writes the surface cache
+================
+*/
+void D_FinishPrebuild (void)
+{
+	D_WaitJobs ();
+	sc_numprebuild = 0;
+}
+
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "r_local.h"
+#include "r_pvscache.h"
 
 //define	PASSAGES
 
@@ -192,6 +193,7 @@ void R_Init (void)
 	
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);	
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);	
+	Cmd_AddCommand ("lightmapbench", R_LightmapBench_f);
 
 	Cvar_RegisterVariable (&r_draworder);
 	Cvar_RegisterVariable (&r_speeds);
@@ -255,6 +257,7 @@ void R_NewMap (void)
 		 	
 	r_viewleaf = NULL;
 	R_ClearParticles ();
+	R_ClearPVSCache (cl.worldmodel);
 
 	r_cnumsurfs = r_maxsurfs.value;
 
@@ -492,32 +495,13 @@ R_MarkLeaves
 */
 void R_MarkLeaves (void)
 {
-	byte	*vis;
-	mnode_t	*node;
-	int		i;
-
 	if (r_oldviewleaf == r_viewleaf)
 		return;
 	
 	r_visframecount++;
 	r_oldviewleaf = r_viewleaf;
 
-	vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel);
-		
-	for (i=0 ; i<cl.worldmodel->numleafs ; i++)
-	{
-		if (vis[i>>3] & (1<<(i&7)))
-		{
-			node = (mnode_t *)&cl.worldmodel->leafs[i+1];
-			do
-			{
-				if (node->visframe == r_visframecount)
-					break;
-				node->visframe = r_visframecount;
-				node = node->parent;
-			} while (node);
-		}
-	}
+	R_MarkLeavesCached (cl.worldmodel, r_viewleaf, r_visframecount);
 }
 
 
@@ -912,6 +896,10 @@ void R_EdgeDrawing (void)
 
 	R_RenderWorld ();
 
+// the surface prebuild ran alongside the world walk, bmodel dlights are
+// marked from here on
+	D_FinishPrebuild ();
+
 	if (r_drawculledpolys)
 		R_ScanEdges ();
 
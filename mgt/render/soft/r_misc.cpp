@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "r_local.h"
+#include "d_local.h"
+#include "r_lightmap.h"
 
 
 /*
@@ -60,20 +62,17 @@ void Show (void)
 
 /*
 ====================
-R_TimeRefresh_f
+R_TimeRefreshRun
 
-For program optimization
+Renders a full turn of 128 frames, returns the time taken
 ====================
 */
-void R_TimeRefresh_f (void)
+float R_TimeRefreshRun (void)
 {
 	int			i;
-	float		start, stop, time;
-	int			startangle;
+	float		start, stop;
 	vrect_t		vr;
 
-	startangle = r_refdef.viewangles[1];
-	
 	start = Sys_FloatTime ();
 	for (i=0 ; i<128 ; i++)
 	{
@@ -93,12 +92,78 @@ void R_TimeRefresh_f (void)
 		VID_Update (&vr);
 	}
 	stop = Sys_FloatTime ();
-	time = stop-start;
-	Con_Printf ("%f seconds (%f fps)\n", time, 128/time);
+
+	return stop-start;
+}
+
+/*
+====================
+R_TimeRefresh_f
+
+For program optimization
+
+"timerefresh scale" repeats the run with 1, 2, 4... r_rasterthreads and
+reports the speedup over a single thread
+====================
+*/
+void R_TimeRefresh_f (void)
+{
+	float		time, basetime;
+	float		oldthreads;
+	int			startangle;
+	int			threads;
+
+	startangle = r_refdef.viewangles[1];
+	
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "scale"))
+	{
+		oldthreads = r_rasterthreads.value;
+		basetime = 0;
+
+		for (threads = 1 ; threads <= MAX_RASTER_BANDS ; threads <<= 1)
+		{
+			Cvar_SetValue ("r_rasterthreads", threads);
+			time = R_TimeRefreshRun ();
+			if (threads == 1)
+				basetime = time;
+			Con_Printf ("%2i threads: %f seconds (%f fps, %.2fx)\n",
+					threads, time, 128/time, basetime/time);
+		}
+
+		Cvar_SetValue ("r_rasterthreads", oldthreads);
+	}
+	else
+	{
+		time = R_TimeRefreshRun ();
+		Con_Printf ("%f seconds (%f fps)\n", time, 128/time);
+	}
 	
 	r_refdef.viewangles[1] = startangle;
 }
 
+/*
+====================
+R_LightmapBench_f
+
+Times the C and the vector lightmap kernels against each other
+====================
+*/
+void R_LightmapBench_f (void)
+{
+	double		ctime, vectime;
+	int			diff;
+
+	diff = R_LightmapBench (40, &ctime, &vectime);
+	if (diff < 0)
+	{
+		Con_Printf ("no vector lightmap kernels in this build\n");
+		return;
+	}
+
+	Con_Printf ("C %.2f ms, vector %.2f ms (%.2fx), largest difference %i\n",
+			ctime*1000, vectime*1000, ctime/vectime, diff);
+}
+
 /*
 ================
 R_LineGraph
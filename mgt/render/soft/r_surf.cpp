@@ -21,21 +21,24 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 #include "r_local.h"
-
-drawsurf_t	r_drawsurf;
-
-int				lightleft, sourcesstep, blocksize, sourcetstep;
-int				lightdelta, lightdeltastep;
-int				lightright, lightleftstep, lightrightstep, blockdivshift;
-unsigned		blockdivmask;
-void			*prowdestbase;
-unsigned char	*pbasesource;
-int				surfrowbytes;	// used by ASM files
-unsigned		*r_lightptr;
-int				r_stepback;
-int				r_lightwidth;
-int				r_numhblocks, r_numvblocks;
-unsigned char	*r_source, *r_sourcemax;
+#include "r_lightmap.h"
+
+// surfaces are also built by the prebuild jobs, so the builder state is per
+// thread
+D_THREADLOCAL drawsurf_t	r_drawsurf;
+
+D_THREADLOCAL int				lightleft, sourcesstep, blocksize, sourcetstep;
+D_THREADLOCAL int				lightdelta, lightdeltastep;
+D_THREADLOCAL int				lightright, lightleftstep, lightrightstep, blockdivshift;
+D_THREADLOCAL unsigned			blockdivmask;
+D_THREADLOCAL void				*prowdestbase;
+D_THREADLOCAL unsigned char		*pbasesource;
+D_THREADLOCAL int				surfrowbytes;	// used by ASM files
+D_THREADLOCAL unsigned			*r_lightptr;
+D_THREADLOCAL int				r_stepback;
+D_THREADLOCAL int				r_lightwidth;
+D_THREADLOCAL int				r_numhblocks, r_numvblocks;
+D_THREADLOCAL unsigned char		*r_source, *r_sourcemax;
 
 void R_DrawSurfaceBlock8_mip0 (void);
 void R_DrawSurfaceBlock8_mip1 (void);
@@ -51,7 +54,7 @@ static void	(*surfmiptable[4])(void) = {
 
 
 
-unsigned		blocklights[18*18];
+D_THREADLOCAL unsigned	blocklights[LIGHTMAP_MAX_LUXELS];
 
 /*
 ===============
@@ -62,13 +65,16 @@ void R_AddDynamicLights (void)
 {
 	msurface_t *surf;
 	int			lnum;
-	int			sd, td;
 	float		dist, rad, minlight;
 	vec3_t		impact, local;
-	int			s, t;
 	int			i;
 	int			smax, tmax;
 	mtexinfo_t	*tex;
+#ifdef QUAKE2
+	int			sd, td;
+	int			s, t;
+	unsigned	temp;
+#endif
 
 	surf = r_drawsurf.surf;
 	smax = (surf->extents[0]>>4)+1;
@@ -100,42 +106,42 @@ void R_AddDynamicLights (void)
 
 		local[0] -= surf->texturemins[0];
 		local[1] -= surf->texturemins[1];
-		
-		for (t = 0 ; t<tmax ; t++)
+
+#ifdef QUAKE2
+	// dark lights take light away and clamp at zero, they are rare enough
+	// to stay off the vector path
+		if (cl_dlights[lnum].dark)
 		{
-			td = local[1] - t*16;
-			if (td < 0)
-				td = -td;
-			for (s=0 ; s<smax ; s++)
+			for (t = 0 ; t<tmax ; t++)
 			{
-				sd = local[0] - s*16;
-				if (sd < 0)
-					sd = -sd;
-				if (sd > td)
-					dist = sd + (td>>1);
-				else
-					dist = td + (sd>>1);
-				if (dist < minlight)
-#ifdef QUAKE2
+				td = local[1] - t*16;
+				if (td < 0)
+					td = -td;
+				for (s=0 ; s<smax ; s++)
 				{
-					unsigned temp;
-					temp = (rad - dist)*256;
-					i = t*smax + s;
-					if (!cl_dlights[lnum].dark)
-						blocklights[i] += temp;
+					sd = local[0] - s*16;
+					if (sd < 0)
+						sd = -sd;
+					if (sd > td)
+						dist = sd + (td>>1);
 					else
+						dist = td + (sd>>1);
+					if (dist < minlight)
 					{
+						temp = (rad - dist)*256;
+						i = t*smax + s;
 						if (blocklights[i] > temp)
 							blocklights[i] -= temp;
 						else
 							blocklights[i] = 0;
 					}
 				}
-#else
-					blocklights[t*smax + s] += (rad - dist)*256;
-#endif
 			}
+			continue;
 		}
+#endif
+
+		R_LightmapAddDlight (blocklights, smax, tmax, local, rad, minlight);
 	}
 }
 
@@ -149,8 +155,7 @@ Combine and scale multiple lightmaps into the 8.8 format in blocklights
 void R_BuildLightMap (void)
 {
 	int			smax, tmax;
-	int			t;
-	int			i, size;
+	int			size;
 	byte		*lightmap;
 	unsigned	scale;
 	int			maps;
@@ -166,14 +171,12 @@ void R_BuildLightMap (void)
 	//if (/* r_fullbright.value || */ !cl.worldmodel->lightdata) // TODO: QW
 	if (r_fullbright.value || !cl.worldmodel->lightdata)
 	{
-		for (i=0 ; i<size ; i++)
-			blocklights[i] = 0;
+		R_LightmapFill (blocklights, size, 0);
 		return;
 	}
 
 // clear to ambient
-	for (i=0 ; i<size ; i++)
-		blocklights[i] = r_refdef.ambientlight<<8;
+	R_LightmapFill (blocklights, size, r_refdef.ambientlight<<8);
 
 
 // add all the lightmaps
@@ -182,8 +185,7 @@ void R_BuildLightMap (void)
 			 maps++)
 		{
 			scale = r_drawsurf.lightadj[maps];	// 8.8 fraction		
-			for (i=0 ; i<size ; i++)
-				blocklights[i] += lightmap[i] * scale;
+			R_LightmapAddStyle (blocklights, lightmap, size, scale);
 			lightmap += size;	// skip to next lightmap
 		}
 
@@ -192,15 +194,7 @@ void R_BuildLightMap (void)
 		R_AddDynamicLights ();
 
 // bound, invert, and shift
-	for (i=0 ; i<size ; i++)
-	{
-		t = (255*256 - (int)blocklights[i]) >> (8 - VID_CBITS);
-
-		if (t < (1 << 6))
-			t = (1 << 6);
-
-		blocklights[i] = t;
-	}
+	R_LightmapShade (blocklights, size);
 }
 
 
@@ -41,6 +41,17 @@ If you have questions concerning this license or the applicable additional terms
 #include "color/ColorSpace.h"
 
 idCVar image_highQualityCompression( "image_highQualityCompression", "0", CVAR_BOOL, "Use high quality (slow) compression" );
+idCVar image_parallelCompression( "image_parallelCompression", "1", CVAR_BOOL, "Split DXT compression of large images over the job threads" );
+
+/*
+========================
+R_CompressDXT
+========================
+*/
+static void R_CompressDXT( dxtEncodeMode_t mode, const byte * inBuf, byte * outBuf, int width, int height ) {
+	idDxtEncoder dxt;
+	dxt.CompressImageParallel( mode, inBuf, outBuf, width, height, image_parallelCompression.GetBool() ? tr.dxtJobList : NULL );
+}
 
 /*
 ========================
@@ -112,34 +123,32 @@ void idBinaryImage::Load2DFromMemory( int width, int height, const byte * pic_co
 
 		// compress data or convert floats as necessary
 		if ( textureFormat == FMT_DXT1 ) {
-			idDxtEncoder dxt;
 			img.Alloc( dxtWidth * dxtHeight / 2 );
 			if ( image_highQualityCompression.GetBool() ) {
-				dxt.CompressImageDXT1HQ( dxtPic, img.data, dxtWidth, dxtHeight );
+				R_CompressDXT( DXT_ENCODE_DXT1_HQ, dxtPic, img.data, dxtWidth, dxtHeight );
 			} else {
-				dxt.CompressImageDXT1Fast( dxtPic, img.data, dxtWidth, dxtHeight );
+				R_CompressDXT( DXT_ENCODE_DXT1, dxtPic, img.data, dxtWidth, dxtHeight );
 			}
 		} else if ( textureFormat == FMT_DXT5 ) {
-			idDxtEncoder dxt;
 			img.Alloc( dxtWidth * dxtHeight );
 			if ( colorFormat == CFM_NORMAL_DXT5 ) {
 				if ( image_highQualityCompression.GetBool() ) {
-					dxt.CompressNormalMapDXT5HQ( dxtPic, img.data, dxtWidth, dxtHeight );
+					R_CompressDXT( DXT_ENCODE_NORMAL_DXT5_HQ, dxtPic, img.data, dxtWidth, dxtHeight );
 				} else {
-					dxt.CompressNormalMapDXT5Fast( dxtPic, img.data, dxtWidth, dxtHeight );
+					R_CompressDXT( DXT_ENCODE_NORMAL_DXT5, dxtPic, img.data, dxtWidth, dxtHeight );
 				}
 			} else if ( colorFormat == CFM_YCOCG_DXT5 ) {
 				if ( image_highQualityCompression.GetBool() ) {
-					dxt.CompressYCoCgDXT5HQ( dxtPic, img.data, dxtWidth, dxtHeight );
+					R_CompressDXT( DXT_ENCODE_YCOCG_DXT5_HQ, dxtPic, img.data, dxtWidth, dxtHeight );
 				} else {
-					dxt.CompressYCoCgDXT5Fast( dxtPic, img.data, dxtWidth, dxtHeight );
+					R_CompressDXT( DXT_ENCODE_YCOCG_DXT5, dxtPic, img.data, dxtWidth, dxtHeight );
 				}
 			} else {
 				fileData.colorFormat = colorFormat = CFM_DEFAULT;
 				if ( image_highQualityCompression.GetBool() ) {
-					dxt.CompressImageDXT5HQ( dxtPic, img.data, dxtWidth, dxtHeight );
+					R_CompressDXT( DXT_ENCODE_DXT5_HQ, dxtPic, img.data, dxtWidth, dxtHeight );
 				} else {
-					dxt.CompressImageDXT5Fast( dxtPic, img.data, dxtWidth, dxtHeight );
+					R_CompressDXT( DXT_ENCODE_DXT5, dxtPic, img.data, dxtWidth, dxtHeight );
 				}
 			}
 		} else if ( textureFormat == FMT_LUM8 || textureFormat == FMT_INT8 ) {
@@ -265,12 +274,10 @@ void idBinaryImage::LoadCubeFromMemory( int width, const byte * pics[6], int num
 			img.height = padSize;
 			if ( textureFormat == FMT_DXT1 ) {
 				img.Alloc( padSize * padSize / 2 );
-				idDxtEncoder dxt;
-				dxt.CompressImageDXT1Fast( padSrc, img.data, padSize, padSize );
+				R_CompressDXT( DXT_ENCODE_DXT1, padSrc, img.data, padSize, padSize );
 			} else if ( textureFormat == FMT_DXT5 ) {
 				img.Alloc( padSize * padSize );
-				idDxtEncoder dxt;
-				dxt.CompressImageDXT5Fast( padSrc, img.data, padSize, padSize );
+				R_CompressDXT( DXT_ENCODE_DXT5, padSrc, img.data, padSize, padSize );
 			} else {
 				fileData.format = textureFormat = FMT_RGBA8;
 				img.Alloc( padSize * padSize * 4 );
@@ -34,6 +34,31 @@ Contains the DxtEncoder and DxtDecoder declarations.
 ================================================================================================
 */
 
+/*
+================================================
+dxtEncodeMode_t selects one of the idDxtEncoder compressors, so a whole image can be handed
+to CompressImage or split over a job list with CompressImageParallel.
+================================================
+*/
+enum dxtEncodeMode_t {
+	DXT_ENCODE_DXT1,
+	DXT_ENCODE_DXT1_HQ,
+	DXT_ENCODE_DXT5,
+	DXT_ENCODE_DXT5_HQ,
+	DXT_ENCODE_YCOCG_DXT5,
+	DXT_ENCODE_YCOCG_DXT5_HQ,
+	DXT_ENCODE_NORMAL_DXT5,
+	DXT_ENCODE_NORMAL_DXT5_HQ,
+	DXT_ENCODE_NORMAL_DXN2,
+	DXT_ENCODE_NORMAL_DXN2_HQ,
+	DXT_ENCODE_MAX
+};
+
+static const int MAX_DXT_ENCODE_BANDS		= 64;			// most jobs a single image is split into
+static const int MIN_DXT_ENCODE_BAND_PIXELS	= 128 * 128;	// smaller bands aren't worth a job
+
+class idParallelJobList;
+
 /*
 ================================================
 idDxtEncoder encodes Images in a number of DXT formats. Raw input Images are assumed to be in
@@ -58,6 +83,16 @@ public:
 	void	SetSrcPadding( int pad ) { srcPadding = pad; }
 	void	SetDstPadding( int pad ) { dstPadding = pad; }
 
+	// size of one compressed 4x4 block
+	static int	BlockSize( dxtEncodeMode_t mode );
+
+	// compresses with the given mode on the calling thread
+	void	CompressImage( dxtEncodeMode_t mode, const byte *inBuf, byte *outBuf, int width, int height );
+
+	// splits the image into bands of 4x4 block rows, each compressed by its own encoder on jobList,
+	// and returns once they are all done; the output is identical to CompressImage
+	void	CompressImageParallel( dxtEncodeMode_t mode, const byte *inBuf, byte *outBuf, int width, int height, idParallelJobList *jobList );
+
 	// high quality DXT1 compression (no alpha), uses exhaustive search to find a line through color space and is very slow
 	void	CompressImageDXT1HQ( const byte *inBuf, byte *outBuf, int width, int height );
 	
@@ -252,6 +287,23 @@ private:
 	void				EncodeNormalRGBIndices( byte *outBuf, const byte min, const byte max, const byte *values );
 };
 
+/*
+================================================
+dxtEncodeBand_t is the job parameter for a single band of CompressImageParallel.
+================================================
+*/
+struct dxtEncodeBand_t {
+	dxtEncodeMode_t		mode;
+	const byte *		inBuf;
+	byte *				outBuf;
+	int					width;
+	int					height;
+	int					srcPadding;
+	int					dstPadding;
+};
+
+void DxtEncodeBandJob( dxtEncodeBand_t * band );
+
 /*
 ========================
 idDxtEncoder::CompressImageDXT1Fast
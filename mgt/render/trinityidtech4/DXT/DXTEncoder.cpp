@@ -2526,13 +2526,6 @@ void idDxtEncoder::CompressNormalMapDXT1RenormalizeHQ( const byte *inBuf, byte *
 #define USE_SCALE		1
 #define USE_BIAS		1
 
-static int c_blocks;
-static int c_scaled;
-static int c_scaled2x;
-static int c_scaled4x;
-static int c_differentBias;
-static int c_biasHelped;
-
 /*
 ========================
 idDxtEncoder::BiasScaleNormalY
@@ -2581,22 +2574,8 @@ void idDxtEncoder::BiasScaleNormalY( byte *colorBlock ) const {
 
 	if ( scale == 1 ) {
 		bestBias = 128;
-	} else {
-		c_scaled++;
-		if ( scale == 2 ) c_scaled2x++;
-		if ( scale == 4 ) c_scaled4x++;
-		if ( bestBias != 128 ) {
-			c_differentBias++;
-			int r = Max( abs( minColor - 128 ), abs( maxColor - 128 ) );
-			int s = 1 + ( r <= s0 ) + 2 * ( r <= s1 );
-			if ( scale > s ) {
-				c_biasHelped++;
-			}
-		}
 	}
 
-	c_blocks++;
-
 	for ( int i = 0; i < 16; i++ ) {
 		colorBlock[i*4+0] = byte( bestBias + 4 );
 		colorBlock[i*4+1] = byte( ( colorBlock[i*4+1] - bestBias ) * scale + 128 );
@@ -4746,3 +4725,121 @@ void idDxtEncoder::ConvertImageDXN1_DXT1( const byte *inBuf, byte *outBuf, int w
 		inBuf += srcPadding;
 	}
 }
+
+/*
+========================
+idDxtEncoder::BlockSize
+========================
+*/
+int idDxtEncoder::BlockSize( dxtEncodeMode_t mode ) {
+	switch( mode ) {
+		case DXT_ENCODE_DXT1:
+		case DXT_ENCODE_DXT1_HQ:
+			return 8;
+		default:
+			return 16;
+	}
+}
+
+/*
+========================
+idDxtEncoder::CompressImage
+
+params:	mode		- compressor to use
+params:	inBuf		- image to compress
+paramO:	outBuf		- result of compression
+params:	width		- width of image
+params:	height		- height of image
+========================
+*/
+void idDxtEncoder::CompressImage( dxtEncodeMode_t mode, const byte *inBuf, byte *outBuf, int width, int height ) {
+	switch( mode ) {
+		case DXT_ENCODE_DXT1:				CompressImageDXT1Fast( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_DXT1_HQ:			CompressImageDXT1HQ( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_DXT5:				CompressImageDXT5Fast( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_DXT5_HQ:			CompressImageDXT5HQ( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_YCOCG_DXT5:			CompressYCoCgDXT5Fast( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_YCOCG_DXT5_HQ:		CompressYCoCgDXT5HQ( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_NORMAL_DXT5:		CompressNormalMapDXT5Fast( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_NORMAL_DXT5_HQ:		CompressNormalMapDXT5HQ( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_NORMAL_DXN2:		CompressNormalMapDXN2Fast( inBuf, outBuf, width, height ); break;
+		case DXT_ENCODE_NORMAL_DXN2_HQ:		CompressNormalMapDXN2HQ( inBuf, outBuf, width, height ); break;
+		default: assert( 0 );
+	}
+}
+
+/*
+========================
+DxtEncodeBandJob
+
+Every band gets its own encoder, the encoders keep their output pointer in a member.
+========================
+*/
+void DxtEncodeBandJob( dxtEncodeBand_t * band ) {
+	idDxtEncoder dxt;
+	dxt.SetSrcPadding( band->srcPadding );
+	dxt.SetDstPadding( band->dstPadding );
+	dxt.CompressImage( band->mode, band->inBuf, band->outBuf, band->width, band->height );
+}
+
+REGISTER_PARALLEL_JOB( DxtEncodeBandJob, "DxtEncodeBandJob" );
+
+/*
+========================
+idDxtEncoder::CompressImageParallel
+
+Each row of 4x4 blocks only reads its own four rows of pixels and writes its own run of
+blocks, so the image can be cut into bands of whole block rows without changing the output.
+Images that are too small to split, or not made of whole blocks, are done on the calling thread.
+
+params:	mode		- compressor to use
+params:	inBuf		- image to compress
+paramO:	outBuf		- result of compression
+params:	width		- width of image
+params:	height		- height of image
+params:	jobList		- idle job list to run the bands on, NULL to not use jobs
+========================
+*/
+void idDxtEncoder::CompressImageParallel( dxtEncodeMode_t mode, const byte *inBuf, byte *outBuf, int width, int height, idParallelJobList *jobList ) {
+	const int blockRows = height >> 2;
+
+	int numBands = 1;
+	if ( jobList != NULL && width >= 4 && ( width & 3 ) == 0 && height >= 4 && ( height & 3 ) == 0 ) {
+		// a few bands per core so a slow band doesn't hold up the rest
+		numBands = parallelJobManager->GetNumProcessingUnits() * 4;
+		numBands = Min( numBands, ( width * height ) / MIN_DXT_ENCODE_BAND_PIXELS );
+		numBands = Min( numBands, blockRows );
+		numBands = Min( numBands, MAX_DXT_ENCODE_BANDS );
+	}
+
+	if ( numBands < 2 ) {
+		CompressImage( mode, inBuf, outBuf, width, height );
+		return;
+	}
+
+	const int srcRowBytes = width * 4 * 4 + srcPadding;
+	const int dstRowBytes = ( width >> 2 ) * BlockSize( mode ) + dstPadding;
+
+	dxtEncodeBand_t bands[MAX_DXT_ENCODE_BANDS];
+
+	int firstRow = 0;
+	for ( int i = 0; i < numBands; i++ ) {
+		const int lastRow = ( blockRows * ( i + 1 ) ) / numBands;
+
+		dxtEncodeBand_t & band = bands[i];
+		band.mode = mode;
+		band.inBuf = inBuf + firstRow * srcRowBytes;
+		band.outBuf = outBuf + firstRow * dstRowBytes;
+		band.width = width;
+		band.height = ( lastRow - firstRow ) * 4;
+		band.srcPadding = srcPadding;
+		band.dstPadding = dstPadding;
+
+		jobList->AddJob( (jobRun_t)DxtEncodeBandJob, &band );
+
+		firstRow = lastRow;
+	}
+
+	jobList->Submit();
+	jobList->Wait();
+}
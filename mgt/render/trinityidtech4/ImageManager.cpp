@@ -31,6 +31,7 @@ If you have questions concerning this license or the applicable additional terms
 
 
 #include "tr_local.h"
+#include "DXT/DXTCodec.h"
 
 // do this with a pointer, in case we want to make the actual manager
 // a private virtual subclass
@@ -636,6 +637,91 @@ void R_CombineCubeImages_f( const idCmdArgs &args ) {
 	common->SetRefreshOnPrint( false );
 }
 
+/*
+===============
+R_BenchmarkDXT_f
+
+Times the DXT compressors on a generated image, first on the calling thread and then split
+over the job threads, and checks that both give the same blocks.
+
+benchmarkDXT [size] [hq]
+===============
+*/
+void R_BenchmarkDXT_f( const idCmdArgs &args ) {
+	static const struct {
+		dxtEncodeMode_t	mode;
+		dxtEncodeMode_t	modeHQ;
+		const char *	name;
+	} tests[] = {
+		{ DXT_ENCODE_DXT1,			DXT_ENCODE_DXT1_HQ,				"DXT1" },
+		{ DXT_ENCODE_DXT5,			DXT_ENCODE_DXT5_HQ,				"DXT5" },
+		{ DXT_ENCODE_YCOCG_DXT5,	DXT_ENCODE_YCOCG_DXT5_HQ,		"YCoCg DXT5" },
+		{ DXT_ENCODE_NORMAL_DXT5,	DXT_ENCODE_NORMAL_DXT5_HQ,		"normal DXT5" },
+		{ DXT_ENCODE_NORMAL_DXN2,	DXT_ENCODE_NORMAL_DXN2_HQ,		"normal DXN2" },
+	};
+
+	int size = 1024;
+	bool hq = false;
+	for ( int i = 1; i < args.Argc(); i++ ) {
+		if ( !idStr::Icmp( args.Argv( i ), "hq" ) ) {
+			hq = true;
+		} else {
+			size = atoi( args.Argv( i ) );
+		}
+	}
+	size = idMath::ClampInt( 16, 4096, size ) & ~3;
+
+	// the exhaustive searches are far too slow to repeat
+	const int iterations = hq ? 1 : 8;
+	const int pixels = size * size;
+
+	byte * pic = (byte *)Mem_Alloc16( pixels * 4, TAG_TEMP );
+	byte * serialBlocks = (byte *)Mem_Alloc16( pixels, TAG_TEMP );
+	byte * parallelBlocks = (byte *)Mem_Alloc16( pixels, TAG_TEMP );
+
+	// smooth gradients with some noise on top, so the blocks aren't all flat
+	idRandom random( 0 );
+	for ( int y = 0; y < size; y++ ) {
+		for ( int x = 0; x < size; x++ ) {
+			byte * p = pic + ( y * size + x ) * 4;
+			p[0] = ( x * 255 / size + random.RandomInt( 24 ) ) & 255;
+			p[1] = ( y * 255 / size + random.RandomInt( 24 ) ) & 255;
+			p[2] = ( ( x + y ) * 127 / size + random.RandomInt( 24 ) ) & 255;
+			p[3] = ( ( x ^ y ) + random.RandomInt( 24 ) ) & 255;
+		}
+	}
+
+	common->Printf( "%i x %i %s, %i processing units\n", size, size, hq ? "high quality" : "fast", parallelJobManager->GetNumProcessingUnits() );
+	common->Printf( "mode           serial MP/s   jobs MP/s\n" );
+
+	for ( int i = 0; i < (int)( sizeof( tests ) / sizeof( tests[0] ) ); i++ ) {
+		const dxtEncodeMode_t mode = hq ? tests[i].modeHQ : tests[i].mode;
+		const int blockBytes = ( pixels / 16 ) * idDxtEncoder::BlockSize( mode );
+		idDxtEncoder dxt;
+
+		const int64 start = Sys_Microseconds();
+		for ( int j = 0; j < iterations; j++ ) {
+			dxt.CompressImage( mode, pic, serialBlocks, size, size );
+		}
+		const int64 mid = Sys_Microseconds();
+		for ( int j = 0; j < iterations; j++ ) {
+			dxt.CompressImageParallel( mode, pic, parallelBlocks, size, size, tr.dxtJobList );
+		}
+		const int64 end = Sys_Microseconds();
+
+		// pixels per microsecond is megapixels per second
+		const float serialRate = (float)pixels * iterations / Max( mid - start, (int64)1 );
+		const float parallelRate = (float)pixels * iterations / Max( end - mid, (int64)1 );
+
+		common->Printf( "%-14s %11.1f %11.1f%s\n", tests[i].name, serialRate, parallelRate,
+			memcmp( serialBlocks, parallelBlocks, blockBytes ) != 0 ? "  MISMATCH" : "" );
+	}
+
+	Mem_Free16( pic );
+	Mem_Free16( serialBlocks );
+	Mem_Free16( parallelBlocks );
+}
+
 /*
 ===============
 UnbindAll
@@ -675,6 +761,7 @@ void idImageManager::Init() {
 	cmdSystem->AddCommand( "reloadImages", R_ReloadImages_f, CMD_FL_RENDERER, "reloads images" );
 	cmdSystem->AddCommand( "listImages", R_ListImages_f, CMD_FL_RENDERER, "lists images" );
 	cmdSystem->AddCommand( "combineCubeImages", R_CombineCubeImages_f, CMD_FL_RENDERER, "combines six images for roq compression" );
+	cmdSystem->AddCommand( "benchmarkDXT", R_BenchmarkDXT_f, CMD_FL_RENDERER, "times the DXT compressors with and without jobs" );
 
 	// should forceLoadImages be here?
 }
@@ -61,6 +61,10 @@ static void R_PerformanceCounters() {
 			tr.pc.c_tangentIndexes/3,
 			tr.pc.c_guiSurfs
 			); 
+		common->Printf( "md5 skinning: cpuVerts:%i usec:%i\n",
+			tr.pc.c_skinnedVerts.GetValue(),
+			tr.pc.skinMicroSec.GetValue()
+			);
 	}
 
 	if ( r_showCull.GetBool() ) {
@@ -30,6 +30,7 @@ If you have questions concerning this license or the applicable additional terms
 #include "../idlib/precompiled.h"
 
 #include "tr_local.h"
+#include "DXT/DXTCodec.h"
 
 // Vista OpenGL wrapper check
 #include "../sys/win32/win_local.h"
@@ -1888,6 +1889,8 @@ void R_InitCommands() {
 	cmdSystem->AddCommand( "listRenderLightDefs", R_ListRenderLightDefs_f, CMD_FL_RENDERER, "lists the light defs" );
 	cmdSystem->AddCommand( "listModes", R_ListModes_f, CMD_FL_RENDERER, "lists all video modes" );
 	cmdSystem->AddCommand( "reloadSurface", R_ReloadSurface_f, CMD_FL_RENDERER, "reloads the decl and images for selected surface" );
+	cmdSystem->AddCommand( "captureShadowVolumes", R_CaptureShadowVolumes_f, CMD_FL_RENDERER, "writes the shadow volume jobs of the next view to a file" );
+	cmdSystem->AddCommand( "benchmarkShadowVolumes", R_BenchmarkShadowVolumes_f, CMD_FL_RENDERER, "times captured shadow volume jobs with and without job threads" );
 }
 
 /*
@@ -1936,6 +1939,10 @@ void idRenderSystemLocal::Clear() {
 	}
 
 	frontEndJobList = NULL;
+	dxtJobList = NULL;
+
+	shadowVolumeCapture = NULL;
+	shadowVolumeCaptureCount = 0;
 }
 
 /*
@@ -2188,6 +2195,7 @@ void idRenderSystemLocal::Init() {
 	}
 
 	frontEndJobList = parallelJobManager->AllocJobList( JOBLIST_RENDERER_FRONTEND, JOBLIST_PRIORITY_MEDIUM, 2048, 0, NULL );
+	dxtJobList = parallelJobManager->AllocJobList( JOBLIST_UTILITY, JOBLIST_PRIORITY_MEDIUM, MAX_DXT_ENCODE_BANDS, 0, NULL );
 
 	// make sure the command buffers are ready to accept the first screen update
 	SwapCommandBuffers( NULL, NULL, NULL, NULL );
@@ -2229,6 +2237,9 @@ void idRenderSystemLocal::Shutdown() {
 	delete guiModel;
 
 	parallelJobManager->FreeJobList( frontEndJobList );
+	parallelJobManager->FreeJobList( dxtJobList );
+
+	R_FinishShadowVolumeCapture();
 
 	Clear();
 
@@ -0,0 +1,745 @@
+/*
+===========================================================================
+
+Doom 3 BFG Edition GPL Source Code
+Copyright (C) 1993-2012 id Software LLC, a ZeniMax Media company.
+
+This file is part of the Doom 3 BFG Edition GPL Source Code ("Doom 3 BFG Edition Source Code").
+
+Doom 3 BFG Edition Source Code is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Doom 3 BFG Edition Source Code is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Doom 3 BFG Edition Source Code.  If not, see <http://www.gnu.org/licenses/>.
+
+In addition, the Doom 3 BFG Edition Source Code is also subject to certain additional terms. You should have received a copy of these additional terms immediately following the terms and conditions of the GNU General Public License which accompanied the Doom 3 BFG Edition Source Code.  If not, please request a copy in writing from id Software at the address below.
+
+If you have questions concerning this license or the applicable additional terms, you may contact in writing id Software LLC, c/o ZeniMax Media Inc., Suite 120, Rockville, Maryland 20850 USA.
+
+===========================================================================
+*/
+
+#pragma hdrstop
+#include "../idlib/precompiled.h"
+
+#include "tr_local.h"
+
+/*
+================================================================================================
+
+Shadow Volume Job Capture and Benchmark
+
+captureShadowVolumes writes the inputs of all the shadow volume jobs of the next rendered
+view to a file: the occluder triangles, the light and view origins in model space and the
+model view projection and light projection matrices. benchmarkShadowVolumes loads such a
+file and runs the jobs on the calling thread and then on the job threads, so the job
+kernels can be timed in isolation. The jobs only touch memory, nothing is sent to the GPU.
+
+The captured data is written in the native layout of the structures, a capture can only
+be read back by a build with the same vertex, index and joint layout.
+
+================================================================================================
+*/
+
+static const int SHADOW_CAPTURE_MAGIC	= ( 'S' << 24 ) | ( 'H' << 16 ) | ( 'V' << 8 ) | 'C';
+static const int SHADOW_CAPTURE_VERSION	= 2;
+
+enum shadowCaptureType_t {
+	SHADOW_CAPTURE_END,
+	SHADOW_CAPTURE_PRELIGHT,
+	SHADOW_CAPTURE_STATIC,
+	SHADOW_CAPTURE_DYNAMIC
+};
+
+/*
+====================
+R_WriteShadowCaptureArray
+====================
+*/
+static void R_WriteShadowCaptureArray( idFile * file, const void * data, int count, int size ) {
+	file->WriteInt( data != NULL ? count : -1 );
+	if ( data != NULL && count > 0 ) {
+		file->Write( data, count * size );
+	}
+}
+
+/*
+====================
+R_WriteShadowCaptureCountedArray
+
+The vertex and index counts are written with the arrays. A count that has no array
+to go with it is written as zero, so a capture never has a missing array with a count.
+====================
+*/
+static void R_WriteShadowCaptureCountedArray( idFile * file, const void * data, int count, int size ) {
+	file->WriteInt( data != NULL ? count : 0 );
+	R_WriteShadowCaptureArray( file, data, count, size );
+}
+
+/*
+====================
+R_WriteShadowCaptureCommon
+====================
+*/
+static void R_WriteShadowCaptureCommon( idFile * file, const idBounds & triangleBounds, const idRenderMatrix & triangleMVP,
+											const idVec3 & localLightOrigin, const idVec3 & localViewOrigin,
+											float zNear, float lightZMin, float lightZMax,
+											bool forceShadowCaps, bool useShadowPreciseInsideTest, bool useShadowDepthBounds ) {
+	file->WriteVec3( triangleBounds[0] );
+	file->WriteVec3( triangleBounds[1] );
+	file->Write( &triangleMVP, sizeof( triangleMVP ) );
+	file->WriteVec3( localLightOrigin );
+	file->WriteVec3( localViewOrigin );
+	file->WriteFloat( zNear );
+	file->WriteFloat( lightZMin );
+	file->WriteFloat( lightZMax );
+	file->WriteBool( forceShadowCaps );
+	file->WriteBool( useShadowPreciseInsideTest );
+	file->WriteBool( useShadowDepthBounds );
+}
+
+/*
+====================
+R_CapturePreLightShadowVolumes
+
+Called from R_AddLights before the pre-light shadow volume jobs are started.
+====================
+*/
+void R_CapturePreLightShadowVolumes( const viewLight_t * viewLights ) {
+	idFile * file = tr.shadowVolumeCapture;
+
+	for ( const viewLight_t * vLight = viewLights; vLight != NULL; vLight = vLight->next ) {
+		for ( const preLightShadowVolumeParms_t * parms = vLight->preLightShadowVolumes; parms != NULL; parms = parms->next ) {
+			file->WriteInt( SHADOW_CAPTURE_PRELIGHT );
+			R_WriteShadowCaptureCountedArray( file, parms->verts, parms->numVerts, sizeof( parms->verts[0] ) );
+			R_WriteShadowCaptureCountedArray( file, parms->indexes, parms->numIndexes, sizeof( parms->indexes[0] ) );
+			R_WriteShadowCaptureCommon( file, parms->triangleBounds, parms->triangleMVP, parms->localLightOrigin, parms->localViewOrigin,
+										parms->zNear, parms->lightZMin, parms->lightZMax,
+										parms->forceShadowCaps, parms->useShadowPreciseInsideTest, parms->useShadowDepthBounds );
+			tr.shadowVolumeCaptureCount++;
+		}
+	}
+}
+
+/*
+====================
+R_CaptureShadowVolumes
+
+Called from R_AddModels before the static and dynamic shadow volume jobs are started.
+This finishes the capture.
+====================
+*/
+void R_CaptureShadowVolumes( const viewEntity_t * viewEntitys ) {
+	idFile * file = tr.shadowVolumeCapture;
+
+	for ( const viewEntity_t * vEntity = viewEntitys; vEntity != NULL; vEntity = vEntity->next ) {
+		for ( const staticShadowVolumeParms_t * parms = vEntity->staticShadowVolumes; parms != NULL; parms = parms->next ) {
+			file->WriteInt( SHADOW_CAPTURE_STATIC );
+			R_WriteShadowCaptureCountedArray( file, parms->verts, parms->numVerts, sizeof( parms->verts[0] ) );
+			R_WriteShadowCaptureCountedArray( file, parms->indexes, parms->numIndexes, sizeof( parms->indexes[0] ) );
+			R_WriteShadowCaptureCommon( file, parms->triangleBounds, parms->triangleMVP, parms->localLightOrigin, parms->localViewOrigin,
+										parms->zNear, parms->lightZMin, parms->lightZMax,
+										parms->forceShadowCaps, parms->useShadowPreciseInsideTest, parms->useShadowDepthBounds );
+			file->WriteInt( parms->numShadowIndicesWithCaps );
+			file->WriteInt( parms->numShadowIndicesNoCaps );
+			tr.shadowVolumeCaptureCount++;
+		}
+		for ( const dynamicShadowVolumeParms_t * parms = vEntity->dynamicShadowVolumes; parms != NULL; parms = parms->next ) {
+			file->WriteInt( SHADOW_CAPTURE_DYNAMIC );
+			R_WriteShadowCaptureCountedArray( file, parms->verts, parms->numVerts, sizeof( parms->verts[0] ) );
+			R_WriteShadowCaptureCountedArray( file, parms->indexes, parms->numIndexes, sizeof( parms->indexes[0] ) );
+			R_WriteShadowCaptureCommon( file, parms->triangleBounds, parms->triangleMVP, parms->localLightOrigin, parms->localViewOrigin,
+										parms->zNear, parms->lightZMin, parms->lightZMax,
+										parms->forceShadowCaps, parms->useShadowPreciseInsideTest, parms->useShadowDepthBounds );
+			R_WriteShadowCaptureArray( file, parms->silEdges, parms->numSilEdges, sizeof( parms->silEdges[0] ) );
+			R_WriteShadowCaptureArray( file, parms->joints, parms->numJoints, sizeof( parms->joints[0] ) );
+			file->Write( &parms->localLightProject, sizeof( parms->localLightProject ) );
+			file->WriteBool( parms->cullShadowTrianglesToLight );
+			file->WriteInt( parms->shadowIndices != NULL ? parms->maxShadowIndices : -1 );
+			file->WriteInt( parms->lightIndices != NULL ? parms->maxLightIndices : -1 );
+			tr.shadowVolumeCaptureCount++;
+		}
+	}
+
+	R_FinishShadowVolumeCapture();
+}
+
+/*
+====================
+R_FinishShadowVolumeCapture
+====================
+*/
+void R_FinishShadowVolumeCapture() {
+	if ( tr.shadowVolumeCapture == NULL ) {
+		return;
+	}
+	tr.shadowVolumeCapture->WriteInt( SHADOW_CAPTURE_END );
+	common->Printf( "wrote %i shadow volume jobs to %s\n", tr.shadowVolumeCaptureCount, tr.shadowVolumeCapture->GetName() );
+	delete tr.shadowVolumeCapture;
+	tr.shadowVolumeCapture = NULL;
+}
+
+/*
+====================
+R_CaptureShadowVolumes_f
+
+captureShadowVolumes <file>
+====================
+*/
+void R_CaptureShadowVolumes_f( const idCmdArgs & args ) {
+	if ( args.Argc() != 2 ) {
+		common->Printf( "usage: captureShadowVolumes <file>\n" );
+		return;
+	}
+
+	R_FinishShadowVolumeCapture();
+
+	idStr fileName = args.Argv( 1 );
+	fileName.DefaultFileExtension( ".shadowjobs" );
+
+	idFile * file = fileSystem->OpenFileWrite( fileName );
+	if ( file == NULL ) {
+		common->Printf( "couldn't open %s\n", fileName.c_str() );
+		return;
+	}
+
+	file->WriteInt( SHADOW_CAPTURE_MAGIC );
+	file->WriteInt( SHADOW_CAPTURE_VERSION );
+	file->WriteInt( sizeof( idDrawVert ) );
+	file->WriteInt( sizeof( idShadowVert ) );
+	file->WriteInt( sizeof( triIndex_t ) );
+	file->WriteInt( sizeof( idJointMat ) );
+
+	tr.shadowVolumeCapture = file;
+	tr.shadowVolumeCaptureCount = 0;
+}
+
+/*
+================================================
+idShadowBenchJob
+
+A captured shadow volume job with its own copy of the input and its own output.
+================================================
+*/
+class idShadowBenchJob {
+public:
+							idShadowBenchJob();
+							~idShadowBenchJob();
+
+	bool					Read( idFile * file, shadowCaptureType_t captureType );
+	void					Reset();
+	void					AddJob( idParallelJobList * jobList );
+	void					Run();
+	unsigned int			Checksum() const;
+
+	shadowCaptureType_t		type;
+	int						numTriangles;		// triangles tested for facing and light culling by a dynamic shadow volume job
+
+	// outputs
+	int						numShadowIndices;
+	int						numLightIndices;
+	int						renderZFail;
+	float					shadowZMin;
+	float					shadowZMax;
+	volatile shadowVolumeState_t shadowVolumeState;
+	triIndex_t *			shadowIndices;
+	triIndex_t *			lightIndices;
+
+private:
+	preLightShadowVolumeParms_t	preLightParms;
+	staticShadowVolumeParms_t	staticParms;
+	dynamicShadowVolumeParms_t	dynamicParms;
+
+	void *					verts;
+	triIndex_t *			indexes;
+	silEdge_t *				silEdges;
+	idJointMat *			joints;
+
+	static void *			ReadArray( idFile * file, int size, int & count, bool & ok );
+};
+
+/*
+========================
+idShadowBenchJob::idShadowBenchJob
+========================
+*/
+idShadowBenchJob::idShadowBenchJob() {
+	type = SHADOW_CAPTURE_END;
+	numTriangles = 0;
+	numShadowIndices = 0;
+	numLightIndices = 0;
+	renderZFail = 0;
+	shadowZMin = 0.0f;
+	shadowZMax = 0.0f;
+	shadowVolumeState = SHADOWVOLUME_DONE;
+	shadowIndices = NULL;
+	lightIndices = NULL;
+	memset( &preLightParms, 0, sizeof( preLightParms ) );
+	memset( &staticParms, 0, sizeof( staticParms ) );
+	memset( &dynamicParms, 0, sizeof( dynamicParms ) );
+	verts = NULL;
+	indexes = NULL;
+	silEdges = NULL;
+	joints = NULL;
+}
+
+/*
+========================
+idShadowBenchJob::~idShadowBenchJob
+========================
+*/
+idShadowBenchJob::~idShadowBenchJob() {
+	Mem_Free16( verts );
+	Mem_Free16( indexes );
+	Mem_Free16( silEdges );
+	Mem_Free16( joints );
+	Mem_Free16( shadowIndices );
+	Mem_Free16( lightIndices );
+}
+
+/*
+========================
+idShadowBenchJob::ReadArray
+
+Returns NULL if the array wasn't set when it was captured.
+========================
+*/
+void * idShadowBenchJob::ReadArray( idFile * file, int size, int & count, bool & ok ) {
+	file->ReadInt( count );
+	if ( count <= 0 ) {
+		count = Max( count, 0 );
+		return NULL;
+	}
+	// the jobs read 16 bytes at a time
+	void * data = Mem_Alloc16( ALIGN( count * size, 16 ), TAG_TEMP );
+	if ( file->Read( data, count * size ) != count * size ) {
+		ok = false;
+	}
+	return data;
+}
+
+/*
+========================
+idShadowBenchJob::Read
+========================
+*/
+bool idShadowBenchJob::Read( idFile * file, shadowCaptureType_t captureType ) {
+	int numVerts = 0;
+	int numIndexes = 0;
+	int count = 0;
+	bool ok = true;
+
+	type = captureType;
+
+	file->ReadInt( numVerts );
+	verts = ReadArray( file, ( type == SHADOW_CAPTURE_DYNAMIC ) ? sizeof( idDrawVert ) : sizeof( idShadowVert ), count, ok );
+	if ( verts != NULL && count != numVerts ) {
+		ok = false;
+	}
+	file->ReadInt( numIndexes );
+	indexes = (triIndex_t *)ReadArray( file, sizeof( triIndex_t ), count, ok );
+	if ( indexes != NULL && count != numIndexes ) {
+		ok = false;
+	}
+
+	idBounds triangleBounds;
+	idRenderMatrix triangleMVP;
+	idVec3 localLightOrigin;
+	idVec3 localViewOrigin;
+	float zNear = 0.0f;
+	float lightZMin = 0.0f;
+	float lightZMax = 0.0f;
+	bool forceShadowCaps = false;
+	bool useShadowPreciseInsideTest = false;
+	bool useShadowDepthBounds = false;
+
+	file->ReadVec3( triangleBounds[0] );
+	file->ReadVec3( triangleBounds[1] );
+	file->Read( &triangleMVP, sizeof( triangleMVP ) );
+	file->ReadVec3( localLightOrigin );
+	file->ReadVec3( localViewOrigin );
+	file->ReadFloat( zNear );
+	file->ReadFloat( lightZMin );
+	file->ReadFloat( lightZMax );
+	file->ReadBool( forceShadowCaps );
+	file->ReadBool( useShadowPreciseInsideTest );
+	file->ReadBool( useShadowDepthBounds );
+
+	if ( type == SHADOW_CAPTURE_PRELIGHT ) {
+		preLightShadowVolumeParms_t & parms = preLightParms;
+		parms.verts = (const idShadowVert *)verts;
+		parms.numVerts = numVerts;
+		parms.indexes = indexes;
+		parms.numIndexes = numIndexes;
+		parms.triangleBounds = triangleBounds;
+		parms.triangleMVP = triangleMVP;
+		parms.localLightOrigin = localLightOrigin;
+		parms.localViewOrigin = localViewOrigin;
+		parms.zNear = zNear;
+		parms.lightZMin = lightZMin;
+		parms.lightZMax = lightZMax;
+		parms.forceShadowCaps = forceShadowCaps;
+		parms.useShadowPreciseInsideTest = useShadowPreciseInsideTest;
+		parms.useShadowDepthBounds = useShadowDepthBounds;
+		parms.numShadowIndices = &numShadowIndices;
+		parms.renderZFail = &renderZFail;
+		parms.shadowZMin = &shadowZMin;
+		parms.shadowZMax = &shadowZMax;
+		parms.shadowVolumeState = &shadowVolumeState;
+	} else if ( type == SHADOW_CAPTURE_STATIC ) {
+		staticShadowVolumeParms_t & parms = staticParms;
+		parms.verts = (const idShadowVert *)verts;
+		parms.numVerts = numVerts;
+		parms.indexes = indexes;
+		parms.numIndexes = numIndexes;
+		parms.triangleBounds = triangleBounds;
+		parms.triangleMVP = triangleMVP;
+		parms.localLightOrigin = localLightOrigin;
+		parms.localViewOrigin = localViewOrigin;
+		parms.zNear = zNear;
+		parms.lightZMin = lightZMin;
+		parms.lightZMax = lightZMax;
+		parms.forceShadowCaps = forceShadowCaps;
+		parms.useShadowPreciseInsideTest = useShadowPreciseInsideTest;
+		parms.useShadowDepthBounds = useShadowDepthBounds;
+		file->ReadInt( parms.numShadowIndicesWithCaps );
+		file->ReadInt( parms.numShadowIndicesNoCaps );
+		parms.numShadowIndices = &numShadowIndices;
+		parms.renderZFail = &renderZFail;
+		parms.shadowZMin = &shadowZMin;
+		parms.shadowZMax = &shadowZMax;
+		parms.shadowVolumeState = &shadowVolumeState;
+	} else {
+		dynamicShadowVolumeParms_t & parms = dynamicParms;
+		int numSilEdges = 0;
+		int numJoints = 0;
+		int maxShadowIndices = 0;
+		int maxLightIndices = 0;
+
+		silEdges = (silEdge_t *)ReadArray( file, sizeof( silEdge_t ), numSilEdges, ok );
+		joints = (idJointMat *)ReadArray( file, sizeof( idJointMat ), numJoints, ok );
+		file->Read( &parms.localLightProject, sizeof( parms.localLightProject ) );
+		file->ReadBool( parms.cullShadowTrianglesToLight );
+		file->ReadInt( maxShadowIndices );
+		file->ReadInt( maxLightIndices );
+
+		// the output is streamed out 16 bytes at a time
+		if ( maxShadowIndices >= 0 ) {
+			shadowIndices = (triIndex_t *)Mem_Alloc16( ALIGN( maxShadowIndices * sizeof( triIndex_t ), 16 ) + 16, TAG_TEMP );
+		}
+		if ( maxLightIndices >= 0 ) {
+			lightIndices = (triIndex_t *)Mem_Alloc16( ALIGN( maxLightIndices * sizeof( triIndex_t ), 16 ) + 16, TAG_TEMP );
+		}
+
+		parms.verts = (const idDrawVert *)verts;
+		parms.numVerts = numVerts;
+		parms.indexes = indexes;
+		parms.numIndexes = numIndexes;
+		parms.silEdges = silEdges;
+		parms.numSilEdges = numSilEdges;
+		parms.joints = joints;
+		parms.numJoints = numJoints;
+		parms.triangleBounds = triangleBounds;
+		parms.triangleMVP = triangleMVP;
+		parms.localLightOrigin = localLightOrigin;
+		parms.localViewOrigin = localViewOrigin;
+		parms.zNear = zNear;
+		parms.lightZMin = lightZMin;
+		parms.lightZMax = lightZMax;
+		parms.forceShadowCaps = forceShadowCaps;
+		parms.useShadowPreciseInsideTest = useShadowPreciseInsideTest;
+		parms.useShadowDepthBounds = useShadowDepthBounds;
+		parms.shadowIndices = shadowIndices;
+		parms.maxShadowIndices = Max( maxShadowIndices, 0 );
+		parms.numShadowIndices = &numShadowIndices;
+		parms.lightIndices = lightIndices;
+		parms.maxLightIndices = Max( maxLightIndices, 0 );
+		parms.numLightIndices = &numLightIndices;
+		parms.renderZFail = &renderZFail;
+		parms.shadowZMin = &shadowZMin;
+		parms.shadowZMax = &shadowZMax;
+		parms.shadowVolumeState = &shadowVolumeState;
+		numTriangles = numIndexes / 3;
+
+		if ( ( numJoints > 0 ) != ( joints != NULL ) ) {
+			ok = false;
+		}
+	}
+
+	// the arrays must match the counts or the job reads past them
+	if ( numVerts < 0 || numIndexes < 0 || ( verts == NULL && numVerts > 0 ) || ( indexes == NULL && numIndexes > 0 ) ) {
+		ok = false;
+	}
+
+	return ok;
+}
+
+/*
+========================
+idShadowBenchJob::Reset
+
+The jobs store their temp buffers in the parms, these are allocated on the stack of
+the thread running the job so they have to be cleared before every run.
+========================
+*/
+void idShadowBenchJob::Reset() {
+	preLightParms.tempCullBits = NULL;
+	staticParms.tempCullBits = NULL;
+	dynamicParms.tempFacing = NULL;
+	dynamicParms.tempCulled = NULL;
+	dynamicParms.tempVerts = NULL;
+	dynamicParms.indexBuffer = NULL;
+
+	numShadowIndices = 0;
+	numLightIndices = 0;
+	renderZFail = 0;
+	shadowZMin = 0.0f;
+	shadowZMax = 0.0f;
+	shadowVolumeState = SHADOWVOLUME_UNFINISHED;
+}
+
+/*
+========================
+idShadowBenchJob::AddJob
+========================
+*/
+void idShadowBenchJob::AddJob( idParallelJobList * jobList ) {
+	switch ( type ) {
+		case SHADOW_CAPTURE_PRELIGHT:	jobList->AddJob( (jobRun_t)PreLightShadowVolumeJob, &preLightParms ); break;
+		case SHADOW_CAPTURE_STATIC:		jobList->AddJob( (jobRun_t)StaticShadowVolumeJob, &staticParms ); break;
+		case SHADOW_CAPTURE_DYNAMIC:	jobList->AddJob( (jobRun_t)DynamicShadowVolumeJob, &dynamicParms ); break;
+		default: break;
+	}
+}
+
+/*
+========================
+idShadowBenchJob::Run
+========================
+*/
+void idShadowBenchJob::Run() {
+	switch ( type ) {
+		case SHADOW_CAPTURE_PRELIGHT:	PreLightShadowVolumeJob( &preLightParms ); break;
+		case SHADOW_CAPTURE_STATIC:		StaticShadowVolumeJob( &staticParms ); break;
+		case SHADOW_CAPTURE_DYNAMIC:	DynamicShadowVolumeJob( &dynamicParms ); break;
+		default: break;
+	}
+}
+
+/*
+========================
+idShadowBenchJob::Checksum
+========================
+*/
+unsigned int idShadowBenchJob::Checksum() const {
+	unsigned int checksum = numShadowIndices ^ ( numLightIndices << 8 ) ^ ( renderZFail << 16 ) ^ ( shadowVolumeState << 17 );
+	checksum ^= MD5_BlockChecksum( &shadowZMin, sizeof( shadowZMin ) ) ^ MD5_BlockChecksum( &shadowZMax, sizeof( shadowZMax ) );
+	if ( shadowIndices != NULL && numShadowIndices > 0 ) {
+		checksum ^= MD5_BlockChecksum( shadowIndices, numShadowIndices * sizeof( triIndex_t ) );
+	}
+	if ( lightIndices != NULL && numLightIndices > 0 ) {
+		checksum ^= MD5_BlockChecksum( lightIndices, numLightIndices * sizeof( triIndex_t ) );
+	}
+	return checksum;
+}
+
+/*
+====================
+R_CountSilhouetteEdges
+
+Every silhouette edge and every shadow cap triangle adds six indices. The quad of a
+silhouette edge has one near and one far vertex in the second and third index, a cap
+triangle has two near vertices there, and the near vertices have the even indices.
+====================
+*/
+static int R_CountSilhouetteEdges( const triIndex_t * shadowIndices, int numShadowIndices ) {
+	int numSilEdges = 0;
+	for ( int i = 0; i + 6 <= numShadowIndices; i += 6 ) {
+		numSilEdges += ( shadowIndices[i + 1] ^ shadowIndices[i + 2] ) & 1;
+	}
+	return numSilEdges;
+}
+
+/*
+====================
+R_RunShadowBenchJobs
+====================
+*/
+static int64 R_RunShadowBenchJobs( idList< idShadowBenchJob * > & jobs, idParallelJobList * jobList, int iterations ) {
+	const int64 start = Sys_Microseconds();
+	for ( int i = 0; i < iterations; i++ ) {
+		for ( int j = 0; j < jobs.Num(); j++ ) {
+			jobs[j]->Reset();
+		}
+		if ( jobList != NULL ) {
+			for ( int j = 0; j < jobs.Num(); j++ ) {
+				jobs[j]->AddJob( jobList );
+			}
+			jobList->Submit();
+			jobList->Wait();
+		} else {
+			for ( int j = 0; j < jobs.Num(); j++ ) {
+				jobs[j]->Run();
+			}
+		}
+	}
+	const int64 end = Sys_Microseconds();
+	return Max( end - start, (int64)1 );
+}
+
+/*
+====================
+R_BenchmarkShadowVolumes_f
+
+Times the captured shadow volume jobs, first on the calling thread and then on the job
+threads, and checks that both give the same output. Only the dynamic jobs test triangles,
+so they are timed again on their own for the triangle rate.
+
+benchmarkShadowVolumes <file> [iterations]
+====================
+*/
+void R_BenchmarkShadowVolumes_f( const idCmdArgs & args ) {
+	if ( args.Argc() < 2 ) {
+		common->Printf( "usage: benchmarkShadowVolumes <file> [iterations]\n" );
+		return;
+	}
+
+	idStr fileName = args.Argv( 1 );
+	fileName.DefaultFileExtension( ".shadowjobs" );
+	const int iterations = ( args.Argc() > 2 ) ? idMath::ClampInt( 1, 10000, atoi( args.Argv( 2 ) ) ) : 32;
+
+	idFileLocal file( fileSystem->OpenFileRead( fileName ) );
+	if ( file == NULL ) {
+		common->Printf( "couldn't open %s\n", fileName.c_str() );
+		return;
+	}
+
+	int magic = 0;
+	int version = 0;
+	int drawVertSize = 0;
+	int shadowVertSize = 0;
+	int indexSize = 0;
+	int jointSize = 0;
+	file->ReadInt( magic );
+	file->ReadInt( version );
+	file->ReadInt( drawVertSize );
+	file->ReadInt( shadowVertSize );
+	file->ReadInt( indexSize );
+	file->ReadInt( jointSize );
+	if ( magic != SHADOW_CAPTURE_MAGIC || version != SHADOW_CAPTURE_VERSION ) {
+		common->Printf( "%s is not a shadow volume capture\n", fileName.c_str() );
+		return;
+	}
+	if ( drawVertSize != sizeof( idDrawVert ) || shadowVertSize != sizeof( idShadowVert ) || indexSize != sizeof( triIndex_t ) || jointSize != sizeof( idJointMat ) ) {
+		common->Printf( "%s was captured with a different vertex layout\n", fileName.c_str() );
+		return;
+	}
+
+	idList< idShadowBenchJob * > jobs;
+	int numJobsOfType[SHADOW_CAPTURE_DYNAMIC + 1] = { 0 };
+	bool ok = true;
+	while ( ok ) {
+		// a capture that was cut short has no end marker
+		int type = SHADOW_CAPTURE_END;
+		if ( file->ReadInt( type ) != sizeof( type ) ) {
+			ok = false;
+			break;
+		}
+		if ( type == SHADOW_CAPTURE_END ) {
+			break;
+		}
+		if ( type < SHADOW_CAPTURE_PRELIGHT || type > SHADOW_CAPTURE_DYNAMIC ) {
+			ok = false;
+			break;
+		}
+		idShadowBenchJob * job = new (TAG_TEMP) idShadowBenchJob;
+		jobs.Append( job );
+		ok = job->Read( file, (shadowCaptureType_t)type );
+		numJobsOfType[type]++;
+	}
+	if ( !ok ) {
+		common->Printf( "%s is damaged\n", fileName.c_str() );
+		jobs.DeleteContents();
+		return;
+	}
+	if ( jobs.Num() == 0 ) {
+		common->Printf( "no shadow volume jobs in %s\n", fileName.c_str() );
+		return;
+	}
+
+	// run the jobs on the calling thread
+	const int64 serialMicroSec = R_RunShadowBenchJobs( jobs, NULL, iterations );
+
+	idList< unsigned int > checksums;
+	checksums.SetNum( jobs.Num() );
+
+	int numTriangles = 0;
+	int numLightCulled = 0;
+	int numSilEdges = 0;
+	int numShadowIndices = 0;
+	int numZFail = 0;
+	for ( int i = 0; i < jobs.Num(); i++ ) {
+		const idShadowBenchJob * job = jobs[i];
+		checksums[i] = job->Checksum();
+		numTriangles += job->numTriangles;
+		numShadowIndices += job->numShadowIndices;
+		numZFail += job->renderZFail ? 1 : 0;
+		if ( job->lightIndices != NULL ) {
+			numLightCulled += job->numTriangles - job->numLightIndices / 3;
+		}
+		if ( job->shadowIndices != NULL ) {
+			numSilEdges += R_CountSilhouetteEdges( job->shadowIndices, job->numShadowIndices );
+		}
+	}
+
+	// run the same jobs on the job threads
+	idParallelJobList * jobList = parallelJobManager->AllocJobList( JOBLIST_UTILITY, JOBLIST_PRIORITY_MEDIUM, jobs.Num(), 0, NULL );
+	const int64 parallelMicroSec = R_RunShadowBenchJobs( jobs, jobList, iterations );
+
+	// the dynamic jobs on their own, both ways
+	idList< idShadowBenchJob * > dynamicJobs;
+	for ( int i = 0; i < jobs.Num(); i++ ) {
+		if ( jobs[i]->type == SHADOW_CAPTURE_DYNAMIC ) {
+			dynamicJobs.Append( jobs[i] );
+		}
+	}
+	int64 dynamicSerialMicroSec = 1;
+	int64 dynamicParallelMicroSec = 1;
+	if ( dynamicJobs.Num() > 0 ) {
+		dynamicSerialMicroSec = R_RunShadowBenchJobs( dynamicJobs, NULL, iterations );
+		dynamicParallelMicroSec = R_RunShadowBenchJobs( dynamicJobs, jobList, iterations );
+	}
+	parallelJobManager->FreeJobList( jobList );
+
+	int numMismatches = 0;
+	for ( int i = 0; i < jobs.Num(); i++ ) {
+		if ( jobs[i]->Checksum() != checksums[i] ) {
+			numMismatches++;
+		}
+	}
+
+	// triangles per microsecond is millions of triangles per second
+	const float serialRate = (float)numTriangles * iterations / dynamicSerialMicroSec;
+	const float parallelRate = (float)numTriangles * iterations / dynamicParallelMicroSec;
+
+	common->Printf( "%s: %i pre-light, %i static, %i dynamic shadow volume jobs, %i iterations, %i processing units\n", fileName.c_str(),
+		numJobsOfType[SHADOW_CAPTURE_PRELIGHT], numJobsOfType[SHADOW_CAPTURE_STATIC], numJobsOfType[SHADOW_CAPTURE_DYNAMIC],
+		iterations, parallelJobManager->GetNumProcessingUnits() );
+	common->Printf( "%i triangles tested, %i culled to the light, %i silhouette edges, %i shadow indices, %i z-fail\n",
+		numTriangles, numLightCulled, numSilEdges, numShadowIndices, numZFail );
+	common->Printf( "               msec/run   dynamic msec/run    Mtris/s\n" );
+	common->Printf( "serial      %11.3f %18.3f %10.1f\n", serialMicroSec * 0.001f / iterations, dynamicSerialMicroSec * 0.001f / iterations, serialRate );
+	common->Printf( "jobs        %11.3f %18.3f %10.1f\n", parallelMicroSec * 0.001f / iterations, dynamicParallelMicroSec * 0.001f / iterations, parallelRate );
+	if ( numMismatches > 0 ) {
+		common->Printf( "%i jobs gave a different result on the job threads\n", numMismatches );
+	}
+
+	jobs.DeleteContents();
+}
@@ -504,6 +504,10 @@ void R_AddLights() {
 	// Add jobs to setup pre-light shadow volumes.
 	//-------------------------------------------------
 
+	if ( tr.shadowVolumeCapture != NULL ) {
+		R_CapturePreLightShadowVolumes( tr.viewDef->viewLights );
+	}
+
 	if ( r_useParallelAddShadows.GetInteger() == 1 ) {
 		for ( viewLight_t * vLight = tr.viewDef->viewLights; vLight != NULL; vLight = vLight->next ) {
 			for ( preLightShadowVolumeParms_t * shadowParms = vLight->preLightShadowVolumes; shadowParms != NULL; shadowParms = shadowParms->next ) {
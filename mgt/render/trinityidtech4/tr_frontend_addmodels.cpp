@@ -1026,6 +1026,10 @@ void R_AddModels() {
 	// Kick off jobs to setup static and dynamic shadow volumes.
 	//-------------------------------------------------
 
+	if ( tr.shadowVolumeCapture != NULL ) {
+		R_CaptureShadowVolumes( tr.viewDef->viewEntitys );
+	}
+
 	if ( r_useParallelAddShadows.GetInteger() == 1 ) {
 		for ( viewEntity_t * vEntity = tr.viewDef->viewEntitys; vEntity != NULL; vEntity = vEntity->next ) {
 			for ( staticShadowVolumeParms_t * shadowParms = vEntity->staticShadowVolumes; shadowParms != NULL; shadowParms = shadowParms->next ) {
@@ -584,6 +584,8 @@ struct performanceCounters_t {
 	int		c_deformedSurfaces;	// idMD5Mesh::GenerateSurface
 	int		c_deformedVerts;	// idMD5Mesh::GenerateSurface
 	int		c_deformedIndexes;	// idMD5Mesh::GenerateSurface
+	idSysInterlockedInteger	c_skinnedVerts;		// idMD5Mesh::UpdateSurface, skinned on the cpu
+	idSysInterlockedInteger	skinMicroSec;		// idRenderModelMD5::InstantiateDynamicModel, summed over the job threads
 	int		c_tangentIndexes;	// R_DeriveTangents()
 	int		c_entityUpdates;
 	int		c_lightUpdates;
@@ -813,6 +815,10 @@ public:
 	drawSurf_t				testImageSurface_;
 
 	idParallelJobList *		frontEndJobList;
+	idParallelJobList *		dxtJobList;			// for splitting up image compression
+
+	idFile *				shadowVolumeCapture;		// captureShadowVolumes writes the shadow volume jobs of the next view here
+	int						shadowVolumeCaptureCount;
 
 	unsigned				timerQueryId;		// for GL_TIME_ELAPSED_EXT queries
 };
@@ -1148,6 +1154,20 @@ void R_LinkDrawSurfToView( drawSurf_t * drawSurf, viewDef_t * viewDef );
 
 void R_AddModels();
 
+/*
+============================================================
+
+SHADOWVOLUMEBENCHMARK
+
+============================================================
+*/
+
+void R_CapturePreLightShadowVolumes( const viewLight_t * viewLights );
+void R_CaptureShadowVolumes( const viewEntity_t * viewEntitys );
+void R_FinishShadowVolumeCapture();
+void R_CaptureShadowVolumes_f( const idCmdArgs & args );
+void R_BenchmarkShadowVolumes_f( const idCmdArgs & args );
+
 /*
 =============================================================
 